@@ -0,0 +1,40 @@
+#version 450
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+    mat4 cascade_view_proj[4];
+    vec4 cascade_splits;
+} ubo;
+
+// 与render_system.hpp中的GpuObjectData保持一致，通过firstInstance传入的gl_InstanceIndex索引
+struct ObjectData {
+    mat4 model;
+    vec4 position_scale;
+    vec4 position_offset;
+    vec4 bounding_sphere;
+    uvec2 lod_ranges[5];
+    float lod_errors[5];
+    uint lod_count;
+    uint material_index;
+    int vertex_offset;
+    uint draw_batch;
+    uint draw_slot;
+    uint batch_first_slot;
+};
+
+layout(std430, binding = 1) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+
+layout(location = 0) in vec3 in_position;
+
+// 与shading.vert的计算方式保持一致，保证shading pass中EQUAL深度测试能够通过
+invariant gl_Position;
+
+void main() {
+    ObjectData object = objects[gl_InstanceIndex];
+    vec3 position = in_position * object.position_scale.xyz + object.position_offset.xyz;
+    vec4 world_pos = object.model * vec4(position, 1.0);
+    gl_Position = ubo.proj * ubo.view * world_pos;
+}
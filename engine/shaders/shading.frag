@@ -1,56 +1,164 @@
 #version 450
 
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+    mat4 cascade_view_proj[4];
+    vec4 cascade_splits;// 各cascade远端在相机空间中的深度
+    vec4 light_position;
+    vec4 camera_position;
+    vec4 shadow_params;// x为阴影比较时的深度偏移
+}
+ubo;
+
 layout(binding = 1) uniform sampler2D texSampler;
-layout(binding = 2) uniform sampler2D shadow_map_sampler;
+layout(binding = 2) uniform sampler2DArrayShadow shadow_map_sampler;// 第i层为第i个cascade，比较采样器
+
+// 与clustered_lighting.hpp中的PointLight、ClusterUniforms保持一致
+struct PointLight {
+    vec4 position_radius;// 世界空间，w为影响半径
+    vec4 color_intensity;
+};
+
+layout(std430, binding = 4) readonly buffer LightBuffer {
+    PointLight lights[];
+};
+
+layout(std430, binding = 5) readonly buffer ClusterLightCountBuffer {
+    uint cluster_light_counts[];
+};
+
+layout(std430, binding = 6) readonly buffer ClusterLightIndexBuffer {
+    uint cluster_light_indices[];
+};
+
+layout(std140, binding = 7) uniform ClusterUniforms {
+    mat4 view;
+    mat4 inv_proj;
+    uvec4 grid_size;   // xyz为各维度的froxel数，w为光源数
+    vec4 screen_params;// xy为shading pass的分辨率，z、w为近平面与远平面
+}
+clusters;
+
+const uint max_lights_per_cluster = 128;
 
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
 layout(location = 2) in vec3 frag_normal;
-layout(location = 3) in vec4 light_proj_pos;
+layout(location = 3) in float view_depth;
 
 layout(location = 4) in vec3 frag_world_pos;
 
 layout(location = 0) out vec4 outColor;
 
-float CalculateShadowAtPos(vec4 in_light_proj_pos, vec2 offset) {
-    // 执行透视除法
-    vec3 light_proj_coords = in_light_proj_pos.xyz / in_light_proj_pos.w;
-    // 变换到[0,1]的范围
-    vec2 shadow_tex_uv = light_proj_coords.xy * 0.5 + vec2(0.5, 0.5);
-    // 反转y轴
-    shadow_tex_uv.y = -shadow_tex_uv.y;
-    // 取得最近点的深度(使用[0,1]范围下的fragPosLight当坐标)
-    float closest_depth = texture(shadow_map_sampler, shadow_tex_uv + offset).r;
-    // 取得当前片段在光源视角下的深度
-    float current_depth = light_proj_coords.z;
-    // 检查当前片段是否在阴影中
-    float shadow = current_depth - 0.005 >= closest_depth ? 0.90 : 0.0;
-
-    return shadow;
+// 选择覆盖当前片段的最精细的cascade，超出最后一个cascade时返回-1
+int SelectCascade() {
+    for (int i = 0; i < 4; i++) {
+        if (view_depth < ubo.cascade_splits[i]) { return i; }
+    }
+    return -1;
 }
 
-float Pcf(vec4 in_light_proj_pos) {
-    ivec2 tex_dim = textureSize(shadow_map_sampler, 0);
-    float scale = 1.0;
-    float dx = scale * 1.0 / float(tex_dim.x);
-    float dy = scale * 1.0 / float(tex_dim.y);
+// 以下常量由RenderSystem按shading变体以specialization constant传入，默认值只在未指定时使用
+// 阴影过滤kernel，与ShadowFilter对应：0为一次硬件2x2 PCF，1、2为拟合3x3、5x5 tent kernel的优化PCF，3为poisson disk
+layout(constant_id = 0) const int shadow_filter = 1;
+// poisson disk的采样数，不超过16
+layout(constant_id = 1) const int poisson_tap_count = 8;
+layout(constant_id = 2) const bool enable_shadows = true;
+layout(constant_id = 3) const bool enable_clustered_lighting = true;
+
+const float shadow_intensity = 0.90;
+const float poisson_radius = 1.5;// 以texel为单位
+
+const vec2 poisson_disk[16] = vec2[](
+    vec2(-0.94201624, -0.39906216), vec2(0.94558609, -0.76890725), vec2(-0.09418410, -0.92938870),
+    vec2(0.34495938, 0.29387760), vec2(-0.91588581, 0.45771432), vec2(-0.81544232, -0.87912464),
+    vec2(-0.38277543, 0.27676845), vec2(0.97484398, 0.75648379), vec2(0.44323325, -0.97511554),
+    vec2(0.53742981, -0.47373420), vec2(-0.26496911, -0.41893023), vec2(0.79197514, 0.19090188),
+    vec2(-0.24188840, 0.99706507), vec2(-0.81409955, 0.91437590), vec2(0.19984126, 0.78641367),
+    vec2(0.14383161, -0.14100790));
+
+// 一次比较采样，返回受光的比例，采样器开启线性过滤时硬件对周围2x2个texel的比较结果做双线性插值
+float SampleShadow(vec2 uv, int cascade, float reference_depth) {
+    return texture(shadow_map_sampler, vec4(uv, cascade, reference_depth));
+}
+
+// 将多个双线性比较采样加权组合为更大的tent kernel，N x N的kernel只需((N + 1) / 2)^2次采样
+float OptimizedPcf(vec2 uv, int cascade, float reference_depth, vec2 texel_size) {
+    vec2 texel_uv = uv / texel_size;
+    vec2 base_uv = floor(texel_uv + 0.5);
+    float s = texel_uv.x + 0.5 - base_uv.x;
+    float t = texel_uv.y + 0.5 - base_uv.y;
+    base_uv = (base_uv - 0.5) * texel_size;
+
+    float sum = 0.0;
+    if (shadow_filter == 1) {
+        vec2 uw = vec2(3.0 - 2.0 * s, 1.0 + 2.0 * s);
+        vec2 u = vec2((2.0 - s) / uw.x - 1.0, s / uw.y + 1.0);
+        vec2 vw = vec2(3.0 - 2.0 * t, 1.0 + 2.0 * t);
+        vec2 v = vec2((2.0 - t) / vw.x - 1.0, t / vw.y + 1.0);
+
+        for (int y = 0; y < 2; y++) {
+            for (int x = 0; x < 2; x++) {
+                vec2 offset = vec2(u[x], v[y]) * texel_size;
+                sum += uw[x] * vw[y] * SampleShadow(base_uv + offset, cascade, reference_depth);
+            }
+        }
+        return sum / 16.0;
+    }
 
-    float shadow_factor = 0.0;
-    int count = 0;
-    int range = 1;
+    vec3 uw = vec3(4.0 - 3.0 * s, 7.0, 1.0 + 3.0 * s);
+    vec3 u = vec3((3.0 - 2.0 * s) / uw.x - 2.0, (3.0 + s) / uw.y, s / uw.z + 2.0);
+    vec3 vw = vec3(4.0 - 3.0 * t, 7.0, 1.0 + 3.0 * t);
+    vec3 v = vec3((3.0 - 2.0 * t) / vw.x - 2.0, (3.0 + t) / vw.y, t / vw.z + 2.0);
 
-    for (int x = -range; x <= range; x++) {
-        for (int y = -range; y <= range; y++) {
-            shadow_factor += CalculateShadowAtPos(in_light_proj_pos, vec2(dx * x, dy * y));
-            count++;
+    for (int y = 0; y < 3; y++) {
+        for (int x = 0; x < 3; x++) {
+            vec2 offset = vec2(u[x], v[y]) * texel_size;
+            sum += uw[x] * vw[y] * SampleShadow(base_uv + offset, cascade, reference_depth);
         }
     }
-    return shadow_factor / count;
+    return sum / 144.0;
+}
+
+float PoissonPcf(vec2 uv, int cascade, float reference_depth, vec2 texel_size) {
+    int tap_count = clamp(poisson_tap_count, 1, 16);
+    float sum = 0.0;
+    for (int i = 0; i < tap_count; i++) {
+        sum += SampleShadow(uv + poisson_disk[i] * poisson_radius * texel_size, cascade, reference_depth);
+    }
+    return sum / float(tap_count);
+}
+
+// 返回阴影的强度，0为完全受光
+float Pcf() {
+    if (!enable_shadows) { return 0.0; }
+
+    int cascade = SelectCascade();
+    if (cascade < 0) { return 0.0; }
+
+    // 正交投影，不需要透视除法
+    vec3 light_proj_coords = (ubo.cascade_view_proj[cascade] * vec4(frag_world_pos, 1.0)).xyz;
+    // 阴影渲染时使用了负高度的视口，NDC的y向上对应图像的第0行在顶部
+    vec2 uv = vec2(light_proj_coords.x * 0.5 + 0.5, 0.5 - light_proj_coords.y * 0.5);
+    float reference_depth = light_proj_coords.z - ubo.shadow_params.x;
+    vec2 texel_size = 1.0 / vec2(textureSize(shadow_map_sampler, 0).xy);
+
+    // shadow_filter为常量，编译pipeline时未选中的分支会被消除
+    float lit;
+    if (shadow_filter == 0) {
+        lit = SampleShadow(uv, cascade, reference_depth);
+    } else if (shadow_filter == 3) {
+        lit = PoissonPcf(uv, cascade, reference_depth, texel_size);
+    } else {
+        lit = OptimizedPcf(uv, cascade, reference_depth, texel_size);
+    }
+    return (1.0 - lit) * shadow_intensity;
 }
 
 vec3 BlinnPhong(vec3 ka, vec3 kd, vec3 ks, float p) {
-    vec3 light_pos = vec3(-2.0f, 2.0f, 2.0f);
-    vec3 eye_pos = vec3(2.0f, 1.5f, 2.0f);
+    vec3 light_pos = ubo.light_position.xyz;
+    vec3 eye_pos = ubo.camera_position.xyz;
     
     // ambient
     vec3 ambient_color = ka;
@@ -70,9 +178,47 @@ vec3 BlinnPhong(vec3 ka, vec3 kd, vec3 ks, float p) {
     return ambient_color + diffuse_color + specular_color;
 }
 
+// 片段所在froxel中的点光源，froxel的划分与light_cull.comp一致
+vec3 ClusteredPointLights(vec3 kd, vec3 ks, float p) {
+    if (!enable_clustered_lighting) { return vec3(0.0); }
+
+    uvec3 grid = clusters.grid_size.xyz;
+    vec2 tile_size = clusters.screen_params.xy / vec2(grid.xy);
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / tile_size), grid.xy - 1);
+    float near_plane = clusters.screen_params.z;
+    float far_plane = clusters.screen_params.w;
+    float slice = log(view_depth / near_plane) / log(far_plane / near_plane) * float(grid.z);
+    uint z = uint(clamp(slice, 0.0, float(grid.z - 1)));
+    uint cluster_index = tile.x + tile.y * grid.x + z * grid.x * grid.y;
+
+    vec3 eye_pos = ubo.camera_position.xyz;
+    vec3 normal = normalize(frag_normal);
+    vec3 view_dir = normalize(eye_pos - frag_world_pos);
+
+    vec3 color = vec3(0.0);
+    uint light_count = cluster_light_counts[cluster_index];
+    for (uint i = 0; i < light_count; i++) {
+        PointLight light = lights[cluster_light_indices[cluster_index * max_lights_per_cluster + i]];
+        vec3 to_light = light.position_radius.xyz - frag_world_pos;
+        float distance = length(to_light);
+        // 在影响半径处平滑衰减到0，与剔除使用的半径一致
+        float window = clamp(1.0 - pow(distance / light.position_radius.w, 4.0), 0.0, 1.0);
+        float attenuation = window * window / (distance * distance + 1.0);
+
+        vec3 light_dir = to_light / max(distance, 1e-4);
+        vec3 half_dir = normalize(light_dir + view_dir);
+        vec3 diffuse_color = kd * max(dot(light_dir, normal), 0.0);
+        vec3 specular_color = ks * pow(max(dot(half_dir, normal), 0.0), p);
+        color += (diffuse_color + specular_color) * light.color_intensity.rgb * light.color_intensity.w * attenuation;
+    }
+    return color;
+}
+
 //TODO(PBR)
 void main() { 
-    outColor = vec4((1 - Pcf(light_proj_pos)) 
-             * BlinnPhong(vec3(0.005, 0.005, 0.005), vec3(0.8, 0.8, 0.8), vec3(0.8, 0.8, 0.8), 32.0) 
-             * texture(texSampler, fragTexCoord).rgb, 1.0); 
+    vec3 kd = vec3(0.8, 0.8, 0.8);
+    vec3 ks = vec3(0.8, 0.8, 0.8);
+    vec3 lighting = (1 - Pcf()) * BlinnPhong(vec3(0.005, 0.005, 0.005), kd, ks, 32.0)
+                  + ClusteredPointLights(kd, ks, 32.0);
+    outColor = vec4(lighting * texture(texSampler, fragTexCoord).rgb, 1.0); 
 }
@@ -1,13 +1,33 @@
 #version 450
 
 layout(binding = 0) uniform UniformBufferObject {
-    mat4 model;
     mat4 view;
     mat4 proj;
-    mat4 light_view_proj;
+    mat4 cascade_view_proj[4];
+    vec4 cascade_splits;
 }
 ubo;
 
+// 与render_system.hpp中的GpuObjectData保持一致，通过firstInstance传入的gl_InstanceIndex索引
+struct ObjectData {
+    mat4 model;
+    vec4 position_scale;
+    vec4 position_offset;
+    vec4 bounding_sphere;
+    uvec2 lod_ranges[5];
+    float lod_errors[5];
+    uint lod_count;
+    uint material_index;
+    int vertex_offset;
+    uint draw_batch;
+    uint draw_slot;
+    uint batch_first_slot;
+};
+
+layout(std430, binding = 3) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+
 layout(location = 0) in vec3 in_position;
 layout(location = 1) in vec3 in_color;
 layout(location = 2) in vec3 in_normal;
@@ -16,18 +36,24 @@ layout(location = 3) in vec2 in_texcoord;
 layout(location = 0) out vec3 frag_color;
 layout(location = 1) out vec2 frag_tex_coord;
 layout(location = 2) out vec3 frag_normal;
-layout(location = 3) out vec4 light_proj_pos;
+layout(location = 3) out float view_depth;// 相机空间中的深度，用于选择cascade
 
 layout(location = 4) out vec3 world_position;
 
+// 开启depth pre-pass时shading pass使用EQUAL深度测试，需与depth_prepass.vert得到完全一致的深度
+invariant gl_Position;
+
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(in_position, 1.0);
-    world_position = in_position;
+    ObjectData object = objects[gl_InstanceIndex];
+    vec3 position = in_position * object.position_scale.xyz + object.position_offset.xyz;
+    vec4 world_pos = object.model * vec4(position, 1.0);
+    gl_Position = ubo.proj * ubo.view * world_pos;
+    world_position = world_pos.xyz;
 
     frag_color = in_color;
     frag_tex_coord = in_texcoord;
 
     //TODO(处理非均匀缩放问题)
-    frag_normal = (ubo.model * vec4(in_normal, 0.0)).xyz;
-    light_proj_pos = ubo.light_view_proj * ubo.model * vec4(in_position, 1.0);
+    frag_normal = (object.model * vec4(in_normal, 0.0)).xyz;
+    view_depth = -(ubo.view * world_pos).z;
 }
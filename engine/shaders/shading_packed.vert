@@ -0,0 +1,67 @@
+#version 450
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+    mat4 cascade_view_proj[4];
+    vec4 cascade_splits;
+}
+ubo;
+
+// 与render_system.hpp中的GpuObjectData保持一致，通过firstInstance传入的gl_InstanceIndex索引
+struct ObjectData {
+    mat4 model;
+    vec4 position_scale;
+    vec4 position_offset;
+    vec4 bounding_sphere;
+    uvec2 lod_ranges[5];
+    float lod_errors[5];
+    uint lod_count;
+    uint material_index;
+    int vertex_offset;
+    uint draw_batch;
+    uint draw_slot;
+    uint batch_first_slot;
+};
+
+layout(std430, binding = 3) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+
+// Packed格式：位置为相对包围盒的unorm16，法线为八面体编码的snorm16x2，uv为half，不含颜色
+layout(location = 0) in vec3 in_position;
+layout(location = 2) in vec2 in_normal;
+layout(location = 3) in vec2 in_texcoord;
+
+layout(location = 0) out vec3 frag_color;
+layout(location = 1) out vec2 frag_tex_coord;
+layout(location = 2) out vec3 frag_normal;
+layout(location = 3) out float view_depth;// 相机空间中的深度，用于选择cascade
+
+layout(location = 4) out vec3 world_position;
+
+// 开启depth pre-pass时shading pass使用EQUAL深度测试，需与depth_prepass.vert得到完全一致的深度
+invariant gl_Position;
+
+vec3 OctDecode(vec2 encoded) {
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float t = max(-normal.z, 0.0);
+    normal.x += normal.x >= 0.0 ? -t : t;
+    normal.y += normal.y >= 0.0 ? -t : t;
+    return normalize(normal);
+}
+
+void main() {
+    ObjectData object = objects[gl_InstanceIndex];
+    vec3 position = in_position * object.position_scale.xyz + object.position_offset.xyz;
+    vec4 world_pos = object.model * vec4(position, 1.0);
+    gl_Position = ubo.proj * ubo.view * world_pos;
+    world_position = world_pos.xyz;
+
+    frag_color = vec3(1.0);
+    frag_tex_coord = in_texcoord;
+
+    //TODO(处理非均匀缩放问题)
+    frag_normal = (object.model * vec4(OctDecode(in_normal), 0.0)).xyz;
+    view_depth = -(ubo.view * world_pos).z;
+}
@@ -1,17 +1,43 @@
 #version 450
 
 layout(binding = 0) uniform UniformBufferObject {
-    mat4 model;
     mat4 view;
     mat4 proj;
-    mat4 light_view_proj;
+    mat4 cascade_view_proj[4];
+    vec4 cascade_splits;
 } ubo;
 
+// 与render_system.hpp中的GpuObjectData保持一致，通过firstInstance传入的gl_InstanceIndex索引
+struct ObjectData {
+    mat4 model;
+    vec4 position_scale;
+    vec4 position_offset;
+    vec4 bounding_sphere;
+    uvec2 lod_ranges[5];
+    float lod_errors[5];
+    uint lod_count;
+    uint material_index;
+    int vertex_offset;
+    uint draw_batch;
+    uint draw_slot;
+    uint batch_first_slot;
+};
+
+layout(std430, binding = 1) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+
+// 与render_system.hpp中的ShadowPushConstants保持一致
+layout(push_constant) uniform ShadowPushConstants {
+    uint cascade_index;
+}
+shadow;
+
+// Packed格式下为相对包围盒的unorm16，Full格式下scale/offset为单位变换
 layout(location = 0) in vec3 in_position;
-layout(location = 1) in vec3 in_color;
-layout(location = 2) in vec3 in_normal;
-layout(location = 3) in vec2 in_texcoord;
 
 void main() {
-    gl_Position = ubo.light_view_proj * ubo.model * vec4(in_position, 1.0);
+    ObjectData object = objects[gl_InstanceIndex];
+    vec3 position = in_position * object.position_scale.xyz + object.position_offset.xyz;
+    gl_Position = ubo.cascade_view_proj[shadow.cascade_index] * object.model * vec4(position, 1.0);
 }
@@ -0,0 +1,84 @@
+#version 450
+
+layout(binding = 0) uniform sampler2D scene_color;
+
+// 与render_system.hpp中的UpscalePushConstants保持一致
+layout(push_constant) uniform UpscalePushConstants {
+    vec2 uv_scale; // 渲染区域占scene color的比例，场景只渲染在左上角
+    float sharpness;// 0为只做双线性放大
+}
+upscale;
+
+// 后处理抗锯齿，作为MSAA的低开销替代
+layout(constant_id = 0) const bool enable_fxaa = false;
+
+layout(location = 0) in vec2 uv;
+
+layout(location = 0) out vec4 out_color;
+
+vec2 texel_size;
+
+// 限制在渲染区域内，双线性过滤不会取到区域外的旧内容
+vec3 SampleScene(vec2 scene_uv) {
+    return texture(scene_color, clamp(scene_uv, texel_size * 0.5, upscale.uv_scale - texel_size * 0.5)).rgb;
+}
+
+// scene color为sRGB格式，采样得到线性值，开方近似回到感知亮度
+float Luma(vec3 color) {
+    return dot(sqrt(color), vec3(0.299, 0.587, 0.114));
+}
+
+// 按对角四个样本的亮度梯度估计边缘方向，沿边缘方向采样混合；按scene color的texel偏移，先抗锯齿后放大
+vec3 Fxaa(vec2 scene_uv, vec3 center) {
+    float luma_nw = Luma(SampleScene(scene_uv + vec2(-1.0, -1.0) * texel_size));
+    float luma_ne = Luma(SampleScene(scene_uv + vec2(1.0, -1.0) * texel_size));
+    float luma_sw = Luma(SampleScene(scene_uv + vec2(-1.0, 1.0) * texel_size));
+    float luma_se = Luma(SampleScene(scene_uv + vec2(1.0, 1.0) * texel_size));
+    float luma_m = Luma(center);
+
+    float luma_min = min(luma_m, min(min(luma_nw, luma_ne), min(luma_sw, luma_se)));
+    float luma_max = max(luma_m, max(max(luma_nw, luma_ne), max(luma_sw, luma_se)));
+    // 对比度低的区域不是边缘
+    if (luma_max - luma_min < max(0.0312, luma_max * 0.125)) { return center; }
+
+    vec2 dir = vec2(-((luma_nw + luma_ne) - (luma_sw + luma_se)), (luma_nw + luma_sw) - (luma_ne + luma_se));
+    float dir_reduce = max((luma_nw + luma_ne + luma_sw + luma_se) * (0.25 / 8.0), 1.0 / 128.0);
+    float inv_dir_min = 1.0 / (min(abs(dir.x), abs(dir.y)) + dir_reduce);
+    dir = clamp(dir * inv_dir_min, vec2(-8.0), vec2(8.0)) * texel_size;
+
+    vec3 rgb_a =
+            0.5 * (SampleScene(scene_uv + dir * (1.0 / 3.0 - 0.5)) + SampleScene(scene_uv + dir * (2.0 / 3.0 - 0.5)));
+    vec3 rgb_b = rgb_a * 0.5 + 0.25 * (SampleScene(scene_uv - dir * 0.5) + SampleScene(scene_uv + dir * 0.5));
+    // 较远的两个样本越过了边缘时只使用较近的结果
+    float luma_b = Luma(rgb_b);
+    return (luma_b < luma_min || luma_b > luma_max) ? rgb_a : rgb_b;
+}
+
+void main() {
+    texel_size = 1.0 / vec2(textureSize(scene_color, 0));
+    vec2 scene_uv = clamp(uv * upscale.uv_scale, texel_size * 0.5, upscale.uv_scale - texel_size * 0.5);
+
+    vec3 center = texture(scene_color, scene_uv).rgb;
+    if (enable_fxaa) {
+        // 锐化会重新放大被平滑的边缘，开启FXAA时不再锐化
+        out_color = vec4(Fxaa(scene_uv, center), 1.0);
+        return;
+    }
+    if (upscale.sharpness <= 0.0) {
+        out_color = vec4(center, 1.0);
+        return;
+    }
+
+    // 十字形邻域的unsharp mask，结果限制在邻域的范围内以避免边缘出现光晕
+    vec3 left = SampleScene(scene_uv - vec2(texel_size.x, 0.0));
+    vec3 right = SampleScene(scene_uv + vec2(texel_size.x, 0.0));
+    vec3 up = SampleScene(scene_uv - vec2(0.0, texel_size.y));
+    vec3 down = SampleScene(scene_uv + vec2(0.0, texel_size.y));
+
+    vec3 neighbor_min = min(min(min(left, right), min(up, down)), center);
+    vec3 neighbor_max = max(max(max(left, right), max(up, down)), center);
+    vec3 blurred = (left + right + up + down) * 0.25;
+    vec3 sharpened = center + (center - blurred) * upscale.sharpness;
+
+    out_color = vec4(clamp(sharpened, neighbor_min, neighbor_max), 1.0);
+}
@@ -8,6 +8,8 @@ void Engine::Init() { m_render_system = std::make_unique<rendering::RenderSystem
 
 void Engine::Run() {
     while (!m_render_system->ShouldCloseWindow()) {
+        // 限帧的等待放在采样输入之前，输入到提交之间不包含等待时间
+        m_render_system->WaitForNextFrame();
         float delta_time = CalculateDeltaTime();
         glfwPollEvents();
         m_render_system->Tick(delta_time);
@@ -0,0 +1,86 @@
+#include "job_system.hpp"
+
+namespace saturn {
+
+JobSystem::JobSystem() {
+    auto hardware_threads = std::thread::hardware_concurrency();
+    auto worker_count = hardware_threads > 1 ? hardware_threads - 1 : 1;
+
+    m_workers.reserve(worker_count);
+    for (uint32_t i = 0; i < worker_count; ++i) { m_workers.emplace_back([this]() { WorkerLoop(); }); }
+
+    ENGINE_LOG_INFO("Job system started with {} worker threads", worker_count);
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_stop = true;
+    }
+    m_condition.notify_all();
+    for (auto &worker: m_workers) { worker.join(); }
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t batch_size,
+                            const std::function<void(uint32_t, uint32_t)> &func) {
+    if (count == 0) { return; }
+    batch_size = std::max(batch_size, 1u);
+    uint32_t batch_count = (count + batch_size - 1) / batch_size;
+
+    // 批次很少时直接在调用线程上执行，避免唤醒工作线程的开销
+    if (batch_count == 1 || m_workers.empty()) {
+        func(0, count);
+        return;
+    }
+
+    // 工作线程可能在ParallelFor返回后才开始执行，此时已没有剩余批次，不会再访问func
+    struct SharedState {
+        std::atomic<uint32_t> m_next_batch{0};
+        std::atomic<uint32_t> m_finished_batches{0};
+        const std::function<void(uint32_t, uint32_t)> *m_func = nullptr;
+        uint32_t m_count = 0;
+        uint32_t m_batch_size = 0;
+        uint32_t m_batch_count = 0;
+    };
+    auto state = std::make_shared<SharedState>();
+    state->m_func = &func;
+    state->m_count = count;
+    state->m_batch_size = batch_size;
+    state->m_batch_count = batch_count;
+
+    auto run_batches = [state]() {
+        uint32_t batch = 0;
+        while ((batch = state->m_next_batch.fetch_add(1)) < state->m_batch_count) {
+            uint32_t begin = batch * state->m_batch_size;
+            uint32_t end = std::min(begin + state->m_batch_size, state->m_count);
+            (*state->m_func)(begin, end);
+            state->m_finished_batches.fetch_add(1, std::memory_order_release);
+        }
+    };
+
+    auto helper_count = std::min(static_cast<uint32_t>(m_workers.size()), batch_count - 1);
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        for (uint32_t i = 0; i < helper_count; ++i) { m_jobs.emplace_back(run_batches); }
+    }
+    m_condition.notify_all();
+
+    run_batches();
+    while (state->m_finished_batches.load(std::memory_order_acquire) < batch_count) { std::this_thread::yield(); }
+}
+
+void JobSystem::WorkerLoop() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock{m_mutex};
+            m_condition.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+            if (m_stop && m_jobs.empty()) { return; }
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+        job();
+    }
+}
+
+}// namespace saturn
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <engine_pch.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace saturn {
+
+/**
+ * @brief 固定数量工作线程的线程池，线程数为硬件线程数减一，调用线程同样参与执行
+ */
+class JobSystem {
+public:
+    static auto Ins() -> JobSystem & {
+        static JobSystem ins;
+        return ins;
+    }
+
+    JobSystem(const JobSystem &job_system) = delete;
+    auto operator=(const JobSystem &job_system) -> JobSystem & = delete;
+    ~JobSystem();
+
+    /**
+     * @brief 将[0, count)按batch_size切分为多个批次并行执行，返回时所有批次都已完成
+     * @param func 处理[begin, end)范围的函数，会在多个线程上同时调用
+     */
+    void ParallelFor(uint32_t count, uint32_t batch_size, const std::function<void(uint32_t, uint32_t)> &func);
+
+    [[nodiscard]] auto GetWorkerCount() const -> uint32_t { return static_cast<uint32_t>(m_workers.size()); }
+
+private:
+    JobSystem();
+
+    void WorkerLoop();
+
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void()>> m_jobs;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stop = false;
+};
+
+}// namespace saturn
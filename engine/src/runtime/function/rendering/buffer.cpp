@@ -24,19 +24,24 @@ auto Buffer::CalculateAlignment(VkDeviceSize instance_size, VkDeviceSize min_off
 
 Buffer::Buffer(std::shared_ptr<Device> render_device, VkDeviceSize instance_size, uint32_t instance_count,
                VkBufferUsageFlags usage_flags, VkMemoryPropertyFlags memory_property_flags,
-               VkDeviceSize min_offset_alignment)
+               VkDeviceSize min_offset_alignment, VkSharingMode sharing_mode)
     : m_render_device{std::move(render_device)}, m_instance_size{instance_size}, m_instance_count{instance_count},
       usageFlags{usage_flags}, memoryPropertyFlags{memory_property_flags} {
 
     m_alignment_size = CalculateAlignment(instance_size, min_offset_alignment);
     m_buffer_size = m_alignment_size * instance_count;
-    m_render_device->CreateBuffer(m_buffer_size, usage_flags, memory_property_flags, m_buffer, m_device_memory);
+    m_render_device->CreateBuffer(m_buffer_size, usage_flags, memory_property_flags, m_buffer, m_device_memory,
+                                  sharing_mode);
 }
 
 Buffer::~Buffer() {
     Unmap();
-    vkDestroyBuffer(m_render_device->GetVkDevice(), m_buffer, nullptr);
-    vkFreeMemory(m_render_device->GetVkDevice(), m_device_memory, nullptr);
+    // 在飞的帧可能仍在读写该buffer
+    m_render_device->GetDeletionQueue().Push(
+            [device = m_render_device->GetVkDevice(), buffer = m_buffer, device_memory = m_device_memory]() {
+                vkDestroyBuffer(device, buffer, nullptr);
+                vkFreeMemory(device, device_memory, nullptr);
+            });
 }
 
 /**
@@ -70,7 +75,7 @@ void Buffer::Unmap() {
  * @param offset (Optional) Byte offset from beginning of mapped region
  *
  */
-void Buffer::WriteToBuffer(void *data, VkDeviceSize size, VkDeviceSize offset) {
+void Buffer::WriteToBuffer(const void *data, VkDeviceSize size, VkDeviceSize offset) {
     SATURN_ASSERT(m_mapped_memory, "Cannot copy to unmapped buffer");
 
     if (size == VK_WHOLE_SIZE) {
@@ -142,7 +147,7 @@ auto Buffer::CreateDescriptorBufferInfo(VkDeviceSize size, VkDeviceSize offset)
  * @param index Used in offset calculation
  *
  */
-void Buffer::WriteToIndex(void *data, int index) { WriteToBuffer(data, m_instance_size, index * m_alignment_size); }
+void Buffer::WriteToIndex(const void *data, int index) { WriteToBuffer(data, m_instance_size, index * m_alignment_size); }
 
 /**
  *  Flush the memory range at index * alignmentSize of the buffer to make it visible to the device
@@ -12,9 +12,12 @@ namespace rendering {
 
 class Buffer {
 public:
+    /**
+     * @param sharing_mode 为CONCURRENT时由所有队列族共享，用于graphics与async compute、transfer队列都会访问的buffer
+     */
     Buffer(std::shared_ptr<Device> render_device, VkDeviceSize instance_size, uint32_t instance_count,
                  VkBufferUsageFlags usage_flags, VkMemoryPropertyFlags memory_property_flags,
-                 VkDeviceSize min_offset_alignment = 1);
+                 VkDeviceSize min_offset_alignment = 1, VkSharingMode sharing_mode = VK_SHARING_MODE_EXCLUSIVE);
     ~Buffer();
 
     Buffer(const Buffer &) = delete;
@@ -23,13 +26,13 @@ public:
     auto Map(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0) -> VkResult;
     void Unmap();
 
-    void WriteToBuffer(void *data, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+    void WriteToBuffer(const void *data, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
     auto Flush(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0) -> VkResult;
     auto CreateDescriptorBufferInfo(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0)
             -> VkDescriptorBufferInfo;
     auto Invalidate(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0) -> VkResult;
 
-    void WriteToIndex(void *data, int index);
+    void WriteToIndex(const void *data, int index);
     auto FlushIndex(int index) -> VkResult;
     auto CreateDescriptorBufferInfoForIndex(int index) -> VkDescriptorBufferInfo;
     auto InvalidateIndex(int index) -> VkResult;
@@ -0,0 +1,108 @@
+#include "cluster_culler.hpp"
+
+#include <runtime/core/job/job_system.hpp>
+#include <runtime/function/rendering/frustum.hpp>
+
+namespace saturn {
+
+namespace rendering {
+
+ClusterCuller::ClusterCuller(std::shared_ptr<Device> render_device, uint32_t frames_in_flight,
+                             uint32_t max_index_count)
+    : m_render_device{std::move(render_device)}, m_max_index_count{std::max(max_index_count, 1u)} {
+    m_index_buffers.resize(frames_in_flight);
+    for (auto &index_buffer: m_index_buffers) {
+        // CPU每帧写入、GPU只读一次，直接放在host visible的内存中
+        index_buffer = std::make_shared<Buffer>(
+                m_render_device, sizeof(uint32_t), m_max_index_count, VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        index_buffer->Map();
+    }
+}
+
+void ClusterCuller::BeginFrame(uint32_t frame_index) {
+    m_current_frame_index = frame_index;
+    m_write_offset = 0;
+    for (auto &draw_ranges: m_draw_ranges) { draw_ranges.clear(); }
+}
+
+void ClusterCuller::Cull(const std::vector<std::shared_ptr<RenderObject>> &render_objects, LodView lod_view,
+                         const CullView &cull_view) {
+    auto &draw_ranges = m_draw_ranges.at(static_cast<size_t>(lod_view));
+    auto &statistics = m_statistics.at(static_cast<size_t>(lod_view));
+    draw_ranges.assign(render_objects.size(), DrawRange{});
+    statistics = Statistics{};
+
+    auto planes = ExtractFrustumPlanes(cull_view.m_view_proj);
+    auto *mapped_indices = static_cast<uint32_t *>(GetIndexBuffer()->GetMappedMemory());
+
+    for (size_t object_index = 0; object_index < render_objects.size(); ++object_index) {
+        const auto &render_object = render_objects[object_index];
+        const auto &lod = render_object->GetLod(lod_view);
+        statistics.m_total_meshlets += lod.m_meshlet_count;
+
+        auto bounding_sphere = render_object->GetWorldBoundingSphere();
+        if (lod.m_meshlet_count == 0 ||
+            IsSphereOutsideFrustum(planes, glm::vec3(bounding_sphere), bounding_sphere.w)) {
+            continue;
+        }
+
+        const auto *meshlets = render_object->GetMeshlets().data() + lod.m_first_meshlet;
+        const auto &indices = render_object->GetIndices();
+        const auto &model_matrix = render_object->GetModelMatrix();
+        // 法线锥的轴按法线变换，非均匀缩放下仍然垂直于表面
+        auto normal_matrix = glm::transpose(glm::inverse(glm::mat3(model_matrix)));
+        // 开放的网格（如地板）从背面看时没有正面遮挡，光栅化又不剔除背面，只能对闭合的网格做锥剔除
+        bool cone_culling = cull_view.m_cone_culling && render_object->IsClosed();
+        float max_scale = render_object->GetMaxScale();
+
+        // 1. 并行判断每个meshlet是否可见
+        m_visibility.resize(lod.m_meshlet_count);
+        JobSystem::Ins().ParallelFor(lod.m_meshlet_count, kMeshletBatchSize, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i) {
+                const auto &meshlet = meshlets[i];
+                auto center = glm::vec3(model_matrix * glm::vec4(meshlet.m_center, 1.0f));
+                float radius = meshlet.m_radius * max_scale;
+
+                bool visible = !IsSphereOutsideFrustum(planes, center, radius);
+                // 整个包围球都位于法线锥的背面一侧时，meshlet中所有三角形都背对相机
+                if (visible && cone_culling && meshlet.m_cone_cutoff <= 1.0f) {
+                    auto axis = glm::normalize(normal_matrix * meshlet.m_cone_axis);
+                    auto to_center = center - cull_view.m_camera_position;
+                    visible = glm::dot(to_center, axis) < meshlet.m_cone_cutoff * glm::length(to_center) + radius;
+                }
+                m_visibility[i] = visible ? 1 : 0;
+            }
+        });
+
+        // 2. 前缀和得到每个可见meshlet在紧凑索引中的位置
+        m_index_offsets.resize(lod.m_meshlet_count);
+        uint32_t visible_index_count = 0;
+        for (uint32_t i = 0; i < lod.m_meshlet_count; ++i) {
+            m_index_offsets[i] = visible_index_count;
+            if (m_visibility[i] != 0) {
+                visible_index_count += meshlets[i].m_index_count;
+                ++statistics.m_visible_meshlets;
+            }
+        }
+        SATURN_ASSERT(m_write_offset + visible_index_count <= m_max_index_count,
+                      "Cluster culling index buffer overflow");
+
+        // 3. 并行拷贝可见meshlet的索引
+        auto *object_indices = mapped_indices + m_write_offset;
+        JobSystem::Ins().ParallelFor(lod.m_meshlet_count, kMeshletBatchSize, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i) {
+                if (m_visibility[i] == 0) { continue; }
+                std::memcpy(object_indices + m_index_offsets[i], indices.data() + meshlets[i].m_first_index,
+                            meshlets[i].m_index_count * sizeof(uint32_t));
+            }
+        });
+
+        draw_ranges[object_index] = {m_write_offset, visible_index_count};
+        m_write_offset += visible_index_count;
+    }
+}
+
+}// namespace rendering
+
+}// namespace saturn
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <engine_pch.hpp>
+#include <runtime/function/rendering/buffer.hpp>
+#include <runtime/function/rendering/device.hpp>
+#include <runtime/function/rendering/render_object.hpp>
+
+namespace saturn {
+
+namespace rendering {
+
+/**
+ * @brief 在CPU上逐meshlet做视锥与法线锥剔除，并把可见meshlet的索引紧凑地写入每帧独立的index buffer
+ *
+ * 剔除与索引拷贝由JobSystem在工作线程上并行执行，不依赖任何设备扩展
+ */
+class ClusterCuller {
+public:
+    struct CullView {
+        glm::mat4 m_view_proj{1.0f};
+        glm::vec3 m_camera_position{0.0f};
+        bool m_cone_culling = false;// 光栅化不剔除背面，仅对IsClosed()的网格生效
+    };
+
+    /**
+     * @brief 某个RenderObject在紧凑index buffer中的绘制范围
+     */
+    struct DrawRange {
+        uint32_t m_first_index = 0;
+        uint32_t m_index_count = 0;
+    };
+
+    struct Statistics {
+        uint32_t m_total_meshlets = 0;
+        uint32_t m_visible_meshlets = 0;
+    };
+
+    /**
+     * @param max_index_count 一帧内所有视角写入的索引总数上限
+     */
+    ClusterCuller(std::shared_ptr<Device> render_device, uint32_t frames_in_flight, uint32_t max_index_count);
+
+    /**
+     * @brief 切换到frame_index对应的index buffer，调用前需确保该帧的GPU工作已经完成
+     */
+    void BeginFrame(uint32_t frame_index);
+
+    /**
+     * @brief 剔除render_objects在lod_view下当前LOD的meshlet，结果与render_objects一一对应
+     */
+    void Cull(const std::vector<std::shared_ptr<RenderObject>> &render_objects, LodView lod_view,
+              const CullView &cull_view);
+
+    [[nodiscard]] auto GetDrawRanges(LodView lod_view) const -> const std::vector<DrawRange> & {
+        return m_draw_ranges.at(static_cast<size_t>(lod_view));
+    }
+    [[nodiscard]] auto GetStatistics(LodView lod_view) const -> const Statistics & {
+        return m_statistics.at(static_cast<size_t>(lod_view));
+    }
+    [[nodiscard]] auto GetIndexBuffer() const -> const std::shared_ptr<Buffer> & {
+        return m_index_buffers.at(m_current_frame_index);
+    }
+
+private:
+    static constexpr uint32_t kMeshletBatchSize = 64;
+
+    std::shared_ptr<Device> m_render_device;
+    std::vector<std::shared_ptr<Buffer>> m_index_buffers;
+    uint32_t m_max_index_count;
+    uint32_t m_current_frame_index = 0;
+    uint32_t m_write_offset = 0;
+
+    std::array<std::vector<DrawRange>, kLodViewCount> m_draw_ranges{};
+    std::array<Statistics, kLodViewCount> m_statistics{};
+    std::vector<uint8_t> m_visibility{};
+    std::vector<uint32_t> m_index_offsets{};
+};
+
+}// namespace rendering
+
+}// namespace saturn
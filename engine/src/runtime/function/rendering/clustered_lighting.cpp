@@ -0,0 +1,116 @@
+#include "clustered_lighting.hpp"
+
+#include <glm/glm.hpp>
+
+namespace saturn {
+
+namespace rendering {
+
+ClusteredLighting::ClusteredLighting(std::shared_ptr<Device> render_device, DescriptorLayoutCache &layout_cache,
+                                     DescriptorAllocator &descriptor_allocator,
+                                     std::shared_ptr<DescriptorWriteCache> write_cache, uint32_t frame_count)
+    : m_render_device{std::move(render_device)}, m_write_cache{std::move(write_cache)} {
+    m_descriptor_set_layout =
+            DescriptorSetLayout::Builder(m_render_device)
+                    .AddBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                    .AddBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                    .AddBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                    .AddBinding(3, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                    .Build(layout_cache);
+
+    m_cull_pipeline = ComputePipeline::Builder(m_render_device)
+                              .BindShader(R"(\shaders\light_cull.comp.spv)")
+                              .BindDescriptorSetLayout(m_descriptor_set_layout)
+                              .Build();
+
+    m_light_buffers.resize(frame_count);
+    m_cluster_light_count_buffers.resize(frame_count);
+    m_cluster_light_index_buffers.resize(frame_count);
+    m_uniform_buffers.resize(frame_count);
+    m_descriptor_sets.resize(frame_count);
+    m_light_counts.resize(frame_count, 0);
+    for (uint32_t i = 0; i < frame_count; ++i) {
+        // 光源每帧由CPU更新，直接放在host可见的内存中
+        m_light_buffers[i] = std::make_shared<Buffer>(
+                m_render_device, sizeof(PointLight), kMaxLights, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 1,
+                VK_SHARING_MODE_CONCURRENT);
+        m_light_buffers[i]->Map();
+        m_uniform_buffers[i] = std::make_shared<Buffer>(
+                m_render_device, sizeof(ClusterUniforms), 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 1,
+                VK_SHARING_MODE_CONCURRENT);
+        m_uniform_buffers[i]->Map();
+
+        // froxel的光源列表只在GPU上读写
+        m_cluster_light_count_buffers[i] =
+                std::make_shared<Buffer>(m_render_device, sizeof(uint32_t), kClusterCount,
+                                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 1,
+                                         VK_SHARING_MODE_CONCURRENT);
+        m_cluster_light_index_buffers[i] =
+                std::make_shared<Buffer>(m_render_device, sizeof(uint32_t), kClusterCount * kMaxLightsPerCluster,
+                                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 1,
+                                         VK_SHARING_MODE_CONCURRENT);
+
+        if (!descriptor_allocator.Allocate(m_descriptor_set_layout->GetDescriptorSetLayout(), m_descriptor_sets[i])) {
+            throw std::runtime_error("failed to allocate light culling descriptor set!");
+        }
+
+        auto light_buffer_info = m_light_buffers[i]->CreateDescriptorBufferInfo();
+        auto light_count_buffer_info = m_cluster_light_count_buffers[i]->CreateDescriptorBufferInfo();
+        auto light_index_buffer_info = m_cluster_light_index_buffers[i]->CreateDescriptorBufferInfo();
+        auto uniform_buffer_info = m_uniform_buffers[i]->CreateDescriptorBufferInfo();
+        DescriptorWriter(m_descriptor_set_layout, nullptr, m_write_cache)
+                .WriteBuffer(0, &light_buffer_info)
+                .WriteBuffer(1, &light_count_buffer_info)
+                .WriteBuffer(2, &light_index_buffer_info)
+                .WriteBuffer(3, &uniform_buffer_info)
+                .Overwrite(m_descriptor_sets[i]);
+    }
+}
+
+void ClusteredLighting::Update(uint32_t frame_index, const std::vector<PointLight> &lights, const glm::mat4 &view,
+                               const glm::mat4 &proj, VkExtent2D extent, float near_plane, float far_plane) {
+    auto light_count = std::min(static_cast<uint32_t>(lights.size()), kMaxLights);
+    if (light_count > 0) {
+        m_light_buffers.at(frame_index)->WriteToBuffer(lights.data(), light_count * sizeof(PointLight));
+    }
+    m_light_counts.at(frame_index) = light_count;
+
+    ClusterUniforms uniforms{};
+    uniforms.view = view;
+    uniforms.inv_proj = glm::inverse(proj);
+    uniforms.grid_size = glm::uvec4(kGridSizeX, kGridSizeY, kGridSizeZ, light_count);
+    uniforms.screen_params = glm::vec4(static_cast<float>(extent.width), static_cast<float>(extent.height),
+                                       near_plane, far_plane);
+    m_uniform_buffers.at(frame_index)->WriteToBuffer(&uniforms);
+}
+
+void ClusteredLighting::CmdBuildClusters(const std::shared_ptr<CommandsBuilder> &cmd_builder, uint32_t frame_index) {
+    m_cull_pipeline->CmdBindCommandBuffer(cmd_builder);
+    m_cull_pipeline->CmdBindDescriptorSets(cmd_builder, m_descriptor_sets.at(frame_index));
+    m_cull_pipeline->CmdDispatch(cmd_builder, kClusterCount, kLocalSize);
+}
+
+void ClusteredLighting::CmdBarrier(const std::shared_ptr<CommandsBuilder> &cmd_builder, uint32_t frame_index) {
+    std::array<VkBufferMemoryBarrier, 2> barriers{};
+    for (auto &barrier: barriers) {
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+    }
+    barriers[0].buffer = m_cluster_light_count_buffers.at(frame_index)->GetVkBuffer();
+    barriers[1].buffer = m_cluster_light_index_buffers.at(frame_index)->GetVkBuffer();
+
+    vkCmdPipelineBarrier(cmd_builder->GetCurrentCommandBuffer(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr,
+                         static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+}
+
+}// namespace rendering
+
+}// namespace saturn
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <engine_pch.hpp>
+#include <runtime/function/rendering/buffer.hpp>
+#include <runtime/function/rendering/commands.hpp>
+#include <runtime/function/rendering/compute_pipeline.hpp>
+#include <runtime/function/rendering/descriptor.hpp>
+#include <runtime/function/rendering/device.hpp>
+
+namespace saturn {
+
+namespace rendering {
+
+/**
+ * @brief 点光源的clustered forward shading
+ *
+ * 视锥按屏幕tile与指数划分的深度切片分为kGridSizeX * kGridSizeY * kGridSizeZ个froxel，每帧在light_cull.comp中
+ * 为每个froxel求出与之相交的点光源，写入定长的索引列表；shading.frag按片段所在的froxel只遍历这些光源
+ *
+ * 所有缓冲区每帧一份，由shading的descriptor set直接引用
+ */
+class ClusteredLighting {
+public:
+    /**
+     * @brief 布局需与light_cull.comp、shading.frag中的PointLight（std430）保持一致
+     */
+    struct PointLight {
+        glm::vec4 position_radius;// 世界空间，w为影响半径
+        glm::vec4 color_intensity;
+    };
+
+    /**
+     * @brief 布局需与light_cull.comp、shading.frag中的ClusterUniforms（std140）保持一致
+     */
+    struct ClusterUniforms {
+        glm::mat4 view;
+        glm::mat4 inv_proj;
+        glm::uvec4 grid_size;   // xyz为各维度的froxel数，w为光源数
+        glm::vec4 screen_params;// xy为shading pass的分辨率，z、w为近平面与远平面
+    };
+    static_assert(sizeof(ClusterUniforms) == 160, "ClusterUniforms must match the std140 layout of light_cull.comp");
+
+    static constexpr uint32_t kGridSizeX = 16;
+    static constexpr uint32_t kGridSizeY = 9;
+    static constexpr uint32_t kGridSizeZ = 24;
+    static constexpr uint32_t kClusterCount = kGridSizeX * kGridSizeY * kGridSizeZ;
+    static constexpr uint32_t kMaxLights = 4096;
+    static constexpr uint32_t kMaxLightsPerCluster = 128;// 需与shader中的max_lights_per_cluster一致
+    static constexpr uint32_t kLocalSize = 64;
+
+    ClusteredLighting(std::shared_ptr<Device> render_device, DescriptorLayoutCache &layout_cache,
+                      DescriptorAllocator &descriptor_allocator, std::shared_ptr<DescriptorWriteCache> write_cache,
+                      uint32_t frame_count);
+
+    ClusteredLighting(const ClusteredLighting &) = delete;
+    auto operator=(const ClusteredLighting &) -> ClusteredLighting & = delete;
+
+    /**
+     * @brief 写入该帧的光源与相机参数，该帧槽位上一次提交的帧完成后调用，超过kMaxLights的光源被忽略
+     * @param extent shading pass的分辨率，froxel的tile按它划分
+     */
+    void Update(uint32_t frame_index, const std::vector<PointLight> &lights, const glm::mat4 &view,
+                const glm::mat4 &proj, VkExtent2D extent, float near_plane, float far_plane);
+
+    /**
+     * @brief 录制froxel的光源剔除，需在render pass之外调用，可以录制到async compute队列上
+     */
+    void CmdBuildClusters(const std::shared_ptr<CommandsBuilder> &cmd_builder, uint32_t frame_index);
+
+    /**
+     * @brief 在同一graphics队列上剔除之后调用，使结果对片段着色器可见；在async compute队列上剔除时由semaphore同步
+     */
+    void CmdBarrier(const std::shared_ptr<CommandsBuilder> &cmd_builder, uint32_t frame_index);
+
+    [[nodiscard]] auto GetLightCount(uint32_t frame_index) const -> uint32_t {
+        return m_light_counts.at(frame_index);
+    }
+
+    [[nodiscard]] auto GetLightBuffer(uint32_t frame_index) const -> const std::shared_ptr<Buffer> & {
+        return m_light_buffers.at(frame_index);
+    }
+    [[nodiscard]] auto GetClusterLightCountBuffer(uint32_t frame_index) const -> const std::shared_ptr<Buffer> & {
+        return m_cluster_light_count_buffers.at(frame_index);
+    }
+    [[nodiscard]] auto GetClusterLightIndexBuffer(uint32_t frame_index) const -> const std::shared_ptr<Buffer> & {
+        return m_cluster_light_index_buffers.at(frame_index);
+    }
+    [[nodiscard]] auto GetUniformBuffer(uint32_t frame_index) const -> const std::shared_ptr<Buffer> & {
+        return m_uniform_buffers.at(frame_index);
+    }
+
+private:
+    std::shared_ptr<Device> m_render_device;
+    std::shared_ptr<DescriptorSetLayout> m_descriptor_set_layout;
+    std::shared_ptr<ComputePipeline> m_cull_pipeline;
+    std::shared_ptr<DescriptorWriteCache> m_write_cache;
+    std::vector<std::shared_ptr<Buffer>> m_light_buffers;
+    std::vector<std::shared_ptr<Buffer>> m_cluster_light_count_buffers;
+    std::vector<std::shared_ptr<Buffer>> m_cluster_light_index_buffers;
+    std::vector<std::shared_ptr<Buffer>> m_uniform_buffers;
+    std::vector<VkDescriptorSet> m_descriptor_sets;
+    std::vector<uint32_t> m_light_counts;
+};
+
+}// namespace rendering
+
+}// namespace saturn
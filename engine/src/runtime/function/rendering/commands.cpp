@@ -4,12 +4,16 @@ namespace saturn {
 
 namespace rendering {
 
-CommandsBuilder::CommandsBuilder(std::shared_ptr<Device> device)
-    : m_render_device(std::move(device)) {}
+CommandsBuilder::CommandsBuilder(std::shared_ptr<Device> device, QueueType queue_type)
+    : m_render_device(std::move(device)), m_queue_type(queue_type) {}
 
 CommandsBuilder::~CommandsBuilder() {
+    if (m_one_time_fence != VK_NULL_HANDLE) {
+        vkDestroyFence(m_render_device->GetVkDevice(), m_one_time_fence, nullptr);
+    }
     for (auto *command_buffer: m_command_buffers) {
-        vkFreeCommandBuffers(m_render_device->GetVkDevice(), m_render_device->GetCommandPool(), 1, &command_buffer);
+        vkFreeCommandBuffers(m_render_device->GetVkDevice(), m_render_device->GetCommandPool(m_queue_type), 1,
+                             &command_buffer);
     }
 }
 
@@ -17,7 +21,7 @@ auto CommandsBuilder::AllocateCommandBuffers(int count) -> CommandsBuilder & {
     m_command_buffers.resize(count);
     VkCommandBufferAllocateInfo alloc_info{};
     alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    alloc_info.commandPool = m_render_device->GetCommandPool();
+    alloc_info.commandPool = m_render_device->GetCommandPool(m_queue_type);
     alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
     alloc_info.commandBufferCount = count;
 
@@ -52,13 +56,31 @@ auto CommandsBuilder::EndRecord() -> CommandsBuilder & {
 auto CommandsBuilder::WaitForSemaphoresAndStages(const std::vector<VkSemaphore> &semaphores,
                                                        const std::vector<VkPipelineStageFlags> &stages)
         -> CommandsBuilder & {
-    m_wait_for_semaphores = semaphores;
-    m_wait_for_stages = stages;
+    m_wait_for_semaphores.insert(m_wait_for_semaphores.end(), semaphores.begin(), semaphores.end());
+    m_wait_for_stages.insert(m_wait_for_stages.end(), stages.begin(), stages.end());
+    m_wait_for_values.resize(m_wait_for_semaphores.size(), 0);
     return *this;
 }
 
 auto CommandsBuilder::SignalSemaphores(const std::vector<VkSemaphore> &semaphores) -> CommandsBuilder & {
-    m_signal_semaphores = semaphores;
+    m_signal_semaphores.insert(m_signal_semaphores.end(), semaphores.begin(), semaphores.end());
+    m_signal_values.resize(m_signal_semaphores.size(), 0);
+    return *this;
+}
+
+auto CommandsBuilder::WaitForTimelineSemaphore(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags stage)
+        -> CommandsBuilder & {
+    m_wait_for_semaphores.push_back(semaphore);
+    m_wait_for_stages.push_back(stage);
+    m_wait_for_values.push_back(value);
+    m_has_timeline_semaphores = true;
+    return *this;
+}
+
+auto CommandsBuilder::SignalTimelineSemaphore(VkSemaphore semaphore, uint64_t value) -> CommandsBuilder & {
+    m_signal_semaphores.push_back(semaphore);
+    m_signal_values.push_back(value);
+    m_has_timeline_semaphores = true;
     return *this;
 }
 
@@ -67,6 +89,13 @@ auto CommandsBuilder::SignalFence(VkFence fence) -> CommandsBuilder & {
     return *this;
 }
 
+auto CommandsBuilder::SignalFrame(const FrameTimeline::FrameSignal &frame_signal) -> CommandsBuilder & {
+    if (frame_signal.m_semaphore != VK_NULL_HANDLE) {
+        return SignalTimelineSemaphore(frame_signal.m_semaphore, frame_signal.m_frame);
+    }
+    return SignalFence(frame_signal.m_fence);
+}
+
 auto CommandsBuilder::SubmitTo(VkQueue queue) -> CommandsBuilder & {
     auto *command_buffer = GetCurrentCommandBuffer();
     VkSubmitInfo submit_info{};
@@ -85,14 +114,44 @@ auto CommandsBuilder::SubmitTo(VkQueue queue) -> CommandsBuilder & {
         submit_info.pSignalSemaphores = m_signal_semaphores.data();
     }
 
+    VkTimelineSemaphoreSubmitInfoKHR timeline_info{};
+    if (m_has_timeline_semaphores) {
+        timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+        timeline_info.waitSemaphoreValueCount = submit_info.waitSemaphoreCount;
+        timeline_info.pWaitSemaphoreValues = m_wait_for_values.data();
+        timeline_info.signalSemaphoreValueCount = submit_info.signalSemaphoreCount;
+        timeline_info.pSignalSemaphoreValues = m_signal_values.data();
+        submit_info.pNext = &timeline_info;
+    }
+
+    // 其他提交都由调用者通过semaphore或fence同步
+    bool one_time = m_wait_for_semaphores.empty() && m_signal_semaphores.empty() && m_fence == VK_NULL_HANDLE;
+    if (one_time) {
+        auto *device = m_render_device->GetVkDevice();
+        if (m_one_time_fence == VK_NULL_HANDLE) {
+            VkFenceCreateInfo fence_info{};
+            fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+            if (vkCreateFence(device, &fence_info, nullptr, &m_one_time_fence) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create fence!");
+            }
+        }
+        m_fence = m_one_time_fence;
+    }
+
     vkQueueSubmit(queue, 1, &submit_info, m_fence);
 
-    if (m_wait_for_semaphores.empty()) { vkQueueWaitIdle(queue); }
+    if (one_time) {
+        vkWaitForFences(m_render_device->GetVkDevice(), 1, &m_one_time_fence, VK_TRUE, UINT64_MAX);
+        vkResetFences(m_render_device->GetVkDevice(), 1, &m_one_time_fence);
+    }
 
     // reset
     m_wait_for_semaphores.clear();
     m_signal_semaphores.clear();
     m_wait_for_stages.clear();
+    m_wait_for_values.clear();
+    m_signal_values.clear();
+    m_has_timeline_semaphores = false;
     m_fence = VK_NULL_HANDLE;
     m_current_command_buffer_index = 0;
 
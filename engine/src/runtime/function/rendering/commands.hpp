@@ -14,9 +14,16 @@ enum class RenderCommandsUsage {
     OneTimeSubmit,// 只会提交一次，不会复用
 };
 
+/**
+ * @brief 录制并提交command buffer，没有任何semaphore与fence的提交视为一次性的同步操作，提交后只等待这一次提交完成，
+ * 不等待队列中在飞的帧
+ */
 class CommandsBuilder {
 public:
-    explicit CommandsBuilder(std::shared_ptr<Device> device);
+    /**
+     * @param queue_type 从该队列族的command pool分配，只能提交到该族的队列
+     */
+    explicit CommandsBuilder(std::shared_ptr<Device> device, QueueType queue_type = QueueType::Graphics);
     ~CommandsBuilder();
 
     auto AllocateCommandBuffers(int count) -> CommandsBuilder &;
@@ -26,7 +33,17 @@ public:
     auto WaitForSemaphoresAndStages(const std::vector<VkSemaphore> &semaphores,
                                     const std::vector<VkPipelineStageFlags> &stages) -> CommandsBuilder &;
     auto SignalSemaphores(const std::vector<VkSemaphore> &semaphores) -> CommandsBuilder &;
+    /**
+     * @brief 以下两者需要Device::IsTimelineSemaphoreSupported()，可与binary semaphore混用
+     */
+    auto WaitForTimelineSemaphore(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags stage)
+            -> CommandsBuilder &;
+    auto SignalTimelineSemaphore(VkSemaphore semaphore, uint64_t value) -> CommandsBuilder &;
     auto SignalFence(VkFence fence) -> CommandsBuilder &;
+    /**
+     * @brief signal FrameTimeline::SubmitFrame()返回的timeline semaphore或fence
+     */
+    auto SignalFrame(const FrameTimeline::FrameSignal &frame_signal) -> CommandsBuilder &;
 
     auto SubmitTo(VkQueue queue) -> CommandsBuilder &;
 
@@ -34,11 +51,16 @@ public:
 
 private:
     std::shared_ptr<Device> m_render_device;
+    QueueType m_queue_type;
     int m_current_command_buffer_index{0};
     std::vector<VkCommandBuffer> m_command_buffers;
     std::vector<VkSemaphore> m_wait_for_semaphores, m_signal_semaphores;
     std::vector<VkPipelineStageFlags> m_wait_for_stages;
+    // 与semaphore一一对应，binary semaphore的值被忽略
+    std::vector<uint64_t> m_wait_for_values, m_signal_values;
+    bool m_has_timeline_semaphores{false};
     VkFence m_fence {VK_NULL_HANDLE};
+    VkFence m_one_time_fence{VK_NULL_HANDLE};// 一次性提交时等待，第一次使用时创建
 };
 
 }
@@ -0,0 +1,112 @@
+#include "compute_pipeline.hpp"
+
+#include <runtime/resource/file_helper.hpp>
+#include <utility>
+
+namespace saturn {
+
+namespace rendering {
+
+ComputePipeline::Builder::Builder(std::shared_ptr<Device> device) : m_device(std::move(device)) {}
+
+auto ComputePipeline::Builder::BindShader(std::string comp_shader_path) -> Builder & {
+    m_comp_path = std::move(comp_shader_path);
+    return *this;
+}
+
+auto ComputePipeline::Builder::BindDescriptorSetLayout(std::shared_ptr<DescriptorSetLayout> descriptor_set_layout)
+        -> Builder & {
+    m_descriptor_set_layouts.push_back(std::move(descriptor_set_layout));
+    return *this;
+}
+
+auto ComputePipeline::Builder::AddPushConstantRange(uint32_t size, uint32_t offset) -> Builder & {
+    SATURN_ASSERT(size > 0 && size % 4 == 0 && offset % 4 == 0, "Push constant range must be 4-byte aligned");
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(m_device->GetPhyDevice(), &properties);
+    SATURN_ASSERT(offset + size <= properties.limits.maxPushConstantsSize, "Push constant range exceeds device limit");
+
+    m_push_constant_ranges.push_back({VK_SHADER_STAGE_COMPUTE_BIT, offset, size});
+    return *this;
+}
+
+auto ComputePipeline::Builder::Build() -> std::shared_ptr<ComputePipeline> {
+    return std::make_shared<ComputePipeline>(m_device, m_comp_path, m_descriptor_set_layouts, m_push_constant_ranges);
+}
+
+ComputePipeline::ComputePipeline(std::shared_ptr<Device> device, const std::string &comp_filepath,
+                                 const std::vector<std::shared_ptr<DescriptorSetLayout>> &descriptor_set_layouts,
+                                 const std::vector<VkPushConstantRange> &push_constant_ranges)
+    : m_device(std::move(device)) {
+    std::vector<VkDescriptorSetLayout> vk_descriptor_set_layouts{};
+    vk_descriptor_set_layouts.reserve(descriptor_set_layouts.size());
+    for (const auto &descriptor_set_layout: descriptor_set_layouts) {
+        vk_descriptor_set_layouts.push_back(descriptor_set_layout->GetDescriptorSetLayout());
+    }
+
+    VkPipelineLayoutCreateInfo pipeline_layout_create_info{};
+    pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeline_layout_create_info.setLayoutCount = static_cast<uint32_t>(vk_descriptor_set_layouts.size());
+    pipeline_layout_create_info.pSetLayouts = vk_descriptor_set_layouts.data();
+    pipeline_layout_create_info.pushConstantRangeCount = static_cast<uint32_t>(push_constant_ranges.size());
+    pipeline_layout_create_info.pPushConstantRanges = push_constant_ranges.data();
+    if (vkCreatePipelineLayout(m_device->GetVkDevice(), &pipeline_layout_create_info, nullptr, &m_pipeline_layout) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to create compute pipeline layout!");
+    }
+
+    auto comp_code = resource::FileHelper::ReadFile(comp_filepath);
+
+    VkShaderModuleCreateInfo shader_module_info{};
+    shader_module_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    shader_module_info.codeSize = comp_code.size();
+    shader_module_info.pCode = reinterpret_cast<const uint32_t *>(comp_code.data());
+
+    VkShaderModule comp_shader_module = VK_NULL_HANDLE;
+    if (vkCreateShaderModule(m_device->GetVkDevice(), &shader_module_info, nullptr, &comp_shader_module) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("failed to create shader module");
+    }
+
+    VkComputePipelineCreateInfo pipeline_info{};
+    pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipeline_info.stage.module = comp_shader_module;
+    pipeline_info.stage.pName = "main";
+    pipeline_info.layout = m_pipeline_layout;
+    pipeline_info.basePipelineIndex = -1;
+    pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
+
+    auto result = vkCreateComputePipelines(m_device->GetVkDevice(), VK_NULL_HANDLE, 1, &pipeline_info, nullptr,
+                                           &m_compute_pipeline);
+    vkDestroyShaderModule(m_device->GetVkDevice(), comp_shader_module, nullptr);
+    if (result != VK_SUCCESS) { throw std::runtime_error("failed to create compute pipeline"); }
+}
+
+ComputePipeline::~ComputePipeline() {
+    vkDestroyPipeline(m_device->GetVkDevice(), m_compute_pipeline, nullptr);
+    vkDestroyPipelineLayout(m_device->GetVkDevice(), m_pipeline_layout, nullptr);
+}
+
+void ComputePipeline::CmdBindCommandBuffer(const std::shared_ptr<CommandsBuilder> &cmd_builder) const {
+    vkCmdBindPipeline(cmd_builder->GetCurrentCommandBuffer(), VK_PIPELINE_BIND_POINT_COMPUTE, m_compute_pipeline);
+}
+
+void ComputePipeline::CmdBindDescriptorSets(const std::shared_ptr<CommandsBuilder> &cmd_builder,
+                                            VkDescriptorSet descriptor_set, uint32_t first_set) const {
+    vkCmdBindDescriptorSets(cmd_builder->GetCurrentCommandBuffer(), VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline_layout,
+                            first_set, 1, &descriptor_set, 0, nullptr);
+}
+
+void ComputePipeline::CmdDispatch(const std::shared_ptr<CommandsBuilder> &cmd_builder, uint32_t invocation_count,
+                                  uint32_t local_size) const {
+    uint32_t group_count = (invocation_count + local_size - 1) / local_size;
+    if (group_count == 0) { return; }
+    vkCmdDispatch(cmd_builder->GetCurrentCommandBuffer(), group_count, 1, 1);
+}
+
+}// namespace rendering
+
+}// namespace saturn
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <engine_pch.hpp>
+
+#include <vulkan/vulkan.h>
+
+#include "commands.hpp"
+#include "descriptor.hpp"
+#include "device.hpp"
+
+namespace saturn {
+
+namespace rendering {
+
+class ComputePipeline {
+public:
+    class Builder {
+    public:
+        explicit Builder(std::shared_ptr<Device> device);
+        auto BindShader(std::string comp_shader_path) -> Builder &;
+
+        /**
+         * @brief 按调用顺序追加descriptor set layout，第一次调用对应set = 0
+         */
+        auto BindDescriptorSetLayout(std::shared_ptr<DescriptorSetLayout> descriptor_set_layout) -> Builder &;
+        auto AddPushConstantRange(uint32_t size, uint32_t offset = 0) -> Builder &;
+
+        template<typename T>
+        auto AddPushConstantRange(uint32_t offset = 0) -> Builder & {
+            return AddPushConstantRange(static_cast<uint32_t>(sizeof(T)), offset);
+        }
+
+        auto Build() -> std::shared_ptr<ComputePipeline>;
+
+    private:
+        std::shared_ptr<Device> m_device;
+        std::string m_comp_path;
+        std::vector<std::shared_ptr<DescriptorSetLayout>> m_descriptor_set_layouts{};
+        std::vector<VkPushConstantRange> m_push_constant_ranges{};
+    };
+
+    ComputePipeline(std::shared_ptr<Device> device, const std::string &comp_filepath,
+                    const std::vector<std::shared_ptr<DescriptorSetLayout>> &descriptor_set_layouts,
+                    const std::vector<VkPushConstantRange> &push_constant_ranges);
+    ~ComputePipeline();
+
+    ComputePipeline(const ComputePipeline &) = delete;
+    auto operator=(const ComputePipeline &) -> ComputePipeline & = delete;
+
+    [[nodiscard]] auto GetPipelineLayout() const -> VkPipelineLayout { return m_pipeline_layout; }
+
+    void CmdBindCommandBuffer(const std::shared_ptr<CommandsBuilder> &cmd_builder) const;
+    void CmdBindDescriptorSets(const std::shared_ptr<CommandsBuilder> &cmd_builder, VkDescriptorSet descriptor_set,
+                               uint32_t first_set = 0) const;
+
+    template<typename T>
+    void CmdPushConstants(const std::shared_ptr<CommandsBuilder> &cmd_builder, const T &data,
+                          uint32_t offset = 0) const {
+        static_assert(std::is_trivially_copyable_v<T>, "Push constant data must be trivially copyable");
+        static_assert(sizeof(T) % 4 == 0, "Push constant size must be a multiple of 4");
+        vkCmdPushConstants(cmd_builder->GetCurrentCommandBuffer(), m_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT,
+                           offset, static_cast<uint32_t>(sizeof(T)), &data);
+    }
+
+    /**
+     * @brief 按工作组大小向上取整后dispatch
+     */
+    void CmdDispatch(const std::shared_ptr<CommandsBuilder> &cmd_builder, uint32_t invocation_count,
+                     uint32_t local_size) const;
+
+private:
+    std::shared_ptr<Device> m_device;
+    VkPipelineLayout m_pipeline_layout = VK_NULL_HANDLE;
+    VkPipeline m_compute_pipeline = VK_NULL_HANDLE;
+};
+
+}// namespace rendering
+
+}// namespace saturn
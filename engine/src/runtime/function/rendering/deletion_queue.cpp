@@ -0,0 +1,59 @@
+#include "deletion_queue.hpp"
+
+#include "device.hpp"
+
+namespace saturn {
+
+namespace rendering {
+
+namespace {
+
+// 最后一份引用放开时执行deleter
+class PendingDeletion {
+public:
+    explicit PendingDeletion(std::function<void()> deleter) : m_deleter(std::move(deleter)) {}
+    ~PendingDeletion() { m_deleter(); }
+
+    PendingDeletion(const PendingDeletion &) = delete;
+    auto operator=(const PendingDeletion &) -> PendingDeletion & = delete;
+
+private:
+    std::function<void()> m_deleter;
+};
+
+}// namespace
+
+void DeletionQueue::Push(std::function<void()> deleter) {
+    Retire(std::make_shared<PendingDeletion>(std::move(deleter)));
+}
+
+void DeletionQueue::Retire(std::shared_ptr<void> resource) {
+    if (resource == nullptr) { return; }
+    m_pending.emplace_back(m_render_device.GetFrameTimeline().GetPendingFrame(), std::move(resource));
+}
+
+void DeletionQueue::Collect() {
+    if (m_pending.empty()) { return; }
+
+    // 先移出再析构，deleter中释放的资源可能再次进入队列
+    auto completed_frame = m_render_device.GetFrameTimeline().GetCompletedFrame();
+    std::vector<std::shared_ptr<void>> retired;
+    while (!m_pending.empty() && m_pending.front().first <= completed_frame) {
+        retired.push_back(std::move(m_pending.front().second));
+        m_pending.pop_front();
+    }
+    retired.clear();
+}
+
+void DeletionQueue::Flush() {
+    // 析构可能再次push（例如Swapchain析构其中的Image），直到队列为空
+    while (!m_pending.empty()) {
+        auto retired = std::move(m_pending);
+        m_pending.clear();
+        retired.clear();
+    }
+}
+
+}// namespace rendering
+
+}// namespace saturn
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <engine_pch.hpp>
+
+#include <deque>
+
+namespace saturn {
+
+namespace rendering {
+
+class Device;
+
+/**
+ * @brief 按帧延迟销毁GPU资源
+ *
+ * 资源被释放时已提交以及正在录制的帧都可能还在使用它：释放时记录FrameTimeline的下一次提交的帧，该帧完成后
+ * 才真正销毁。Buffer、Image的析构通过它销毁Vulkan对象，运行时替换网格、纹理或重建swapchain都不需要等待设备空闲
+ */
+class DeletionQueue {
+public:
+    explicit DeletionQueue(Device &render_device) : m_render_device(render_device) {}
+    ~DeletionQueue() { Flush(); }
+
+    DeletionQueue(const DeletionQueue &) = delete;
+    auto operator=(const DeletionQueue &) -> DeletionQueue & = delete;
+
+    /**
+     * @brief deleter在当前所有在飞的帧完成后执行，不能捕获持有Device的shared_ptr，否则Device无法析构
+     */
+    void Push(std::function<void()> deleter);
+
+    /**
+     * @brief 放开resource的引用，当前所有在飞的帧完成后才析构；resource持有Device时需在Device析构之前Flush
+     */
+    void Retire(std::shared_ptr<void> resource);
+
+    /**
+     * @brief 析构所有所属帧已经完成的资源，不阻塞，每帧开始时调用
+     */
+    void Collect();
+
+    /**
+     * @brief 立即销毁所有待销毁的资源，需在设备空闲时调用
+     */
+    void Flush();
+
+private:
+    Device &m_render_device;
+    std::deque<std::pair<uint64_t, std::shared_ptr<void>>> m_pending;// 按帧递增
+};
+
+}// namespace rendering
+
+}// namespace saturn
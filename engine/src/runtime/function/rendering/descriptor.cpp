@@ -33,13 +33,18 @@ DescriptorPool::~DescriptorPool() {
 }
 
 auto DescriptorPool::AllocateDescriptor(VkDescriptorSetLayout descriptor_set_layout, VkDescriptorSet &descriptor_set) const -> bool {
+    return TryAllocateDescriptor(descriptor_set_layout, descriptor_set) == VK_SUCCESS;
+}
+
+auto DescriptorPool::TryAllocateDescriptor(VkDescriptorSetLayout descriptor_set_layout,
+                                           VkDescriptorSet &descriptor_set) const -> VkResult {
     VkDescriptorSetAllocateInfo alloc_info{};
     alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     alloc_info.descriptorPool = m_descriptor_pool;
     alloc_info.pSetLayouts = &descriptor_set_layout;
     alloc_info.descriptorSetCount = 1;
 
-    return vkAllocateDescriptorSets(m_render_device->GetVkDevice(), &alloc_info, &descriptor_set) == VK_SUCCESS;
+    return vkAllocateDescriptorSets(m_render_device->GetVkDevice(), &alloc_info, &descriptor_set);
 }
 
 void DescriptorPool::FreeDescriptors(std::vector<VkDescriptorSet> &descriptor_sets) const {
@@ -75,32 +80,92 @@ auto DescriptorSetLayout::Builder::Build() const -> std::unique_ptr<DescriptorSe
     return std::make_unique<DescriptorSetLayout>(m_render_device, bindings);
 }
 
+auto DescriptorSetLayout::Builder::Build(DescriptorLayoutCache &layout_cache) const
+        -> std::shared_ptr<DescriptorSetLayout> {
+    return layout_cache.GetOrCreate(bindings);
+}
+
 // *************** Descriptor Set Layout *********************
 
 DescriptorSetLayout::DescriptorSetLayout(
         std::shared_ptr<Device> render_device, const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> &bindings)
-    : m_render_device{std::move(render_device)}, m_bindings{bindings} {
+    : m_render_device{std::move(render_device)} {
 
-    std::vector<VkDescriptorSetLayoutBinding> set_layout_bindings{};
-    set_layout_bindings.reserve(bindings.size());
-    for (auto kv: bindings) {
-        set_layout_bindings.push_back(kv.second);
+    m_bindings.reserve(bindings.size());
+    for (const auto &[index, binding]: bindings) {
+        m_bindings.push_back(binding);
     }
+    std::sort(m_bindings.begin(), m_bindings.end(),
+              [](const auto &lhs, const auto &rhs) { return lhs.binding < rhs.binding; });
 
     VkDescriptorSetLayoutCreateInfo descriptor_set_layout_info{};
     descriptor_set_layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    descriptor_set_layout_info.bindingCount = static_cast<uint32_t>(set_layout_bindings.size());
-    descriptor_set_layout_info.pBindings = set_layout_bindings.data();
+    descriptor_set_layout_info.bindingCount = static_cast<uint32_t>(m_bindings.size());
+    descriptor_set_layout_info.pBindings = m_bindings.data();
 
     if (vkCreateDescriptorSetLayout(m_render_device->GetVkDevice(), &descriptor_set_layout_info, nullptr, &m_descriptor_set_layout) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create descriptor set layout!");
     }
+
+    CreateUpdateTemplate();
 }
 
 DescriptorSetLayout::~DescriptorSetLayout() {
+    if (m_update_template != VK_NULL_HANDLE) {
+        m_render_device->GetExtensionFunctions().m_destroy_descriptor_update_template(m_render_device->GetVkDevice(),
+                                                                                      m_update_template, nullptr);
+    }
     vkDestroyDescriptorSetLayout(m_render_device->GetVkDevice(), m_descriptor_set_layout, nullptr);
 }
 
+auto DescriptorSetLayout::FindBinding(uint32_t binding) const -> const VkDescriptorSetLayoutBinding * {
+    auto iter = std::lower_bound(m_bindings.begin(), m_bindings.end(), binding,
+                                 [](const auto &layout_binding, uint32_t value) { return layout_binding.binding < value; });
+    if (iter == m_bindings.end() || iter->binding != binding) { return nullptr; }
+    return &*iter;
+}
+
+auto DescriptorSetLayout::GetBindingSlot(uint32_t binding) const -> uint32_t {
+    const auto *layout_binding = FindBinding(binding);
+    SATURN_ASSERT(layout_binding != nullptr, "Layout does not contain specified binding");
+    return static_cast<uint32_t>(layout_binding - m_bindings.data());
+}
+
+void DescriptorSetLayout::CreateUpdateTemplate() {
+    const auto &extension_functions = m_render_device->GetExtensionFunctions();
+    if (extension_functions.m_create_descriptor_update_template == nullptr ||
+        m_bindings.size() > DescriptorWriter::kMaxWrites) {
+        return;
+    }
+
+    std::array<VkDescriptorUpdateTemplateEntryKHR, DescriptorWriter::kMaxWrites> entries{};
+    for (uint32_t slot = 0; slot < m_bindings.size(); ++slot) {
+        const auto &binding = m_bindings[slot];
+        // 模板的每个槽位只容纳一个DescriptorInfo，数组binding交给vkUpdateDescriptorSets处理
+        if (binding.descriptorCount != 1) { return; }
+
+        entries[slot].dstBinding = binding.binding;
+        entries[slot].dstArrayElement = 0;
+        entries[slot].descriptorCount = 1;
+        entries[slot].descriptorType = binding.descriptorType;
+        entries[slot].offset = slot * sizeof(DescriptorInfo);
+        entries[slot].stride = sizeof(DescriptorInfo);
+    }
+
+    VkDescriptorUpdateTemplateCreateInfoKHR template_info{};
+    template_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO_KHR;
+    template_info.descriptorUpdateEntryCount = static_cast<uint32_t>(m_bindings.size());
+    template_info.pDescriptorUpdateEntries = entries.data();
+    template_info.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET_KHR;
+    template_info.descriptorSetLayout = m_descriptor_set_layout;
+
+    if (extension_functions.m_create_descriptor_update_template(m_render_device->GetVkDevice(), &template_info,
+                                                                 nullptr, &m_update_template) != VK_SUCCESS) {
+        ENGINE_LOG_WARN("Failed to create descriptor update template, fall back to vkUpdateDescriptorSets");
+        m_update_template = VK_NULL_HANDLE;
+    }
+}
+
 // *************** Descriptor Pool Builder *********************
 
 auto DescriptorPool::Builder::AddPoolSize(
@@ -129,67 +194,279 @@ auto DescriptorPool::Builder::Build() const -> std::shared_ptr<DescriptorPool> {
     return std::make_shared<DescriptorPool>(m_render_device, m_current_sets_count, m_pool_flags, m_pool_sizes);
 }
 
-// *************** Descriptor Writer *********************
+// *************** Descriptor Layout Cache *********************
+
+auto DescriptorLayoutCache::LayoutKey::operator==(const LayoutKey &other) const -> bool {
+    if (m_bindings.size() != other.m_bindings.size()) { return false; }
+    for (size_t i = 0; i < m_bindings.size(); ++i) {
+        const auto &lhs = m_bindings[i];
+        const auto &rhs = other.m_bindings[i];
+        if (lhs.binding != rhs.binding || lhs.descriptorType != rhs.descriptorType ||
+            lhs.descriptorCount != rhs.descriptorCount || lhs.stageFlags != rhs.stageFlags) {
+            return false;
+        }
+    }
+    return true;
+}
 
-DescriptorWriter::DescriptorWriter(std::shared_ptr<DescriptorSetLayout> set_layout, std::shared_ptr<DescriptorPool> pool)
-    : m_set_layout{set_layout}, m_pool{std::move(pool)}, m_bindings(set_layout->GetBindings()) {}
+auto DescriptorLayoutCache::LayoutKeyHash::operator()(const LayoutKey &key) const -> size_t {
+    size_t seed = key.m_bindings.size();
+    for (const auto &binding: key.m_bindings) {
+        // 把一个binding的所有字段压进一个64位整数后再混合
+        uint64_t packed = static_cast<uint64_t>(binding.binding) | static_cast<uint64_t>(binding.descriptorType) << 16 |
+                          static_cast<uint64_t>(binding.descriptorCount) << 24 |
+                          static_cast<uint64_t>(binding.stageFlags) << 40;
+        seed ^= std::hash<uint64_t>{}(packed) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+    return seed;
+}
 
-auto DescriptorWriter::WriteBuffer(
-        uint32_t binding, VkDescriptorBufferInfo *buffer_info) -> DescriptorWriter & {
-    SATURN_ASSERT(m_bindings.count(binding) == 1, "Layout does not contain specified binding");
+auto DescriptorLayoutCache::GetOrCreate(const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> &bindings)
+        -> std::shared_ptr<DescriptorSetLayout> {
+    LayoutKey key{};
+    key.m_bindings.reserve(bindings.size());
+    for (const auto &[index, binding]: bindings) {
+        SATURN_ASSERT(binding.pImmutableSamplers == nullptr, "Immutable samplers are not supported by layout cache");
+        key.m_bindings.push_back(binding);
+    }
+    std::sort(key.m_bindings.begin(), key.m_bindings.end(),
+              [](const auto &lhs, const auto &rhs) { return lhs.binding < rhs.binding; });
 
-    const auto &binding_description = m_bindings.at(binding);
+    auto iter = m_layouts.find(key);
+    if (iter != m_layouts.end()) {
+        ++m_hit_count;
+        return iter->second;
+    }
 
-    SATURN_ASSERT(binding_description.descriptorCount == 1, "Binding single descriptor info, but binding expects multiple");
+    auto layout = std::make_shared<DescriptorSetLayout>(m_render_device, bindings);
+    m_layouts.emplace(std::move(key), layout);
+    return layout;
+}
 
-    VkWriteDescriptorSet write{};
-    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    write.descriptorType = binding_description.descriptorType;
-    write.dstBinding = binding;
-    write.pBufferInfo = buffer_info;
-    write.descriptorCount = 1;
+// *************** Descriptor Allocator *********************
 
-    m_writes.push_back(write);
-    return *this;
+DescriptorAllocator::DescriptorAllocator(std::shared_ptr<Device> render_device, uint32_t initial_sets_per_pool,
+                                         std::vector<PoolSizeRatio> pool_size_ratios,
+                                         VkDescriptorPoolCreateFlags pool_flags)
+    : m_render_device{std::move(render_device)}, m_pool_size_ratios{std::move(pool_size_ratios)},
+      m_pool_flags{pool_flags}, m_sets_per_pool{std::max(initial_sets_per_pool, 1u)} {
+    m_ready_pools.push_back(CreatePool(m_sets_per_pool));
 }
 
-auto DescriptorWriter::WriteImage(
-        uint32_t binding, VkDescriptorImageInfo *image_info) -> DescriptorWriter & {
-    SATURN_ASSERT(m_bindings.count(binding) == 1, "Layout does not contain specified binding");
+auto DescriptorAllocator::CreatePool(uint32_t set_count) -> std::shared_ptr<DescriptorPool> {
+    std::vector<VkDescriptorPoolSize> pool_sizes{};
+    pool_sizes.reserve(m_pool_size_ratios.size());
+    for (const auto &ratio: m_pool_size_ratios) {
+        auto descriptor_count = static_cast<uint32_t>(std::ceil(ratio.m_ratio * static_cast<float>(set_count)));
+        pool_sizes.push_back({ratio.m_type, std::max(descriptor_count, 1u)});
+    }
+    return std::make_shared<DescriptorPool>(m_render_device, set_count, m_pool_flags, pool_sizes);
+}
 
-    const auto &binding_description = m_bindings.at(binding);
+auto DescriptorAllocator::AcquirePool() -> std::shared_ptr<DescriptorPool> {
+    if (!m_ready_pools.empty()) { return m_ready_pools.back(); }
+
+    m_sets_per_pool = std::min(m_sets_per_pool * 2, kMaxSetsPerPool);
+    ENGINE_LOG_INFO("Descriptor allocator grows: new pool with {} sets", m_sets_per_pool);
+    m_ready_pools.push_back(CreatePool(m_sets_per_pool));
+    return m_ready_pools.back();
+}
 
-    SATURN_ASSERT(binding_description.descriptorCount == 1, "Binding single descriptor info, but binding expects multiple");
+auto DescriptorAllocator::Allocate(VkDescriptorSetLayout descriptor_set_layout, VkDescriptorSet &descriptor_set)
+        -> bool {
+    auto pool = AcquirePool();
+    VkResult result = pool->TryAllocateDescriptor(descriptor_set_layout, descriptor_set);
+
+    // 没有maintenance1的驱动可能返回其它错误码，统一视为pool已满，换一个新pool重试一次
+    if (result != VK_SUCCESS) {
+        if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) {
+            ENGINE_LOG_WARN("Descriptor pool allocation failed with VkResult {}, retry with a new pool",
+                            static_cast<int>(result));
+        }
+        m_full_pools.push_back(pool);
+        m_ready_pools.pop_back();
+
+        pool = AcquirePool();
+        result = pool->TryAllocateDescriptor(descriptor_set_layout, descriptor_set);
+    }
 
-    VkWriteDescriptorSet write{};
+    if (result != VK_SUCCESS) {
+        ENGINE_LOG_ERROR("Can't allocate descriptor from a fresh pool");
+        return false;
+    }
+    ++m_allocated_set_count;
+    return true;
+}
+
+void DescriptorAllocator::ResetPools() {
+    for (auto &pool: m_ready_pools) { pool->ResetPool(); }
+    for (auto &pool: m_full_pools) {
+        pool->ResetPool();
+        m_ready_pools.push_back(pool);
+    }
+    m_full_pools.clear();
+    m_allocated_set_count = 0;
+}
+
+// *************** Descriptor Write Cache *********************
+
+auto DescriptorWriteCache::BindingState::operator==(const BindingState &other) const -> bool {
+    return m_type == other.m_type && m_buffer_info.buffer == other.m_buffer_info.buffer &&
+           m_buffer_info.offset == other.m_buffer_info.offset && m_buffer_info.range == other.m_buffer_info.range &&
+           m_image_info.sampler == other.m_image_info.sampler &&
+           m_image_info.imageView == other.m_image_info.imageView &&
+           m_image_info.imageLayout == other.m_image_info.imageLayout;
+}
+
+auto DescriptorWriteCache::MakeBindingState(const VkWriteDescriptorSet &write) -> BindingState {
+    BindingState state{};
+    state.m_type = write.descriptorType;
+    if (write.pBufferInfo != nullptr) { state.m_buffer_info = *write.pBufferInfo; }
+    if (write.pImageInfo != nullptr) { state.m_image_info = *write.pImageInfo; }
+    return state;
+}
+
+auto DescriptorWriteCache::Filter(VkDescriptorSet set, VkWriteDescriptorSet *writes, uint32_t write_count)
+        -> uint32_t {
+    auto &binding_states = m_set_states[set];
+
+    uint32_t kept_count = 0;
+    for (uint32_t i = 0; i < write_count; ++i) {
+        const auto &write = writes[i];
+        // 数组binding不做缓存，始终写入
+        if (write.descriptorCount == 1 && write.dstArrayElement == 0) {
+            auto state = MakeBindingState(write);
+            auto iter = binding_states.find(write.dstBinding);
+            if (iter != binding_states.end() && iter->second == state) {
+                ++m_skipped_write_count;
+                continue;
+            }
+            binding_states[write.dstBinding] = state;
+        }
+        writes[kept_count++] = write;
+    }
+    m_applied_write_count += kept_count;
+    return kept_count;
+}
+
+void DescriptorWriteCache::Invalidate(VkDescriptorSet set) { m_set_states.erase(set); }
+
+void DescriptorWriteCache::Invalidate(VkDescriptorSet set, uint32_t binding) {
+    auto iter = m_set_states.find(set);
+    if (iter != m_set_states.end()) { iter->second.erase(binding); }
+}
+
+// *************** Descriptor Writer *********************
+
+DescriptorWriter::DescriptorWriter(std::shared_ptr<DescriptorSetLayout> set_layout, std::shared_ptr<DescriptorPool> pool,
+                                   std::shared_ptr<DescriptorWriteCache> cache)
+    : m_set_layout{std::move(set_layout)}, m_pool{std::move(pool)}, m_cache{std::move(cache)} {}
+
+auto DescriptorWriter::AddWrite(uint32_t binding) -> VkWriteDescriptorSet & {
+    SATURN_ASSERT(m_write_count < kMaxWrites, "Too many descriptor writes for one DescriptorWriter");
+
+    const auto *binding_description = m_set_layout->FindBinding(binding);
+    SATURN_ASSERT(binding_description != nullptr, "Layout does not contain specified binding");
+    SATURN_ASSERT(binding_description->descriptorCount == 1, "Binding single descriptor info, but binding expects multiple");
+
+    auto &write = m_writes[m_write_count++];
+    write = {};
     write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    write.descriptorType = binding_description.descriptorType;
+    write.descriptorType = binding_description->descriptorType;
     write.dstBinding = binding;
-    write.pImageInfo = image_info;
     write.descriptorCount = 1;
+    return write;
+}
 
-    m_writes.push_back(write);
+auto DescriptorWriter::WriteBuffer(
+        uint32_t binding, const VkDescriptorBufferInfo *buffer_info) -> DescriptorWriter & {
+    auto &write = AddWrite(binding);
+    auto &info = m_infos[m_write_count - 1];
+    info.m_buffer_info = *buffer_info;
+    write.pBufferInfo = &info.m_buffer_info;
+    return *this;
+}
+
+auto DescriptorWriter::WriteImage(
+        uint32_t binding, const VkDescriptorImageInfo *image_info) -> DescriptorWriter & {
+    auto &write = AddWrite(binding);
+    auto &info = m_infos[m_write_count - 1];
+    info.m_image_info = *image_info;
+    write.pImageInfo = &info.m_image_info;
+    return *this;
+}
+
+auto DescriptorWriter::SetUseUpdateTemplate(bool use_update_template) -> DescriptorWriter & {
+    m_use_update_template = use_update_template;
     return *this;
 }
 
 auto DescriptorWriter::Build(VkDescriptorSet &set) -> bool {
+    SATURN_ASSERT(m_pool != nullptr, "DescriptorWriter was created without a pool");
     bool success = m_pool->AllocateDescriptor(m_set_layout->GetDescriptorSetLayout(), set);
     if (!success) {
         ENGINE_LOG_ERROR("Can't allocate descriptor");
         return false;
     }
+    // 新分配的set可能复用了已释放set的handle
+    if (m_cache) { m_cache->Invalidate(set); }
     Overwrite(set);
     return true;
 }
 
-void DescriptorWriter::Overwrite(VkDescriptorSet &set) {
-    for (auto &write: m_writes) {
-        write.dstSet = set;
+auto DescriptorWriter::Build(DescriptorAllocator &allocator, VkDescriptorSet &set) -> bool {
+    if (!allocator.Allocate(m_set_layout->GetDescriptorSetLayout(), set)) { return false; }
+    if (m_cache) { m_cache->Invalidate(set); }
+    Overwrite(set);
+    return true;
+}
+
+auto DescriptorWriter::CanUseUpdateTemplate(const VkWriteDescriptorSet *writes, uint32_t write_count) const -> bool {
+    if (!m_use_update_template || m_set_layout->GetUpdateTemplate() == VK_NULL_HANDLE ||
+        write_count != m_set_layout->GetBindings().size()) {
+        return false;
+    }
+
+    // 模板会写入所有槽位，必须保证每个binding恰好被写入一次
+    uint32_t written_slots = 0;
+    for (uint32_t i = 0; i < write_count; ++i) {
+        written_slots |= 1u << m_set_layout->GetBindingSlot(writes[i].dstBinding);
     }
-    vkUpdateDescriptorSets(m_pool->GetDevice()->GetVkDevice(), m_writes.size(), m_writes.data(), 0, nullptr);
+    return written_slots == (1u << write_count) - 1;
 }
 
+void DescriptorWriter::Overwrite(VkDescriptorSet &set) {
+    std::array<VkWriteDescriptorSet, kMaxWrites> writes{};
+    for (uint32_t i = 0; i < m_write_count; ++i) {
+        writes[i] = m_writes[i];
+        writes[i].dstSet = set;
+        // writer可能被拷贝过，指针需要重新指向本对象的m_infos
+        if (writes[i].pImageInfo != nullptr) { writes[i].pImageInfo = &m_infos[i].m_image_info; }
+        if (writes[i].pBufferInfo != nullptr) { writes[i].pBufferInfo = &m_infos[i].m_buffer_info; }
+    }
+
+    uint32_t write_count = m_write_count;
+    if (m_cache) { write_count = m_cache->Filter(set, writes.data(), write_count); }
+    if (write_count == 0) { return; }
+
+    auto render_device = m_set_layout->GetDevice();
+
+    if (CanUseUpdateTemplate(writes.data(), write_count)) {
+        std::array<DescriptorInfo, kMaxWrites> template_data{};
+        for (uint32_t i = 0; i < write_count; ++i) {
+            auto slot = m_set_layout->GetBindingSlot(writes[i].dstBinding);
+            if (writes[i].pImageInfo != nullptr) {
+                template_data[slot].m_image_info = *writes[i].pImageInfo;
+            } else {
+                template_data[slot].m_buffer_info = *writes[i].pBufferInfo;
+            }
+        }
+        render_device->GetExtensionFunctions().m_update_descriptor_set_with_template(
+                render_device->GetVkDevice(), set, m_set_layout->GetUpdateTemplate(), template_data.data());
+        return;
+    }
 
+    vkUpdateDescriptorSets(render_device->GetVkDevice(), write_count, writes.data(), 0, nullptr);
 }
 
 }// namespace saturn
\ No newline at end of file
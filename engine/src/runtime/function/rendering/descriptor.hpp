@@ -42,6 +42,8 @@ public:
     [[nodiscard]] auto GetDevice() const -> std::shared_ptr<Device> { return m_render_device; }
 
     auto AllocateDescriptor(VkDescriptorSetLayout descriptor_set_layout, VkDescriptorSet &descriptor_set) const -> bool;
+    auto TryAllocateDescriptor(VkDescriptorSetLayout descriptor_set_layout, VkDescriptorSet &descriptor_set) const
+            -> VkResult;
 
     void FreeDescriptors(std::vector<VkDescriptorSet> &descriptor_sets) const;
 
@@ -54,6 +56,8 @@ private:
     friend class DescriptorWriter;
 };
 
+class DescriptorLayoutCache;
+
 class DescriptorSetLayout {
 public:
     //-----------------------------------Builder-------------------------------------
@@ -65,6 +69,11 @@ public:
                         uint32_t count = 1) -> Builder &;
         [[nodiscard]] auto Build() const -> std::unique_ptr<DescriptorSetLayout>;
 
+        /**
+         * @brief 通过cache创建，binding完全相同的layout只会创建一次
+         */
+        [[nodiscard]] auto Build(DescriptorLayoutCache &layout_cache) const -> std::shared_ptr<DescriptorSetLayout>;
+
     private:
         std::shared_ptr<Device> m_render_device;
         std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings{};
@@ -78,35 +87,193 @@ public:
     auto operator=(const DescriptorSetLayout &) -> DescriptorSetLayout & = delete;
 
     [[nodiscard]] auto GetDescriptorSetLayout() const -> VkDescriptorSetLayout { return m_descriptor_set_layout; }
-    [[nodiscard]] auto GetBindings() -> std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> & {
-        return m_bindings;
-    }
+    [[nodiscard]] auto GetDevice() const -> std::shared_ptr<Device> { return m_render_device; }
+
+    /**
+     * @brief 按binding升序排列的binding数组
+     */
+    [[nodiscard]] auto GetBindings() const -> const std::vector<VkDescriptorSetLayoutBinding> & { return m_bindings; }
+
+    /**
+     * @brief 二分查找binding，不存在时返回nullptr
+     */
+    [[nodiscard]] auto FindBinding(uint32_t binding) const -> const VkDescriptorSetLayoutBinding *;
+
+    /**
+     * @brief binding在m_bindings中的下标，同时也是该binding在update template数据中的槽位
+     */
+    [[nodiscard]] auto GetBindingSlot(uint32_t binding) const -> uint32_t;
+
+    /**
+     * @brief 每个binding对应一个DescriptorInfo槽位的update template，设备不支持或layout含数组binding时为VK_NULL_HANDLE
+     */
+    [[nodiscard]] auto GetUpdateTemplate() const -> VkDescriptorUpdateTemplateKHR { return m_update_template; }
 
 private:
+    void CreateUpdateTemplate();
+
     std::shared_ptr<Device> m_render_device;
     VkDescriptorSetLayout m_descriptor_set_layout;
-    std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> m_bindings;
+    VkDescriptorUpdateTemplateKHR m_update_template = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSetLayoutBinding> m_bindings;
+};
+
+/**
+ * @brief update template数据中的一个槽位，image与buffer共用同一块内存
+ */
+union DescriptorInfo {
+    VkDescriptorImageInfo m_image_info;
+    VkDescriptorBufferInfo m_buffer_info;
+};
+
+/**
+ * @brief 按binding内容缓存DescriptorSetLayout，避免重复创建相同的layout
+ */
+class DescriptorLayoutCache {
+public:
+    explicit DescriptorLayoutCache(std::shared_ptr<Device> render_device) : m_render_device{std::move(render_device)} {}
+    DescriptorLayoutCache(const DescriptorLayoutCache &) = delete;
+    auto operator=(const DescriptorLayoutCache &) -> DescriptorLayoutCache & = delete;
+
+    auto GetOrCreate(const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> &bindings)
+            -> std::shared_ptr<DescriptorSetLayout>;
+
+    [[nodiscard]] auto GetLayoutCount() const -> size_t { return m_layouts.size(); }
+    [[nodiscard]] auto GetHitCount() const -> uint64_t { return m_hit_count; }
+
+private:
+    struct LayoutKey {
+        std::vector<VkDescriptorSetLayoutBinding> m_bindings;// 按binding排序
+
+        auto operator==(const LayoutKey &other) const -> bool;
+    };
+
+    struct LayoutKeyHash {
+        auto operator()(const LayoutKey &key) const -> size_t;
+    };
+
+    std::shared_ptr<Device> m_render_device;
+    std::unordered_map<LayoutKey, std::shared_ptr<DescriptorSetLayout>, LayoutKeyHash> m_layouts{};
+    uint64_t m_hit_count = 0;
+};
+
+/**
+ * @brief 可增长的descriptor set分配器
+ *
+ * 当前pool耗尽(VK_ERROR_OUT_OF_POOL_MEMORY / VK_ERROR_FRAGMENTED_POOL)时自动创建新的pool接在链上，
+ * 每个新pool的容量翻倍。ResetPools会重置链上所有pool，适合每帧重置的临时descriptor set。
+ */
+class DescriptorAllocator {
+public:
+    struct PoolSizeRatio {
+        VkDescriptorType m_type;
+        float m_ratio;// 每个set平均需要的该类型descriptor数量
+    };
+
+    DescriptorAllocator(std::shared_ptr<Device> render_device, uint32_t initial_sets_per_pool,
+                        std::vector<PoolSizeRatio> pool_size_ratios, VkDescriptorPoolCreateFlags pool_flags = 0);
+    DescriptorAllocator(const DescriptorAllocator &) = delete;
+    auto operator=(const DescriptorAllocator &) -> DescriptorAllocator & = delete;
+
+    auto Allocate(VkDescriptorSetLayout descriptor_set_layout, VkDescriptorSet &descriptor_set) -> bool;
+
+    /**
+     * @brief 重置所有pool，由此分配的descriptor set全部失效。调用者需保证这些set不再被GPU使用
+     */
+    void ResetPools();
+
+    [[nodiscard]] auto GetDevice() const -> std::shared_ptr<Device> { return m_render_device; }
+    [[nodiscard]] auto GetPoolCount() const -> size_t { return m_ready_pools.size() + m_full_pools.size(); }
+    [[nodiscard]] auto GetAllocatedSetCount() const -> uint64_t { return m_allocated_set_count; }
+
+private:
+    auto AcquirePool() -> std::shared_ptr<DescriptorPool>;
+    auto CreatePool(uint32_t set_count) -> std::shared_ptr<DescriptorPool>;
+
+    static constexpr uint32_t kMaxSetsPerPool = 4096;
+
+    std::shared_ptr<Device> m_render_device;
+    std::vector<PoolSizeRatio> m_pool_size_ratios;
+    VkDescriptorPoolCreateFlags m_pool_flags;
+    uint32_t m_sets_per_pool;
+
+    std::vector<std::shared_ptr<DescriptorPool>> m_ready_pools{};// 仍可分配的pool，末尾为当前pool
+    std::vector<std::shared_ptr<DescriptorPool>> m_full_pools{};
+    uint64_t m_allocated_set_count = 0;
 };
 
+/**
+ * @brief 记录每个descriptor set上各binding最近一次写入的资源，用于跳过内容完全相同的重复更新
+ *
+ * @note 只比较handle，若某个被引用的资源被销毁并重建，handle可能被驱动复用，此时需要调用Invalidate
+ */
+class DescriptorWriteCache {
+public:
+    /**
+     * @brief 原地移除与已记录状态相同的写入，并记录剩余写入的新状态
+     *
+     * @return 剩余的写入数量
+     */
+    auto Filter(VkDescriptorSet set, VkWriteDescriptorSet *writes, uint32_t write_count) -> uint32_t;
+
+    void Invalidate(VkDescriptorSet set);
+    void Invalidate(VkDescriptorSet set, uint32_t binding);
+
+    [[nodiscard]] auto GetSkippedWriteCount() const -> uint64_t { return m_skipped_write_count; }
+    [[nodiscard]] auto GetAppliedWriteCount() const -> uint64_t { return m_applied_write_count; }
+
+private:
+    struct BindingState {
+        VkDescriptorType m_type;
+        VkDescriptorBufferInfo m_buffer_info;
+        VkDescriptorImageInfo m_image_info;
+
+        auto operator==(const BindingState &other) const -> bool;
+    };
+
+    static auto MakeBindingState(const VkWriteDescriptorSet &write) -> BindingState;
+
+    std::unordered_map<VkDescriptorSet, std::unordered_map<uint32_t, BindingState>> m_set_states{};
+    uint64_t m_skipped_write_count = 0;
+    uint64_t m_applied_write_count = 0;
+};
+
+/**
+ * @brief 记录对一个descriptor set的写入，所有写入与资源信息保存在定长数组中，写入过程不产生堆分配
+ *
+ * 当写入恰好覆盖layout的全部binding时使用update template一次性更新，否则退回vkUpdateDescriptorSets
+ */
 class DescriptorWriter {
 public:
-    DescriptorWriter(std::shared_ptr<DescriptorSetLayout> set_layout, std::shared_ptr<DescriptorPool> pool);
+    static constexpr uint32_t kMaxWrites = 16;
+
+    DescriptorWriter(std::shared_ptr<DescriptorSetLayout> set_layout, std::shared_ptr<DescriptorPool> pool,
+                     std::shared_ptr<DescriptorWriteCache> cache = nullptr);
 
-    auto WriteBuffer(uint32_t binding, VkDescriptorBufferInfo *buffer_info) -> DescriptorWriter &;
+    auto WriteBuffer(uint32_t binding, const VkDescriptorBufferInfo *buffer_info) -> DescriptorWriter &;
 
     /**
      * @brief 将descriptor中的采样器与真正的图像资源绑定
      */
-    auto WriteImage(uint32_t binding, VkDescriptorImageInfo *image_info) -> DescriptorWriter &;
+    auto WriteImage(uint32_t binding, const VkDescriptorImageInfo *image_info) -> DescriptorWriter &;
+
+    auto SetUseUpdateTemplate(bool use_update_template) -> DescriptorWriter &;
 
     auto Build(VkDescriptorSet &set) -> bool;
+    auto Build(DescriptorAllocator &allocator, VkDescriptorSet &set) -> bool;
     void Overwrite(VkDescriptorSet &set);
 
 private:
+    auto AddWrite(uint32_t binding) -> VkWriteDescriptorSet &;
+    [[nodiscard]] auto CanUseUpdateTemplate(const VkWriteDescriptorSet *writes, uint32_t write_count) const -> bool;
+
     std::shared_ptr<DescriptorSetLayout> m_set_layout;
     std::shared_ptr<DescriptorPool> m_pool;
-    const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> &m_bindings;
-    std::vector<VkWriteDescriptorSet> m_writes;
+    std::shared_ptr<DescriptorWriteCache> m_cache;
+    std::array<VkWriteDescriptorSet, kMaxWrites> m_writes{};
+    std::array<DescriptorInfo, kMaxWrites> m_infos{};// 与m_writes一一对应，保存资源信息的副本
+    uint32_t m_write_count = 0;
+    bool m_use_update_template = true;
 };
 
 }// namespace rendering
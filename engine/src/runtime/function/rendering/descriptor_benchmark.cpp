@@ -0,0 +1,97 @@
+#include "descriptor_benchmark.hpp"
+
+#include <runtime/function/rendering/buffer.hpp>
+
+namespace saturn {
+
+namespace rendering {
+
+namespace {
+
+// 与shading的descriptor set规模相当
+constexpr uint32_t kBindingCount = 8;
+
+/**
+ * @brief 按DescriptorWriter改为定长数组之前的方式写入：每个writer拷贝一份binding哈希表，每次写入查表后追加到std::vector
+ */
+void LegacyWrite(VkDevice device, const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> &layout_bindings,
+                 const VkDescriptorBufferInfo &buffer_info, VkDescriptorSet set) {
+    std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings = layout_bindings;
+    std::vector<VkWriteDescriptorSet> writes;
+    for (uint32_t binding = 0; binding < kBindingCount; ++binding) {
+        SATURN_ASSERT(bindings.count(binding) == 1, "Layout does not contain specified binding");
+        const auto &binding_description = bindings.at(binding);
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.descriptorType = binding_description.descriptorType;
+        write.dstBinding = binding;
+        write.pBufferInfo = &buffer_info;
+        write.descriptorCount = 1;
+        writes.push_back(write);
+    }
+    for (auto &write: writes) { write.dstSet = set; }
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+template<typename WriteFunction>
+auto MeasureWritesPerSecond(uint32_t iterations, WriteFunction &&write_set) -> double {
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < iterations; ++i) { write_set(); }
+    double seconds =
+            std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_time).count();
+    return seconds > 0.0 ? static_cast<double>(iterations) * kBindingCount / seconds : 0.0;
+}
+
+}// namespace
+
+auto RunDescriptorWriteBenchmark(const std::shared_ptr<Device> &render_device, DescriptorLayoutCache &layout_cache,
+                                 uint32_t iterations) -> DescriptorWriteBenchmarkResult {
+    DescriptorSetLayout::Builder layout_builder(render_device);
+    layout_builder.AddBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT);
+    for (uint32_t binding = 1; binding < kBindingCount; ++binding) {
+        layout_builder.AddBinding(binding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT);
+    }
+    auto set_layout = layout_builder.Build(layout_cache);
+
+    std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> layout_bindings;
+    for (const auto &binding: set_layout->GetBindings()) { layout_bindings[binding.binding] = binding; }
+
+    // 独立的pool，set随pool一起释放
+    auto pool = DescriptorPool::Builder(render_device)
+                        .AddPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1)
+                        .AddPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, kBindingCount - 1)
+                        .Build();
+    VkDescriptorSet set = VK_NULL_HANDLE;
+    if (!pool->AllocateDescriptor(set_layout->GetDescriptorSetLayout(), set)) {
+        throw std::runtime_error("failed to allocate benchmark descriptor set!");
+    }
+
+    Buffer buffer(render_device, 256, 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    auto buffer_info = buffer.CreateDescriptorBufferInfo();
+
+    auto write_with_writer = [&](bool use_update_template) {
+        DescriptorWriter writer(set_layout, nullptr);
+        writer.SetUseUpdateTemplate(use_update_template);
+        for (uint32_t binding = 0; binding < kBindingCount; ++binding) { writer.WriteBuffer(binding, &buffer_info); }
+        writer.Overwrite(set);
+    };
+
+    DescriptorWriteBenchmarkResult result{};
+    result.m_legacy_writes_per_second = MeasureWritesPerSecond(
+            iterations, [&]() { LegacyWrite(render_device->GetVkDevice(), layout_bindings, buffer_info, set); });
+    result.m_writer_writes_per_second = MeasureWritesPerSecond(iterations, [&]() { write_with_writer(false); });
+    if (set_layout->GetUpdateTemplate() != VK_NULL_HANDLE) {
+        result.m_template_writes_per_second = MeasureWritesPerSecond(iterations, [&]() { write_with_writer(true); });
+    }
+
+    ENGINE_LOG_INFO("Descriptor writes/s legacy:{:.0f} writer:{:.0f} template:{:.0f}",
+                    result.m_legacy_writes_per_second, result.m_writer_writes_per_second,
+                    result.m_template_writes_per_second);
+    return result;
+}
+
+}// namespace rendering
+
+}// namespace saturn
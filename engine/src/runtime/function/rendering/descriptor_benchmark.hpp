@@ -0,0 +1,30 @@
+#pragma once
+
+#include <engine_pch.hpp>
+#include <runtime/function/rendering/descriptor.hpp>
+
+namespace saturn {
+
+namespace rendering {
+
+/**
+ * @brief 各descriptor写入路径每秒完成的写入数，一次写入对应一个binding
+ */
+struct DescriptorWriteBenchmarkResult {
+    double m_legacy_writes_per_second = 0.0;  // 改为定长数组之前的写法：拷贝binding哈希表，写入追加到std::vector
+    double m_writer_writes_per_second = 0.0;  // DescriptorWriter关闭update template，退回vkUpdateDescriptorSets
+    double m_template_writes_per_second = 0.0;// DescriptorWriter使用update template，设备不支持时为0
+};
+
+/**
+ * @brief 用只含buffer的layout反复整体写入同一个未被使用的descriptor set，不经过DescriptorWriteCache
+ *
+ * 在调用线程上同步执行，只测量CPU开销
+ * @param iterations 每条路径整体写入该set的次数
+ */
+auto RunDescriptorWriteBenchmark(const std::shared_ptr<Device> &render_device, DescriptorLayoutCache &layout_cache,
+                                 uint32_t iterations) -> DescriptorWriteBenchmarkResult;
+
+}// namespace rendering
+
+}// namespace saturn
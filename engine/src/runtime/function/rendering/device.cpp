@@ -7,16 +7,26 @@ namespace saturn {
 
 namespace rendering {
 
-Device::Device(const std::string &engine_name, const std::string &game_name, std::shared_ptr<Window> window) : m_render_window(std::move(window)) {
+Device::Device(const std::string &engine_name, const std::string &game_name, std::shared_ptr<Window> window)
+    : m_render_window(std::move(window)), m_deletion_queue(*this) {
     CreateInstance(engine_name, game_name);
     CreateSurface();
     PickPhysicalDevice();
     CreateLogicalDevice();
-    CreateCommandPool();
+    LoadExtensionFunctions();
+    CreateCommandPools();
+    m_frame_timeline = std::make_unique<FrameTimeline>(*this);
+    m_upload_queue = std::make_unique<UploadQueue>(*this);
 }
 
 Device::~Device() {
-    vkDestroyCommandPool(m_device, m_command_pool, nullptr);
+    // 调用者已等待设备空闲，剩余的延迟销毁需在销毁VkDevice与command pool之前执行
+    m_upload_queue.reset();
+    m_deletion_queue.Flush();
+    m_frame_timeline.reset();
+    for (const auto &[queue_family, command_pool]: m_command_pools) {
+        vkDestroyCommandPool(m_device, command_pool, nullptr);
+    }
     vkDestroySurfaceKHR(m_vk_instance, m_surface, nullptr);
     vkDestroyDevice(m_device, nullptr);
 }
@@ -32,7 +42,8 @@ void Device::CreateInstance(const std::string &engine_name, const std::string &g
     app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     app_info.pEngineName = game_name.c_str();
     app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    app_info.apiVersion = VK_API_VERSION_1_0;
+    m_instance_api_version = GetInstanceApiVersion();
+    app_info.apiVersion = m_instance_api_version;
 
     VkInstanceCreateInfo create_info{};
     create_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -139,6 +150,9 @@ void Device::PickPhysicalDevice() {
         if (IsPhyDeviceSuitable(device)) {
             m_physical_device = device;
             m_msaa_samples_flag = GetMaxUsableSampleCount();
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties(m_physical_device, &properties);
+            m_api_version = std::min(m_instance_api_version, properties.apiVersion);
             break;
         }
     }
@@ -149,9 +163,21 @@ void Device::PickPhysicalDevice() {
 
 void Device::CreateLogicalDevice() {
     QueueFamilyIndices indices = FindQueueFamilies(m_physical_device);
+    m_queue_family_indices = indices;
 
     std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
     std::set<uint32_t> unique_queue_families = {indices.m_graphics_family.value(), indices.m_present_family.value()};
+    if (indices.m_compute_family.has_value()) { unique_queue_families.insert(indices.m_compute_family.value()); }
+    if (indices.m_transfer_family.has_value()) { unique_queue_families.insert(indices.m_transfer_family.value()); }
+    // present队列只用于vkQueuePresentKHR，不访问任何资源
+    m_unique_queue_families = {indices.m_graphics_family.value()};
+    for (auto queue_family: {indices.m_compute_family, indices.m_transfer_family}) {
+        if (queue_family.has_value() &&
+            std::find(m_unique_queue_families.begin(), m_unique_queue_families.end(), queue_family.value()) ==
+                    m_unique_queue_families.end()) {
+            m_unique_queue_families.push_back(queue_family.value());
+        }
+    }
 
     float queue_priority = 1.0f;
     for (uint32_t queue_family: unique_queue_families) {
@@ -163,8 +189,15 @@ void Device::CreateLogicalDevice() {
         queue_create_infos.push_back(queue_create_info);
     }
 
+    VkPhysicalDeviceFeatures supported_features{};
+    vkGetPhysicalDeviceFeatures(m_physical_device, &supported_features);
+
     VkPhysicalDeviceFeatures device_features{};
     device_features.samplerAnisotropy = VK_TRUE;
+    // GPU剔除写出的间接绘制命令通过firstInstance传递物体下标
+    device_features.drawIndirectFirstInstance = supported_features.drawIndirectFirstInstance;
+    device_features.multiDrawIndirect = supported_features.multiDrawIndirect;
+    m_enabled_features = device_features;
 
     VkDeviceCreateInfo create_info{};
     create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -174,8 +207,26 @@ void Device::CreateLogicalDevice() {
 
     create_info.pEnabledFeatures = &device_features;
 
-    create_info.enabledExtensionCount = static_cast<uint32_t>(m_device_extensions.size());
-    create_info.ppEnabledExtensionNames = m_device_extensions.data();
+    std::vector<const char *> enabled_extensions = m_device_extensions;
+    for (const auto *extension: GetSupportedOptionalExtensions(m_physical_device)) {
+        enabled_extensions.push_back(extension);
+    }
+    for (const auto *extension: enabled_extensions) {
+        m_enabled_device_extensions.insert(extension);
+        ENGINE_LOG_INFO("Enable device extension: {}", extension);
+    }
+
+    create_info.enabledExtensionCount = static_cast<uint32_t>(enabled_extensions.size());
+    create_info.ppEnabledExtensionNames = enabled_extensions.data();
+
+    // Vulkan 1.2与支持该扩展的设备都必须支持timelineSemaphore特性
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timeline_semaphore_features{};
+    timeline_semaphore_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+    timeline_semaphore_features.timelineSemaphore = VK_TRUE;
+    if (m_api_version >= VK_API_VERSION_1_2 ||
+        m_enabled_device_extensions.contains(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME)) {
+        create_info.pNext = &timeline_semaphore_features;
+    }
 
     if (m_enable_validation_layers) {
         create_info.enabledLayerCount = static_cast<uint32_t>(m_validation_layers.size());
@@ -190,6 +241,73 @@ void Device::CreateLogicalDevice() {
 
     vkGetDeviceQueue(m_device, indices.m_graphics_family.value(), 0, &m_graphics_queue);
     vkGetDeviceQueue(m_device, indices.m_present_family.value(), 0, &m_present_queue);
+    vkGetDeviceQueue(m_device, GetQueueFamilyIndex(QueueType::Compute), 0, &m_compute_queue);
+    vkGetDeviceQueue(m_device, GetQueueFamilyIndex(QueueType::Transfer), 0, &m_transfer_queue);
+
+    ENGINE_LOG_INFO("Queue families graphics:{} compute:{} transfer:{}", GetQueueFamilyIndex(QueueType::Graphics),
+                    GetQueueFamilyIndex(QueueType::Compute), GetQueueFamilyIndex(QueueType::Transfer));
+}
+
+auto Device::GetQueue(QueueType queue_type) -> VkQueue {
+    switch (queue_type) {
+        case QueueType::Compute:
+            return m_compute_queue;
+        case QueueType::Transfer:
+            return m_transfer_queue;
+        default:
+            return m_graphics_queue;
+    }
+}
+
+auto Device::GetQueueFamilyIndex(QueueType queue_type) const -> uint32_t {
+    switch (queue_type) {
+        case QueueType::Compute:
+            return m_queue_family_indices.m_compute_family.value_or(m_queue_family_indices.m_graphics_family.value());
+        case QueueType::Transfer:
+            return m_queue_family_indices.m_transfer_family.value_or(
+                    m_queue_family_indices.m_compute_family.value_or(m_queue_family_indices.m_graphics_family.value()));
+        default:
+            return m_queue_family_indices.m_graphics_family.value();
+    }
+}
+
+void Device::LoadExtensionFunctions() {
+    if (IsDeviceExtensionEnabled(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME)) {
+        m_extension_functions.m_create_descriptor_update_template =
+                reinterpret_cast<PFN_vkCreateDescriptorUpdateTemplateKHR>(
+                        vkGetDeviceProcAddr(m_device, "vkCreateDescriptorUpdateTemplateKHR"));
+        m_extension_functions.m_destroy_descriptor_update_template =
+                reinterpret_cast<PFN_vkDestroyDescriptorUpdateTemplateKHR>(
+                        vkGetDeviceProcAddr(m_device, "vkDestroyDescriptorUpdateTemplateKHR"));
+        m_extension_functions.m_update_descriptor_set_with_template =
+                reinterpret_cast<PFN_vkUpdateDescriptorSetWithTemplateKHR>(
+                        vkGetDeviceProcAddr(m_device, "vkUpdateDescriptorSetWithTemplateKHR"));
+    }
+    if (IsDeviceExtensionEnabled(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME)) {
+        m_extension_functions.m_cmd_draw_indexed_indirect_count =
+                reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+                        vkGetDeviceProcAddr(m_device, "vkCmdDrawIndexedIndirectCountKHR"));
+    }
+    if (m_api_version >= VK_API_VERSION_1_2) {
+        m_extension_functions.m_get_semaphore_counter_value = reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(
+                vkGetDeviceProcAddr(m_device, "vkGetSemaphoreCounterValue"));
+        m_extension_functions.m_wait_semaphores =
+                reinterpret_cast<PFN_vkWaitSemaphoresKHR>(vkGetDeviceProcAddr(m_device, "vkWaitSemaphores"));
+    } else if (IsDeviceExtensionEnabled(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME)) {
+        m_extension_functions.m_get_semaphore_counter_value = reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(
+                vkGetDeviceProcAddr(m_device, "vkGetSemaphoreCounterValueKHR"));
+        m_extension_functions.m_wait_semaphores =
+                reinterpret_cast<PFN_vkWaitSemaphoresKHR>(vkGetDeviceProcAddr(m_device, "vkWaitSemaphoresKHR"));
+    }
+}
+
+auto Device::GetInstanceApiVersion() -> uint32_t {
+    // vkEnumerateInstanceVersion是1.1新增的，1.0的加载器上为空
+    auto enumerate_instance_version = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(
+            vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion"));
+    uint32_t api_version = VK_API_VERSION_1_0;
+    if (enumerate_instance_version != nullptr) { enumerate_instance_version(&api_version); }
+    return std::min(api_version, VK_API_VERSION_1_2);
 }
 
 auto Device::GetMaxUsableSampleCount() -> VkSampleCountFlagBits {
@@ -197,6 +315,7 @@ auto Device::GetMaxUsableSampleCount() -> VkSampleCountFlagBits {
     vkGetPhysicalDeviceProperties(m_physical_device, &physical_device_properties);
 
     VkSampleCountFlags counts = physical_device_properties.limits.framebufferColorSampleCounts & physical_device_properties.limits.framebufferDepthSampleCounts;
+    m_supported_msaa_samples = counts;
     if (counts & VK_SAMPLE_COUNT_64_BIT) { return VK_SAMPLE_COUNT_64_BIT; }
     if (counts & VK_SAMPLE_COUNT_32_BIT) { return VK_SAMPLE_COUNT_32_BIT; }
     if (counts & VK_SAMPLE_COUNT_16_BIT) { return VK_SAMPLE_COUNT_16_BIT; }
@@ -220,9 +339,26 @@ auto Device::GetRequiredExtensions() const -> std::vector<const char *> {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
     }
 
+    // 设备扩展VK_KHR_timeline_semaphore依赖它
+    if (IsInstanceExtensionSupported(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)) {
+        extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+    }
+
     return extensions;
 }
 
+auto Device::IsInstanceExtensionSupported(const char *extension_name) -> bool {
+    uint32_t extension_count = 0;
+    vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, nullptr);
+
+    std::vector<VkExtensionProperties> available_extensions(extension_count);
+    vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, available_extensions.data());
+
+    return std::any_of(available_extensions.begin(), available_extensions.end(), [&](const auto &extension) {
+        return strcmp(extension_name, extension.extensionName) == 0;
+    });
+}
+
 auto Device::IsPhyDeviceSuitable(VkPhysicalDevice device) -> bool {
     QueueFamilyIndices indices = FindQueueFamilies(device);
 
@@ -249,39 +385,50 @@ auto Device::FindQueueFamilies(VkPhysicalDevice device) -> QueueFamilyIndices {
     std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
     vkGetPhysicalDeviceQueueFamilyProperties(device, &queue_family_count, queue_families.data());
 
-    int i = 0;
-    for (const auto &queue_family: queue_families) {
-        if (queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+    std::optional<uint32_t> transfer_fallback;
+    for (uint32_t i = 0; i < queue_family_count; ++i) {
+        auto queue_flags = queue_families[i].queueFlags;
+        if ((queue_flags & VK_QUEUE_GRAPHICS_BIT) && !indices.m_graphics_family.has_value()) {
             indices.m_graphics_family = i;
         }
 
+        // 优先与graphics同族，present不需要额外的同步
         VkBool32 present_support = 0u;
         vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &present_support);
-
-        if (present_support) {
+        if (present_support && (!indices.m_present_family.has_value() || indices.m_graphics_family == i)) {
             indices.m_present_family = i;
         }
 
-        if (indices.IsComplete()) {
-            break;
+        if (queue_flags & VK_QUEUE_GRAPHICS_BIT) { continue; }
+        if ((queue_flags & VK_QUEUE_COMPUTE_BIT) && !indices.m_compute_family.has_value()) {
+            indices.m_compute_family = i;
+        }
+        // 只含transfer能力的族通常对应独立的DMA引擎，compute族同样可以执行拷贝
+        if ((queue_flags & VK_QUEUE_TRANSFER_BIT) && !(queue_flags & VK_QUEUE_COMPUTE_BIT) &&
+            !indices.m_transfer_family.has_value()) {
+            indices.m_transfer_family = i;
+        }
+        if ((queue_flags & VK_QUEUE_COMPUTE_BIT) && indices.m_compute_family != i && !transfer_fallback.has_value()) {
+            transfer_fallback = i;
         }
-
-        i++;
     }
+    if (!indices.m_transfer_family.has_value()) { indices.m_transfer_family = transfer_fallback; }
 
     return indices;
 }
 
-void Device::CreateCommandPool() {
-    QueueFamilyIndices queue_family_indices = FindQueueFamilies(m_physical_device);
+void Device::CreateCommandPools() {
+    for (auto queue_family: m_unique_queue_families) {
+        VkCommandPoolCreateInfo pool_info{};
+        pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        pool_info.queueFamilyIndex = queue_family;
 
-    VkCommandPoolCreateInfo pool_info{};
-    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-    pool_info.queueFamilyIndex = queue_family_indices.m_graphics_family.value();
-
-    if (vkCreateCommandPool(m_device, &pool_info, nullptr, &m_command_pool) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create graphics command pool!");
+        VkCommandPool command_pool;
+        if (vkCreateCommandPool(m_device, &pool_info, nullptr, &command_pool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create command pool!");
+        }
+        m_command_pools.emplace(queue_family, command_pool);
     }
 }
 
@@ -301,6 +448,31 @@ auto Device::CheckDeviceExtensionSupport(VkPhysicalDevice device) -> bool {
     return required_extensions.empty();
 }
 
+auto Device::GetSupportedOptionalExtensions(VkPhysicalDevice device) -> std::vector<const char *> {
+    uint32_t extension_count;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extension_count, nullptr);
+
+    std::vector<VkExtensionProperties> available_extensions(extension_count);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extension_count, available_extensions.data());
+
+    std::vector<const char *> supported_extensions{};
+    for (const auto *optional_extension: m_optional_device_extensions) {
+        // 已是核心功能，或依赖的实例扩展未启用
+        if (strcmp(optional_extension, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) == 0 &&
+            (m_api_version >= VK_API_VERSION_1_2 ||
+             !IsInstanceExtensionSupported(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME))) {
+            continue;
+        }
+        for (const auto &extension: available_extensions) {
+            if (strcmp(optional_extension, extension.extensionName) == 0) {
+                supported_extensions.push_back(optional_extension);
+                break;
+            }
+        }
+    }
+    return supported_extensions;
+}
+
 auto Device::QuerySwapChainSupport(VkPhysicalDevice device) -> SwapChainSupportDetails {
     SwapChainSupportDetails details;
 
@@ -364,12 +536,13 @@ void Device::CreateBuffer(VkDeviceSize size,
                                 VkBufferUsageFlags usage,
                                 VkMemoryPropertyFlags properties,
                                 VkBuffer &buffer,
-                                VkDeviceMemory &buffer_memory) {
+                                VkDeviceMemory &buffer_memory,
+                                VkSharingMode sharing_mode) {
     VkBufferCreateInfo buffer_info{};
     buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     buffer_info.size = size;
     buffer_info.usage = usage;
-    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    FillSharingMode(sharing_mode, buffer_info);
 
     if (m_device == nullptr) {
         ENGINE_LOG_ERROR("m_device is invalid");
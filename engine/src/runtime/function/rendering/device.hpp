@@ -2,6 +2,9 @@
 
 #include <engine_pch.hpp>
 
+#include "deletion_queue.hpp"
+#include "frame_timeline.hpp"
+#include "upload_queue.hpp"
 #include "window.hpp"
 
 namespace saturn {
@@ -14,14 +17,39 @@ struct SwapChainSupportDetails {
     std::vector<VkPresentModeKHR> presentModes;
 };
 
+/**
+ * @brief 设备上没有对应的独立队列族时，Compute与Transfer回退到graphics队列
+ */
+enum class QueueType {
+    Graphics,
+    Compute, // 不含graphics能力的async compute队列
+    Transfer,// 优先只含transfer能力的DMA队列
+};
+
 struct QueueFamilyIndices {
     std::optional<uint32_t> m_graphics_family;
     std::optional<uint32_t> m_present_family;
+    // 以下两项只记录与graphics不同的队列族
+    std::optional<uint32_t> m_compute_family;
+    std::optional<uint32_t> m_transfer_family;
     [[nodiscard]] auto IsComplete() const -> bool {
         return m_graphics_family.has_value() && m_present_family.has_value();
     }
 };
 
+/**
+ * @brief 通过vkGetDeviceProcAddr加载的扩展函数，对应扩展未启用时为nullptr；已提升为核心的功能在设备支持该版本时
+ * 加载核心版本的函数
+ */
+struct DeviceExtensionFunctions {
+    PFN_vkCreateDescriptorUpdateTemplateKHR m_create_descriptor_update_template = nullptr;
+    PFN_vkDestroyDescriptorUpdateTemplateKHR m_destroy_descriptor_update_template = nullptr;
+    PFN_vkUpdateDescriptorSetWithTemplateKHR m_update_descriptor_set_with_template = nullptr;
+    PFN_vkCmdDrawIndexedIndirectCountKHR m_cmd_draw_indexed_indirect_count = nullptr;
+    PFN_vkGetSemaphoreCounterValueKHR m_get_semaphore_counter_value = nullptr;
+    PFN_vkWaitSemaphoresKHR m_wait_semaphores = nullptr;
+};
+
 class Device {
 public:
     explicit Device(const std::string &engine_name, const std::string &game_name, std::shared_ptr<Window> window);
@@ -34,14 +62,65 @@ public:
     [[nodiscard]] auto GetVkInstance() -> VkInstance { return m_vk_instance; };
     [[nodiscard]] auto IsEnableValidationLayers() const -> bool { return m_enable_validation_layers; };
     [[nodiscard]] auto GetValidationLayers() const -> std::vector<const char *> { return m_validation_layers; }
-    auto GetCommandPool() -> VkCommandPool { return m_command_pool; }
+    /**
+     * @brief 每个队列族一个command pool，录制的command buffer只能提交到该族的队列
+     */
+    auto GetCommandPool(QueueType queue_type = QueueType::Graphics) -> VkCommandPool {
+        return m_command_pools.at(GetQueueFamilyIndex(queue_type));
+    }
     auto GetPhyDevice() -> VkPhysicalDevice { return m_physical_device; }
     auto GetVkDevice() -> VkDevice { return m_device; }
     auto GetGraphicsQueue() -> VkQueue { return m_graphics_queue; }
     auto GetPresentQueue() -> VkQueue { return m_present_queue; }
+    auto GetQueue(QueueType queue_type) -> VkQueue;
+    [[nodiscard]] auto GetQueueFamilyIndex(QueueType queue_type) const -> uint32_t;
+    /**
+     * @brief 是否有与graphics不同的队列族，否则该类型的工作仍提交到graphics队列
+     */
+    [[nodiscard]] auto HasDedicatedQueue(QueueType queue_type) const -> bool {
+        return GetQueueFamilyIndex(queue_type) != GetQueueFamilyIndex(QueueType::Graphics);
+    }
+    /**
+     * @brief 所有创建了队列的队列族，以VK_SHARING_MODE_CONCURRENT创建的资源由它们共享
+     */
+    [[nodiscard]] auto GetUniqueQueueFamilies() const -> const std::vector<uint32_t> & {
+        return m_unique_queue_families;
+    }
+    /**
+     * @brief Vulkan 1.2的核心功能或VK_KHR_timeline_semaphore，两者的函数与结构体相同
+     */
+    [[nodiscard]] auto IsTimelineSemaphoreSupported() const -> bool {
+        return m_extension_functions.m_wait_semaphores != nullptr;
+    }
     auto GetMaxMsaaSamples() -> VkSampleCountFlagBits { return m_msaa_samples_flag; }
+    /**
+     * @brief 颜色与深度附件都支持该采样数时才能用于shading pass
+     */
+    [[nodiscard]] auto IsMsaaSamplesSupported(VkSampleCountFlagBits samples) const -> bool {
+        return (m_supported_msaa_samples & samples) != 0;
+    }
     auto GetRenderWindow() -> std::shared_ptr<Window> { return m_render_window; }
+    /**
+     * @brief 在飞的帧可能仍在使用的资源通过它延迟销毁，由RenderSystem在每帧开始时回收已完成的帧
+     */
+    auto GetDeletionQueue() -> DeletionQueue & { return m_deletion_queue; }
+    /**
+     * @brief 帧的graphics提交推进的GPU帧计数
+     */
+    auto GetFrameTimeline() -> FrameTimeline & { return *m_frame_timeline; }
+    /**
+     * @brief 在transfer队列上执行的上传，由RenderSystem在每帧开始时提交
+     */
+    auto GetUploadQueue() -> UploadQueue & { return *m_upload_queue; }
     auto GetSurface() -> VkSurfaceKHR { return m_surface; }
+    [[nodiscard]] auto GetExtensionFunctions() const -> const DeviceExtensionFunctions & { return m_extension_functions; }
+    /**
+     * @brief 创建逻辑设备时实际启用的特性，可选特性仅在设备支持时开启
+     */
+    [[nodiscard]] auto GetEnabledFeatures() const -> const VkPhysicalDeviceFeatures & { return m_enabled_features; }
+    [[nodiscard]] auto IsDeviceExtensionEnabled(const std::string &extension_name) const -> bool {
+        return m_enabled_device_extensions.contains(extension_name);
+    }
     //--------------------------------------------------
 
     //---------------------Image------------------------
@@ -53,8 +132,24 @@ public:
     //--------------------------------------------------
 
     // Buffer Helper Functions
+    /**
+     * @param sharing_mode 为CONCURRENT时由GetUniqueQueueFamilies()中的所有队列族共享，只有一个队列族时退化为EXCLUSIVE
+     */
     void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer,
-                      VkDeviceMemory &buffer_memory);
+                      VkDeviceMemory &buffer_memory, VkSharingMode sharing_mode = VK_SHARING_MODE_EXCLUSIVE);
+
+    /**
+     * @brief 按sharing_mode填写create info中的共享方式，queueFamilyIndices指向Device内部，需在Device存活期间使用
+     */
+    template<typename CreateInfo>
+    void FillSharingMode(VkSharingMode sharing_mode, CreateInfo &create_info) const {
+        create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        if (sharing_mode == VK_SHARING_MODE_CONCURRENT && m_unique_queue_families.size() > 1) {
+            create_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            create_info.queueFamilyIndexCount = static_cast<uint32_t>(m_unique_queue_families.size());
+            create_info.pQueueFamilyIndices = m_unique_queue_families.data();
+        }
+    }
 
     void CopyBuffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size);
 
@@ -75,16 +170,24 @@ private:
 
     void PickPhysicalDevice();
     void CreateLogicalDevice();
-    void CreateCommandPool();
+    void CreateCommandPools();
+    void LoadExtensionFunctions();
+
+    /**
+     * @brief 加载器支持的实例版本，不超过1.2
+     */
+    static auto GetInstanceApiVersion() -> uint32_t;
 
     auto GetMaxUsableSampleCount() -> VkSampleCountFlagBits;
     auto IsValidationLayerSupport() -> bool;
+    static auto IsInstanceExtensionSupported(const char *extension_name) -> bool;
 
     // helper functions
     [[nodiscard]] auto GetRequiredExtensions() const -> std::vector<const char *>;
     auto IsPhyDeviceSuitable(VkPhysicalDevice device) -> bool;
     auto FindQueueFamilies(VkPhysicalDevice device) -> QueueFamilyIndices;
     auto CheckDeviceExtensionSupport(VkPhysicalDevice device) -> bool;
+    auto GetSupportedOptionalExtensions(VkPhysicalDevice device) -> std::vector<const char *>;
     auto QuerySwapChainSupport(VkPhysicalDevice device) -> SwapChainSupportDetails;
     auto GetSwapChainSupport() -> SwapChainSupportDetails { return QuerySwapChainSupport(m_physical_device); }
     auto FindSupportedFormat(const std::vector<VkFormat> &candidates, VkImageTiling tiling,
@@ -94,18 +197,35 @@ private:
     VkDebugUtilsMessengerEXT m_debug_messenger;
     std::vector<const char *> m_validation_layers{"VK_LAYER_KHRONOS_validation"};
     std::vector<const char *> m_device_extensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME, VK_KHR_MAINTENANCE_1_EXTENSION_NAME};
+    // 可选扩展，设备支持时才启用
+    std::vector<const char *> m_optional_device_extensions = {VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME,
+                                                              VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME,
+                                                              VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME};
+    std::set<std::string> m_enabled_device_extensions{};
+    DeviceExtensionFunctions m_extension_functions{};
+    VkPhysicalDeviceFeatures m_enabled_features{};
 
     std::shared_ptr<Window> m_render_window;
     VkSampleCountFlagBits m_msaa_samples_flag = VK_SAMPLE_COUNT_1_BIT;// 最大支持的采样数
+    VkSampleCountFlags m_supported_msaa_samples = VK_SAMPLE_COUNT_1_BIT;
     VkPhysicalDevice m_physical_device = VK_NULL_HANDLE;
-
-    VkCommandPool m_command_pool;
+    uint32_t m_instance_api_version = VK_API_VERSION_1_0;
+    uint32_t m_api_version = VK_API_VERSION_1_0;// 实例与物理设备版本中较低的一个
+    std::unique_ptr<FrameTimeline> m_frame_timeline;
+    DeletionQueue m_deletion_queue;
+    std::unique_ptr<UploadQueue> m_upload_queue;
+
+    QueueFamilyIndices m_queue_family_indices;
+    std::vector<uint32_t> m_unique_queue_families;
+    std::map<uint32_t, VkCommandPool> m_command_pools;// key为队列族
     VkSurfaceKHR m_surface;
 
     VkDevice m_device;
     VkSurfaceKHR surface_;
     VkQueue m_graphics_queue;
     VkQueue m_present_queue;
+    VkQueue m_compute_queue;
+    VkQueue m_transfer_queue;
 
 #ifdef SATURN_DEBUG
     const bool m_enable_validation_layers = true;
@@ -0,0 +1,73 @@
+#include "dynamic_resolution.hpp"
+
+namespace saturn {
+
+namespace rendering {
+
+namespace {
+
+constexpr float kRiseSmoothing = 0.5f;// 耗时上升时的平滑系数，越大跟随越快
+constexpr float kFallSmoothing = 0.05f;
+constexpr float kHeadroom = 0.85f;    // 耗时低于预算的该比例时才放大
+constexpr float kScaleStep = 1.0f / 64.0f;
+// 读回的耗时比录制晚若干帧，改变比例后等待新比例的结果再做下一次调整，避免过冲
+constexpr uint32_t kSettleFrames = 4;
+
+}// namespace
+
+DynamicResolution::DynamicResolution(float target_frame_milliseconds, float min_scale, float max_scale)
+    : m_target_frame_milliseconds{std::max(target_frame_milliseconds, 0.1f)},
+      m_min_scale{min_scale},
+      m_max_scale{max_scale},
+      m_scale{max_scale} {
+    SATURN_ASSERT(min_scale > 0.0f && min_scale <= max_scale, "Invalid dynamic resolution scale range");
+}
+
+void DynamicResolution::Update(float gpu_frame_milliseconds) {
+    if (gpu_frame_milliseconds <= 0.0f) { return; }
+
+    if (m_smoothed_frame_milliseconds <= 0.0f) {
+        m_smoothed_frame_milliseconds = gpu_frame_milliseconds;
+    } else {
+        float smoothing = gpu_frame_milliseconds > m_smoothed_frame_milliseconds ? kRiseSmoothing : kFallSmoothing;
+        m_smoothed_frame_milliseconds += (gpu_frame_milliseconds - m_smoothed_frame_milliseconds) * smoothing;
+    }
+
+    if (!m_enabled) { return; }
+    if (m_settle_frames > 0) {
+        --m_settle_frames;
+        return;
+    }
+
+    bool over_budget = m_smoothed_frame_milliseconds > m_target_frame_milliseconds;
+    bool has_headroom = m_smoothed_frame_milliseconds < m_target_frame_milliseconds * kHeadroom;
+    if (!over_budget && !has_headroom) { return; }
+
+    // 耗时与像素数成正比，像素数与比例的平方成正比
+    float desired_scale = m_scale * std::sqrt(m_target_frame_milliseconds / m_smoothed_frame_milliseconds);
+    // 放大时只走一半，留出余量并避免越过预算后立即回落
+    if (has_headroom) { desired_scale = m_scale + (desired_scale - m_scale) * 0.5f; }
+    desired_scale = std::round(desired_scale / kScaleStep) * kScaleStep;
+    desired_scale = std::clamp(desired_scale, m_min_scale, m_max_scale);
+    if (desired_scale != m_scale) {
+        m_scale = desired_scale;
+        m_settle_frames = kSettleFrames;
+    }
+}
+
+auto DynamicResolution::ComputeRenderExtent(VkExtent2D full_extent) const -> VkExtent2D {
+    auto scale_dimension = [this](uint32_t dimension) {
+        return std::max(static_cast<uint32_t>(std::lround(static_cast<float>(dimension) * m_scale)), 1u);
+    };
+    return {std::min(scale_dimension(full_extent.width), full_extent.width),
+            std::min(scale_dimension(full_extent.height), full_extent.height)};
+}
+
+void DynamicResolution::SetEnabled(bool enabled) {
+    m_enabled = enabled;
+    if (!m_enabled) { m_scale = m_max_scale; }
+}
+
+}// namespace rendering
+
+}// namespace saturn
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <engine_pch.hpp>
+#include <runtime/function/rendering/device.hpp>
+
+namespace saturn {
+
+namespace rendering {
+
+/**
+ * @brief 根据GPU帧耗时调整shading pass的渲染比例，使帧耗时保持在目标预算以内
+ *
+ * GPU耗时近似与像素数即比例的平方成正比，每次按sqrt(预算 / 耗时)估计新的比例。耗时先做不对称的平滑：
+ * 超出预算时快速跟随以应对负载突增，低于预算时缓慢恢复，并且只在留有余量时放大，避免在两个比例间来回切换
+ */
+class DynamicResolution {
+public:
+    explicit DynamicResolution(float target_frame_milliseconds, float min_scale = 0.5f, float max_scale = 1.0f);
+
+    /**
+     * @brief 输入最近一次读回的GPU帧耗时，为0（尚无结果）时忽略
+     */
+    void Update(float gpu_frame_milliseconds);
+
+    /**
+     * @brief full_extent按当前比例缩放后的尺寸，宽高至少为1
+     */
+    [[nodiscard]] auto ComputeRenderExtent(VkExtent2D full_extent) const -> VkExtent2D;
+
+    /**
+     * @brief 关闭时比例固定为max_scale
+     */
+    void SetEnabled(bool enabled);
+    [[nodiscard]] auto IsEnabled() const -> bool { return m_enabled; }
+
+    void SetTargetFrameMilliseconds(float target_frame_milliseconds) {
+        m_target_frame_milliseconds = std::max(target_frame_milliseconds, 0.1f);
+    }
+    [[nodiscard]] auto GetTargetFrameMilliseconds() const -> float { return m_target_frame_milliseconds; }
+
+    [[nodiscard]] auto GetScale() const -> float { return m_scale; }
+    [[nodiscard]] auto GetSmoothedFrameMilliseconds() const -> float { return m_smoothed_frame_milliseconds; }
+
+private:
+    float m_target_frame_milliseconds;
+    float m_min_scale;
+    float m_max_scale;
+    float m_scale;
+    float m_smoothed_frame_milliseconds = 0.0f;
+    uint32_t m_settle_frames = 0;
+    bool m_enabled = true;
+};
+
+}// namespace rendering
+
+}// namespace saturn
@@ -0,0 +1,74 @@
+#include "frame_benchmark.hpp"
+
+#include <format>
+
+namespace saturn {
+
+namespace rendering {
+
+FrameBenchmark::FrameBenchmark(uint32_t warmup_frames, uint32_t measured_frames)
+    : m_warmup_frames(warmup_frames), m_measured_frames(std::max(measured_frames, 1u)) {}
+
+void FrameBenchmark::Start(std::string name, std::vector<Case> cases, std::function<void()> on_finished) {
+    SATURN_ASSERT(!IsRunning(), "Benchmark is already running");
+
+    m_name = std::move(name);
+    m_cases = std::move(cases);
+    m_on_finished = std::move(on_finished);
+    m_case_index = 0;
+    m_case_frame = 0;
+    m_case_applied = false;
+    m_results.clear();
+    ENGINE_LOG_INFO("Benchmark '{}' started: {} cases, {} warmup + {} measured frames each", m_name, m_cases.size(),
+                    m_warmup_frames, m_measured_frames);
+}
+
+void FrameBenchmark::BeginFrame() {
+    if (!HasPendingCase()) {
+        // 与m_apply一样在开始录制之前恢复设置，本帧的上传可以随本帧提交
+        if (m_on_finished) { std::exchange(m_on_finished, nullptr)(); }
+        return;
+    }
+    if (m_case_applied) { return; }
+
+    m_scope_sums.clear();
+    if (m_cases[m_case_index].m_apply) { m_cases[m_case_index].m_apply(); }
+    m_case_applied = true;
+}
+
+void FrameBenchmark::RecordFrame(const std::vector<GpuProfiler::ScopeResult> &scope_results) {
+    if (!HasPendingCase() || !m_case_applied) { return; }
+
+    if (++m_case_frame <= m_warmup_frames) { return; }
+    for (const auto &scope_result: scope_results) {
+        auto iter = std::find_if(m_scope_sums.begin(), m_scope_sums.end(),
+                                 [&](const auto &sum) { return sum.m_name == scope_result.m_name; });
+        if (iter == m_scope_sums.end()) {
+            m_scope_sums.push_back({scope_result.m_name, 0.0f});
+            iter = std::prev(m_scope_sums.end());
+        }
+        iter->m_milliseconds += scope_result.m_milliseconds;
+    }
+    if (m_case_frame == m_warmup_frames + m_measured_frames) { FinishCase(); }
+}
+
+void FrameBenchmark::FinishCase() {
+    CaseResult result{};
+    result.m_name = m_cases[m_case_index].m_name;
+    std::string summary;
+    for (auto scope_sum: m_scope_sums) {
+        scope_sum.m_milliseconds /= static_cast<float>(m_measured_frames);
+        summary += std::format(" {}:{:.3f}ms", scope_sum.m_name, scope_sum.m_milliseconds);
+        result.m_scopes.push_back(std::move(scope_sum));
+    }
+    ENGINE_LOG_INFO("Benchmark '{}' [{}]{}", m_name, result.m_name, summary);
+    m_results.push_back(std::move(result));
+
+    ++m_case_index;
+    m_case_frame = 0;
+    m_case_applied = false;
+}
+
+}// namespace rendering
+
+}// namespace saturn
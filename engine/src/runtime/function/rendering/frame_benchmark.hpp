@@ -0,0 +1,72 @@
+#pragma once
+
+#include <engine_pch.hpp>
+#include <runtime/function/rendering/gpu_profiler.hpp>
+
+namespace saturn {
+
+namespace rendering {
+
+/**
+ * @brief 在固定种子的压力测试场景中依次运行若干配置，统计每个配置下GpuProfiler各分段的平均耗时
+ *
+ * 每个配置先运行预热帧再开始统计，切换配置时重建的资源以及GPU耗时读回的延迟（最多kMaxFramesInFlight帧）
+ * 不会计入结果。每个配置的结果输出到日志，并保留到下一次运行供UI显示
+ */
+class FrameBenchmark {
+public:
+    struct Case {
+        std::string m_name;
+        std::function<void()> m_apply;// 在该配置的第一帧开始录制之前调用
+    };
+
+    struct CaseResult {
+        std::string m_name;
+        std::vector<GpuProfiler::ScopeResult> m_scopes;// 各分段的平均耗时，按首次出现的顺序排列
+    };
+
+    FrameBenchmark(uint32_t warmup_frames, uint32_t measured_frames);
+
+    /**
+     * @brief 从下一帧开始依次运行cases，全部完成后的下一帧调用on_finished恢复运行之前的设置
+     */
+    void Start(std::string name, std::vector<Case> cases, std::function<void()> on_finished);
+
+    /**
+     * @brief 所有配置完成后，直到on_finished被调用之前仍视为在运行
+     */
+    [[nodiscard]] auto IsRunning() const -> bool { return HasPendingCase() || m_on_finished != nullptr; }
+
+    /**
+     * @brief 每帧在应用设置、开始录制之前调用，进入新的配置时调用其m_apply，全部完成后调用on_finished
+     */
+    void BeginFrame();
+
+    /**
+     * @brief 每帧在GpuProfiler读回耗时之后调用，scope_results中可以附加在CPU上测得的分段，与GPU的分段一样统计
+     */
+    void RecordFrame(const std::vector<GpuProfiler::ScopeResult> &scope_results);
+
+    [[nodiscard]] auto GetName() const -> const std::string & { return m_name; }
+    [[nodiscard]] auto GetResults() const -> const std::vector<CaseResult> & { return m_results; }
+
+private:
+    [[nodiscard]] auto HasPendingCase() const -> bool { return m_case_index < m_cases.size(); }
+    void FinishCase();
+
+    uint32_t m_warmup_frames;
+    uint32_t m_measured_frames;
+
+    std::string m_name;
+    std::vector<Case> m_cases;
+    std::function<void()> m_on_finished;
+    size_t m_case_index = 0;
+    uint32_t m_case_frame = 0;// 当前配置已经读回的帧数，包括预热帧
+    bool m_case_applied = false;
+    std::vector<GpuProfiler::ScopeResult> m_scope_sums;
+    std::vector<CaseResult> m_results;
+};
+
+}// namespace rendering
+
+}// namespace saturn
@@ -0,0 +1,71 @@
+#include "frame_pacer.hpp"
+
+#include <thread>
+
+namespace saturn {
+
+namespace rendering {
+
+namespace {
+
+// 截止时刻之前的这段时间改为自旋等待
+constexpr auto kSpinThreshold = std::chrono::microseconds(2000);
+constexpr float kSmoothing = 0.1f;
+
+auto ToMilliseconds(std::chrono::steady_clock::duration duration) -> float {
+    return std::chrono::duration<float, std::milli>(duration).count();
+}
+
+void Smooth(float &smoothed, float value) {
+    smoothed = smoothed <= 0.0f ? value : smoothed + (value - smoothed) * kSmoothing;
+}
+
+}// namespace
+
+FramePacer::FramePacer(uint32_t frame_slots) : m_slot_input_times(frame_slots) {}
+
+void FramePacer::WaitForNextFrame() {
+    auto now = Clock::now();
+    if (m_target_fps > 0.0f) {
+        auto frame_duration =
+                std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_target_fps));
+        // 落后超过一帧时（例如拖动窗口）从当前时刻重新计时，不连续补帧
+        if (now > m_next_frame_time + frame_duration) { m_next_frame_time = now; }
+
+        if (now < m_next_frame_time - kSpinThreshold) {
+            std::this_thread::sleep_until(m_next_frame_time - kSpinThreshold);
+        }
+        while (Clock::now() < m_next_frame_time) { std::this_thread::yield(); }
+
+        m_next_frame_time += frame_duration;
+        now = Clock::now();
+    }
+
+    Smooth(m_cpu_frame_milliseconds, ToMilliseconds(now - m_last_frame_time));
+    m_last_frame_time = now;
+}
+
+void FramePacer::OnInputSampled() { m_input_time = Clock::now(); }
+
+void FramePacer::OnFrameSlotAcquired(uint32_t frame_index) {
+    auto &slot_input_time = m_slot_input_times.at(frame_index);
+    if (slot_input_time.has_value()) {
+        Smooth(m_completion_latency_milliseconds, ToMilliseconds(Clock::now() - *slot_input_time));
+    }
+    slot_input_time = m_input_time;
+}
+
+void FramePacer::OnPresentQueued(uint32_t frame_index) {
+    const auto &slot_input_time = m_slot_input_times.at(frame_index);
+    if (slot_input_time.has_value()) {
+        Smooth(m_present_latency_milliseconds, ToMilliseconds(Clock::now() - *slot_input_time));
+    }
+}
+
+void FramePacer::ResetFrameSlots() {
+    for (auto &slot_input_time: m_slot_input_times) { slot_input_time.reset(); }
+}
+
+}// namespace rendering
+
+}// namespace saturn
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <engine_pch.hpp>
+
+namespace saturn {
+
+namespace rendering {
+
+/**
+ * @brief 帧率限制以及输入到显示的延迟统计
+ *
+ * 限帧先sleep到截止时刻之前的一小段时间，剩余部分自旋等待，sleep的精度通常只有1~2ms。等待发生在采样输入之前，
+ * 采样输入到提交之间不会夹着限帧的等待时间
+ *
+ * 延迟从采样输入开始计算：到vkQueuePresentKHR返回为提交延迟；到等待该帧完成返回为完成延迟。没有
+ * VK_GOOGLE_display_timing时无法得知真正的显示时刻，完成延迟是GPU完成时刻的上界，CPU为瓶颈时偏大
+ */
+class FramePacer {
+public:
+    explicit FramePacer(uint32_t frame_slots);
+
+    /**
+     * @brief 目标帧率，为0时不限制
+     */
+    void SetTargetFps(float target_fps) { m_target_fps = std::max(target_fps, 0.0f); }
+    [[nodiscard]] auto GetTargetFps() const -> float { return m_target_fps; }
+
+    /**
+     * @brief 等待到下一帧的开始时刻，需在采样输入之前调用
+     */
+    void WaitForNextFrame();
+
+    void OnInputSampled();
+
+    /**
+     * @brief 等待帧槽位上一次提交的帧完成之后调用，统计上一次使用该槽位的帧的完成延迟，并把本帧的输入时刻记在该槽位上
+     */
+    void OnFrameSlotAcquired(uint32_t frame_index);
+
+    void OnPresentQueued(uint32_t frame_index);
+
+    /**
+     * @brief 槽位的数量或使用方式改变之后（例如等待设备空闲）丢弃尚未统计的输入时刻
+     */
+    void ResetFrameSlots();
+
+    [[nodiscard]] auto GetCpuFrameMilliseconds() const -> float { return m_cpu_frame_milliseconds; }
+    [[nodiscard]] auto GetPresentLatencyMilliseconds() const -> float { return m_present_latency_milliseconds; }
+    [[nodiscard]] auto GetCompletionLatencyMilliseconds() const -> float {
+        return m_completion_latency_milliseconds;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    float m_target_fps = 0.0f;
+    Clock::time_point m_next_frame_time{Clock::now()};
+    Clock::time_point m_last_frame_time{Clock::now()};
+    Clock::time_point m_input_time{Clock::now()};
+    std::vector<std::optional<Clock::time_point>> m_slot_input_times;
+
+    // 均为指数平滑后的结果
+    float m_cpu_frame_milliseconds = 0.0f;
+    float m_present_latency_milliseconds = 0.0f;
+    float m_completion_latency_milliseconds = 0.0f;
+};
+
+}// namespace rendering
+
+}// namespace saturn
@@ -0,0 +1,106 @@
+#include "frame_timeline.hpp"
+
+#include "device.hpp"
+
+namespace saturn {
+
+namespace rendering {
+
+FrameTimeline::FrameTimeline(Device &render_device) : m_render_device(render_device) {
+    if (!m_render_device.IsTimelineSemaphoreSupported()) {
+        ENGINE_LOG_INFO("Timeline semaphores are not supported, frame timeline falls back to fences");
+        return;
+    }
+
+    VkSemaphoreTypeCreateInfoKHR type_info{};
+    type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+    type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+    type_info.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphore_info{};
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphore_info.pNext = &type_info;
+
+    if (vkCreateSemaphore(m_render_device.GetVkDevice(), &semaphore_info, nullptr, &m_semaphore) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create frame timeline semaphore!");
+    }
+}
+
+FrameTimeline::~FrameTimeline() {
+    // 调用者已等待设备空闲
+    auto *device = m_render_device.GetVkDevice();
+    vkDestroySemaphore(device, m_semaphore, nullptr);
+    for (const auto &[frame, fence]: m_pending_fences) { vkDestroyFence(device, fence, nullptr); }
+    for (auto *fence: m_free_fences) { vkDestroyFence(device, fence, nullptr); }
+}
+
+auto FrameTimeline::GetCompletedFrame() -> uint64_t {
+    if (m_semaphore != VK_NULL_HANDLE) {
+        m_render_device.GetExtensionFunctions().m_get_semaphore_counter_value(m_render_device.GetVkDevice(),
+                                                                              m_semaphore, &m_completed_frame);
+    } else {
+        m_completed_frame = std::max(m_completed_frame, CollectFences());
+    }
+    return m_completed_frame;
+}
+
+void FrameTimeline::WaitForFrame(uint64_t frame) {
+    SATURN_ASSERT(frame <= m_submitted_frame, "Can't wait for a frame that has not been submitted");
+    if (frame <= m_completed_frame) { return; }
+
+    if (m_semaphore != VK_NULL_HANDLE) {
+        VkSemaphoreWaitInfoKHR wait_info{};
+        wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+        wait_info.semaphoreCount = 1;
+        wait_info.pSemaphores = &m_semaphore;
+        wait_info.pValues = &frame;
+        m_render_device.GetExtensionFunctions().m_wait_semaphores(m_render_device.GetVkDevice(), &wait_info,
+                                                                  UINT64_MAX);
+    } else {
+        // 帧都提交到graphics队列，按提交顺序完成，等待第一个不早于frame的fence即可
+        auto it = std::find_if(m_pending_fences.begin(), m_pending_fences.end(),
+                               [frame](const auto &pending) { return pending.first >= frame; });
+        SATURN_ASSERT(it != m_pending_fences.end(), "Missing fence for a submitted frame");
+        vkWaitForFences(m_render_device.GetVkDevice(), 1, &it->second, VK_TRUE, UINT64_MAX);
+    }
+    GetCompletedFrame();
+}
+
+auto FrameTimeline::SubmitFrame() -> FrameSignal {
+    FrameSignal signal{};
+    signal.m_frame = ++m_submitted_frame;
+    if (m_semaphore != VK_NULL_HANDLE) {
+        signal.m_semaphore = m_semaphore;
+        return signal;
+    }
+
+    if (!m_free_fences.empty()) {
+        signal.m_fence = m_free_fences.back();
+        m_free_fences.pop_back();
+    } else {
+        VkFenceCreateInfo fence_info{};
+        fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if (vkCreateFence(m_render_device.GetVkDevice(), &fence_info, nullptr, &signal.m_fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create frame fence!");
+        }
+    }
+    m_pending_fences.emplace_back(signal.m_frame, signal.m_fence);
+    return signal;
+}
+
+auto FrameTimeline::CollectFences() -> uint64_t {
+    uint64_t completed_frame = 0;
+    auto *device = m_render_device.GetVkDevice();
+    while (!m_pending_fences.empty() && vkGetFenceStatus(device, m_pending_fences.front().second) == VK_SUCCESS) {
+        auto [frame, fence] = m_pending_fences.front();
+        m_pending_fences.pop_front();
+        vkResetFences(device, 1, &fence);
+        m_free_fences.push_back(fence);
+        completed_frame = frame;
+    }
+    return completed_frame;
+}
+
+}// namespace rendering
+
+}// namespace saturn
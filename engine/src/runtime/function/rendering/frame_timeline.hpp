@@ -0,0 +1,87 @@
+#pragma once
+
+#include <engine_pch.hpp>
+
+#include <deque>
+
+#include <vulkan/vulkan.h>
+
+namespace saturn {
+
+namespace rendering {
+
+class Device;
+
+/**
+ * @brief 单调递增的GPU帧计数，每次帧的graphics提交加一
+ *
+ * 支持timeline semaphore（Vulkan 1.2或VK_KHR_timeline_semaphore）时，帧提交signal一个timeline semaphore，
+ * 计数就是它的值，其他队列也可以直接等待它；否则回退为每帧一个从池中复用的fence。任何子系统都可以记录
+ * 资源最后被使用的帧，之后查询或等待该帧完成，不需要为每个操作单独创建fence
+ */
+class FrameTimeline {
+public:
+    /**
+     * @brief 帧的graphics提交需要signal的对象，支持timeline semaphore时m_fence为VK_NULL_HANDLE，否则m_semaphore为空
+     */
+    struct FrameSignal {
+        uint64_t m_frame = 0;
+        VkSemaphore m_semaphore = VK_NULL_HANDLE;
+        VkFence m_fence = VK_NULL_HANDLE;
+    };
+
+    explicit FrameTimeline(Device &render_device);
+    ~FrameTimeline();
+
+    FrameTimeline(const FrameTimeline &) = delete;
+    auto operator=(const FrameTimeline &) -> FrameTimeline & = delete;
+
+    /**
+     * @brief 最近一次提交的帧，还没有提交过时为0
+     */
+    [[nodiscard]] auto GetSubmittedFrame() const -> uint64_t { return m_submitted_frame; }
+
+    /**
+     * @brief 下一次提交的帧，正在录制的帧引用的资源需等到该帧完成
+     */
+    [[nodiscard]] auto GetPendingFrame() const -> uint64_t { return m_submitted_frame + 1; }
+
+    /**
+     * @brief GPU已经完成的最大帧，不阻塞
+     */
+    auto GetCompletedFrame() -> uint64_t;
+
+    auto IsFrameCompleted(uint64_t frame) -> bool { return frame <= GetCompletedFrame(); }
+
+    /**
+     * @brief 阻塞直到frame完成，frame不能大于GetSubmittedFrame()
+     */
+    void WaitForFrame(uint64_t frame);
+
+    /**
+     * @brief 回退到fence时为VK_NULL_HANDLE
+     */
+    [[nodiscard]] auto GetVkSemaphore() const -> VkSemaphore { return m_semaphore; }
+
+    /**
+     * @brief 分配下一帧的编号，返回值需由紧接着的帧提交signal
+     */
+    auto SubmitFrame() -> FrameSignal;
+
+private:
+    /**
+     * @brief 回收所有已signal的fence，返回其中最大的帧
+     */
+    auto CollectFences() -> uint64_t;
+
+    Device &m_render_device;
+    VkSemaphore m_semaphore = VK_NULL_HANDLE;
+    uint64_t m_submitted_frame = 0;
+    uint64_t m_completed_frame = 0;
+    std::deque<std::pair<uint64_t, VkFence>> m_pending_fences;// 按帧递增
+    std::vector<VkFence> m_free_fences;
+};
+
+}// namespace rendering
+
+}// namespace saturn
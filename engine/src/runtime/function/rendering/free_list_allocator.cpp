@@ -0,0 +1,64 @@
+#include "free_list_allocator.hpp"
+
+namespace saturn {
+
+namespace rendering {
+
+FreeListAllocator::FreeListAllocator(uint32_t capacity) { Reset(capacity); }
+
+auto FreeListAllocator::Allocate(uint32_t size) -> std::optional<uint32_t> {
+    SATURN_ASSERT(size > 0, "Can't allocate an empty range");
+
+    for (auto iter = m_free_blocks.begin(); iter != m_free_blocks.end(); ++iter) {
+        auto [offset, block_size] = *iter;
+        if (block_size < size) { continue; }
+
+        m_free_blocks.erase(iter);
+        if (block_size > size) { m_free_blocks.emplace(offset + size, block_size - size); }
+        m_used_size += size;
+        return offset;
+    }
+    return std::nullopt;
+}
+
+void FreeListAllocator::Free(uint32_t offset, uint32_t size) {
+    SATURN_ASSERT(size > 0 && offset + size <= m_capacity, "Freed range is out of bounds");
+    m_used_size -= size;
+
+    auto next = m_free_blocks.lower_bound(offset);
+    SATURN_ASSERT(next == m_free_blocks.end() || offset + size <= next->first, "Freed range overlaps a free block");
+
+    // 与后一个空闲块相接时合并
+    if (next != m_free_blocks.end() && offset + size == next->first) {
+        size += next->second;
+        next = m_free_blocks.erase(next);
+    }
+
+    // 与前一个空闲块相接时合并
+    if (next != m_free_blocks.begin()) {
+        auto prev = std::prev(next);
+        SATURN_ASSERT(prev->first + prev->second <= offset, "Freed range overlaps a free block");
+        if (prev->first + prev->second == offset) {
+            prev->second += size;
+            return;
+        }
+    }
+    m_free_blocks.emplace_hint(next, offset, size);
+}
+
+void FreeListAllocator::Reset(uint32_t capacity) {
+    m_free_blocks.clear();
+    m_capacity = capacity;
+    m_used_size = 0;
+    if (capacity > 0) { m_free_blocks.emplace(0, capacity); }
+}
+
+auto FreeListAllocator::GetLargestFreeBlock() const -> uint32_t {
+    uint32_t largest = 0;
+    for (const auto &[offset, size]: m_free_blocks) { largest = std::max(largest, size); }
+    return largest;
+}
+
+}// namespace rendering
+
+}// namespace saturn
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <engine_pch.hpp>
+
+namespace saturn {
+
+namespace rendering {
+
+/**
+ * @brief 管理一段线性地址空间的分配器，只记录偏移与大小，不持有任何GPU资源
+ *
+ * 空闲块按偏移有序保存，分配时取第一个足够大的块（first fit），释放时与相邻的空闲块合并
+ */
+class FreeListAllocator {
+public:
+    explicit FreeListAllocator(uint32_t capacity = 0);
+
+    /**
+     * @return 分配到的起始偏移，没有足够大的连续空闲块时返回std::nullopt
+     */
+    auto Allocate(uint32_t size) -> std::optional<uint32_t>;
+
+    /**
+     * @brief 归还[offset, offset + size)，size需与分配时一致
+     */
+    void Free(uint32_t offset, uint32_t size);
+
+    /**
+     * @brief 丢弃所有分配并将容量设为capacity，整理碎片后由调用者重新分配
+     */
+    void Reset(uint32_t capacity);
+
+    [[nodiscard]] auto GetCapacity() const -> uint32_t { return m_capacity; }
+    [[nodiscard]] auto GetUsedSize() const -> uint32_t { return m_used_size; }
+    [[nodiscard]] auto GetFreeBlockCount() const -> uint32_t { return static_cast<uint32_t>(m_free_blocks.size()); }
+    [[nodiscard]] auto GetLargestFreeBlock() const -> uint32_t;
+
+private:
+    std::map<uint32_t, uint32_t> m_free_blocks;// 偏移 -> 大小
+    uint32_t m_capacity = 0;
+    uint32_t m_used_size = 0;
+};
+
+}// namespace rendering
+
+}// namespace saturn
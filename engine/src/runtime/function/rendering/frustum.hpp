@@ -0,0 +1,35 @@
+#pragma once
+
+#include <engine_pch.hpp>
+
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+namespace saturn {
+
+namespace rendering {
+
+/**
+ * @brief 从view_proj中提取世界空间的6个视锥平面，xyz为指向视锥内部的单位法线，深度范围为[0, 1]
+ *
+ * 顺序为left、right、bottom、top、near、far，GPU剔除的shader中使用相同的平面表示
+ */
+inline auto ExtractFrustumPlanes(const glm::mat4 &view_proj) -> std::array<glm::vec4, 6> {
+    auto row = [&](int i) { return glm::vec4(view_proj[0][i], view_proj[1][i], view_proj[2][i], view_proj[3][i]); };
+
+    std::array<glm::vec4, 6> planes{row(3) + row(0), row(3) - row(0), row(3) + row(1),
+                                    row(3) - row(1), row(2),          row(3) - row(2)};
+    for (auto &plane: planes) { plane /= glm::length(glm::vec3(plane)); }
+    return planes;
+}
+
+inline auto IsSphereOutsideFrustum(const std::array<glm::vec4, 6> &planes, const glm::vec3 &center, float radius)
+        -> bool {
+    return std::any_of(planes.begin(), planes.end(), [&](const glm::vec4 &plane) {
+        return glm::dot(glm::vec3(plane), center) + plane.w < -radius;
+    });
+}
+
+}// namespace rendering
+
+}// namespace saturn
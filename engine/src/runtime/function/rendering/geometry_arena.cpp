@@ -0,0 +1,262 @@
+#include "geometry_arena.hpp"
+
+#include <runtime/function/rendering/commands.hpp>
+
+namespace saturn {
+
+namespace rendering {
+
+GeometryArena::GeometryArena(std::shared_ptr<Device> render_device, uint32_t initial_vertex_capacity,
+                             uint32_t initial_index_capacity)
+    : m_render_device{std::move(render_device)} {
+    initial_vertex_capacity = std::max(initial_vertex_capacity, 1u);
+    initial_index_capacity = std::max(initial_index_capacity, 1u);
+
+    for (size_t i = 0; i < m_vertex_pools.size(); ++i) {
+        auto vertex_format = static_cast<resource::VertexFormat>(i);
+        auto &pool = m_vertex_pools[i];
+        pool.m_vertex_stride = resource::Model::GetVertexStride(vertex_format);
+        pool.m_position_stride = resource::Model::GetPositionStride(vertex_format);
+        pool.m_vertex_buffer = CreateVertexBuffer(pool.m_vertex_stride, initial_vertex_capacity);
+        pool.m_position_buffer = CreateVertexBuffer(pool.m_position_stride, initial_vertex_capacity);
+        pool.m_allocator.Reset(initial_vertex_capacity);
+    }
+
+    m_index_buffer = CreateIndexBuffer(initial_index_capacity);
+    m_index_allocator.Reset(initial_index_capacity);
+}
+
+auto GeometryArena::Upload(const resource::Model &model) -> Handle {
+    Allocation allocation{};
+    allocation.m_vertex_format = model.GetVertexFormat();
+    allocation.m_vertex_count = static_cast<uint32_t>(model.m_vertices.size());
+    allocation.m_index_count = static_cast<uint32_t>(model.m_indices.size());
+    allocation.m_live = true;
+    SATURN_ASSERT(allocation.m_vertex_count > 0 && allocation.m_index_count > 0, "Can't upload an empty mesh");
+
+    allocation.m_vertex_offset = AllocateVertices(allocation.m_vertex_format, allocation.m_vertex_count);
+    allocation.m_first_index = AllocateIndices(allocation.m_index_count);
+
+    const auto &pool = m_vertex_pools.at(static_cast<size_t>(allocation.m_vertex_format));
+    UploadToBuffer(pool.m_vertex_buffer, static_cast<VkDeviceSize>(allocation.m_vertex_offset) * pool.m_vertex_stride,
+                   model.GetVertexData(), model.GetVertexDataSize());
+    auto positions = model.BuildPositionStream();
+    UploadToBuffer(pool.m_position_buffer,
+                   static_cast<VkDeviceSize>(allocation.m_vertex_offset) * pool.m_position_stride, positions.data(),
+                   positions.size());
+    UploadToBuffer(m_index_buffer, static_cast<VkDeviceSize>(allocation.m_first_index) * sizeof(uint32_t),
+                   model.m_indices.data(), model.m_indices.size() * sizeof(uint32_t));
+
+    Handle handle = 0;
+    if (!m_free_handles.empty()) {
+        handle = m_free_handles.back();
+        m_free_handles.pop_back();
+        m_allocations[handle] = allocation;
+    } else {
+        handle = static_cast<Handle>(m_allocations.size());
+        m_allocations.push_back(allocation);
+    }
+    return handle;
+}
+
+void GeometryArena::Free(Handle handle) {
+    auto &allocation = m_allocations.at(handle);
+    SATURN_ASSERT(allocation.m_live, "Geometry is already freed");
+    allocation.m_live = false;
+
+    // 已提交与正在录制的帧仍在读取这段空间，立即归还会被之后transfer队列上的上传覆盖；
+    // 回调不能持有arena的shared_ptr，否则arena与Device互相持有
+    auto vertex_generation = m_vertex_pools.at(static_cast<size_t>(allocation.m_vertex_format)).m_generation;
+    m_render_device->GetDeletionQueue().Push(
+            [weak_arena = weak_from_this(), handle, vertex_generation, index_generation = m_index_generation]() {
+                if (auto arena = weak_arena.lock()) {
+                    arena->ReleaseAllocation(handle, vertex_generation, index_generation);
+                }
+            });
+}
+
+void GeometryArena::ReleaseAllocation(Handle handle, uint32_t vertex_generation, uint32_t index_generation) {
+    const auto &allocation = m_allocations.at(handle);
+    auto &pool = m_vertex_pools.at(static_cast<size_t>(allocation.m_vertex_format));
+    if (pool.m_generation == vertex_generation) {
+        pool.m_allocator.Free(allocation.m_vertex_offset, allocation.m_vertex_count);
+    }
+    if (m_index_generation == index_generation) {
+        m_index_allocator.Free(allocation.m_first_index, allocation.m_index_count);
+    }
+    m_free_handles.push_back(handle);
+}
+
+void GeometryArena::Defragment() {
+    for (size_t i = 0; i < m_vertex_pools.size(); ++i) {
+        RebuildVertexPool(static_cast<resource::VertexFormat>(i), m_vertex_pools[i].m_allocator.GetCapacity());
+    }
+    RebuildIndexBuffer(m_index_allocator.GetCapacity());
+}
+
+auto GeometryArena::GetLayoutVersion() const -> uint32_t {
+    uint32_t version = m_index_generation;
+    for (const auto &pool: m_vertex_pools) { version += pool.m_generation; }
+    return version;
+}
+
+auto GeometryArena::GetStatistics() const -> Statistics {
+    Statistics statistics{};
+    for (const auto &pool: m_vertex_pools) {
+        statistics.m_used_vertices += pool.m_allocator.GetUsedSize();
+        statistics.m_vertex_capacity += pool.m_allocator.GetCapacity();
+        statistics.m_free_block_count += pool.m_allocator.GetFreeBlockCount();
+    }
+    statistics.m_used_indices = m_index_allocator.GetUsedSize();
+    statistics.m_index_capacity = m_index_allocator.GetCapacity();
+    statistics.m_free_block_count += m_index_allocator.GetFreeBlockCount();
+    return statistics;
+}
+
+auto GeometryArena::AllocateVertices(resource::VertexFormat vertex_format, uint32_t vertex_count) -> uint32_t {
+    auto &allocator = m_vertex_pools.at(static_cast<size_t>(vertex_format)).m_allocator;
+    if (auto offset = allocator.Allocate(vertex_count)) { return *offset; }
+
+    // 总空闲量足够时只需整理碎片，否则按2倍扩容
+    uint32_t capacity = allocator.GetCapacity();
+    uint32_t required = allocator.GetUsedSize() + vertex_count;
+    if (required > capacity) { capacity = std::max(capacity * 2, required); }
+    RebuildVertexPool(vertex_format, capacity);
+    return allocator.Allocate(vertex_count).value();
+}
+
+auto GeometryArena::AllocateIndices(uint32_t index_count) -> uint32_t {
+    if (auto offset = m_index_allocator.Allocate(index_count)) { return *offset; }
+
+    uint32_t capacity = m_index_allocator.GetCapacity();
+    uint32_t required = m_index_allocator.GetUsedSize() + index_count;
+    if (required > capacity) { capacity = std::max(capacity * 2, required); }
+    RebuildIndexBuffer(capacity);
+    return m_index_allocator.Allocate(index_count).value();
+}
+
+void GeometryArena::RebuildVertexPool(resource::VertexFormat vertex_format, uint32_t capacity) {
+    auto &pool = m_vertex_pools.at(static_cast<size_t>(vertex_format));
+
+    // 按原偏移排序后依次紧凑排列，网格之间的相对顺序不变
+    std::vector<Allocation *> live_allocations;
+    for (auto &allocation: m_allocations) {
+        if (allocation.m_live && allocation.m_vertex_format == vertex_format) {
+            live_allocations.push_back(&allocation);
+        }
+    }
+    std::sort(live_allocations.begin(), live_allocations.end(),
+              [](const Allocation *a, const Allocation *b) { return a->m_vertex_offset < b->m_vertex_offset; });
+
+    std::vector<VkBufferCopy> vertex_regions;
+    std::vector<VkBufferCopy> position_regions;
+    uint32_t write_offset = 0;
+    for (auto *allocation: live_allocations) {
+        vertex_regions.push_back({static_cast<VkDeviceSize>(allocation->m_vertex_offset) * pool.m_vertex_stride,
+                                  static_cast<VkDeviceSize>(write_offset) * pool.m_vertex_stride,
+                                  static_cast<VkDeviceSize>(allocation->m_vertex_count) * pool.m_vertex_stride});
+        position_regions.push_back(
+                {static_cast<VkDeviceSize>(allocation->m_vertex_offset) * pool.m_position_stride,
+                 static_cast<VkDeviceSize>(write_offset) * pool.m_position_stride,
+                 static_cast<VkDeviceSize>(allocation->m_vertex_count) * pool.m_position_stride});
+        allocation->m_vertex_offset = write_offset;
+        write_offset += allocation->m_vertex_count;
+    }
+    SATURN_ASSERT(write_offset <= capacity, "Geometry arena capacity is smaller than the live vertices");
+
+    // 之前提交的帧仍可能读取旧缓冲区，其销毁由Buffer的析构延迟到这些帧完成之后
+    auto vertex_buffer = CreateVertexBuffer(pool.m_vertex_stride, capacity);
+    auto position_buffer = CreateVertexBuffer(pool.m_position_stride, capacity);
+    CopyRegions(pool.m_vertex_buffer, vertex_buffer, vertex_regions);
+    CopyRegions(pool.m_position_buffer, position_buffer, position_regions);
+    pool.m_vertex_buffer = std::move(vertex_buffer);
+    pool.m_position_buffer = std::move(position_buffer);
+
+    pool.m_allocator.Reset(capacity);
+    if (write_offset > 0) { pool.m_allocator.Allocate(write_offset); }
+    ++pool.m_generation;
+
+    ENGINE_LOG_INFO("Rebuilt {} geometry vertex pool: {}/{} vertices",
+                    vertex_format == resource::VertexFormat::Packed ? "packed" : "full", write_offset, capacity);
+}
+
+void GeometryArena::RebuildIndexBuffer(uint32_t capacity) {
+    std::vector<Allocation *> live_allocations;
+    for (auto &allocation: m_allocations) {
+        if (allocation.m_live) { live_allocations.push_back(&allocation); }
+    }
+    std::sort(live_allocations.begin(), live_allocations.end(),
+              [](const Allocation *a, const Allocation *b) { return a->m_first_index < b->m_first_index; });
+
+    std::vector<VkBufferCopy> regions;
+    uint32_t write_offset = 0;
+    for (auto *allocation: live_allocations) {
+        regions.push_back({static_cast<VkDeviceSize>(allocation->m_first_index) * sizeof(uint32_t),
+                           static_cast<VkDeviceSize>(write_offset) * sizeof(uint32_t),
+                           static_cast<VkDeviceSize>(allocation->m_index_count) * sizeof(uint32_t)});
+        allocation->m_first_index = write_offset;
+        write_offset += allocation->m_index_count;
+    }
+    SATURN_ASSERT(write_offset <= capacity, "Geometry arena capacity is smaller than the live indices");
+
+    auto index_buffer = CreateIndexBuffer(capacity);
+    CopyRegions(m_index_buffer, index_buffer, regions);
+    m_index_buffer = std::move(index_buffer);
+
+    m_index_allocator.Reset(capacity);
+    if (write_offset > 0) { m_index_allocator.Allocate(write_offset); }
+    ++m_index_generation;
+
+    ENGINE_LOG_INFO("Rebuilt geometry index buffer: {}/{} indices", write_offset, capacity);
+}
+
+auto GeometryArena::CreateVertexBuffer(uint32_t stride, uint32_t capacity) const -> std::shared_ptr<Buffer> {
+    // 整理碎片时既是拷贝的源也是目标；transfer队列写入、graphics队列读取，以CONCURRENT共享
+    return std::make_shared<Buffer>(m_render_device, stride, capacity,
+                                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 1, VK_SHARING_MODE_CONCURRENT);
+}
+
+auto GeometryArena::CreateIndexBuffer(uint32_t capacity) const -> std::shared_ptr<Buffer> {
+    return std::make_shared<Buffer>(m_render_device, sizeof(uint32_t), capacity,
+                                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                            VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 1, VK_SHARING_MODE_CONCURRENT);
+}
+
+void GeometryArena::UploadToBuffer(const std::shared_ptr<Buffer> &target, VkDeviceSize offset, const void *data,
+                                   VkDeviceSize size) const {
+    auto staging_buffer =
+            std::make_shared<Buffer>(m_render_device, size, 1, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    staging_buffer->Map();
+    staging_buffer->WriteToBuffer(data, size);
+    staging_buffer->Unmap();
+
+    VkBufferCopy copy_region{};
+    copy_region.srcOffset = 0;
+    copy_region.dstOffset = offset;
+    copy_region.size = size;
+    auto *staging_vk_buffer = staging_buffer->GetVkBuffer();
+    m_render_device->GetUploadQueue().CopyBuffer(std::move(staging_buffer), staging_vk_buffer, target->GetVkBuffer(),
+                                                 copy_region);
+}
+
+void GeometryArena::CopyRegions(const std::shared_ptr<Buffer> &src, const std::shared_ptr<Buffer> &dst,
+                                const std::vector<VkBufferCopy> &regions) const {
+    if (regions.empty()) { return; }
+
+    // src中可能还有未提交的上传，先让它们落地
+    m_render_device->GetUploadQueue().SubmitAndWait();
+
+    CommandsBuilder cmd_builder{m_render_device};
+    cmd_builder.AllocateCommandBuffers(1).BeginRecord();
+    vkCmdCopyBuffer(cmd_builder.GetCurrentCommandBuffer(), src->GetVkBuffer(), dst->GetVkBuffer(),
+                    static_cast<uint32_t>(regions.size()), regions.data());
+    cmd_builder.EndRecord().SubmitTo(m_render_device->GetGraphicsQueue());
+}
+
+}// namespace rendering
+
+}// namespace saturn
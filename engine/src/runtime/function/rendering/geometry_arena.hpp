@@ -0,0 +1,137 @@
+#pragma once
+
+#include <engine_pch.hpp>
+#include <runtime/function/rendering/buffer.hpp>
+#include <runtime/function/rendering/device.hpp>
+#include <runtime/function/rendering/free_list_allocator.hpp>
+#include <runtime/resource/model.hpp>
+
+namespace saturn {
+
+namespace rendering {
+
+/**
+ * @brief 所有网格共用的几何缓冲区：每种顶点格式一组大的vertex/position buffer，所有格式共用一个index buffer
+ *
+ * 网格从中按顶点、索引为单位子分配，索引保持网格内的局部编号，绘制时通过vertexOffset与firstIndex定位，
+ * 同一顶点格式的物体无需重新绑定缓冲区。容量不足时先整理碎片，仍不足则扩容，两者都会替换底层的Buffer
+ *
+ * 需通过std::make_shared创建，释放的空间经由DeletionQueue延迟归还
+ */
+class GeometryArena : public std::enable_shared_from_this<GeometryArena> {
+public:
+    using Handle = uint32_t;
+
+    /**
+     * @brief 一个网格在arena中的位置，整理碎片或扩容后会变化，绘制时需重新查询
+     */
+    struct Allocation {
+        resource::VertexFormat m_vertex_format = resource::VertexFormat::Full;
+        uint32_t m_vertex_offset = 0;
+        uint32_t m_vertex_count = 0;
+        uint32_t m_first_index = 0;
+        uint32_t m_index_count = 0;
+        bool m_live = false;
+    };
+
+    struct Statistics {
+        uint32_t m_used_vertices = 0;
+        uint32_t m_vertex_capacity = 0;
+        uint32_t m_used_indices = 0;
+        uint32_t m_index_capacity = 0;
+        uint32_t m_free_block_count = 0;// 所有缓冲区的空闲块数，反映碎片化程度
+    };
+
+    GeometryArena(std::shared_ptr<Device> render_device, uint32_t initial_vertex_capacity,
+                  uint32_t initial_index_capacity);
+
+    GeometryArena(const GeometryArena &) = delete;
+    auto operator=(const GeometryArena &) -> GeometryArena & = delete;
+
+    /**
+     * @brief 上传模型的顶点、位置流与索引，拷贝录制到UploadQueue，在下一帧提交时与之前的帧并行执行；
+     * 需要扩容或整理碎片时会等待拷贝完成
+     */
+    auto Upload(const resource::Model &model) -> Handle;
+
+    /**
+     * @brief 释放网格，其空间在当前所有在飞的帧完成之后才归还，之前的上传不会覆盖仍在被读取的顶点与索引
+     */
+    void Free(Handle handle);
+
+    /**
+     * @brief 将所有存活的网格紧凑地拷贝到新的缓冲区中，会等待拷贝完成，只应在加载或卸载场景之后调用
+     */
+    void Defragment();
+
+    [[nodiscard]] auto GetAllocation(Handle handle) const -> const Allocation & { return m_allocations.at(handle); }
+
+    /**
+     * @brief 扩容或整理碎片重建缓冲区、网格的位置改变时递增，缓存了网格位置的使用者据此刷新
+     */
+    [[nodiscard]] auto GetLayoutVersion() const -> uint32_t;
+
+    [[nodiscard]] auto GetVertexBuffer(resource::VertexFormat vertex_format) const -> const std::shared_ptr<Buffer> & {
+        return m_vertex_pools.at(static_cast<size_t>(vertex_format)).m_vertex_buffer;
+    }
+    [[nodiscard]] auto GetPositionBuffer(resource::VertexFormat vertex_format) const
+            -> const std::shared_ptr<Buffer> & {
+        return m_vertex_pools.at(static_cast<size_t>(vertex_format)).m_position_buffer;
+    }
+    [[nodiscard]] auto GetIndexBuffer() const -> const std::shared_ptr<Buffer> & { return m_index_buffer; }
+
+    [[nodiscard]] auto GetStatistics() const -> Statistics;
+
+private:
+    struct VertexPool {
+        std::shared_ptr<Buffer> m_vertex_buffer;
+        std::shared_ptr<Buffer> m_position_buffer;
+        FreeListAllocator m_allocator;
+        uint32_t m_vertex_stride = 0;
+        uint32_t m_position_stride = 0;
+        uint32_t m_generation = 0;// 每次重建缓冲区后递增
+    };
+
+    /**
+     * @brief 由Free推入DeletionQueue的回调执行，归还网格的空间与handle；
+     * 期间重建过的缓冲区不含已释放的网格，其空间已随重建归还，只需归还handle
+     */
+    void ReleaseAllocation(Handle handle, uint32_t vertex_generation, uint32_t index_generation);
+
+    auto AllocateVertices(resource::VertexFormat vertex_format, uint32_t vertex_count) -> uint32_t;
+    auto AllocateIndices(uint32_t index_count) -> uint32_t;
+
+    /**
+     * @brief 按新容量创建缓冲区，并按原有顺序把存活的网格紧凑地拷贝过去
+     */
+    void RebuildVertexPool(resource::VertexFormat vertex_format, uint32_t capacity);
+    void RebuildIndexBuffer(uint32_t capacity);
+
+    auto CreateVertexBuffer(uint32_t stride, uint32_t capacity) const -> std::shared_ptr<Buffer>;
+    auto CreateIndexBuffer(uint32_t capacity) const -> std::shared_ptr<Buffer>;
+
+    /**
+     * @brief 通过staging buffer把data写入target的offset处
+     */
+    void UploadToBuffer(const std::shared_ptr<Buffer> &target, VkDeviceSize offset, const void *data,
+                        VkDeviceSize size) const;
+
+    /**
+     * @brief 录制并同步提交一组缓冲区之间的拷贝
+     */
+    void CopyRegions(const std::shared_ptr<Buffer> &src, const std::shared_ptr<Buffer> &dst,
+                     const std::vector<VkBufferCopy> &regions) const;
+
+    std::shared_ptr<Device> m_render_device;
+    std::array<VertexPool, resource::kVertexFormatCount> m_vertex_pools;
+    std::shared_ptr<Buffer> m_index_buffer;
+    FreeListAllocator m_index_allocator;
+    uint32_t m_index_generation = 0;
+
+    std::vector<Allocation> m_allocations;
+    std::vector<Handle> m_free_handles;
+};
+
+}// namespace rendering
+
+}// namespace saturn
@@ -0,0 +1,229 @@
+#include "gpu_culler.hpp"
+
+#include <runtime/function/rendering/frustum.hpp>
+
+namespace saturn {
+
+namespace rendering {
+
+auto GpuCuller::IsSupported(const Device &render_device) -> bool {
+    return render_device.GetEnabledFeatures().drawIndirectFirstInstance == VK_TRUE;
+}
+
+GpuCuller::GpuCuller(std::shared_ptr<Device> render_device, DescriptorLayoutCache &layout_cache,
+                     DescriptorAllocator &descriptor_allocator, std::shared_ptr<DescriptorWriteCache> write_cache,
+                     const std::vector<std::shared_ptr<Buffer>> &object_buffers)
+    : m_render_device{std::move(render_device)},
+      m_write_cache{std::move(write_cache)},
+      m_compacting{m_render_device->GetExtensionFunctions().m_cmd_draw_indexed_indirect_count != nullptr} {
+    m_descriptor_set_layout =
+            DescriptorSetLayout::Builder(m_render_device)
+                    .AddBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                    .AddBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                    .AddBinding(2, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                    .AddBinding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+                    .AddBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                    .AddBinding(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                    .Build(layout_cache);
+
+    m_cull_pipeline = ComputePipeline::Builder(m_render_device)
+                              .BindShader(R"(\shaders\cull.comp.spv)")
+                              .BindDescriptorSetLayout(m_descriptor_set_layout)
+                              .AddPushConstantRange<CullPushConstants>()
+                              .Build();
+
+    m_indirect_buffers.resize(object_buffers.size());
+    m_uniform_buffers.resize(object_buffers.size());
+    m_count_buffers.resize(object_buffers.size());
+    m_count_readback_buffers.resize(object_buffers.size());
+    m_lod_state_buffers.resize(object_buffers.size());
+    m_descriptor_sets.resize(object_buffers.size());
+    m_object_capacities.resize(object_buffers.size(), 0);
+    m_clear_lod_states.resize(object_buffers.size(), false);
+    for (size_t i = 0; i < object_buffers.size(); ++i) {
+        m_uniform_buffers[i] = std::make_shared<Buffer>(
+                m_render_device, sizeof(CullUniforms), 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 1,
+                VK_SHARING_MODE_CONCURRENT);
+        m_uniform_buffers[i]->Map();
+        m_count_buffers[i] = std::make_shared<Buffer>(
+                m_render_device, sizeof(DrawCounts), kLodViewCount * kDrawBatchCount,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                        VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 1, VK_SHARING_MODE_CONCURRENT);
+        m_count_readback_buffers[i] = std::make_shared<Buffer>(
+                m_render_device, sizeof(DrawCounts), kLodViewCount * kDrawBatchCount, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 1,
+                VK_SHARING_MODE_CONCURRENT);
+        m_count_readback_buffers[i]->Map();
+        // 第一次使用该帧槽位之前没有统计结果
+        std::memset(m_count_readback_buffers[i]->GetMappedMemory(), 0,
+                    m_count_readback_buffers[i]->GetBufferSize());
+
+        if (!descriptor_allocator.Allocate(m_descriptor_set_layout->GetDescriptorSetLayout(), m_descriptor_sets[i])) {
+            throw std::runtime_error("failed to allocate gpu culling descriptor set!");
+        }
+
+        auto uniform_buffer_info = m_uniform_buffers[i]->CreateDescriptorBufferInfo();
+        auto count_buffer_info = m_count_buffers[i]->CreateDescriptorBufferInfo();
+        // binding 3的Hi-Z金字塔随swapchain重建，在CmdCull中写入；随object buffer容量变化的binding在SetObjectBuffer中写入
+        DescriptorWriter(m_descriptor_set_layout, nullptr, m_write_cache)
+                .WriteBuffer(2, &uniform_buffer_info)
+                .WriteBuffer(4, &count_buffer_info)
+                .Overwrite(m_descriptor_sets[i]);
+        SetObjectBuffer(static_cast<uint32_t>(i), object_buffers[i]);
+    }
+}
+
+void GpuCuller::SetObjectBuffer(uint32_t frame_index, const std::shared_ptr<Buffer> &object_buffer) {
+    auto object_capacity = object_buffer->GetInstanceCount();
+    if (object_capacity != m_object_capacities.at(frame_index)) {
+        auto &indirect_buffer = m_indirect_buffers.at(frame_index);
+        auto &lod_state_buffer = m_lod_state_buffers.at(frame_index);
+        if (indirect_buffer != nullptr) {
+            m_render_device->GetDeletionQueue().Retire(std::move(indirect_buffer));
+            m_render_device->GetDeletionQueue().Retire(std::move(lod_state_buffer));
+        }
+
+        auto command_count = object_capacity * static_cast<uint32_t>(kLodViewCount);
+        indirect_buffer = std::make_shared<Buffer>(
+                m_render_device, sizeof(VkDrawIndexedIndirectCommand), command_count,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 1, VK_SHARING_MODE_CONCURRENT);
+        lod_state_buffer = std::make_shared<Buffer>(
+                m_render_device, sizeof(uint32_t), command_count,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 1, VK_SHARING_MODE_CONCURRENT);
+        m_object_capacities.at(frame_index) = object_capacity;
+        m_clear_lod_states.at(frame_index) = true;
+    }
+
+    auto object_buffer_info = object_buffer->CreateDescriptorBufferInfo();
+    auto indirect_buffer_info = m_indirect_buffers.at(frame_index)->CreateDescriptorBufferInfo();
+    auto lod_state_buffer_info = m_lod_state_buffers.at(frame_index)->CreateDescriptorBufferInfo();
+    DescriptorWriter(m_descriptor_set_layout, nullptr, m_write_cache)
+            .WriteBuffer(0, &object_buffer_info)
+            .WriteBuffer(1, &indirect_buffer_info)
+            .WriteBuffer(5, &lod_state_buffer_info)
+            .Overwrite(m_descriptor_sets.at(frame_index));
+}
+
+void GpuCuller::CmdResetDrawCounts(const std::shared_ptr<CommandsBuilder> &cmd_builder, uint32_t frame_index) {
+    auto *cmd_buffer = cmd_builder->GetCurrentCommandBuffer();
+    std::array<VkBuffer, 2> cleared_buffers{m_count_buffers.at(frame_index)->GetVkBuffer(), VK_NULL_HANDLE};
+    uint32_t cleared_count = 1;
+    // 新分配的LOD选择结果从LOD 0开始，之后每次剔除读取上一次的结果
+    if (m_clear_lod_states.at(frame_index)) {
+        cleared_buffers[cleared_count++] = m_lod_state_buffers.at(frame_index)->GetVkBuffer();
+        m_clear_lod_states.at(frame_index) = false;
+    }
+
+    std::array<VkBufferMemoryBarrier, 2> barriers{};
+    for (uint32_t i = 0; i < cleared_count; ++i) {
+        vkCmdFillBuffer(cmd_buffer, cleared_buffers[i], 0, VK_WHOLE_SIZE, 0);
+
+        auto &barrier = barriers[i];
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = cleared_buffers[i];
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+    }
+
+    vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0,
+                         nullptr, cleared_count, barriers.data(), 0, nullptr);
+}
+
+void GpuCuller::CmdCull(const std::shared_ptr<CommandsBuilder> &cmd_builder, uint32_t frame_index,
+                        uint32_t object_count, LodView lod_view, const glm::mat4 &view_proj,
+                        const LodSelection &lod_selection, const HiZPyramid &hiz_pyramid, bool occlusion_culling) {
+    SATURN_ASSERT(object_count <= m_object_capacities.at(frame_index), "Too many objects for gpu culling");
+
+    // 该帧槽位上一次提交的帧已完成，uniform buffer与descriptor set都不再被GPU使用
+    auto *uniforms = static_cast<CullUniforms *>(m_uniform_buffers.at(frame_index)->GetMappedMemory());
+    auto &view_data = uniforms->views.at(static_cast<size_t>(lod_view));
+    view_data.frustum_planes = ExtractFrustumPlanes(view_proj);
+    view_data.hiz_view_proj = hiz_pyramid.GetViewProj();
+    view_data.lod_origin = glm::vec4(lod_selection.m_camera_position, lod_selection.m_perspective ? 1.0f : 0.0f);
+    view_data.lod_params = glm::vec4(lod_selection.m_pixels_per_unit, lod_selection.m_error_threshold_pixels,
+                                     lod_selection.m_min_distance, RenderObject::kLodHysteresis);
+    uniforms->hiz_size = glm::vec2(hiz_pyramid.GetWidth(), hiz_pyramid.GetHeight());
+    uniforms->hiz_uv_scale = hiz_pyramid.GetUvScale();
+    uniforms->hiz_mip_count = hiz_pyramid.GetMipCount();
+
+    auto hiz_image_info = hiz_pyramid.CreateDescriptorImageInfo();
+    DescriptorWriter(m_descriptor_set_layout, nullptr, m_write_cache)
+            .WriteImage(3, &hiz_image_info)
+            .Overwrite(m_descriptor_sets.at(frame_index));
+
+    CullPushConstants push_constants{};
+    push_constants.object_count = object_count;
+    push_constants.lod_view = static_cast<uint32_t>(lod_view);
+    push_constants.command_offset = static_cast<uint32_t>(lod_view) * m_object_capacities.at(frame_index);
+    push_constants.occlusion_culling = occlusion_culling && hiz_pyramid.IsValid() ? 1 : 0;
+    push_constants.compact = m_compacting ? 1 : 0;
+
+    m_cull_pipeline->CmdBindCommandBuffer(cmd_builder);
+    m_cull_pipeline->CmdBindDescriptorSets(cmd_builder, m_descriptor_sets.at(frame_index));
+    m_cull_pipeline->CmdPushConstants(cmd_builder, push_constants);
+    m_cull_pipeline->CmdDispatch(cmd_builder, object_count, kLocalSize);
+}
+
+void GpuCuller::CmdCopyDrawCounts(const std::shared_ptr<CommandsBuilder> &cmd_builder, uint32_t frame_index) {
+    auto *cmd_buffer = cmd_builder->GetCurrentCommandBuffer();
+    const auto &count_buffer = m_count_buffers.at(frame_index);
+    const auto &readback_buffer = m_count_readback_buffers.at(frame_index);
+
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = count_buffer->GetVkBuffer();
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0,
+                         nullptr, 1, &barrier, 0, nullptr);
+
+    VkBufferCopy copy_region{};
+    copy_region.size = count_buffer->GetBufferSize();
+    vkCmdCopyBuffer(cmd_buffer, count_buffer->GetVkBuffer(), readback_buffer->GetVkBuffer(), 1, &copy_region);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barrier.buffer = readback_buffer->GetVkBuffer();
+    vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1,
+                         &barrier, 0, nullptr);
+}
+
+void GpuCuller::CmdBarrier(const std::shared_ptr<CommandsBuilder> &cmd_builder, uint32_t frame_index) {
+    std::array<VkBufferMemoryBarrier, 2> barriers{};
+    for (auto &barrier: barriers) {
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+    }
+    barriers[0].buffer = m_indirect_buffers.at(frame_index)->GetVkBuffer();
+    barriers[1].buffer = m_count_buffers.at(frame_index)->GetVkBuffer();
+
+    vkCmdPipelineBarrier(cmd_builder->GetCurrentCommandBuffer(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 0, nullptr, static_cast<uint32_t>(barriers.size()),
+                         barriers.data(), 0, nullptr);
+}
+
+auto GpuCuller::GetDrawCounts(uint32_t frame_index, LodView lod_view, uint32_t batch) const -> DrawCounts {
+    const auto *counts = static_cast<const DrawCounts *>(m_count_readback_buffers.at(frame_index)->GetMappedMemory());
+    return counts[static_cast<size_t>(lod_view) * kDrawBatchCount + batch];
+}
+
+}// namespace rendering
+
+}// namespace saturn
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <engine_pch.hpp>
+#include <runtime/function/rendering/buffer.hpp>
+#include <runtime/function/rendering/compute_pipeline.hpp>
+#include <runtime/function/rendering/descriptor.hpp>
+#include <runtime/function/rendering/device.hpp>
+#include <runtime/function/rendering/hiz_pyramid.hpp>
+#include <runtime/function/rendering/render_object.hpp>
+
+namespace saturn {
+
+namespace rendering {
+
+/**
+ * @brief 在compute shader中对物体做视锥剔除，为可见的物体写出VkDrawIndexedIndirectCommand
+ *
+ * 物体数据来自每帧的object buffer，命令按视角分段存放，每段的长度为该帧object buffer的容量，段内按绘制批次
+ * 连续排列，物体的位置由object buffer中的draw_slot指定，object buffer扩容后需调用SetObjectBuffer重新分配命令段。
+ * 支持VK_KHR_draw_indirect_count时可见的命令紧凑排列在批次的开头，每个批次一次
+ * vkCmdDrawIndexedIndirectCount；否则不可见的物体保留命令并将instanceCount置0，整个批次一次多重间接绘制。
+ * firstInstance为物体下标，顶点着色器通过gl_InstanceIndex读取物体数据
+ *
+ * 可见物体的LOD在剔除时按投影误差选择，规则与RenderObject::UpdateLod相同。滞后区间需要上一次选择的结果，
+ * 每个帧槽位在GPU上保存自己的选择，扩容后从LOD 0重新开始，同一次剔除中即可收敛到正确的LOD
+ *
+ * 每个视角与批次的可见物体数和三角形数在GPU上累加，复制到host可见的缓冲区，供之后复用该帧槽位时读取
+ *
+ * 开启遮挡剔除时，主相机视角额外用上一帧构建的Hi-Z金字塔测试包围盒，结果有一帧的延迟。投影没有完全落在上一帧
+ * 视口内的包围盒视为可见。已知限制：没有对本帧被剔除的物体按本帧深度再测试一遍，上一帧被遮挡、本帧重新露出的物体
+ * 会晚一帧出现（相机快速移动或遮挡物移开时可见短暂的闪现）
+ */
+class GpuCuller {
+public:
+    /**
+     * @brief 每个视角的剔除参数，布局需与cull.comp中的CullView（std140）保持一致
+     */
+    struct CullViewData {
+        std::array<glm::vec4, 6> frustum_planes;
+        glm::mat4 hiz_view_proj;// 构建Hi-Z时的view_proj，用于将包围盒投影到金字塔中
+        glm::vec4 lod_origin;   // xyz为相机位置，w为1时像素密度按到相机的距离缩放，为0时不缩放
+        glm::vec4 lod_params;   // x为像素密度，y为误差阈值（像素），z为最小距离，w为kLodHysteresis
+    };
+
+    /**
+     * @brief 每帧一份的uniform buffer，布局需与cull.comp中的CullUniforms（std140）保持一致
+     */
+    struct CullUniforms {
+        std::array<CullViewData, kLodViewCount> views;
+        glm::vec2 hiz_size;
+        glm::vec2 hiz_uv_scale;// 上一帧渲染区域相对整张深度图的比例
+        uint32_t hiz_mip_count;
+        std::array<uint32_t, 3> padding;
+    };
+    static_assert(sizeof(CullUniforms) == 992, "CullUniforms must match the std140 layout of cull.comp");
+
+    /**
+     * @brief 一个视角选择LOD的参数，与RenderObject::UpdateLod的pixels_per_unit含义相同
+     */
+    struct LodSelection {
+        glm::vec3 m_camera_position{0.0f};
+        float m_pixels_per_unit = 0.0f;// 透视视角为距离1处的值，按包围球到相机的距离缩放
+        float m_min_distance = 0.0f;   // 距离的下限，避免相机进入包围球时除以0
+        bool m_perspective = false;
+        float m_error_threshold_pixels = 1.0f;
+    };
+
+    /**
+     * @brief 布局需与cull.comp中的push_constant块保持一致
+     */
+    struct CullPushConstants {
+        uint32_t object_count;
+        uint32_t lod_view;
+        uint32_t command_offset;
+        uint32_t occlusion_culling;
+        uint32_t compact;
+    };
+
+    /**
+     * @brief 每个视角与批次在GPU上统计的结果，布局需与cull.comp中的DrawCounts保持一致
+     */
+    struct DrawCounts {
+        uint32_t draw_count;// 可见的物体数，紧凑排列时作为vkCmdDrawIndexedIndirectCount的绘制数
+        uint32_t triangle_count;
+    };
+
+    /**
+     * @brief 一个绘制批次在各视角命令段中的范围
+     */
+    struct DrawBatch {
+        uint32_t m_first_slot = 0;
+        uint32_t m_object_count = 0;
+    };
+
+    static constexpr uint32_t kLocalSize = 64;
+    // 同一批次的物体使用相同的pipeline与顶点缓冲，阴影按mobility分别绘制到静态缓存与动态层
+    static constexpr uint32_t kDrawBatchCount = static_cast<uint32_t>(resource::kVertexFormatCount) * 2;
+
+    static constexpr auto GetDrawBatch(resource::VertexFormat vertex_format, RenderObject::Mobility mobility)
+            -> uint32_t {
+        return static_cast<uint32_t>(vertex_format) * 2 + static_cast<uint32_t>(mobility);
+    }
+
+    /**
+     * @brief 间接绘制的firstInstance非0时需要drawIndirectFirstInstance特性
+     */
+    static auto IsSupported(const Device &render_device) -> bool;
+
+    /**
+     * @brief 每个帧槽位一个object buffer，命令段的长度取其容量
+     */
+    GpuCuller(std::shared_ptr<Device> render_device, DescriptorLayoutCache &layout_cache,
+              DescriptorAllocator &descriptor_allocator, std::shared_ptr<DescriptorWriteCache> write_cache,
+              const std::vector<std::shared_ptr<Buffer>> &object_buffers);
+
+    /**
+     * @brief 替换该帧槽位的object buffer，容量改变时重新分配命令与LOD选择的缓冲区，旧的交给DeletionQueue；
+     * 需在该帧槽位上一次提交的帧完成之后调用
+     */
+    void SetObjectBuffer(uint32_t frame_index, const std::shared_ptr<Buffer> &object_buffer);
+
+    /**
+     * @brief 在本帧所有视角的剔除之前调用，清零GPU上的统计
+     */
+    void CmdResetDrawCounts(const std::shared_ptr<CommandsBuilder> &cmd_builder, uint32_t frame_index);
+
+    /**
+     * @brief 录制lod_view对应视角的剔除与LOD选择，需在render pass之外调用
+     * @param hiz_pyramid 始终绑定到cull.comp，仅在occlusion_culling为true且金字塔有效时参与测试
+     */
+    void CmdCull(const std::shared_ptr<CommandsBuilder> &cmd_builder, uint32_t frame_index, uint32_t object_count,
+                 LodView lod_view, const glm::mat4 &view_proj, const LodSelection &lod_selection,
+                 const HiZPyramid &hiz_pyramid, bool occlusion_culling);
+
+    /**
+     * @brief 在本帧所有视角的剔除之后调用，将统计复制到host可见的缓冲区
+     */
+    void CmdCopyDrawCounts(const std::shared_ptr<CommandsBuilder> &cmd_builder, uint32_t frame_index);
+
+    /**
+     * @brief 所有视角剔除完成后调用，使写出的命令与绘制数对之后的间接绘制可见
+     */
+    void CmdBarrier(const std::shared_ptr<CommandsBuilder> &cmd_builder, uint32_t frame_index);
+
+    /**
+     * @brief 为true时可见的命令紧凑排列，需用vkCmdDrawIndexedIndirectCount绘制
+     */
+    [[nodiscard]] auto IsCompacting() const -> bool { return m_compacting; }
+
+    [[nodiscard]] auto GetIndirectBuffer(uint32_t frame_index) const -> const std::shared_ptr<Buffer> & {
+        return m_indirect_buffers.at(frame_index);
+    }
+
+    [[nodiscard]] auto GetCommandOffset(uint32_t frame_index, LodView lod_view, uint32_t slot) const -> VkDeviceSize {
+        return (static_cast<VkDeviceSize>(lod_view) * m_object_capacities.at(frame_index) + slot) *
+               sizeof(VkDrawIndexedIndirectCommand);
+    }
+
+    [[nodiscard]] auto GetCountBuffer(uint32_t frame_index) const -> const std::shared_ptr<Buffer> & {
+        return m_count_buffers.at(frame_index);
+    }
+
+    [[nodiscard]] static auto GetCountOffset(LodView lod_view, uint32_t batch) -> VkDeviceSize {
+        return (static_cast<VkDeviceSize>(lod_view) * kDrawBatchCount + batch) * sizeof(DrawCounts);
+    }
+
+    /**
+     * @brief 该帧槽位上一次提交的帧在GPU上统计的结果，需在等待该帧完成之后、再次提交之前读取
+     */
+    [[nodiscard]] auto GetDrawCounts(uint32_t frame_index, LodView lod_view, uint32_t batch) const -> DrawCounts;
+
+private:
+    std::shared_ptr<Device> m_render_device;
+    std::shared_ptr<DescriptorSetLayout> m_descriptor_set_layout;
+    std::shared_ptr<ComputePipeline> m_cull_pipeline;
+    std::vector<std::shared_ptr<Buffer>> m_indirect_buffers;
+    std::vector<std::shared_ptr<Buffer>> m_uniform_buffers;
+    std::vector<std::shared_ptr<Buffer>> m_count_buffers;
+    std::vector<std::shared_ptr<Buffer>> m_count_readback_buffers;
+    std::vector<std::shared_ptr<Buffer>> m_lod_state_buffers;// 每个视角、每个物体上一次选择的LOD
+    std::shared_ptr<DescriptorWriteCache> m_write_cache;
+    std::vector<VkDescriptorSet> m_descriptor_sets;
+    std::vector<uint32_t> m_object_capacities;// 每个帧槽位object buffer的容量，即每个视角命令段的长度
+    std::vector<bool> m_clear_lod_states;     // 重新分配后在下一次CmdResetDrawCounts中清零
+    bool m_compacting;
+};
+
+}// namespace rendering
+
+}// namespace saturn
@@ -0,0 +1,108 @@
+#include "gpu_profiler.hpp"
+
+namespace saturn {
+
+namespace rendering {
+
+GpuProfiler::GpuProfiler(std::shared_ptr<Device> render_device, uint32_t frames_in_flight, uint32_t max_scopes)
+    : m_render_device{std::move(render_device)}, m_max_scopes{max_scopes} {
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(m_render_device->GetPhyDevice(), &properties);
+    m_supported = properties.limits.timestampComputeAndGraphics == VK_TRUE;
+    m_timestamp_period = properties.limits.timestampPeriod;
+
+    if (!m_supported) {
+        ENGINE_LOG_WARN("Device does not support timestamp queries, GPU timings are disabled");
+        return;
+    }
+
+    m_frame_queries.resize(frames_in_flight);
+    for (auto &frame_queries: m_frame_queries) {
+        VkQueryPoolCreateInfo query_pool_info{};
+        query_pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        query_pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        query_pool_info.queryCount = m_max_scopes * 2;
+
+        if (vkCreateQueryPool(m_render_device->GetVkDevice(), &query_pool_info, nullptr,
+                              &frame_queries.m_query_pool) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create timestamp query pool!");
+        }
+    }
+}
+
+GpuProfiler::~GpuProfiler() {
+    for (auto &frame_queries: m_frame_queries) {
+        vkDestroyQueryPool(m_render_device->GetVkDevice(), frame_queries.m_query_pool, nullptr);
+    }
+}
+
+void GpuProfiler::BeginFrame(VkCommandBuffer cmd_buffer, uint32_t frame_index) {
+    if (!m_supported) { return; }
+
+    m_current_frame_index = frame_index;
+    auto &frame_queries = m_frame_queries.at(frame_index);
+    CollectResults(frame_queries);
+
+    vkCmdResetQueryPool(cmd_buffer, frame_queries.m_query_pool, 0, m_max_scopes * 2);
+    frame_queries.m_scope_names.clear();
+    frame_queries.m_query_count = 0;
+    m_open_scopes.clear();
+
+    BeginScope(cmd_buffer, "Frame");
+}
+
+void GpuProfiler::EndFrame(VkCommandBuffer cmd_buffer) {
+    if (!m_supported) { return; }
+    SATURN_ASSERT(m_open_scopes.size() == 1, "All GPU profiler scopes must be closed before EndFrame");
+
+    EndScope(cmd_buffer);
+}
+
+void GpuProfiler::BeginScope(VkCommandBuffer cmd_buffer, const std::string &name) {
+    if (!m_supported) { return; }
+
+    auto &frame_queries = m_frame_queries.at(m_current_frame_index);
+    SATURN_ASSERT(frame_queries.m_scope_names.size() < m_max_scopes, "Too many GPU profiler scopes in one frame");
+
+    auto scope_index = static_cast<uint32_t>(frame_queries.m_scope_names.size());
+    frame_queries.m_scope_names.push_back(name);
+    frame_queries.m_query_count = (scope_index + 1) * 2;
+    m_open_scopes.push_back(scope_index);
+
+    vkCmdWriteTimestamp(cmd_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame_queries.m_query_pool, scope_index * 2);
+}
+
+void GpuProfiler::EndScope(VkCommandBuffer cmd_buffer) {
+    if (!m_supported) { return; }
+    SATURN_ASSERT(!m_open_scopes.empty(), "EndScope called without matching BeginScope");
+
+    auto scope_index = m_open_scopes.back();
+    m_open_scopes.pop_back();
+
+    vkCmdWriteTimestamp(cmd_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                        m_frame_queries.at(m_current_frame_index).m_query_pool, scope_index * 2 + 1);
+}
+
+void GpuProfiler::CollectResults(FrameQueries &frame_queries) {
+    if (frame_queries.m_query_count == 0) { return; }
+
+    std::vector<uint64_t> timestamps(frame_queries.m_query_count);
+    // 该帧槽位上一次提交的帧已经完成，结果应当可用；未就绪时保留上一次的结果
+    auto result = vkGetQueryPoolResults(m_render_device->GetVkDevice(), frame_queries.m_query_pool, 0,
+                                        frame_queries.m_query_count, timestamps.size() * sizeof(uint64_t),
+                                        timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS) { return; }
+
+    m_results.resize(frame_queries.m_scope_names.size());
+    for (size_t i = 0; i < frame_queries.m_scope_names.size(); ++i) {
+        auto ticks = timestamps[i * 2 + 1] - timestamps[i * 2];
+        m_results[i].m_name = frame_queries.m_scope_names[i];
+        m_results[i].m_milliseconds = static_cast<float>(static_cast<double>(ticks) * m_timestamp_period * 1e-6);
+    }
+    // 第一个分段即BeginFrame开始的整帧分段
+    m_frame_milliseconds = m_results.front().m_milliseconds;
+}
+
+}// namespace rendering
+
+}// namespace saturn
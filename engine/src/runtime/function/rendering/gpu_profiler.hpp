@@ -0,0 +1,78 @@
+#pragma once
+
+#include <engine_pch.hpp>
+
+#include "device.hpp"
+
+namespace saturn {
+
+namespace rendering {
+
+/**
+ * @brief 基于timestamp query的GPU分段计时，每个in-flight帧持有一个query pool
+ *
+ * 某一帧的计时结果在该帧完成、下一次复用同一个帧下标时读取，因此不会阻塞CPU
+ */
+class GpuProfiler {
+public:
+    struct ScopeResult {
+        std::string m_name;
+        float m_milliseconds = 0.0f;
+    };
+
+    GpuProfiler(std::shared_ptr<Device> render_device, uint32_t frames_in_flight, uint32_t max_scopes = 32);
+    ~GpuProfiler();
+
+    GpuProfiler(const GpuProfiler &) = delete;
+    auto operator=(const GpuProfiler &) -> GpuProfiler & = delete;
+
+    /**
+     * @brief 读取该帧下标上一次录制的计时结果并重置query pool，需在command buffer开始录制后、该帧槽位上一次提交的帧完成后调用
+     *
+     * 同时开始一个覆盖整帧的"Frame"分段，由EndFrame结束
+     */
+    void BeginFrame(VkCommandBuffer cmd_buffer, uint32_t frame_index);
+
+    /**
+     * @brief 结束整帧的分段，需在command buffer结束录制之前调用，此时其余分段都应已结束
+     */
+    void EndFrame(VkCommandBuffer cmd_buffer);
+
+    void BeginScope(VkCommandBuffer cmd_buffer, const std::string &name);
+    void EndScope(VkCommandBuffer cmd_buffer);
+
+    [[nodiscard]] auto IsSupported() const -> bool { return m_supported; }
+
+    /**
+     * @brief 最近一次读回的各分段耗时，按BeginScope的调用顺序排列
+     */
+    [[nodiscard]] auto GetResults() const -> const std::vector<ScopeResult> & { return m_results; }
+
+    /**
+     * @brief 最近一次读回的整帧GPU耗时，尚无结果或不支持timestamp时为0
+     */
+    [[nodiscard]] auto GetFrameMilliseconds() const -> float { return m_frame_milliseconds; }
+
+private:
+    struct FrameQueries {
+        VkQueryPool m_query_pool = VK_NULL_HANDLE;
+        std::vector<std::string> m_scope_names{};
+        uint32_t m_query_count = 0;
+    };
+
+    void CollectResults(FrameQueries &frame_queries);
+
+    std::shared_ptr<Device> m_render_device;
+    std::vector<FrameQueries> m_frame_queries;
+    std::vector<uint32_t> m_open_scopes;// 未结束的scope在m_scope_names中的下标
+    std::vector<ScopeResult> m_results;
+    uint32_t m_current_frame_index = 0;
+    uint32_t m_max_scopes;
+    float m_timestamp_period = 1.0f;// 每个tick对应的纳秒数
+    float m_frame_milliseconds = 0.0f;
+    bool m_supported = false;
+};
+
+}// namespace rendering
+
+}// namespace saturn
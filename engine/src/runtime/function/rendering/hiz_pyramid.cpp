@@ -0,0 +1,204 @@
+#include "hiz_pyramid.hpp"
+
+#include <bit>
+
+namespace saturn {
+
+namespace rendering {
+
+HiZPyramid::HiZPyramid(std::shared_ptr<Device> render_device, DescriptorLayoutCache &layout_cache,
+                       std::shared_ptr<Image> depth_image)
+    : m_render_device{std::move(render_device)}, m_depth_image{std::move(depth_image)} {
+    // 取不超过深度图的2的幂，每一级恰好是上一级的一半，2x2归约不会漏掉边缘的texel
+    auto [depth_width, depth_height] = m_depth_image->GetExtent();
+    m_width = std::bit_floor(std::max(depth_width, 1u));
+    m_height = std::bit_floor(std::max(depth_height, 1u));
+    m_mip_count = static_cast<uint32_t>(std::bit_width(std::max(m_width, m_height)));
+
+    m_pyramid_image = std::make_shared<Image>(m_render_device, m_width, m_height, m_mip_count, VK_SAMPLE_COUNT_1_BIT,
+                                              VK_FORMAT_R32_SFLOAT, VK_IMAGE_TILING_OPTIMAL,
+                                              VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                                              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 1, VK_SHARING_MODE_CONCURRENT);
+    m_pyramid_image->CreateImageView(VK_IMAGE_ASPECT_COLOR_BIT);
+    // 第一次构建之前剔除就会绑定金字塔，需先处于descriptor声明的layout
+    m_pyramid_image->TransitionToLayout(VK_IMAGE_LAYOUT_GENERAL);
+
+    CreateSampler();
+    CreateMipViews();
+    CreateDescriptorSets(layout_cache);
+
+    // 多重采样的深度需要逐个样本读取
+    bool multisampled = m_depth_image->GetImageInfo().m_num_samples != VK_SAMPLE_COUNT_1_BIT;
+    m_init_pipeline = ComputePipeline::Builder(m_render_device)
+                              .BindShader(multisampled ? R"(\shaders\hiz_init_ms.comp.spv)"
+                                                       : R"(\shaders\hiz_init.comp.spv)")
+                              .BindDescriptorSetLayout(m_descriptor_set_layout)
+                              .AddPushConstantRange<HiZPushConstants>()
+                              .Build();
+    m_reduce_pipeline = ComputePipeline::Builder(m_render_device)
+                                .BindShader(R"(\shaders\hiz_reduce.comp.spv)")
+                                .BindDescriptorSetLayout(m_descriptor_set_layout)
+                                .AddPushConstantRange<HiZPushConstants>()
+                                .Build();
+}
+
+HiZPyramid::~HiZPyramid() {
+    for (auto *mip_view: m_mip_views) { vkDestroyImageView(m_render_device->GetVkDevice(), mip_view, nullptr); }
+    vkDestroySampler(m_render_device->GetVkDevice(), m_sampler, nullptr);
+}
+
+void HiZPyramid::CreateSampler() {
+    // 只通过texelFetch读取，不做过滤
+    VkSamplerCreateInfo sampler_info{};
+    sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    sampler_info.magFilter = VK_FILTER_NEAREST;
+    sampler_info.minFilter = VK_FILTER_NEAREST;
+    sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.anisotropyEnable = VK_FALSE;
+    sampler_info.maxAnisotropy = 1.0f;
+    sampler_info.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+    sampler_info.unnormalizedCoordinates = VK_FALSE;
+    sampler_info.compareEnable = VK_FALSE;
+    sampler_info.minLod = 0.0f;
+    sampler_info.maxLod = static_cast<float>(m_mip_count);
+
+    if (vkCreateSampler(m_render_device->GetVkDevice(), &sampler_info, nullptr, &m_sampler) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create hi-z sampler!");
+    }
+}
+
+void HiZPyramid::CreateMipViews() {
+    m_mip_views.resize(m_mip_count);
+    for (uint32_t mip = 0; mip < m_mip_count; ++mip) {
+        VkImageViewCreateInfo view_info{};
+        view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        view_info.image = m_pyramid_image->GetVkImage();
+        view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        view_info.format = VK_FORMAT_R32_SFLOAT;
+        view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        view_info.subresourceRange.baseMipLevel = mip;
+        view_info.subresourceRange.levelCount = 1;
+        view_info.subresourceRange.baseArrayLayer = 0;
+        view_info.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(m_render_device->GetVkDevice(), &view_info, nullptr, &m_mip_views[mip]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create hi-z mip view!");
+        }
+    }
+}
+
+void HiZPyramid::CreateDescriptorSets(DescriptorLayoutCache &layout_cache) {
+    m_descriptor_set_layout =
+            DescriptorSetLayout::Builder(m_render_device)
+                    .AddBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+                    .AddBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
+                    .Build(layout_cache);
+
+    // 每级mip一个set，随金字塔一起重建，使用独立的pool
+    m_descriptor_pool = DescriptorPool::Builder(m_render_device)
+                                .AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_mip_count)
+                                .AddPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, m_mip_count)
+                                .Build();
+
+    m_descriptor_sets.resize(m_mip_count);
+    for (uint32_t mip = 0; mip < m_mip_count; ++mip) {
+        VkDescriptorImageInfo src_info{};
+        src_info.sampler = m_sampler;
+        if (mip == 0) {
+            src_info.imageView = m_depth_image->GetVkImageView();
+            src_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        } else {
+            src_info.imageView = m_mip_views[mip - 1];
+            src_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        }
+
+        VkDescriptorImageInfo dst_info{};
+        dst_info.imageView = m_mip_views[mip];
+        dst_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        if (!DescriptorWriter(m_descriptor_set_layout, m_descriptor_pool)
+                     .WriteImage(0, &src_info)
+                     .WriteImage(1, &dst_info)
+                     .Build(m_descriptor_sets[mip])) {
+            throw std::runtime_error("failed to allocate hi-z descriptor set!");
+        }
+    }
+}
+
+void HiZPyramid::CmdBuild(const std::shared_ptr<CommandsBuilder> &cmd_builder, const glm::mat4 &view_proj,
+                          VkExtent2D render_extent) {
+    auto *cmd_buffer = cmd_builder->GetCurrentCommandBuffer();
+
+    // 每次构建都会覆盖所有mip，旧内容无需保留；等待本帧剔除对金字塔的读取完成
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = m_pyramid_image->GetVkImage();
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, m_mip_count, 0, 1};
+    vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0,
+                         nullptr, 0, nullptr, 1, &barrier);
+
+    auto [depth_width, depth_height] = m_depth_image->GetExtent();
+    HiZPushConstants push_constants{};
+    push_constants.src_size = glm::ivec2(depth_width, depth_height);
+    push_constants.dst_size = glm::ivec2(m_width, m_height);
+    push_constants.sample_count = static_cast<int32_t>(m_depth_image->GetImageInfo().m_num_samples);
+
+    for (uint32_t mip = 0; mip < m_mip_count; ++mip) {
+        const auto &pipeline = mip == 0 ? m_init_pipeline : m_reduce_pipeline;
+        // 只有mip 0使用init pipeline，之后的各级共用reduce pipeline
+        if (mip <= 1) { pipeline->CmdBindCommandBuffer(cmd_builder); }
+        if (mip > 0) {
+            push_constants.src_size = push_constants.dst_size;
+            push_constants.dst_size = glm::max(push_constants.dst_size / 2, glm::ivec2(1));
+        }
+
+        pipeline->CmdBindDescriptorSets(cmd_builder, m_descriptor_sets[mip]);
+        pipeline->CmdPushConstants(cmd_builder, push_constants);
+        vkCmdDispatch(cmd_buffer, (push_constants.dst_size.x + kLocalSize - 1) / kLocalSize,
+                      (push_constants.dst_size.y + kLocalSize - 1) / kLocalSize, 1);
+
+        CmdMipBarrier(cmd_buffer, mip, 1);
+    }
+
+    m_view_proj = view_proj;
+    // 渲染区域之外的texel也参与了取最大值，只会让跨越边界的texel更远，结果仍然保守
+    m_uv_scale = glm::vec2(static_cast<float>(render_extent.width) / static_cast<float>(depth_width),
+                           static_cast<float>(render_extent.height) / static_cast<float>(depth_height));
+    m_valid = true;
+}
+
+void HiZPyramid::CmdMipBarrier(VkCommandBuffer cmd_buffer, uint32_t base_mip, uint32_t mip_count) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = m_pyramid_image->GetVkImage();
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, base_mip, mip_count, 0, 1};
+    vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0,
+                         nullptr, 0, nullptr, 1, &barrier);
+}
+
+auto HiZPyramid::CreateDescriptorImageInfo() const -> VkDescriptorImageInfo {
+    VkDescriptorImageInfo image_info{};
+    image_info.sampler = m_sampler;
+    image_info.imageView = m_pyramid_image->GetVkImageView();
+    image_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    return image_info;
+}
+
+}// namespace rendering
+
+}// namespace saturn
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <engine_pch.hpp>
+#include <runtime/function/rendering/compute_pipeline.hpp>
+#include <runtime/function/rendering/descriptor.hpp>
+#include <runtime/function/rendering/device.hpp>
+#include <runtime/function/rendering/image.hpp>
+
+namespace saturn {
+
+namespace rendering {
+
+/**
+ * @brief 由shading pass的深度构建的层级深度（Hi-Z）金字塔，每个texel保存其覆盖区域内最远（最大）的深度
+ *
+ * mip 0为不超过深度图尺寸的2的幂，之后每一级对上一级做2x2取最大值。金字塔在帧末构建，供下一帧的遮挡剔除读取，
+ * 因此同时记录构建时所用的view_proj与渲染区域，剔除时用它们将包围盒投影到金字塔所在的屏幕空间
+ *
+ * 动态分辨率下深度只写在深度图左上角的渲染区域内，区域之外的深度没有被清除，剔除时只能采样该区域
+ */
+class HiZPyramid {
+public:
+    /**
+     * @brief 布局需与hiz_init.comp、hiz_reduce.comp中的push_constant块保持一致
+     */
+    struct HiZPushConstants {
+        glm::ivec2 src_size;
+        glm::ivec2 dst_size;
+        int32_t sample_count;
+        int32_t padding[3];
+    };
+
+    static constexpr uint32_t kLocalSize = 8;
+
+    /**
+     * @param depth_image 需带有VK_IMAGE_USAGE_SAMPLED_BIT，构建时处于SHADER_READ_ONLY_OPTIMAL
+     */
+    HiZPyramid(std::shared_ptr<Device> render_device, DescriptorLayoutCache &layout_cache,
+               std::shared_ptr<Image> depth_image);
+    ~HiZPyramid();
+
+    HiZPyramid(const HiZPyramid &) = delete;
+    auto operator=(const HiZPyramid &) -> HiZPyramid & = delete;
+
+    /**
+     * @brief 录制金字塔的构建，需在shading pass结束之后、render pass之外调用
+     * @param view_proj 生成深度图时主相机的view_proj
+     * @param render_extent 深度图中写入了深度的左上角区域
+     */
+    void CmdBuild(const std::shared_ptr<CommandsBuilder> &cmd_builder, const glm::mat4 &view_proj,
+                  VkExtent2D render_extent);
+
+    /**
+     * @brief 至少构建过一次后金字塔中才有有效的深度
+     */
+    [[nodiscard]] auto IsValid() const -> bool { return m_valid; }
+    void Invalidate() { m_valid = false; }
+
+    [[nodiscard]] auto GetViewProj() const -> const glm::mat4 & { return m_view_proj; }
+    /**
+     * @brief 渲染区域相对整张深度图的比例，视口内的uv乘以它得到金字塔中的uv
+     */
+    [[nodiscard]] auto GetUvScale() const -> glm::vec2 { return m_uv_scale; }
+    [[nodiscard]] auto GetWidth() const -> uint32_t { return m_width; }
+    [[nodiscard]] auto GetHeight() const -> uint32_t { return m_height; }
+    [[nodiscard]] auto GetMipCount() const -> uint32_t { return m_mip_count; }
+
+    /**
+     * @brief 覆盖所有mip的view与最近点采样器，金字塔在构建之外始终处于VK_IMAGE_LAYOUT_GENERAL
+     */
+    [[nodiscard]] auto CreateDescriptorImageInfo() const -> VkDescriptorImageInfo;
+
+private:
+    void CreateSampler();
+    void CreateMipViews();
+    void CreateDescriptorSets(DescriptorLayoutCache &layout_cache);
+
+    /**
+     * @brief mip写入完成后，使其对下一级的读取（以及下一帧的剔除）可见
+     */
+    void CmdMipBarrier(VkCommandBuffer cmd_buffer, uint32_t base_mip, uint32_t mip_count);
+
+    std::shared_ptr<Device> m_render_device;
+    std::shared_ptr<Image> m_depth_image;
+    std::shared_ptr<Image> m_pyramid_image;
+    std::vector<VkImageView> m_mip_views;
+    VkSampler m_sampler = VK_NULL_HANDLE;
+
+    std::shared_ptr<DescriptorPool> m_descriptor_pool;
+    std::shared_ptr<DescriptorSetLayout> m_descriptor_set_layout;
+    std::vector<VkDescriptorSet> m_descriptor_sets;// 下标i的set读取mip i - 1（i为0时读取深度图）并写入mip i
+    std::shared_ptr<ComputePipeline> m_init_pipeline;
+    std::shared_ptr<ComputePipeline> m_reduce_pipeline;
+
+    glm::mat4 m_view_proj{1.0f};
+    glm::vec2 m_uv_scale{1.0f};
+    uint32_t m_width = 1;
+    uint32_t m_height = 1;
+    uint32_t m_mip_count = 1;
+    bool m_valid = false;
+};
+
+}// namespace rendering
+
+}// namespace saturn
@@ -9,7 +9,7 @@ namespace rendering {
 
 Image::Image(std::shared_ptr<Device> render_device, uint32_t w, uint32_t h, uint32_t mip_levels,
              VkSampleCountFlagBits num_samples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
-             VkMemoryPropertyFlags properties)
+             VkMemoryPropertyFlags properties, uint32_t array_layers, VkSharingMode sharing_mode)
     : m_render_device(std::move(render_device)) {
     m_image_info.m_width = w;
     m_image_info.m_height = h;
@@ -19,6 +19,8 @@ Image::Image(std::shared_ptr<Device> render_device, uint32_t w, uint32_t h, uint
     m_image_info.m_tiling = tiling;
     m_image_info.m_usage = usage;
     m_image_info.m_properties = properties;
+    m_image_info.m_array_layers = array_layers;
+    m_image_info.m_sharing_mode = sharing_mode;
     CreateImage();
 }
 
@@ -45,28 +47,39 @@ Image::Image(const std::string &texture_path, std::shared_ptr<Device> render_dev
 
     if (!pixels) { throw std::runtime_error("Failed to load texture image!"); }
 
-    Buffer staging_buffer{m_render_device, 4, static_cast<uint32_t>(tex_width * tex_height),
-                          VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
-    staging_buffer.Map();
-    staging_buffer.WriteToBuffer(pixels);
-    staging_buffer.Unmap();
+    // 拷贝提交之前由UploadQueue持有
+    auto staging_buffer = std::make_shared<Buffer>(
+            m_render_device, 4, static_cast<uint32_t>(tex_width * tex_height), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    staging_buffer->Map();
+    staging_buffer->WriteToBuffer(pixels);
+    staging_buffer->Unmap();
 
     stbi_image_free(pixels);
 
     CreateImage();
-
-    TransitionToLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-
-    staging_buffer.CopyToImage(m_image, static_cast<uint32_t>(tex_width), static_cast<uint32_t>(tex_height));
-    CreateMipmaps(m_image_info.m_mip_levels);
+    CheckLinearBlitSupport();
+
+    VkBufferImageCopy region{};
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageExtent = {static_cast<uint32_t>(tex_width), static_cast<uint32_t>(tex_height), 1};
+
+    // vkCmdBlitImage只能在graphics队列上执行，mipmap在取得所有权之后生成
+    auto *staging_vk_buffer = staging_buffer->GetVkBuffer();
+    m_render_device->GetUploadQueue().CopyBufferToImage(
+            std::move(staging_buffer), staging_vk_buffer, m_image, region, m_image_info.m_mip_levels,
+            [this](VkCommandBuffer cmd_buffer) { CmdCreateMipmaps(cmd_buffer, m_image_info.m_mip_levels); });
+    m_image_info.m_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 }
 
 Image::~Image() {
-    vkDestroyImage(m_render_device->GetVkDevice(), m_image, nullptr);
-    vkDestroyImageView(m_render_device->GetVkDevice(), m_image_view, nullptr);
-
-    vkFreeMemory(m_render_device->GetVkDevice(), m_image_memory, nullptr);
+    // 在飞的帧可能仍在采样或写入该图像
+    m_render_device->GetDeletionQueue().Push([device = m_render_device->GetVkDevice(), image = m_image,
+                                              image_view = m_image_view, image_memory = m_image_memory]() {
+        vkDestroyImage(device, image, nullptr);
+        vkDestroyImageView(device, image_view, nullptr);
+        vkFreeMemory(device, image_memory, nullptr);
+    });
 }
 
 void Image::CreateImage() {
@@ -78,13 +91,13 @@ void Image::CreateImage() {
     image_info.extent.height = m_image_info.m_height;
     image_info.extent.depth = 1;
     image_info.mipLevels = m_image_info.m_mip_levels;
-    image_info.arrayLayers = 1;
+    image_info.arrayLayers = m_image_info.m_array_layers;
     image_info.format = m_image_info.m_format;
     image_info.tiling = m_image_info.m_tiling;
     image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     image_info.usage = m_image_info.m_usage;
     image_info.samples = m_image_info.m_num_samples;
-    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    m_render_device->FillSharingMode(m_image_info.m_sharing_mode, image_info);
 
     auto *vk_device = m_render_device->GetVkDevice();
 
@@ -123,7 +136,7 @@ void Image::TransitionToLayout(VkImageLayout new_layout) {
     barrier.subresourceRange.baseMipLevel = 0;
     barrier.subresourceRange.levelCount = m_image_info.m_mip_levels;
     barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
+    barrier.subresourceRange.layerCount = m_image_info.m_array_layers;
 
     VkPipelineStageFlags source_stage;
     VkPipelineStageFlags destination_stage;
@@ -141,6 +154,13 @@ void Image::TransitionToLayout(VkImageLayout new_layout) {
 
         source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
         destination_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    } else if (m_image_info.m_layout == VK_IMAGE_LAYOUT_UNDEFINED && new_layout == VK_IMAGE_LAYOUT_GENERAL) {
+        // compute shader读写的storage image
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+        source_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        destination_stage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
     } else {
         throw std::invalid_argument("unsupported layout transition!");
     }
@@ -149,9 +169,19 @@ void Image::TransitionToLayout(VkImageLayout new_layout) {
                          nullptr, 1, &barrier);
 
     cmd_builder.EndRecord().SubmitTo(m_render_device->GetGraphicsQueue());
+    m_image_info.m_layout = new_layout;
 }
 
 void Image::CreateMipmaps(uint32_t mip_levels) {
+    CheckLinearBlitSupport();
+
+    rendering::CommandsBuilder cmd_builder{m_render_device};
+    cmd_builder.AllocateCommandBuffers(1).BeginRecord();
+    CmdCreateMipmaps(cmd_builder.GetCurrentCommandBuffer(), mip_levels);
+    cmd_builder.EndRecord().SubmitTo(m_render_device->GetGraphicsQueue());
+}
+
+void Image::CheckLinearBlitSupport() {
     // Check if image format supports linear blitting
     VkFormatProperties format_properties;
     vkGetPhysicalDeviceFormatProperties(m_render_device->GetPhyDevice(), m_image_info.m_format, &format_properties);
@@ -159,10 +189,9 @@ void Image::CreateMipmaps(uint32_t mip_levels) {
     if (!(format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
         throw std::runtime_error("texture image format does not support linear blitting!");
     }
+}
 
-    rendering::CommandsBuilder cmd_builder{m_render_device};
-    cmd_builder.AllocateCommandBuffers(1).BeginRecord();
-
+void Image::CmdCreateMipmaps(VkCommandBuffer cmd_buffer, uint32_t mip_levels) {
     VkImageMemoryBarrier barrier{};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     barrier.image = m_image;
@@ -183,7 +212,7 @@ void Image::CreateMipmaps(uint32_t mip_levels) {
         barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
         barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
 
-        vkCmdPipelineBarrier(cmd_builder.GetCurrentCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT,
+        vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
                              VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 
         VkImageBlit blit{};
@@ -200,7 +229,7 @@ void Image::CreateMipmaps(uint32_t mip_levels) {
         blit.dstSubresource.baseArrayLayer = 0;
         blit.dstSubresource.layerCount = 1;
 
-        vkCmdBlitImage(cmd_builder.GetCurrentCommandBuffer(), m_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_image,
+        vkCmdBlitImage(cmd_buffer, m_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_image,
                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
 
         barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
@@ -208,7 +237,7 @@ void Image::CreateMipmaps(uint32_t mip_levels) {
         barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
         barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-        vkCmdPipelineBarrier(cmd_builder.GetCurrentCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT,
+        vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
                              VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 
         if (mip_width > 1) mip_width /= 2;
@@ -221,23 +250,21 @@ void Image::CreateMipmaps(uint32_t mip_levels) {
     barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
     barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-    vkCmdPipelineBarrier(cmd_builder.GetCurrentCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT,
+    vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
                          VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-    cmd_builder.EndRecord().SubmitTo(m_render_device->GetGraphicsQueue());
 }
 
 void Image::CreateImageView(VkImageAspectFlags aspect_flags) {
     VkImageViewCreateInfo view_info{};
     view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
     view_info.image = m_image;
-    view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view_info.viewType = m_image_info.m_array_layers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
     view_info.format = m_image_info.m_format;
     view_info.subresourceRange.aspectMask = aspect_flags;
     view_info.subresourceRange.baseMipLevel = 0;
     view_info.subresourceRange.levelCount = m_image_info.m_mip_levels;
     view_info.subresourceRange.baseArrayLayer = 0;
-    view_info.subresourceRange.layerCount = 1;
+    view_info.subresourceRange.layerCount = m_image_info.m_array_layers;
 
     if (vkCreateImageView(m_render_device->GetVkDevice(), &view_info, nullptr, &m_image_view) != VK_SUCCESS) {
         throw std::runtime_error("failed to create image view!");
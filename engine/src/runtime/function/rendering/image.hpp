@@ -22,15 +22,21 @@ public:
         VkImageUsageFlags m_usage;
         VkMemoryPropertyFlags m_properties;
         VkImageLayout m_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        uint32_t m_array_layers = 1;
+        VkSharingMode m_sharing_mode = VK_SHARING_MODE_EXCLUSIVE;// CONCURRENT时由所有队列族共享
     };
 
     Image(std::shared_ptr<Device> render_device, uint32_t w, uint32_t h, uint32_t mip_levels,
           VkSampleCountFlagBits num_samples, VkFormat format, VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL,
           VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
                                     VK_IMAGE_USAGE_SAMPLED_BIT,
-          VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+          VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, uint32_t array_layers = 1,
+          VkSharingMode sharing_mode = VK_SHARING_MODE_EXCLUSIVE);
 
-    // 读取纹理
+    /**
+     * @brief 读取纹理，mip 0在transfer队列上上传，所有权转移到graphics队列后在其上生成mipmap，由下一次
+     * UploadQueue::Submit提交
+     */
     Image(const std::string &texture_path, std::shared_ptr<Device> render_device, VkSampleCountFlagBits num_samples,
           VkFormat format, VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL,
           VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
@@ -41,6 +47,13 @@ public:
 
     void TransitionToLayout(VkImageLayout new_layout);
     void CreateMipmaps(uint32_t mip_levels);
+    /**
+     * @brief 所有mip需处于TRANSFER_DST_OPTIMAL，mip 0已写入数据，完成后所有mip处于SHADER_READ_ONLY_OPTIMAL
+     */
+    void CmdCreateMipmaps(VkCommandBuffer cmd_buffer, uint32_t mip_levels);
+    /**
+     * @brief 覆盖所有mip与layer的view，array_layers大于1时为VK_IMAGE_VIEW_TYPE_2D_ARRAY
+     */
     void CreateImageView(VkImageAspectFlags aspect_flags);
 
     [[nodiscard]] auto GetVkImage() -> VkImage { return m_image; }
@@ -50,11 +63,12 @@ public:
 
 private:
     void CreateImage();
+    void CheckLinearBlitSupport();
 
     std::shared_ptr<Device> m_render_device;
     VkImage m_image;
     VkDeviceMemory m_image_memory;
-    VkImageView m_image_view;
+    VkImageView m_image_view = VK_NULL_HANDLE;
     Info m_image_info;
 };
 
@@ -108,18 +108,55 @@ auto Pipeline::Builder::BindShaders(std::string vert_shader_path, std::string fr
 
 auto Pipeline::Builder::BindDescriptorSetLayout(std::shared_ptr<DescriptorSetLayout> descriptor_set_layout)
         -> Builder & {
-    std::vector<VkDescriptorSetLayout> descriptor_sets_layouts{descriptor_set_layout->GetDescriptorSetLayout()};
-    VkPipelineLayoutCreateInfo pipeline_layout_create_info{};
-    pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipeline_layout_create_info.setLayoutCount = descriptor_sets_layouts.size();
-    pipeline_layout_create_info.pSetLayouts = descriptor_sets_layouts.data();
-    // pipeline_layout_info.pushConstantRangeCount = 1;
-    // pipeline_layout_info.pPushConstantRanges = &push_constant_range;
-    if (vkCreatePipelineLayout(m_device->GetVkDevice(), &pipeline_layout_create_info, nullptr,
-                               &m_config_info->m_pipeline_layout) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create pipeline layout!");
-    }
+    m_descriptor_set_layouts.push_back(std::move(descriptor_set_layout));
+    return *this;
+}
 
+auto Pipeline::Builder::BindDescriptorSetLayouts(
+        const std::vector<std::shared_ptr<DescriptorSetLayout>> &descriptor_set_layouts) -> Builder & {
+    m_descriptor_set_layouts.insert(m_descriptor_set_layouts.end(), descriptor_set_layouts.begin(),
+                                    descriptor_set_layouts.end());
+    return *this;
+}
+
+auto Pipeline::Builder::AddPushConstantRange(VkShaderStageFlags stage_flags, uint32_t size, uint32_t offset)
+        -> Builder & {
+    SATURN_ASSERT(size > 0 && size % 4 == 0 && offset % 4 == 0, "Push constant range must be 4-byte aligned");
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(m_device->GetPhyDevice(), &properties);
+    SATURN_ASSERT(offset + size <= properties.limits.maxPushConstantsSize, "Push constant range exceeds device limit");
+
+    VkPushConstantRange push_constant_range{};
+    push_constant_range.stageFlags = stage_flags;
+    push_constant_range.offset = offset;
+    push_constant_range.size = size;
+    m_config_info->m_push_constant_ranges.push_back(push_constant_range);
+    return *this;
+}
+
+auto Pipeline::Builder::AddSpecializationConstant(VkShaderStageFlagBits stage, uint32_t constant_id, uint32_t value)
+        -> Builder & {
+    SATURN_ASSERT(stage == VK_SHADER_STAGE_VERTEX_BIT || stage == VK_SHADER_STAGE_FRAGMENT_BIT,
+                  "Specialization constants are only supported for vertex and fragment shaders");
+
+    VkSpecializationMapEntry entry{};
+    entry.constantID = constant_id;
+    entry.offset = static_cast<uint32_t>(m_config_info->m_specialization_data.size() * sizeof(uint32_t));
+    entry.size = sizeof(uint32_t);
+    m_config_info->m_specialization_data.push_back(value);
+
+    auto &entries = stage == VK_SHADER_STAGE_VERTEX_BIT ? m_config_info->m_vert_specialization_entries
+                                                        : m_config_info->m_frag_specialization_entries;
+    entries.push_back(entry);
+    return *this;
+}
+
+auto Pipeline::Builder::SetVertexInput(const std::vector<VkVertexInputBindingDescription> &binding_descriptions,
+                                       const std::vector<VkVertexInputAttributeDescription> &attribute_descriptions)
+        -> Builder & {
+    m_config_info->m_binding_descriptions = binding_descriptions;
+    m_config_info->m_attribute_descriptions = attribute_descriptions;
     return *this;
 }
 
@@ -133,10 +170,48 @@ auto Pipeline::Builder::SetMsaaSamples(VkSampleCountFlagBits sample_count) -> Bu
     return *this;
 }
 
+auto Pipeline::Builder::SetDepthCompareOp(VkCompareOp compare_op) -> Builder & {
+    m_config_info->m_depth_stencil_info.depthCompareOp = compare_op;
+    return *this;
+}
+
+auto Pipeline::Builder::SetDepthWrite(bool enable) -> Builder & {
+    m_config_info->m_depth_stencil_info.depthWriteEnable = enable ? VK_TRUE : VK_FALSE;
+    return *this;
+}
+
+auto Pipeline::Builder::DisableColorWrite() -> Builder & {
+    m_config_info->m_color_blend_attachment.blendEnable = VK_FALSE;
+    m_config_info->m_color_blend_attachment.colorWriteMask = 0;
+    return *this;
+}
+
 auto Pipeline::Builder::Build() -> std::shared_ptr<Pipeline> {
+    CreatePipelineLayout();
     return std::make_shared<Pipeline>(m_device, m_vert_path, m_frag_path, m_config_info);
 }
 
+void Pipeline::Builder::CreatePipelineLayout() {
+    std::vector<VkDescriptorSetLayout> descriptor_sets_layouts{};
+    descriptor_sets_layouts.reserve(m_descriptor_set_layouts.size());
+    for (const auto &descriptor_set_layout: m_descriptor_set_layouts) {
+        descriptor_sets_layouts.push_back(descriptor_set_layout->GetDescriptorSetLayout());
+    }
+
+    const auto &push_constant_ranges = m_config_info->m_push_constant_ranges;
+
+    VkPipelineLayoutCreateInfo pipeline_layout_create_info{};
+    pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeline_layout_create_info.setLayoutCount = static_cast<uint32_t>(descriptor_sets_layouts.size());
+    pipeline_layout_create_info.pSetLayouts = descriptor_sets_layouts.data();
+    pipeline_layout_create_info.pushConstantRangeCount = static_cast<uint32_t>(push_constant_ranges.size());
+    pipeline_layout_create_info.pPushConstantRanges = push_constant_ranges.data();
+    if (vkCreatePipelineLayout(m_device->GetVkDevice(), &pipeline_layout_create_info, nullptr,
+                               &m_config_info->m_pipeline_layout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create pipeline layout!");
+    }
+}
+
 Pipeline::Pipeline(std::shared_ptr<Device> device, const std::string &vert_filepath, const std::string &frag_filepath,
                    std::shared_ptr<ConfigInfo> config_info)
     : m_device(std::move(device)), m_config_info(std::move(config_info)) {
@@ -152,10 +227,23 @@ void Pipeline::CmdBindCommandBuffer(std::shared_ptr<CommandsBuilder> cmd_builder
     vkCmdBindPipeline(cmd_builder->GetCurrentCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphics_pipeline);
 }
 
+void Pipeline::CmdBindDescriptorSets(std::shared_ptr<CommandsBuilder> cmd_builder, VkDescriptorSet descriptor_set,
+                                     uint32_t first_set) const {
+    vkCmdBindDescriptorSets(cmd_builder->GetCurrentCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            m_config_info->m_pipeline_layout, first_set, 1, &descriptor_set, 0, nullptr);
+}
+
 void Pipeline::CmdBindDescriptorSets(std::shared_ptr<CommandsBuilder> cmd_builder,
-                                     VkDescriptorSet descriptor_set) const {
+                                     const std::vector<VkDescriptorSet> &descriptor_sets, uint32_t first_set) const {
     vkCmdBindDescriptorSets(cmd_builder->GetCurrentCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS,
-                            m_config_info->m_pipeline_layout, 0, 1, &descriptor_set, 0, nullptr);
+                            m_config_info->m_pipeline_layout, first_set, static_cast<uint32_t>(descriptor_sets.size()),
+                            descriptor_sets.data(), 0, nullptr);
+}
+
+void Pipeline::CmdPushConstants(std::shared_ptr<CommandsBuilder> cmd_builder, VkShaderStageFlags stage_flags,
+                                uint32_t offset, uint32_t size, const void *data) const {
+    vkCmdPushConstants(cmd_builder->GetCurrentCommandBuffer(), m_config_info->m_pipeline_layout, stage_flags, offset,
+                       size, data);
 }
 
 void Pipeline::CreateGraphicsPipeline(const std::string &vert_filepath, const std::string &frag_filepath,
@@ -171,6 +259,18 @@ void Pipeline::CreateGraphicsPipeline(const std::string &vert_filepath, const st
     CreateShaderModule(vert_code, &m_vert_shader_module);
     CreateShaderModule(frag_code, &m_frag_shader_module);
 
+    // 两个stage共用同一块常量数据，各自的entry只引用属于自己的部分
+    auto make_specialization_info = [&](const std::vector<VkSpecializationMapEntry> &entries) {
+        VkSpecializationInfo specialization_info{};
+        specialization_info.mapEntryCount = static_cast<uint32_t>(entries.size());
+        specialization_info.pMapEntries = entries.data();
+        specialization_info.dataSize = config_info->m_specialization_data.size() * sizeof(uint32_t);
+        specialization_info.pData = config_info->m_specialization_data.data();
+        return specialization_info;
+    };
+    auto vert_specialization_info = make_specialization_info(config_info->m_vert_specialization_entries);
+    auto frag_specialization_info = make_specialization_info(config_info->m_frag_specialization_entries);
+
     VkPipelineShaderStageCreateInfo shader_stages[2];
     shader_stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     shader_stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
@@ -178,14 +278,16 @@ void Pipeline::CreateGraphicsPipeline(const std::string &vert_filepath, const st
     shader_stages[0].pName = "main";
     shader_stages[0].flags = 0;
     shader_stages[0].pNext = nullptr;
-    shader_stages[0].pSpecializationInfo = nullptr;
+    shader_stages[0].pSpecializationInfo =
+            config_info->m_vert_specialization_entries.empty() ? nullptr : &vert_specialization_info;
     shader_stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     shader_stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
     shader_stages[1].module = m_frag_shader_module;
     shader_stages[1].pName = "main";
     shader_stages[1].flags = 0;
     shader_stages[1].pNext = nullptr;
-    shader_stages[1].pSpecializationInfo = nullptr;
+    shader_stages[1].pSpecializationInfo =
+            config_info->m_frag_specialization_entries.empty() ? nullptr : &frag_specialization_info;
 
     const auto &binding_descriptions = config_info->m_binding_descriptions;
     const auto &attribute_descriptions = config_info->m_attribute_descriptions;
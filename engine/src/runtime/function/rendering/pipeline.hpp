@@ -31,6 +31,10 @@ public:
         VkPipelineDepthStencilStateCreateInfo m_depth_stencil_info{};
         std::vector<VkDynamicState> m_dynamic_state_enables{};
         VkPipelineDynamicStateCreateInfo m_dynamic_state_info{};
+        std::vector<VkPushConstantRange> m_push_constant_ranges{};
+        std::vector<VkSpecializationMapEntry> m_vert_specialization_entries{};
+        std::vector<VkSpecializationMapEntry> m_frag_specialization_entries{};
+        std::vector<uint32_t> m_specialization_data{};// 两个stage的常量值共用，entry中的offset指向这里
         VkPipelineLayout m_pipeline_layout = nullptr;
         VkRenderPass m_render_pass = nullptr;
         uint32_t m_subpass = 0;
@@ -41,14 +45,57 @@ public:
         explicit Builder(std::shared_ptr<Device> device);
         auto EnableAlphaBlending() -> Builder &;
         auto BindShaders(std::string vert_shader_path, std::string frag_shader_path) -> Builder &;
+
+        /**
+         * @brief 按调用顺序追加descriptor set layout，第一次调用对应set = 0
+         */
         auto BindDescriptorSetLayout(std::shared_ptr<DescriptorSetLayout> descriptor_set_layout) -> Builder &;
+        auto BindDescriptorSetLayouts(const std::vector<std::shared_ptr<DescriptorSetLayout>> &descriptor_set_layouts)
+                -> Builder &;
+
+        auto AddPushConstantRange(VkShaderStageFlags stage_flags, uint32_t size, uint32_t offset = 0) -> Builder &;
+
+        template<typename T>
+        auto AddPushConstantRange(VkShaderStageFlags stage_flags, uint32_t offset = 0) -> Builder & {
+            return AddPushConstantRange(stage_flags, static_cast<uint32_t>(sizeof(T)), offset);
+        }
+
+        /**
+         * @brief 设置顶点或片段着色器中constant_id对应的specialization constant，值按32位写入（int、uint、float或bool）
+         */
+        auto AddSpecializationConstant(VkShaderStageFlagBits stage, uint32_t constant_id, uint32_t value) -> Builder &;
+        auto AddSpecializationConstant(VkShaderStageFlagBits stage, uint32_t constant_id, float value) -> Builder & {
+            uint32_t bits = 0;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return AddSpecializationConstant(stage, constant_id, bits);
+        }
+        auto AddSpecializationConstant(VkShaderStageFlagBits stage, uint32_t constant_id, bool value) -> Builder & {
+            return AddSpecializationConstant(stage, constant_id, static_cast<uint32_t>(value ? VK_TRUE : VK_FALSE));
+        }
+
+        /**
+         * @brief 覆盖默认的顶点输入布局（默认为resource::Model::Vertex）
+         */
+        auto SetVertexInput(const std::vector<VkVertexInputBindingDescription> &binding_descriptions,
+                            const std::vector<VkVertexInputAttributeDescription> &attribute_descriptions) -> Builder &;
+
         auto BindRenderpass(VkRenderPass render_pass) -> Builder &;
         auto SetMsaaSamples(VkSampleCountFlagBits sample_count) -> Builder &;
+        auto SetDepthCompareOp(VkCompareOp compare_op) -> Builder &;
+        auto SetDepthWrite(bool enable) -> Builder &;
+
+        /**
+         * @brief 关闭颜色写入，用于只写深度的pass
+         */
+        auto DisableColorWrite() -> Builder &;
         auto Build() -> std::shared_ptr<Pipeline>;
 
     private:
+        void CreatePipelineLayout();
+
         std::shared_ptr<Device> m_device;
         std::shared_ptr<ConfigInfo> m_config_info;
+        std::vector<std::shared_ptr<DescriptorSetLayout>> m_descriptor_set_layouts{};
         std::string m_vert_path, m_frag_path;
     };
 
@@ -60,9 +107,27 @@ public:
     auto operator=(const Pipeline &) -> Pipeline & = delete;
 
     auto GetGraphicsPipeline() -> VkPipeline { return m_graphics_pipeline; };
+    [[nodiscard]] auto GetPipelineLayout() const -> VkPipelineLayout { return m_config_info->m_pipeline_layout; }
 
     void CmdBindCommandBuffer(std::shared_ptr<CommandsBuilder> cmd_builder);
-    void CmdBindDescriptorSets(std::shared_ptr<CommandsBuilder> cmd_builder, VkDescriptorSet descriptor_set) const;
+    void CmdBindDescriptorSets(std::shared_ptr<CommandsBuilder> cmd_builder, VkDescriptorSet descriptor_set,
+                               uint32_t first_set = 0) const;
+    void CmdBindDescriptorSets(std::shared_ptr<CommandsBuilder> cmd_builder,
+                               const std::vector<VkDescriptorSet> &descriptor_sets, uint32_t first_set = 0) const;
+
+    void CmdPushConstants(std::shared_ptr<CommandsBuilder> cmd_builder, VkShaderStageFlags stage_flags,
+                          uint32_t offset, uint32_t size, const void *data) const;
+
+    /**
+     * @brief 以类型T写入push constant，T的大小与偏移需要落在Builder声明的range内
+     */
+    template<typename T>
+    void CmdPushConstants(std::shared_ptr<CommandsBuilder> cmd_builder, VkShaderStageFlags stage_flags, const T &data,
+                          uint32_t offset = 0) const {
+        static_assert(std::is_trivially_copyable_v<T>, "Push constant data must be trivially copyable");
+        static_assert(sizeof(T) % 4 == 0, "Push constant size must be a multiple of 4");
+        CmdPushConstants(std::move(cmd_builder), stage_flags, offset, static_cast<uint32_t>(sizeof(T)), &data);
+    }
 
 private:
     void CreateGraphicsPipeline(const std::string &vert_filepath, const std::string &frag_filepath,
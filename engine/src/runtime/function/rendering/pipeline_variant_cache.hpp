@@ -0,0 +1,46 @@
+#pragma once
+
+#include <engine_pch.hpp>
+#include <runtime/function/rendering/pipeline.hpp>
+
+namespace saturn {
+
+namespace rendering {
+
+/**
+ * @brief 按变体key缓存的pipeline，key中的每个字段对应一个specialization constant或固定管线状态
+ *
+ * 第一次请求某个key时通过factory创建pipeline，之后直接返回缓存的结果；切换功能只是换一个key，
+ * 之前使用过的pipeline仍保留在缓存中，不需要等待设备空闲，shader中也不需要运行时分支
+ */
+template<typename Key, typename Hash = std::hash<Key>>
+class PipelineVariantCache {
+public:
+    using Factory = std::function<std::shared_ptr<Pipeline>(const Key &)>;
+
+    explicit PipelineVariantCache(Factory factory) : m_factory(std::move(factory)) {}
+
+    PipelineVariantCache(const PipelineVariantCache &) = delete;
+    auto operator=(const PipelineVariantCache &) -> PipelineVariantCache & = delete;
+
+    auto Get(const Key &key) -> const std::shared_ptr<Pipeline> & {
+        auto it = m_pipelines.find(key);
+        if (it == m_pipelines.end()) { it = m_pipelines.emplace(key, m_factory(key)).first; }
+        return it->second;
+    }
+
+    /**
+     * @brief 销毁所有缓存的pipeline，调用者需保证GPU不再使用它们
+     */
+    void Clear() { m_pipelines.clear(); }
+
+    [[nodiscard]] auto GetSize() const -> size_t { return m_pipelines.size(); }
+
+private:
+    Factory m_factory;
+    std::unordered_map<Key, std::shared_ptr<Pipeline>, Hash> m_pipelines;
+};
+
+}// namespace rendering
+
+}// namespace saturn
@@ -6,64 +6,63 @@ namespace saturn {
 
 namespace rendering {
 
-RenderObject::RenderObject(std::shared_ptr<Device> render_device, std::unique_ptr<resource::Model> model)
-    : m_render_device(std::move(render_device)), m_model(std::move(model)) {
-    CreateVertexBuffer();
-    CreateIndexBuffer();
+RenderObject::Mesh::Mesh(std::shared_ptr<GeometryArena> geometry_arena, std::unique_ptr<resource::Model> model)
+    : m_geometry_arena(std::move(geometry_arena)), m_model(std::move(model)) {
+    m_geometry_handle = m_geometry_arena->Upload(*m_model);
+}
+
+RenderObject::Mesh::~Mesh() { m_geometry_arena->Free(m_geometry_handle); }
+
+RenderObject::RenderObject(std::shared_ptr<GeometryArena> geometry_arena, std::unique_ptr<resource::Model> model)
+    : m_mesh(std::make_shared<const Mesh>(std::move(geometry_arena), std::move(model))) {}
+
+auto RenderObject::CreateInstance() const -> std::shared_ptr<RenderObject> {
+    return std::shared_ptr<RenderObject>(new RenderObject(m_mesh));
 }
 
 auto RenderObject::GetBindingDescriptions() -> std::vector<VkVertexInputBindingDescription> {
-    std::vector<VkVertexInputBindingDescription> binding_descriptions(1);
-    binding_descriptions[0].binding = 0;
-    binding_descriptions[0].stride = sizeof(resource::Model::Vertex);
-    binding_descriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    return binding_descriptions;
+    return resource::Model::GetBindingDescriptions(GetVertexFormat());
 }
 
 auto RenderObject::GetAttributeDescriptions() -> std::vector<VkVertexInputAttributeDescription> {
-    std::vector<VkVertexInputAttributeDescription> attribute_descriptions{};
-    attribute_descriptions.push_back({0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(resource::Model::Vertex, m_position)});
-    attribute_descriptions.push_back({1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(resource::Model::Vertex, m_color)});
-    attribute_descriptions.push_back({2, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(resource::Model::Vertex, m_normal)});
-    attribute_descriptions.push_back({3, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(resource::Model::Vertex, m_uv)});
-
-    return attribute_descriptions;
+    return resource::Model::GetAttributeDescriptions(GetVertexFormat());
 }
 
-void RenderObject::CreateVertexBuffer() {
-    auto vertices = m_model->m_vertices;
-
-    rendering::Buffer staging_buffer{m_render_device, sizeof(vertices[0]), static_cast<uint32_t>(vertices.size()),
-                                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
-    staging_buffer.Map();
-    staging_buffer.WriteToBuffer(vertices.data());
-    staging_buffer.Unmap();
+void RenderObject::SetModelMatrix(const glm::mat4 &model_matrix) {
+    if (model_matrix == m_model_matrix) { return; }
+    m_model_matrix = model_matrix;
+    ++m_transform_version;
+}
 
-    m_vertex_buffer = std::make_shared<rendering::Buffer>(
-            m_render_device, sizeof(vertices[0]), static_cast<uint32_t>(vertices.size()),
-            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+auto RenderObject::GetWorldBoundingSphere() const -> glm::vec4 {
+    const auto &model = *m_mesh->m_model;
+    auto local_center = (model.m_bounds_min + model.m_bounds_max) * 0.5f;
+    float local_radius = glm::length(model.m_bounds_max - model.m_bounds_min) * 0.5f;
 
-    staging_buffer.CopyToBuffer(m_vertex_buffer);
+    auto world_center = glm::vec3(m_model_matrix * glm::vec4(local_center, 1.0f));
+    return {world_center, local_radius * GetMaxScale()};
 }
 
-void RenderObject::CreateIndexBuffer() {
-    auto indices = m_model->m_indices;
+void RenderObject::UpdateLod(LodView view, float pixels_per_unit, float error_threshold_pixels) {
+    const auto &lods = GetLods();
+    auto &lod_index = m_lod_indices.at(static_cast<size_t>(view));
+    if (lods.empty()) { return; }
+    lod_index = std::min(lod_index, static_cast<uint32_t>(lods.size() - 1));
 
-    rendering::Buffer staging_buffer{m_render_device, sizeof(indices[0]), static_cast<uint32_t>(indices.size()),
-                                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
-    staging_buffer.Map();
-    staging_buffer.WriteToBuffer(indices.data());
-    staging_buffer.Unmap();
+    float max_scale = GetMaxScale();
+    auto projected_error = [&](uint32_t index) { return lods[index].m_error * max_scale * pixels_per_unit; };
 
-    m_index_buffer = std::make_shared<rendering::Buffer>(
-            m_render_device, sizeof(indices[0]), static_cast<uint32_t>(indices.size()),
-            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-    staging_buffer.CopyToBuffer(m_index_buffer);
+    while (lod_index > 0 && projected_error(lod_index) > error_threshold_pixels) { --lod_index; }
+    while (lod_index + 1 < lods.size() &&
+           projected_error(lod_index + 1) < error_threshold_pixels * kLodHysteresis) {
+        ++lod_index;
+    }
 }
 
+auto RenderObject::GetMaxScale() const -> float {
+    return std::max({glm::length(glm::vec3(m_model_matrix[0])), glm::length(glm::vec3(m_model_matrix[1])),
+                     glm::length(glm::vec3(m_model_matrix[2]))});
+}
 
 }// namespace rendering
 
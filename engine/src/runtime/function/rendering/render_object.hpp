@@ -2,32 +2,161 @@
 
 #include <engine_pch.hpp>
 #include <runtime/function/rendering/buffer.hpp>
+#include <runtime/function/rendering/geometry_arena.hpp>
 #include <runtime/resource/model.hpp>
 
 namespace saturn {
     
 namespace rendering {
 
+/**
+ * @brief 需要独立选择LOD的视角，主相机与每个阴影cascade各自维护当前的LOD
+ */
+enum class LodView : uint8_t {
+    Main,
+    ShadowCascade0,
+    ShadowCascade1,
+    ShadowCascade2,
+    ShadowCascade3,
+};
+
+constexpr uint32_t kShadowCascadeCount = 4;
+constexpr size_t kLodViewCount = 1 + kShadowCascadeCount;
+
+constexpr auto GetShadowCascadeView(uint32_t cascade) -> LodView {
+    return static_cast<LodView>(static_cast<uint32_t>(LodView::ShadowCascade0) + cascade);
+}
+
 class RenderObject {
 public:
-    explicit RenderObject(std::shared_ptr<Device> render_device, std::unique_ptr<resource::Model> model);
+    /**
+     * @brief 静态物体的阴影缓存在static shadowmap中，只有变换改变或cascade移动时才重新渲染；动态物体每次都叠加到缓存之上
+     */
+    enum class Mobility : uint8_t {
+        Static,
+        Dynamic,
+    };
+
+    /**
+     * @brief 误差低于阈值的该倍数时才换用更粗糙的LOD，GPU剔除选择LOD时使用相同的规则
+     */
+    static constexpr float kLodHysteresis = 0.75f;
+
+    /**
+     * @brief 将模型的几何数据上传到geometry_arena中，共用该网格的最后一个物体析构时归还
+     */
+    explicit RenderObject(std::shared_ptr<GeometryArena> geometry_arena, std::unique_ptr<resource::Model> model);
+
+    RenderObject(const RenderObject &) = delete;
+    auto operator=(const RenderObject &) -> RenderObject & = delete;
+
+    /**
+     * @brief 与本物体共用模型与几何数据的新物体，变换、mobility与材质为默认值
+     */
+    [[nodiscard]] auto CreateInstance() const -> std::shared_ptr<RenderObject>;
+
     auto GetBindingDescriptions() -> std::vector<VkVertexInputBindingDescription>;
     auto GetAttributeDescriptions() -> std::vector<VkVertexInputAttributeDescription>;
 
-    auto GetVertexBuffer() -> std::shared_ptr<Buffer> { return m_vertex_buffer; }
-    auto GetIndexBuffer() -> std::shared_ptr<Buffer> { return m_index_buffer; }
+    /**
+     * @brief 与同一顶点格式的其他物体共用的缓冲区，整理碎片后会被替换，绘制时需重新获取
+     */
+    auto GetVertexBuffer() -> std::shared_ptr<Buffer> {
+        return m_mesh->m_geometry_arena->GetVertexBuffer(GetVertexFormat());
+    }
+    auto GetIndexBuffer() -> std::shared_ptr<Buffer> { return m_mesh->m_geometry_arena->GetIndexBuffer(); }
+
+    /**
+     * @brief 只含位置的顶点流，只写深度的pass绑定它以减少顶点读取量
+     */
+    auto GetPositionBuffer() -> std::shared_ptr<Buffer> {
+        return m_mesh->m_geometry_arena->GetPositionBuffer(GetVertexFormat());
+    }
+
+    /**
+     * @brief 网格在共享缓冲区中的位置：LOD的索引范围需加上m_first_index，绘制时vertexOffset为m_vertex_offset
+     */
+    [[nodiscard]] auto GetGeometry() const -> const GeometryArena::Allocation & {
+        return m_mesh->m_geometry_arena->GetAllocation(m_mesh->m_geometry_handle);
+    }
+
+    [[nodiscard]] auto GetVertices() const -> const std::vector<resource::Model::Vertex>& {
+        return m_mesh->m_model->m_vertices;
+    }
+    [[nodiscard]] auto GetIndices() const -> const std::vector<uint32_t>& { return m_mesh->m_model->m_indices; }
 
-    [[nodiscard]] auto GetVertices() const -> const std::vector<resource::Model::Vertex>& { return m_model->m_vertices; }
-    [[nodiscard]] auto GetIndices() const -> const std::vector<uint32_t>& { return m_model->m_indices; }
+    [[nodiscard]] auto GetVertexFormat() const -> resource::VertexFormat { return m_mesh->m_model->GetVertexFormat(); }
+    [[nodiscard]] auto IsClosed() const -> bool { return m_mesh->m_model->IsClosed(); }
+    [[nodiscard]] auto GetPositionScale() const -> glm::vec3 { return m_mesh->m_model->GetPositionScale(); }
+    [[nodiscard]] auto GetPositionOffset() const -> glm::vec3 { return m_mesh->m_model->GetPositionOffset(); }
+
+    void SetModelMatrix(const glm::mat4 &model_matrix);
+    [[nodiscard]] auto GetModelMatrix() const -> const glm::mat4 & { return m_model_matrix; }
+
+    /**
+     * @brief 模型矩阵每次实际改变时加一，阴影缓存据此判断投射阴影的物体是否移动
+     */
+    [[nodiscard]] auto GetTransformVersion() const -> uint32_t { return m_transform_version; }
+
+    void SetMobility(Mobility mobility) { m_mobility = mobility; }
+    [[nodiscard]] auto GetMobility() const -> Mobility { return m_mobility; }
+
+    void SetMaterialIndex(uint32_t material_index) { m_material_index = material_index; }
+    [[nodiscard]] auto GetMaterialIndex() const -> uint32_t { return m_material_index; }
+
+    /**
+     * @brief 世界空间的包围球，xyz为球心，w为半径
+     */
+    [[nodiscard]] auto GetWorldBoundingSphere() const -> glm::vec4;
+
+    /**
+     * @brief 按投影后的误差选择LOD：误差超过阈值时换用更精细的LOD，低于阈值的kLodHysteresis倍才换用更粗糙的LOD
+     * @param pixels_per_unit 物体所在位置上，世界空间单位长度对应的像素数
+     */
+    void UpdateLod(LodView view, float pixels_per_unit, float error_threshold_pixels = 1.0f);
+    [[nodiscard]] auto GetLodIndex(LodView view) const -> uint32_t { return m_lod_indices.at(static_cast<size_t>(view)); }
+    [[nodiscard]] auto GetLod(LodView view) const -> const resource::Model::LodLevel & {
+        return m_mesh->m_model->m_lods.at(GetLodIndex(view));
+    }
+    [[nodiscard]] auto GetLods() const -> const std::vector<resource::Model::LodLevel> & {
+        return m_mesh->m_model->m_lods;
+    }
+    [[nodiscard]] auto GetLodCount() const -> uint32_t { return static_cast<uint32_t>(GetLods().size()); }
+
+    [[nodiscard]] auto GetMeshlets() const -> const std::vector<resource::Model::Meshlet> & {
+        return m_mesh->m_model->m_meshlets;
+    }
+
+    /**
+     * @brief 模型矩阵三个轴上的最大缩放，用于将局部空间的半径变换到世界空间
+     */
+    [[nodiscard]] auto GetMaxScale() const -> float;
 
 private:
-    void CreateVertexBuffer();
-    void CreateIndexBuffer();
+    /**
+     * @brief 模型与其在geometry_arena中的分配，由同一网格的所有实例共享
+     */
+    struct Mesh {
+        Mesh(std::shared_ptr<GeometryArena> geometry_arena, std::unique_ptr<resource::Model> model);
+        ~Mesh();
+
+        Mesh(const Mesh &) = delete;
+        auto operator=(const Mesh &) -> Mesh & = delete;
+
+        std::shared_ptr<GeometryArena> m_geometry_arena;
+        std::unique_ptr<resource::Model> m_model;
+        GeometryArena::Handle m_geometry_handle = 0;
+    };
+
+    explicit RenderObject(std::shared_ptr<const Mesh> mesh) : m_mesh(std::move(mesh)) {}
+
+    std::shared_ptr<const Mesh> m_mesh;
 
-    std::shared_ptr<Device> m_render_device;
-    std::unique_ptr<resource::Model> m_model;
-    std::shared_ptr<Buffer> m_vertex_buffer;
-    std::shared_ptr<Buffer> m_index_buffer;
+    glm::mat4 m_model_matrix{1.0f};
+    uint32_t m_transform_version = 0;
+    Mobility m_mobility = Mobility::Static;
+    uint32_t m_material_index = 0;
+    std::array<uint32_t, kLodViewCount> m_lod_indices{};
 };
 
 }  // namespace rendering
@@ -1,8 +1,15 @@
 #include "render_system.hpp"
 
+#include <runtime/function/rendering/frustum.hpp>
+
+#include <bit>
+#include <numeric>
+#include <random>
+
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
 namespace saturn {
@@ -23,67 +30,254 @@ void RenderSystem::Init() {
 }
 
 void RenderSystem::Tick(float delta_time) {
+    m_frame_pacer->OnInputSampled();
+    // 基准测试切换配置可能重新上传几何数据，需在本帧的上传提交之前完成
+    m_frame_benchmark->BeginFrame();
+    if (m_requested_swapchain_settings != m_swapchain_settings) { ApplySwapchainSettings(); }
+    if (m_requested_frames_in_flight != static_cast<int>(m_frames_in_flight)) { ApplyFramesInFlight(); }
+    // 拖动滑块期间不重复生成实例
+    if (m_requested_stress_instance_count != static_cast<int>(m_stress_instance_count) && !ImGui::IsAnyItemActive()) {
+        SetStressInstanceCount(static_cast<uint32_t>(std::max(m_requested_stress_instance_count, 0)));
+    }
+    // 窗口最小化期间不渲染，也不阻塞主循环
+    if (m_swapchain_dirty && !RecreateSwapchain()) { return; }
+    UpdateRenderExtent();
+
+    if (!BeginFrame()) { return; }
+    // 压力测试场景中CPU的开销随物体数变化，与各分段的GPU耗时一起统计
+    auto scope_results = m_gpu_profiler->GetResults();
+    scope_results.push_back({"CPU Scene Update", m_scene_update_milliseconds});
+    m_frame_benchmark->RecordFrame(scope_results);
+
+    auto scene_update_start = std::chrono::high_resolution_clock::now();
+    UpdateObjectLayout();
+    // 每帧的host可见缓冲区需在该帧槽位上一次提交的帧完成之后写入，只有一帧在飞时尤为重要
     UpdateUniformBuffer(m_cur_swapchain_frame_index);
-
-
-    BeginFrame();
-
-    BeginOffscreenRenderPass();
-    {
-        m_shadowmap_pipeline->CmdBindCommandBuffer(m_command_builder);
-
-        VkBuffer vertex_buffers[] = {m_render_objects.at(0)->GetVertexBuffer()->GetVkBuffer()};
-        VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(m_command_builder->GetCurrentCommandBuffer(), 0, 1, vertex_buffers, offsets);
-
-        vkCmdBindIndexBuffer(m_command_builder->GetCurrentCommandBuffer(),
-                             m_render_objects.at(0)->GetIndexBuffer()->GetVkBuffer(), 0, VK_INDEX_TYPE_UINT32);
-
-        m_shadowmap_pipeline->CmdBindDescriptorSets(m_command_builder,
-                                                    m_shadowmap_descriptor_sets[m_cur_swapchain_frame_index]);
-
-        vkCmdDrawIndexed(m_command_builder->GetCurrentCommandBuffer(),
-                         static_cast<uint32_t>(m_render_objects.at(0)->GetIndices().size()), 1, 0, 0, 0);
+    UpdateObjectBuffer();
+    if (m_enable_gpu_culling) {
+        CullObjectsOnGpu();
+    } else {
+        CullClusters();
     }
-    EndOffscreenRenderPass();
 
+    DrawShadowCascades();
+    m_scene_update_milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>(
+                                          std::chrono::high_resolution_clock::now() - scene_update_start)
+                                          .count();
+
+    if (m_shading_variant.m_clustered_lighting) {
+        if (IsAsyncComputeEnabled()) {
+            // 与阴影的绘制重叠，shading的片段着色器之前完成即可
+            BeginAsyncCompute(1);
+            m_clustered_lighting->CmdBuildClusters(m_compute_command_builder, m_cur_swapchain_frame_index);
+            SubmitAsyncCompute(VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, false);
+        } else {
+            m_gpu_profiler->BeginScope(m_command_builder->GetCurrentCommandBuffer(), "Light Culling");
+            m_clustered_lighting->CmdBuildClusters(m_command_builder, m_cur_swapchain_frame_index);
+            m_clustered_lighting->CmdBarrier(m_command_builder, m_cur_swapchain_frame_index);
+            m_gpu_profiler->EndScope(m_command_builder->GetCurrentCommandBuffer());
+        }
+    }
 
     BeginShadingRenderPass();
     {
-        m_shading_pipeline->CmdBindCommandBuffer(m_command_builder);
-
-        VkBuffer vertex_buffers[] = {m_render_objects.at(0)->GetVertexBuffer()->GetVkBuffer()};
-        VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(m_command_builder->GetCurrentCommandBuffer(), 0, 1, vertex_buffers, offsets);
-
-        vkCmdBindIndexBuffer(m_command_builder->GetCurrentCommandBuffer(),
-                             m_render_objects.at(0)->GetIndexBuffer()->GetVkBuffer(), 0, VK_INDEX_TYPE_UINT32);
+        auto *cmd_buffer = m_command_builder->GetCurrentCommandBuffer();
+
+        // 先只写深度，之后的shading只对可见的片段执行
+        if (m_enable_depth_prepass) {
+            m_gpu_profiler->BeginScope(cmd_buffer, "Depth Pre-pass");
+            DrawRenderObjects(m_depth_prepass_pipelines, m_shadowmap_descriptor_sets[m_cur_swapchain_frame_index],
+                              LodView::Main, true);
+            m_gpu_profiler->EndScope(cmd_buffer);
+        }
 
-        //TODO(整理代码)
-        VkDescriptorImageInfo shadowmap_image_info{};
-        shadowmap_image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        shadowmap_image_info.imageView = m_render_swapchain->GetShadowmapImage()->GetVkImageView();
-        shadowmap_image_info.sampler = m_texture_sampler;
-        rendering::DescriptorWriter(m_descriptor_set_layout, m_descriptor_pool)
-                .WriteImage(2, &shadowmap_image_info)
-                .Overwrite(m_descriptor_sets.at(m_cur_swapchain_frame_index));
+        // depth pre-pass之后使用EQUAL测试且不写深度的变体
+        auto shading_variant = m_shading_variant;
+        shading_variant.m_depth_equal = m_enable_depth_prepass;
+        shading_variant.m_msaa_samples = m_swapchain_settings.m_msaa_samples;
+        auto shading_pipelines = GetShadingPipelines(shading_variant);
+        m_gpu_profiler->BeginScope(cmd_buffer, "Shading");
+        m_main_triangle_count =
+                DrawRenderObjects(shading_pipelines, m_descriptor_sets[m_cur_swapchain_frame_index], LodView::Main);
+        m_gpu_profiler->EndScope(cmd_buffer);
+    }
+    EndShadingRenderPass();
 
-        m_shading_pipeline->CmdBindDescriptorSets(m_command_builder, m_descriptor_sets[m_cur_swapchain_frame_index]);
+    if (m_hiz_pyramid != nullptr) {
+        if (m_enable_gpu_culling && m_enable_occlusion_culling) {
+            BuildHiZPyramid();
+        } else {
+            // 未更新的金字塔已经过时，重新开启后需等到下一次构建
+            m_hiz_pyramid->Invalidate();
+        }
+    }
 
-        vkCmdDrawIndexed(m_command_builder->GetCurrentCommandBuffer(),
-                         static_cast<uint32_t>(m_render_objects.at(0)->GetIndices().size()), 1, 0, 0, 0);
+    BeginPresentRenderPass();
+    {
+        DrawUpscale();
 
         ImGui_ImplVulkan_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
         ImGui::Text("FPS:%i", static_cast<int>(1.0f / delta_time));
+        ImGui::Text("Descriptor writes skipped:%llu",
+                    static_cast<unsigned long long>(m_descriptor_write_cache->GetSkippedWriteCount()));
+        if (ImGui::Button("Descriptor Write Benchmark")) {
+            m_descriptor_benchmark_result =
+                    RunDescriptorWriteBenchmark(m_render_device, *m_descriptor_layout_cache, 100000);
+        }
+        if (m_descriptor_benchmark_result.has_value()) {
+            ImGui::Text("Descriptor writes/s legacy:%.0f writer:%.0f template:%.0f",
+                        m_descriptor_benchmark_result->m_legacy_writes_per_second,
+                        m_descriptor_benchmark_result->m_writer_writes_per_second,
+                        m_descriptor_benchmark_result->m_template_writes_per_second);
+        }
+        // GPU剔除时为GPU上统计的可见三角形，有若干帧的延迟
+        ImGui::Text("Triangles%s main:%llu shadow:%llu", m_enable_gpu_culling ? " (GPU readback)" : "",
+                    static_cast<unsigned long long>(m_main_triangle_count),
+                    static_cast<unsigned long long>(m_shadow_triangle_count));
+        if (m_frame_benchmark->IsRunning()) {
+            ImGui::Text("Benchmark '%s' running...", m_frame_benchmark->GetName().c_str());
+        } else {
+            if (ImGui::Button("Benchmark Vertex Formats")) { StartVertexFormatBenchmark(); }
+            ImGui::SameLine();
+            if (ImGui::Button("Benchmark Anti-aliasing")) { StartAntiAliasingBenchmark(); }
+            if (m_gpu_culler != nullptr) {
+                ImGui::SameLine();
+                if (ImGui::Button("Benchmark Object Count")) { StartObjectCountBenchmark(); }
+            }
+        }
+        if (!m_frame_benchmark->GetResults().empty() && ImGui::TreeNode("Benchmark Results")) {
+            for (const auto &case_result: m_frame_benchmark->GetResults()) {
+                ImGui::Text("%s", case_result.m_name.c_str());
+                for (const auto &scope: case_result.m_scopes) {
+                    ImGui::Text("  %s: %.3f ms", scope.m_name.c_str(), scope.m_milliseconds);
+                }
+            }
+            ImGui::TreePop();
+        }
+        ImGui::Checkbox("Shadow Cache", &m_enable_shadow_cache);
+        ImGui::Text("Shadow cascades rendered static:%u dynamic:%u/%u", m_static_shadow_render_count,
+                    m_dynamic_shadow_render_count, kShadowCascadeCount);
+        const auto geometry_statistics = m_geometry_arena->GetStatistics();
+        ImGui::Text("Geometry arena vertices:%u/%u indices:%u/%u free blocks:%u", geometry_statistics.m_used_vertices,
+                    geometry_statistics.m_vertex_capacity, geometry_statistics.m_used_indices,
+                    geometry_statistics.m_index_capacity, geometry_statistics.m_free_block_count);
+        ImGui::Checkbox("Depth Pre-pass", &m_enable_depth_prepass);
+        bool dynamic_resolution = m_dynamic_resolution->IsEnabled();
+        if (ImGui::Checkbox("Dynamic Resolution", &dynamic_resolution)) {
+            m_dynamic_resolution->SetEnabled(dynamic_resolution);
+        }
+        if (dynamic_resolution) {
+            float target_frame_milliseconds = m_dynamic_resolution->GetTargetFrameMilliseconds();
+            if (ImGui::SliderFloat("Target GPU Frame (ms)", &target_frame_milliseconds, 1.0f, 33.3f)) {
+                m_dynamic_resolution->SetTargetFrameMilliseconds(target_frame_milliseconds);
+            }
+        }
+        ImGui::SliderFloat("Upscale Sharpness", &m_upscale_sharpness, 0.0f, 1.0f);
+        // MSAA的开销计入Shading，FXAA的开销计入Upscale，可在下方的GPU耗时中对比
+        const std::array<VkSampleCountFlagBits, 4> msaa_options{VK_SAMPLE_COUNT_1_BIT, VK_SAMPLE_COUNT_2_BIT,
+                                                                VK_SAMPLE_COUNT_4_BIT, VK_SAMPLE_COUNT_8_BIT};
+        const char *msaa_names[] = {"Off", "2x", "4x", "8x"};
+        auto &requested_msaa_samples = m_requested_swapchain_settings.m_msaa_samples;
+        if (ImGui::BeginCombo("MSAA", msaa_names[std::countr_zero(static_cast<uint32_t>(requested_msaa_samples))])) {
+            for (size_t i = 0; i < msaa_options.size(); ++i) {
+                if (!m_render_device->IsMsaaSamplesSupported(msaa_options[i])) { continue; }
+                if (ImGui::Selectable(msaa_names[i], msaa_options[i] == requested_msaa_samples)) {
+                    requested_msaa_samples = msaa_options[i];
+                }
+            }
+            ImGui::EndCombo();
+        }
+        ImGui::Checkbox("FXAA", &m_enable_fxaa);
+
+        // 帧节奏：吞吐与延迟之间的取舍
+        const std::array<VkPresentModeKHR, 4> present_modes{VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_MAILBOX_KHR,
+                                                            VK_PRESENT_MODE_IMMEDIATE_KHR,
+                                                            VK_PRESENT_MODE_FIFO_RELAXED_KHR};
+        const char *present_mode_names[] = {"FIFO", "Mailbox", "Immediate", "FIFO Relaxed"};
+        auto &requested_present_mode = m_requested_swapchain_settings.m_present_mode;
+        auto requested_present_mode_index = static_cast<size_t>(
+                std::find(present_modes.begin(), present_modes.end(), requested_present_mode) - present_modes.begin());
+        if (ImGui::BeginCombo("Present Mode", present_mode_names[requested_present_mode_index])) {
+            for (size_t i = 0; i < present_modes.size(); ++i) {
+                if (!m_render_swapchain->IsPresentModeSupported(present_modes[i])) { continue; }
+                if (ImGui::Selectable(present_mode_names[i], i == requested_present_mode_index)) {
+                    requested_present_mode = present_modes[i];
+                }
+            }
+            ImGui::EndCombo();
+        }
+        ImGui::SliderInt("Frames In Flight", &m_requested_frames_in_flight, 1, Swapchain::kMaxFramesInFlight);
+        float target_fps = m_frame_pacer->GetTargetFps();
+        if (ImGui::SliderFloat("FPS Limit (0 = off)", &target_fps, 0.0f, 240.0f, "%.0f")) {
+            m_frame_pacer->SetTargetFps(target_fps);
+        }
+        ImGui::Text("CPU frame:%.2f ms latency to present:%.2f ms to GPU done:%.2f ms",
+                    m_frame_pacer->GetCpuFrameMilliseconds(), m_frame_pacer->GetPresentLatencyMilliseconds(),
+                    m_frame_pacer->GetCompletionLatencyMilliseconds());
+        ImGui::Text("Render scale:%.2f (%ux%u) GPU frame:%.2f ms", m_dynamic_resolution->GetScale(),
+                    m_render_extent.width, m_render_extent.height,
+                    m_dynamic_resolution->GetSmoothedFrameMilliseconds());
+        float split_lambda = m_shadow_cascades->GetSplitLambda();
+        if (ImGui::SliderFloat("Cascade Split Lambda", &split_lambda, 0.0f, 1.0f)) {
+            m_shadow_cascades->SetSplitLambda(split_lambda);
+        }
+        // 以下选项只切换shading变体，对应的pipeline首次使用时创建并缓存
+        ImGui::Checkbox("Shadows", &m_shading_variant.m_enable_shadows);
+        const char *shadow_filter_names[] = {"Hardware 2x2", "Optimized PCF 3x3", "Optimized PCF 5x5", "Poisson Disk"};
+        int shadow_filter = static_cast<int>(m_shading_variant.m_shadow_filter);
+        if (ImGui::Combo("Shadow Filter", &shadow_filter, shadow_filter_names, IM_ARRAYSIZE(shadow_filter_names))) {
+            m_shading_variant.m_shadow_filter = static_cast<ShadowFilter>(shadow_filter);
+        }
+        if (m_shading_variant.m_shadow_filter == ShadowFilter::PoissonDisk) {
+            int poisson_tap_count = static_cast<int>(m_shading_variant.m_poisson_tap_count);
+            if (ImGui::SliderInt("Poisson Taps", &poisson_tap_count, 1, 16)) {
+                m_shading_variant.m_poisson_tap_count = static_cast<uint32_t>(poisson_tap_count);
+            }
+        }
+        // 以UBO传入，调整时不需要新的pipeline
+        ImGui::SliderFloat("Shadow Bias", &m_shadow_bias, 0.0f, 0.02f, "%.4f");
+        ImGui::Checkbox("Alpha Blending", &m_shading_variant.m_alpha_blending);
+        ImGui::Checkbox("Clustered Lighting", &m_shading_variant.m_clustered_lighting);
+        if (m_shading_variant.m_clustered_lighting) {
+            ImGui::SliderInt("Point Lights", &m_point_light_count, 0, static_cast<int>(ClusteredLighting::kMaxLights));
+        }
+        ImGui::Text("Shading pipeline variants:%zu", m_shading_pipeline_cache->GetSize());
+        if (m_async_compute_supported) { ImGui::Checkbox("Async Compute", &m_enable_async_compute); }
+        if (m_gpu_culler != nullptr) {
+            ImGui::SliderInt("Stress Instances", &m_requested_stress_instance_count, 0,
+                             static_cast<int>(kMaxStressInstanceCount));
+            ImGui::Text("Objects:%zu CPU scene update:%.3f ms", m_render_objects.size(), m_scene_update_milliseconds);
+            // cluster剔除的缓冲区按加载时的物体分配，压力测试的实例只支持GPU剔除
+            if (m_stress_instance_count == 0) { ImGui::Checkbox("GPU Culling", &m_enable_gpu_culling); }
+            if (m_enable_gpu_culling) { ImGui::Checkbox("Occlusion Culling", &m_enable_occlusion_culling); }
+        }
+        ImGui::Checkbox("Cluster Culling", &m_enable_cluster_culling);
+        ImGui::Checkbox("Cone Culling", &m_enable_cone_culling);
+        if (m_enable_cluster_culling && !m_enable_gpu_culling) {
+            const auto &main_statistics = m_cluster_culler->GetStatistics(LodView::Main);
+            uint32_t shadow_visible_meshlets = 0;
+            uint32_t shadow_total_meshlets = 0;
+            for (uint32_t cascade = 0; cascade < kShadowCascadeCount; ++cascade) {
+                const auto &shadow_statistics = m_cluster_culler->GetStatistics(GetShadowCascadeView(cascade));
+                shadow_visible_meshlets += shadow_statistics.m_visible_meshlets;
+                shadow_total_meshlets += shadow_statistics.m_total_meshlets;
+            }
+            ImGui::Text("Meshlets main:%u/%u shadow:%u/%u", main_statistics.m_visible_meshlets,
+                        main_statistics.m_total_meshlets, shadow_visible_meshlets, shadow_total_meshlets);
+            ImGui::Text("Cluster culling (CPU): %.3f ms", m_cluster_culling_milliseconds);
+        }
+        for (const auto &scope_result: m_gpu_profiler->GetResults()) {
+            ImGui::Text("%s: %.3f ms", scope_result.m_name.c_str(), scope_result.m_milliseconds);
+        }
         // ImGui::ShowDemoWindow();
 
         ImGui::Render();
         ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), m_command_builder->GetCurrentCommandBuffer());
     }
-    EndShadingRenderPass();
+    EndPresentRenderPass();
 
     EndFrame();
     ++m_test;
@@ -95,10 +289,16 @@ void RenderSystem::Clear() {
     ImGui::DestroyContext();
 
     vkDestroySampler(m_render_device->GetVkDevice(), m_texture_sampler, nullptr);
+    vkDestroySampler(m_render_device->GetVkDevice(), m_upscale_sampler, nullptr);
+    // 延迟释放的Swapchain、未提交上传的staging buffer等对象持有Device，需在此处析构，否则Device无法析构
+    m_render_device->GetUploadQueue().SubmitAndWait();
+    m_render_device->GetDeletionQueue().Flush();
 
     glfwTerminate();
 }
 
+void RenderSystem::WaitForNextFrame() { m_frame_pacer->WaitForNextFrame(); }
+
 auto RenderSystem::ShouldCloseWindow() -> bool { return glfwWindowShouldClose(m_window->GetGlfwWindow()) != 0; }
 
 void RenderSystem::InitWindow() { m_window = std::make_shared<rendering::Window>(m_width, m_height, "First Game"); }
@@ -107,15 +307,24 @@ void RenderSystem::InitVulkan() {
     CreateDevice();
     CreateSwapchain();
     CreateDescriptorSetLayout();
+    CreateShadowCascades();
     CreateShadowmapPipeline();
+    CreateDepthPrepassPipeline();
     CreateGraphicsPipeline();
     CreateImage();
     CreateImageSampler();
     LoadModel();
     CreateUniformBuffers();
+    CreateObjectBuffers();
     CreateDescriptorPool();
+    CreateClusteredLighting();
     CreateDescriptorSets();
+    CreateUpscalePipeline();
     CreateCommandBuffers();
+    CreateAsyncCompute();
+    CreateClusterCuller();
+    CreateGpuCuller();
+    CreateHiZPyramid();
 }
 
 void RenderSystem::InitImgui() {
@@ -152,9 +361,10 @@ void RenderSystem::InitImgui() {
     init_info.DescriptorPool = m_imgui_descriptor_pool->GetDescriptorPool();
     init_info.MinImageCount = 3;
     init_info.ImageCount = 3;
-    init_info.MSAASamples = m_render_device->GetMaxMsaaSamples();
+    // UI在放大之后以原生分辨率绘制，不参与MSAA
+    init_info.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
 
-    ImGui_ImplVulkan_Init(&init_info, m_render_swapchain->GetShadingRenderPass());
+    ImGui_ImplVulkan_Init(&init_info, m_render_swapchain->GetPresentRenderPass());
 
     //execute a gpu command to upload imgui font textures
     rendering::CommandsBuilder cmd_builder{m_render_device};
@@ -170,44 +380,118 @@ void RenderSystem::CreateDevice() {
     m_render_device = std::make_shared<rendering::Device>("SaturnEngine", "First Game", m_window);
 }
 
-void RenderSystem::CreateSwapchain() { m_render_swapchain = std::make_unique<rendering::Swapchain>(m_render_device); }
+void RenderSystem::CreateSwapchain() {
+    // 8x在高分辨率下开销很大，默认最多使用4x，可在UI中切换
+    m_swapchain_settings.m_msaa_samples = std::min(VK_SAMPLE_COUNT_4_BIT, m_render_device->GetMaxMsaaSamples());
+    m_requested_swapchain_settings = m_swapchain_settings;
+    m_render_swapchain = std::make_unique<rendering::Swapchain>(m_render_device, m_swapchain_settings);
+    m_frame_pacer = std::make_unique<rendering::FramePacer>(rendering::Swapchain::kMaxFramesInFlight);
+}
 
 void RenderSystem::CreateDescriptorSetLayout() {
+    m_descriptor_layout_cache = std::make_unique<rendering::DescriptorLayoutCache>(m_render_device);
+
     m_shadowmap_descriptor_set_layout =
             rendering::DescriptorSetLayout::Builder(m_render_device)
                     .AddBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
-                    .Build();
+                    .AddBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+                    .Build(*m_descriptor_layout_cache);
 
     m_descriptor_set_layout =
             rendering::DescriptorSetLayout::Builder(m_render_device)
-                    .AddBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+                    .AddBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                                VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
                     .AddBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
                     .AddBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
-                    .Build();
+                    .AddBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+                    .AddBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+                    .AddBinding(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+                    .AddBinding(6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+                    .AddBinding(7, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+                    .Build(*m_descriptor_layout_cache);
+}
+
+void RenderSystem::CreateShadowCascades() {
+    // 4个1024²的cascade，显存只有原先单张4096² shadowmap的四分之一，近处的texel密度反而更高
+    m_shadow_cascades = std::make_unique<rendering::ShadowCascades>(m_render_device, 1024);
 }
 
 void RenderSystem::CreateShadowmapPipeline() {
     std::string vert_path{R"(\shaders\shadow_map.vert.spv)"};
     std::string frag_path{R"(\shaders\shadow_map.frag.spv)"};
 
-    m_shadowmap_pipeline = rendering::Pipeline::Builder(m_render_device)
-                                   .BindShaders(vert_path, frag_path)
-                                   .BindDescriptorSetLayout(m_shadowmap_descriptor_set_layout)
-                                   .BindRenderpass(m_render_swapchain->GetOffscreenRenderPass())
-                                   .Build();
+    for (size_t i = 0; i < resource::kVertexFormatCount; ++i) {
+        auto vertex_format = static_cast<resource::VertexFormat>(i);
+        m_shadowmap_pipelines[i] =
+                rendering::Pipeline::Builder(m_render_device)
+                        .BindShaders(vert_path, frag_path)
+                        .SetVertexInput(resource::Model::GetPositionBindingDescriptions(vertex_format),
+                                        resource::Model::GetPositionAttributeDescriptions(vertex_format))
+                        .BindDescriptorSetLayout(m_shadowmap_descriptor_set_layout)
+                        .AddPushConstantRange<ShadowPushConstants>(VK_SHADER_STAGE_VERTEX_BIT)
+                        .BindRenderpass(m_shadow_cascades->GetRenderPass())
+                        .Build();
+    }
+}
+
+void RenderSystem::CreateDepthPrepassPipeline() {
+    // 与shadowmap共用只含位置的路径，相机的view/proj同样来自binding 0的UBO
+    std::string vert_path{R"(\shaders\depth_prepass.vert.spv)"};
+    std::string frag_path{R"(\shaders\shadow_map.frag.spv)"};
+
+    for (size_t i = 0; i < resource::kVertexFormatCount; ++i) {
+        auto vertex_format = static_cast<resource::VertexFormat>(i);
+        m_depth_prepass_pipelines[i] =
+                rendering::Pipeline::Builder(m_render_device)
+                        .BindShaders(vert_path, frag_path)
+                        .SetVertexInput(resource::Model::GetPositionBindingDescriptions(vertex_format),
+                                        resource::Model::GetPositionAttributeDescriptions(vertex_format))
+                        .BindDescriptorSetLayout(m_shadowmap_descriptor_set_layout)
+                        .BindRenderpass(m_render_swapchain->GetShadingRenderPass())
+                        .SetMsaaSamples(m_swapchain_settings.m_msaa_samples)
+                        .DisableColorWrite()
+                        .Build();
+    }
 }
 
 void RenderSystem::CreateGraphicsPipeline() {
-    std::string vert_path{R"(\shaders\shading.vert.spv)"};
+    m_shading_pipeline_cache = std::make_unique<PipelineVariantCache<ShadingVariant, ShadingVariant::Hash>>(
+            [this](const ShadingVariant &variant) { return CreateShadingPipeline(variant); });
+}
+
+auto RenderSystem::CreateShadingPipeline(const ShadingVariant &variant) -> std::shared_ptr<Pipeline> {
+    // Packed格式的法线需要在shader中解码，因此使用单独的顶点着色器
+    const std::array<std::string, resource::kVertexFormatCount> vert_paths{R"(\shaders\shading.vert.spv)",
+                                                                            R"(\shaders\shading_packed.vert.spv)"};
     std::string frag_path{R"(\shaders\shading.frag.spv)"};
+    auto vertex_format_index = static_cast<size_t>(variant.m_vertex_format);
+
+    Pipeline::Builder builder(m_render_device);
+    builder.BindShaders(vert_paths.at(vertex_format_index), frag_path)
+            .SetVertexInput(resource::Model::GetBindingDescriptions(variant.m_vertex_format),
+                            resource::Model::GetAttributeDescriptions(variant.m_vertex_format))
+            .BindDescriptorSetLayout(m_descriptor_set_layout)
+            .BindRenderpass(m_render_swapchain->GetShadingRenderPass())
+            .SetMsaaSamples(variant.m_msaa_samples);
+    if (variant.m_alpha_blending) { builder.EnableAlphaBlending(); }
+    if (variant.m_depth_equal) { builder.SetDepthCompareOp(VK_COMPARE_OP_EQUAL).SetDepthWrite(false); }
+
+    // constant_id与shading.frag中的声明一一对应，只使用variant中的字段，缓存的pipeline才与其key一致
+    constexpr auto kFrag = VK_SHADER_STAGE_FRAGMENT_BIT;
+    return builder.AddSpecializationConstant(kFrag, 0, static_cast<uint32_t>(variant.m_shadow_filter))
+            .AddSpecializationConstant(kFrag, 1, variant.m_poisson_tap_count)
+            .AddSpecializationConstant(kFrag, 2, variant.m_enable_shadows)
+            .AddSpecializationConstant(kFrag, 3, variant.m_clustered_lighting)
+            .Build();
+}
 
-    m_shading_pipeline = rendering::Pipeline::Builder(m_render_device)
-                                  .BindShaders(vert_path, frag_path)
-                                  .BindDescriptorSetLayout(m_descriptor_set_layout)
-                                  .BindRenderpass(m_render_swapchain->GetShadingRenderPass())
-                                  .SetMsaaSamples(m_render_device->GetMaxMsaaSamples())
-                                  .EnableAlphaBlending()
-                                  .Build();
+auto RenderSystem::GetShadingPipelines(ShadingVariant variant) -> VertexFormatPipelines {
+    VertexFormatPipelines pipelines;
+    for (size_t i = 0; i < resource::kVertexFormatCount; ++i) {
+        variant.m_vertex_format = static_cast<resource::VertexFormat>(i);
+        pipelines[i] = m_shading_pipeline_cache->Get(variant);
+    }
+    return pipelines;
 }
 
 void RenderSystem::CreateImage() {
@@ -247,13 +531,19 @@ void RenderSystem::CreateImageSampler() {
 
 void RenderSystem::LoadModel() {
     // std::string model_path{R"(\models\viking_room.obj)"};
-    std::string temple_model_path{R"(\models\japanese_temple.obj)"};
     std::string floor_model_path{R"(\models\floor.obj)"};
 
+    // 所有网格共用的几何缓冲区，容量不足时自动扩容
+    m_geometry_arena = std::make_shared<rendering::GeometryArena>(m_render_device, 1u << 18, 1u << 20);
+
     m_render_objects.push_back(std::make_shared<rendering::RenderObject>(
-            m_render_device, std::make_unique<resource::Model>(ENGINE_ROOT_DIR + temple_model_path)));
+            m_geometry_arena, std::make_unique<resource::Model>(ENGINE_ROOT_DIR + std::string(kTempleModelPath))));
+    // 寺庙每帧旋转，阴影叠加在地板的缓存之上
+    m_render_objects.back()->SetMobility(RenderObject::Mobility::Dynamic);
     m_render_objects.push_back(std::make_shared<rendering::RenderObject>(
-            m_render_device, std::make_unique<resource::Model>(ENGINE_ROOT_DIR + floor_model_path)));
+            m_geometry_arena, std::make_unique<resource::Model>(ENGINE_ROOT_DIR + floor_model_path)));
+    m_render_objects.back()->SetMaterialIndex(1);
+    m_scene_object_count = m_render_objects.size();
 }
 
 void RenderSystem::CreateUniformBuffers() {
@@ -268,12 +558,51 @@ void RenderSystem::CreateUniformBuffers() {
     }
 }
 
+void RenderSystem::CreateObjectBuffers() {
+    // 按加载的物体数分配，之后增加物体时由ReserveObjectBuffer逐个帧槽位扩容
+    auto object_capacity = std::bit_ceil(static_cast<uint32_t>(std::max<size_t>(m_render_objects.size(), 1)));
+    m_object_buffers.resize(m_render_swapchain->GetMaxFramesInFlight());
+    for (auto &object_buffer: m_object_buffers) { object_buffer = CreateObjectBuffer(object_capacity); }
+}
+
+auto RenderSystem::CreateObjectBuffer(uint32_t object_capacity) const -> std::shared_ptr<Buffer> {
+    auto object_buffer = std::make_shared<rendering::Buffer>(
+            m_render_device, sizeof(GpuObjectData), object_capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 1,
+            VK_SHARING_MODE_CONCURRENT);
+    object_buffer->Map();
+    return object_buffer;
+}
+
 void RenderSystem::CreateDescriptorPool() {
-    m_descriptor_pool = rendering::DescriptorPool::Builder(m_render_device)
-                                .AddPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 10)
-                                .AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 10)
-                                .SetPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
-                                .Build();
+    m_descriptor_write_cache = std::make_shared<rendering::DescriptorWriteCache>();
+
+    const std::vector<rendering::DescriptorAllocator::PoolSizeRatio> pool_size_ratios = {
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f},
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2.0f},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4.0f},
+    };
+
+    // 常驻的descriptor set，随资源生命周期释放
+    m_descriptor_allocator = std::make_unique<rendering::DescriptorAllocator>(
+            m_render_device, 16, pool_size_ratios, VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
+
+    // 每帧的临时descriptor set，不需要单独释放，在该帧完成后整体reset
+    m_frame_descriptor_allocators.resize(m_render_swapchain->GetMaxFramesInFlight());
+    for (auto &frame_allocator: m_frame_descriptor_allocators) {
+        frame_allocator = std::make_unique<rendering::DescriptorAllocator>(m_render_device, 64, pool_size_ratios);
+    }
+}
+
+auto RenderSystem::AllocateFrameDescriptorSet(const std::shared_ptr<DescriptorSetLayout> &layout) -> VkDescriptorSet {
+    VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
+    if (!m_frame_descriptor_allocators.at(m_cur_swapchain_frame_index)
+                 ->Allocate(layout->GetDescriptorSetLayout(), descriptor_set)) {
+        throw std::runtime_error("failed to allocate frame descriptor set!");
+    }
+    // 重置后的pool会复用之前的handle
+    m_descriptor_write_cache->Invalidate(descriptor_set);
+    return descriptor_set;
 }
 
 void RenderSystem::CreateDescriptorSets() {
@@ -284,7 +613,7 @@ void RenderSystem::CreateDescriptorSets() {
         m_shadowmap_descriptor_sets.resize(m_render_swapchain->GetMaxFramesInFlight());
 
         for (int i = 0; i < m_render_swapchain->GetMaxFramesInFlight(); ++i) {
-            m_descriptor_pool->AllocateDescriptor(layouts.at(i), m_shadowmap_descriptor_sets.at(i));
+            m_descriptor_allocator->Allocate(layouts.at(i), m_shadowmap_descriptor_sets.at(i));
         }
 
         for (size_t i = 0; i < m_render_swapchain->GetMaxFramesInFlight(); ++i) {
@@ -293,8 +622,11 @@ void RenderSystem::CreateDescriptorSets() {
             buffer_info.offset = 0;
             buffer_info.range = sizeof(UniformBufferObject);
 
-            rendering::DescriptorWriter(m_shadowmap_descriptor_set_layout, m_descriptor_pool)
+            auto object_buffer_info = m_object_buffers.at(i)->CreateDescriptorBufferInfo();
+
+            rendering::DescriptorWriter(m_shadowmap_descriptor_set_layout, nullptr, m_descriptor_write_cache)
                     .WriteBuffer(0, &buffer_info)
+                    .WriteBuffer(1, &object_buffer_info)
                     .Overwrite(m_shadowmap_descriptor_sets.at(i));
         }
     }
@@ -306,7 +638,7 @@ void RenderSystem::CreateDescriptorSets() {
         m_descriptor_sets.resize(m_render_swapchain->GetMaxFramesInFlight());
 
         for (int i = 0; i < m_render_swapchain->GetMaxFramesInFlight(); ++i) {
-            m_descriptor_pool->AllocateDescriptor(layouts.at(i), m_descriptor_sets.at(i));
+            m_descriptor_allocator->Allocate(layouts.at(i), m_descriptor_sets.at(i));
         }
 
         for (size_t i = 0; i < m_render_swapchain->GetMaxFramesInFlight(); i++) {
@@ -320,15 +652,28 @@ void RenderSystem::CreateDescriptorSets() {
             image_info.imageView = m_render_image->GetVkImageView();
             image_info.sampler = m_texture_sampler;
 
-            VkDescriptorImageInfo shadowmap_image_info{};
-            shadowmap_image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            shadowmap_image_info.imageView = m_render_swapchain->GetShadowmapImage()->GetVkImageView();
-            shadowmap_image_info.sampler = m_texture_sampler;
+            auto object_buffer_info = m_object_buffers.at(i)->CreateDescriptorBufferInfo();
+
+            auto frame_index = static_cast<uint32_t>(i);
+            auto light_buffer_info = m_clustered_lighting->GetLightBuffer(frame_index)->CreateDescriptorBufferInfo();
+            auto light_count_buffer_info =
+                    m_clustered_lighting->GetClusterLightCountBuffer(frame_index)->CreateDescriptorBufferInfo();
+            auto light_index_buffer_info =
+                    m_clustered_lighting->GetClusterLightIndexBuffer(frame_index)->CreateDescriptorBufferInfo();
+            auto cluster_uniform_buffer_info =
+                    m_clustered_lighting->GetUniformBuffer(frame_index)->CreateDescriptorBufferInfo();
+            auto shadowmap_image_info = m_shadow_cascades->CreateDescriptorImageInfo();
 
-            rendering::DescriptorWriter(m_descriptor_set_layout, m_descriptor_pool)
+            // 一次写入layout的全部binding，支持时通过update template更新
+            rendering::DescriptorWriter(m_descriptor_set_layout, nullptr, m_descriptor_write_cache)
                     .WriteBuffer(0, &buffer_info)
                     .WriteImage(1, &image_info)
                     .WriteImage(2, &shadowmap_image_info)
+                    .WriteBuffer(3, &object_buffer_info)
+                    .WriteBuffer(4, &light_buffer_info)
+                    .WriteBuffer(5, &light_count_buffer_info)
+                    .WriteBuffer(6, &light_index_buffer_info)
+                    .WriteBuffer(7, &cluster_uniform_buffer_info)
                     .Overwrite(m_descriptor_sets.at(i));
         }
     }
@@ -337,22 +682,279 @@ void RenderSystem::CreateDescriptorSets() {
 void RenderSystem::CreateCommandBuffers() {
     m_command_builder = std::make_shared<rendering::CommandsBuilder>(m_render_device);
     m_command_builder->AllocateCommandBuffers(m_render_swapchain->GetMaxFramesInFlight());
+
+    m_gpu_profiler = std::make_unique<rendering::GpuProfiler>(m_render_device, m_render_swapchain->GetMaxFramesInFlight());
+    m_frame_benchmark = std::make_unique<rendering::FrameBenchmark>(60, 300);
+}
+
+void RenderSystem::CreateAsyncCompute() {
+    // 没有独立的compute队列族时提交到同一个队列上只会串行执行，仍在graphics的command buffer中录制
+    m_async_compute_supported = m_render_device->HasDedicatedQueue(QueueType::Compute) &&
+                                m_render_device->IsTimelineSemaphoreSupported();
+    if (!m_async_compute_supported) { return; }
+
+    m_compute_timeline = std::make_unique<rendering::TimelineSemaphore>(m_render_device);
+    m_compute_command_builder = std::make_shared<rendering::CommandsBuilder>(m_render_device, QueueType::Compute);
+    m_compute_command_builder->AllocateCommandBuffers(2 * m_render_swapchain->GetMaxFramesInFlight());
+}
+
+void RenderSystem::CreateClusterCuller() {
+    // 每个视角绘制的LOD不会比LOD 0更精细，以LOD 0的索引数作为上限
+    uint32_t max_index_count = 0;
+    for (const auto &render_object: m_render_objects) {
+        max_index_count += render_object->GetLod(LodView::Main).m_index_count;
+    }
+    m_cluster_culler = std::make_unique<rendering::ClusterCuller>(
+            m_render_device, m_render_swapchain->GetMaxFramesInFlight(),
+            max_index_count * static_cast<uint32_t>(kLodViewCount));
+}
+
+void RenderSystem::CreateGpuCuller() {
+    if (!GpuCuller::IsSupported(*m_render_device)) {
+        ENGINE_LOG_WARN("drawIndirectFirstInstance is not supported, GPU culling is disabled");
+        return;
+    }
+
+    m_gpu_culler = std::make_unique<rendering::GpuCuller>(m_render_device, *m_descriptor_layout_cache,
+                                                          *m_descriptor_allocator, m_descriptor_write_cache,
+                                                          m_object_buffers);
+    m_enable_gpu_culling = true;
+}
+
+void RenderSystem::CreateClusteredLighting() {
+    m_clustered_lighting = std::make_unique<rendering::ClusteredLighting>(
+            m_render_device, *m_descriptor_layout_cache, *m_descriptor_allocator, m_descriptor_write_cache,
+            m_render_swapchain->GetMaxFramesInFlight());
+
+    // 压力测试场景：点光源在场景上方绕y轴旋转，固定种子保证每次运行的分布一致
+    std::mt19937 generator{42};
+    std::uniform_real_distribution<float> unit{0.0f, 1.0f};
+    m_point_light_orbits.resize(ClusteredLighting::kMaxLights);
+    for (auto &orbit: m_point_light_orbits) {
+        orbit.m_radius = 0.2f + 1.8f * std::sqrt(unit(generator));
+        orbit.m_height = 0.05f + 0.9f * unit(generator);
+        orbit.m_phase = glm::two_pi<float>() * unit(generator);
+        orbit.m_speed = glm::mix(-0.5f, 0.5f, unit(generator));
+        orbit.m_light.position_radius.w = glm::mix(0.2f, 0.4f, unit(generator));
+        orbit.m_light.color_intensity = glm::vec4(unit(generator), unit(generator), unit(generator), 0.5f);
+    }
+}
+
+void RenderSystem::StartBenchmark(std::string name, std::vector<FrameBenchmark::Case> cases,
+                                  std::function<void()> on_finished) {
+    // 渲染尺寸随GPU耗时变化时各配置之间无法比较，运行期间固定为原生分辨率
+    bool dynamic_resolution = m_dynamic_resolution->IsEnabled();
+    m_dynamic_resolution->SetEnabled(false);
+    m_frame_benchmark->Start(std::move(name), std::move(cases),
+                             [this, dynamic_resolution, on_finished = std::move(on_finished)]() {
+                                 m_dynamic_resolution->SetEnabled(dynamic_resolution);
+                                 if (on_finished) { on_finished(); }
+                             });
 }
 
-void RenderSystem::RecreateSwapchain() {
+void RenderSystem::StartVertexFormatBenchmark() {
+    // 寺庙模型没有顶点颜色，分别以Full与Packed格式重新导入，对比各pass的GPU耗时
+    StartBenchmark("Vertex Formats",
+                   {{"Full (44 B/vertex)", [this]() { ReloadRenderObject(0, kTempleModelPath, false); }},
+                    {"Packed (16 B/vertex)", [this]() { ReloadRenderObject(0, kTempleModelPath, true); }}},
+                   [this]() { ReloadRenderObject(0, kTempleModelPath, true); });
+}
+
+void RenderSystem::StartAntiAliasingBenchmark() {
+    // 在点光源压力测试场景中对比：MSAA的开销计入Shading，FXAA的开销计入Upscale
+    auto swapchain_settings = m_requested_swapchain_settings;
+    bool enable_fxaa = m_enable_fxaa;
+    bool clustered_lighting = m_shading_variant.m_clustered_lighting;
+    int point_light_count = m_point_light_count;
+    m_shading_variant.m_clustered_lighting = true;
+    m_point_light_count = 1024;
+
+    const std::array<std::pair<VkSampleCountFlagBits, const char *>, 4> msaa_cases{
+            {{VK_SAMPLE_COUNT_1_BIT, "No AA"},
+             {VK_SAMPLE_COUNT_2_BIT, "MSAA 2x"},
+             {VK_SAMPLE_COUNT_4_BIT, "MSAA 4x"},
+             {VK_SAMPLE_COUNT_8_BIT, "MSAA 8x"}}};
+    std::vector<FrameBenchmark::Case> cases;
+    for (const auto &[msaa_samples, name]: msaa_cases) {
+        if (!m_render_device->IsMsaaSamplesSupported(msaa_samples)) { continue; }
+        cases.push_back({name, [this, msaa_samples]() {
+                             m_requested_swapchain_settings.m_msaa_samples = msaa_samples;
+                             m_enable_fxaa = false;
+                         }});
+    }
+    cases.push_back({"FXAA", [this]() {
+                         m_requested_swapchain_settings.m_msaa_samples = VK_SAMPLE_COUNT_1_BIT;
+                         m_enable_fxaa = true;
+                     }});
+
+    StartBenchmark("Anti-aliasing", std::move(cases),
+                   [this, swapchain_settings, enable_fxaa, clustered_lighting, point_light_count]() {
+                       m_requested_swapchain_settings = swapchain_settings;
+                       m_enable_fxaa = enable_fxaa;
+                       m_shading_variant.m_clustered_lighting = clustered_lighting;
+                       m_point_light_count = point_light_count;
+                   });
+}
+
+void RenderSystem::StartObjectCountBenchmark() {
+    // 实例都是静态的，每帧不需要重新写入object buffer，CPU的开销应与实例数基本无关；GPU剔除的耗时随实例数增长
+    bool enable_gpu_culling = m_enable_gpu_culling;
+    uint32_t stress_instance_count = m_stress_instance_count;
+
+    std::vector<FrameBenchmark::Case> cases;
+    for (uint32_t instance_count = 0; instance_count <= kMaxStressInstanceCount;
+         instance_count = std::max(instance_count * 4, 1024u)) {
+        cases.push_back({std::to_string(instance_count) + " instances", [this, instance_count]() {
+                             m_enable_gpu_culling = true;
+                             SetStressInstanceCount(instance_count);
+                         }});
+    }
+
+    StartBenchmark("Object Count", std::move(cases), [this, enable_gpu_culling, stress_instance_count]() {
+        SetStressInstanceCount(stress_instance_count);
+        m_enable_gpu_culling = enable_gpu_culling;
+    });
+}
+
+void RenderSystem::SetStressInstanceCount(uint32_t count) {
+    // 实例只持有共享网格的引用，网格的空间由GeometryArena在在飞的帧完成后归还
+    m_render_objects.resize(m_scene_object_count);
+    m_stress_instance_count = count;
+    m_requested_stress_instance_count = static_cast<int>(count);
+    MarkObjectLayoutDirty();
+    if (count == 0) { return; }
+    m_enable_gpu_culling = true;
+
+    // 在场景周围的正方形区域内按网格排列，间距随实例数缩小，实例的大小与间距成比例以免相互重叠
+    constexpr float kStressSceneHalfExtent = 4.0f;
+    auto temple = m_render_objects.at(0);
+    auto grid_size = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(count))));
+    float spacing = 2.0f * kStressSceneHalfExtent / static_cast<float>(grid_size);
+    float scale = 0.4f * spacing / (temple->GetWorldBoundingSphere().w / temple->GetMaxScale());
+
+    m_render_objects.reserve(m_scene_object_count + count);
+    for (uint32_t i = 0; i < count; ++i) {
+        glm::vec3 position{-kStressSceneHalfExtent + (static_cast<float>(i % grid_size) + 0.5f) * spacing, 0.0f,
+                           -kStressSceneHalfExtent + (static_cast<float>(i / grid_size) + 0.5f) * spacing};
+        auto model_matrix = glm::translate(glm::mat4(1.0f), position);
+        model_matrix = glm::rotate(model_matrix, static_cast<float>(i) * 0.7f, glm::vec3(0.0f, 1.0f, 0.0f));
+        model_matrix = glm::scale(model_matrix, glm::vec3(scale));
+
+        auto instance = temple->CreateInstance();
+        instance->SetModelMatrix(model_matrix);
+        instance->SetMaterialIndex(temple->GetMaterialIndex());
+        m_render_objects.push_back(std::move(instance));
+    }
+}
+
+void RenderSystem::ReloadRenderObject(size_t object_index, const std::string &model_path, bool allow_packed) {
+    auto &render_object = m_render_objects.at(object_index);
+    auto reloaded_object = std::make_shared<rendering::RenderObject>(
+            m_geometry_arena, std::make_unique<resource::Model>(ENGINE_ROOT_DIR + model_path, allow_packed));
+    reloaded_object->SetModelMatrix(render_object->GetModelMatrix());
+    reloaded_object->SetMobility(render_object->GetMobility());
+    reloaded_object->SetMaterialIndex(render_object->GetMaterialIndex());
+    // 在飞的帧仍在绘制旧的网格
+    m_render_device->GetDeletionQueue().Retire(std::exchange(render_object, std::move(reloaded_object)));
+    // 顶点格式可能改变，所属的绘制批次随之改变
+    MarkObjectLayoutDirty();
+}
+
+void RenderSystem::UpdatePointLights(float time) {
+    auto light_count = std::min(static_cast<size_t>(std::max(m_point_light_count, 0)), m_point_light_orbits.size());
+    m_point_lights.resize(light_count);
+    for (size_t i = 0; i < light_count; ++i) {
+        const auto &orbit = m_point_light_orbits[i];
+        float angle = orbit.m_phase + orbit.m_speed * time;
+        m_point_lights[i] = orbit.m_light;
+        m_point_lights[i].position_radius.x = orbit.m_radius * std::cos(angle);
+        m_point_lights[i].position_radius.y = orbit.m_height;
+        m_point_lights[i].position_radius.z = orbit.m_radius * std::sin(angle);
+    }
+}
+
+void RenderSystem::CreateUpscalePipeline() {
+    // 目标约60帧，最低渲染一半的宽高
+    m_dynamic_resolution = std::make_unique<rendering::DynamicResolution>(16.0f, 0.5f, 1.0f);
+    m_render_extent = m_render_swapchain->Extent();
+
+    m_upscale_descriptor_set_layout =
+            rendering::DescriptorSetLayout::Builder(m_render_device)
+                    .AddBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+                    .Build(*m_descriptor_layout_cache);
+
+    m_upscale_pipeline_cache = std::make_unique<PipelineVariantCache<bool>>(
+            [this](bool enable_fxaa) { return CreateUpscaleVariant(enable_fxaa); });
+
+    // 双线性放大，渲染区域之外的内容由shader中的clamp排除
+    VkSamplerCreateInfo sampler_info{};
+    sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    sampler_info.magFilter = VK_FILTER_LINEAR;
+    sampler_info.minFilter = VK_FILTER_LINEAR;
+    sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.anisotropyEnable = VK_FALSE;
+    sampler_info.maxAnisotropy = 1.0f;
+    sampler_info.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK;
+    sampler_info.unnormalizedCoordinates = VK_FALSE;
+    sampler_info.compareEnable = VK_FALSE;
+    sampler_info.minLod = 0.0f;
+    sampler_info.maxLod = 0.0f;
+
+    if (vkCreateSampler(m_render_device->GetVkDevice(), &sampler_info, nullptr, &m_upscale_sampler) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upscale sampler!");
+    }
+}
+
+auto RenderSystem::CreateUpscaleVariant(bool enable_fxaa) -> std::shared_ptr<Pipeline> {
+    // present pass只有单采样的swapchain图像，与shading pass的采样数无关
+    return rendering::Pipeline::Builder(m_render_device)
+            .BindShaders(R"(\shaders\upscale.vert.spv)", R"(\shaders\upscale.frag.spv)")
+            .SetVertexInput({}, {})
+            .BindDescriptorSetLayout(m_upscale_descriptor_set_layout)
+            .AddPushConstantRange<UpscalePushConstants>(VK_SHADER_STAGE_FRAGMENT_BIT)
+            .BindRenderpass(m_render_swapchain->GetPresentRenderPass())
+            .SetDepthCompareOp(VK_COMPARE_OP_ALWAYS)
+            .SetDepthWrite(false)
+            .AddSpecializationConstant(VK_SHADER_STAGE_FRAGMENT_BIT, 0, enable_fxaa)
+            .Build();
+}
+
+void RenderSystem::CreateHiZPyramid() {
+    if (m_gpu_culler == nullptr) { return; }
+
+    m_hiz_pyramid = std::make_unique<rendering::HiZPyramid>(m_render_device, *m_descriptor_layout_cache,
+                                                            m_render_swapchain->GetDepthImage());
+}
+
+auto RenderSystem::RecreateSwapchain() -> bool {
     int width = 0;
     int height = 0;
     glfwGetFramebufferSize(m_window->GetGlfwWindow(), &width, &height);
-    while (width == 0 || height == 0) {
-        glfwGetFramebufferSize(m_window->GetGlfwWindow(), &width, &height);
-        glfwWaitEvents();
+    // 最小化时不阻塞等待，由之后的帧重试
+    m_swapchain_dirty = width == 0 || height == 0;
+    if (m_swapchain_dirty) { return false; }
+
+    auto &deletion_queue = m_render_device->GetDeletionQueue();
+    std::shared_ptr<rendering::Swapchain> old_render_swapchain = std::move(m_render_swapchain);
+    m_render_swapchain =
+            std::make_unique<rendering::Swapchain>(m_render_device, m_swapchain_settings, old_render_swapchain);
+    // 采样数改变时shading pass不再兼容，旧采样数的shading pipeline保留在缓存中，切换回来时直接复用
+    if (old_render_swapchain->GetMsaaSamples() != m_render_swapchain->GetMsaaSamples()) {
+        for (const auto &pipeline: m_depth_prepass_pipelines) { deletion_queue.Retire(pipeline); }
+        CreateDepthPrepassPipeline();
     }
+    deletion_queue.Retire(std::move(old_render_swapchain));
 
-    vkDeviceWaitIdle(m_render_device->GetVkDevice());
+    // 新金字塔在构建之前不参与遮挡剔除，旧金字塔引用旧的深度图，一并延迟释放
+    deletion_queue.Retire(std::shared_ptr<HiZPyramid>(std::move(m_hiz_pyramid)));
+    CreateHiZPyramid();
 
-    std::shared_ptr<rendering::Swapchain> old_render_swapchain = std::move(m_render_swapchain);
-    m_render_swapchain = std::make_unique<rendering::Swapchain>(m_render_device, old_render_swapchain);
-    old_render_swapchain.reset();
+    // 保持当前比例，按新的尺寸重新计算，本帧之后的pass不能超出新的framebuffer
+    m_render_extent = m_dynamic_resolution->ComputeRenderExtent(m_render_swapchain->Extent());
+    return true;
 }
 
 void RenderSystem::UpdateUniformBuffer(uint32_t current_frame_index) {
@@ -364,51 +966,334 @@ void RenderSystem::UpdateUniformBuffer(uint32_t current_frame_index) {
 
     // 右手坐标系，z轴指向屏幕外，y轴向上，x轴指向右侧
     UniformBufferObject ubo{};
-    auto eye_pos = glm::vec3(2.0f, 1.5f, 2.0f);
+    // 相机、光源的位置与阴影偏移随UBO每帧传入，修改它们不需要重建shading pipeline
+    auto eye_pos = m_camera_position;
 
     // 非均匀缩放时需要考虑法线的问题
-    ubo.model = glm::mat4(1.0f);
-    ubo.model = glm::rotate(ubo.model, accumulate_time * glm::radians(20.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    ubo.view = glm::lookAt(eye_pos, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    ubo.proj = glm::perspective(
-            glm::radians(45.0f),
-            m_render_swapchain->Extent().width / static_cast<float>(m_render_swapchain->Extent().height), 0.1f, 5.0f);
+    // 只有寺庙在旋转，地板保持静止
+    const auto &temple = m_render_objects.at(0);
+    auto transform_version = temple->GetTransformVersion();
+    temple->SetModelMatrix(
+            glm::rotate(glm::mat4(1.0f), accumulate_time * glm::radians(20.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+    if (temple->GetTransformVersion() != transform_version) { MarkObjectDirty(0); }
+
+    float fov_y = glm::radians(45.0f);
+    float near_plane = 0.1f;
+    float far_plane = 5.0f;
+    float aspect = m_render_extent.width / static_cast<float>(m_render_extent.height);
 
-    // auto light_perspective = glm::perspective(
-    //         glm::radians(45.0f),
-    //         m_render_swapchain->Extent().width / static_cast<float>(m_render_swapchain->Extent().height), 0.1f, 1000.0f);
+    ubo.view = glm::lookAt(eye_pos, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    ubo.proj = glm::perspective(fov_y, aspect, near_plane, far_plane);
+
+    // 所有物体都投射阴影，取包围所有物体的球，光源的近平面需退到它之前
+    auto caster_bounds = ComputeCasterBounds();
+
+    // 方向光，照向原点
+    auto light_pos = m_light_position;
+
+    ShadowCascades::CameraInfo camera_info{};
+    camera_info.m_view = ubo.view;
+    camera_info.m_fov_y = fov_y;
+    camera_info.m_aspect = aspect;
+    camera_info.m_near = near_plane;
+    camera_info.m_far = far_plane;
+    m_shadow_cascades->Update(camera_info, glm::vec3(0.0f) - light_pos, caster_bounds);
+    for (uint32_t cascade = 0; cascade < kShadowCascadeCount; ++cascade) {
+        ubo.cascade_view_proj.at(cascade) = m_shadow_cascades->GetCascade(cascade).m_view_proj;
+        ubo.cascade_splits[static_cast<int>(cascade)] = m_shadow_cascades->GetCascade(cascade).m_split_depth;
+    }
 
-    auto light_perspective = glm::ortho(-5.0f, 5.0f, -5.0f, 5.0f, 0.1f, 5.0f);
-    auto light_pos = glm::vec3(-2.0f, 2.0f, 2.0f);
+    ubo.light_position = glm::vec4(light_pos, 1.0f);
+    ubo.camera_position = glm::vec4(eye_pos, 1.0f);
+    ubo.shadow_params = glm::vec4(m_shadow_bias, 0.0f, 0.0f, 0.0f);
 
-    ubo.light_view_proj = light_perspective * glm::lookAt(light_pos, glm::vec3(0.0f, 0.0f, 0.0f),
-                                                          glm::vec3(0.0f, 1.0f, 0.0f));
+    m_camera_view_proj = ubo.proj * ubo.view;
 
     m_uniform_buffers.at(current_frame_index)->WriteToBuffer(&ubo);
+
+    UpdatePointLights(accumulate_time);
+    m_clustered_lighting->Update(current_frame_index, m_point_lights, ubo.view, ubo.proj, m_render_extent, near_plane,
+                                 far_plane);
+
+    // LOD选择：主相机为透视投影，像素密度与距离成反比；cascade为正交投影，像素密度由其覆盖范围决定
+    m_main_lod_selection.m_camera_position = eye_pos;
+    m_main_lod_selection.m_pixels_per_unit =
+            static_cast<float>(m_render_extent.height) * 0.5f / std::tan(fov_y * 0.5f);
+    m_main_lod_selection.m_min_distance = near_plane;
+    m_main_lod_selection.m_perspective = true;
+    // GPU剔除时由cull.comp为可见的物体选择LOD
+    if (m_enable_gpu_culling) { return; }
+    for (const auto &render_object: m_render_objects) {
+        auto bounding_sphere = render_object->GetWorldBoundingSphere();
+        float distance = std::max(glm::length(glm::vec3(bounding_sphere) - eye_pos) - bounding_sphere.w, near_plane);
+        render_object->UpdateLod(LodView::Main, m_main_lod_selection.m_pixels_per_unit / distance);
+        for (uint32_t cascade = 0; cascade < kShadowCascadeCount; ++cascade) {
+            render_object->UpdateLod(GetShadowCascadeView(cascade),
+                                     m_shadow_cascades->GetCascade(cascade).m_pixels_per_unit);
+        }
+    }
+}
+
+void RenderSystem::UpdateObjectLayout() {
+    // 扩容或整理碎片后网格在共享缓冲区中的位置改变，所有物体的LOD范围都需重新写入
+    if (m_geometry_arena->GetLayoutVersion() != m_geometry_layout_version) {
+        m_geometry_layout_version = m_geometry_arena->GetLayoutVersion();
+        m_object_layout_dirty = true;
+    }
+    if (!m_object_layout_dirty) { return; }
+    m_object_layout_dirty = false;
+
+    // 按绘制批次分配GPU剔除命令的位置，同一批次的物体连续排列
+    auto get_draw_batch = [](const std::shared_ptr<RenderObject> &render_object) {
+        return GpuCuller::GetDrawBatch(render_object->GetVertexFormat(), render_object->GetMobility());
+    };
+    m_draw_batches.fill(GpuCuller::DrawBatch{});
+    for (const auto &render_object: m_render_objects) {
+        ++m_draw_batches.at(get_draw_batch(render_object)).m_object_count;
+    }
+    uint32_t first_slot = 0;
+    for (auto &draw_batch: m_draw_batches) {
+        draw_batch.m_first_slot = first_slot;
+        first_slot += draw_batch.m_object_count;
+    }
+    std::array<uint32_t, GpuCuller::kDrawBatchCount> batch_object_counts{};
+
+    auto object_count = static_cast<uint32_t>(m_render_objects.size());
+    m_object_draw_slots.resize(object_count);
+    m_dynamic_objects.clear();
+    for (uint32_t i = 0; i < object_count; ++i) {
+        const auto &render_object = m_render_objects[i];
+        auto draw_batch = get_draw_batch(render_object);
+        m_object_draw_slots[i] = m_draw_batches.at(draw_batch).m_first_slot + batch_object_counts.at(draw_batch)++;
+        if (render_object->GetMobility() == RenderObject::Mobility::Dynamic) { m_dynamic_objects.push_back(i); }
+    }
+
+    // 所有帧槽位都需要重新写入所有物体
+    m_object_dirty_frames.assign(object_count, (1u << m_frames_in_flight) - 1);
+    m_dirty_objects.resize(object_count);
+    std::iota(m_dirty_objects.begin(), m_dirty_objects.end(), 0u);
+    m_static_caster_bounds.reset();
+    for (auto &caster_version: m_caster_versions) { ++caster_version; }
+}
+
+void RenderSystem::MarkObjectDirty(size_t object_index) {
+    auto mobility = m_render_objects.at(object_index)->GetMobility();
+    ++m_caster_versions.at(static_cast<size_t>(mobility));
+    if (mobility == RenderObject::Mobility::Static) { m_static_caster_bounds.reset(); }
+
+    // 重新分配布局时所有物体都会被写入
+    if (m_object_layout_dirty || object_index >= m_object_dirty_frames.size()) { return; }
+    auto &dirty_frames = m_object_dirty_frames[object_index];
+    if (dirty_frames == 0) { m_dirty_objects.push_back(static_cast<uint32_t>(object_index)); }
+    dirty_frames = (1u << m_frames_in_flight) - 1;
 }
 
-void RenderSystem::BeginFrame() {
-    vkWaitForFences(m_render_device->GetVkDevice(), 1,
-                    &m_render_swapchain->GetInFlightFences()[m_cur_swapchain_frame_index], VK_TRUE, UINT64_MAX);
+auto RenderSystem::ComputeCasterBounds() -> glm::vec4 {
+    using Bounds = std::pair<glm::vec3, glm::vec3>;
+    auto expand = [](Bounds &bounds, const RenderObject &render_object) {
+        auto bounding_sphere = render_object.GetWorldBoundingSphere();
+        bounds.first = glm::min(bounds.first, glm::vec3(bounding_sphere) - bounding_sphere.w);
+        bounds.second = glm::max(bounds.second, glm::vec3(bounding_sphere) + bounding_sphere.w);
+    };
+
+    if (!m_static_caster_bounds.has_value()) {
+        Bounds static_bounds{glm::vec3(std::numeric_limits<float>::max()),
+                             glm::vec3(std::numeric_limits<float>::lowest())};
+        for (const auto &render_object: m_render_objects) {
+            if (render_object->GetMobility() != RenderObject::Mobility::Static) { continue; }
+            expand(static_bounds, *render_object);
+        }
+        m_static_caster_bounds = static_bounds;
+    }
+
+    auto bounds = *m_static_caster_bounds;
+    for (auto object_index: m_dynamic_objects) { expand(bounds, *m_render_objects.at(object_index)); }
+    return {(bounds.first + bounds.second) * 0.5f, glm::length(bounds.second - bounds.first) * 0.5f};
+}
+
+auto RenderSystem::ReserveObjectBuffer() -> bool {
+    auto &object_buffer = m_object_buffers.at(m_cur_swapchain_frame_index);
+    auto object_count = static_cast<uint32_t>(std::max<size_t>(m_render_objects.size(), 1));
+    if (object_buffer->GetInstanceCount() >= object_count) { return false; }
+
+    // 其他帧槽位可能仍在使用各自的缓冲区与descriptor set，轮到它们时再扩容
+    auto object_capacity = std::bit_ceil(object_count);
+    m_render_device->GetDeletionQueue().Retire(std::exchange(object_buffer, CreateObjectBuffer(object_capacity)));
+    auto object_buffer_info = object_buffer->CreateDescriptorBufferInfo();
+    rendering::DescriptorWriter(m_shadowmap_descriptor_set_layout, nullptr, m_descriptor_write_cache)
+            .WriteBuffer(1, &object_buffer_info)
+            .Overwrite(m_shadowmap_descriptor_sets.at(m_cur_swapchain_frame_index));
+    rendering::DescriptorWriter(m_descriptor_set_layout, nullptr, m_descriptor_write_cache)
+            .WriteBuffer(3, &object_buffer_info)
+            .Overwrite(m_descriptor_sets.at(m_cur_swapchain_frame_index));
+    if (m_gpu_culler != nullptr) { m_gpu_culler->SetObjectBuffer(m_cur_swapchain_frame_index, object_buffer); }
+
+    ENGINE_LOG_INFO("Grew object buffer of frame slot {} to {} objects", m_cur_swapchain_frame_index, object_capacity);
+    return true;
+}
+
+void RenderSystem::UpdateObjectBuffer() {
+    const uint32_t frame_bit = 1u << m_cur_swapchain_frame_index;
+    if (ReserveObjectBuffer()) {
+        // 新的缓冲区不含任何物体
+        for (uint32_t i = 0; i < static_cast<uint32_t>(m_object_dirty_frames.size()); ++i) {
+            if (m_object_dirty_frames[i] == 0) { m_dirty_objects.push_back(i); }
+            m_object_dirty_frames[i] |= frame_bit;
+        }
+    }
+
+    auto *objects = static_cast<GpuObjectData *>(m_object_buffers.at(m_cur_swapchain_frame_index)->GetMappedMemory());
+    size_t remaining_count = 0;
+    for (auto object_index: m_dirty_objects) {
+        auto &dirty_frames = m_object_dirty_frames[object_index];
+        if ((dirty_frames & frame_bit) != 0) {
+            const auto &render_object = m_render_objects[object_index];
+            const auto &geometry = render_object->GetGeometry();
+            const auto &lods = render_object->GetLods();
+            auto draw_batch = GpuCuller::GetDrawBatch(render_object->GetVertexFormat(), render_object->GetMobility());
+
+            GpuObjectData object_data{};
+            object_data.model = render_object->GetModelMatrix();
+            object_data.position_scale = glm::vec4(render_object->GetPositionScale(), 0.0f);
+            object_data.position_offset = glm::vec4(render_object->GetPositionOffset(), 0.0f);
+            object_data.bounding_sphere = render_object->GetWorldBoundingSphere();
+            // 误差换算到世界空间，GPU选择LOD时只需乘以像素密度
+            float max_scale = render_object->GetMaxScale();
+            object_data.lod_count = static_cast<uint32_t>(std::min<size_t>(lods.size(), resource::Model::kMaxLodCount));
+            for (uint32_t lod = 0; lod < object_data.lod_count; ++lod) {
+                object_data.lod_ranges.at(lod) =
+                        glm::uvec2(geometry.m_first_index + lods[lod].m_first_index, lods[lod].m_index_count);
+                object_data.lod_errors.at(lod) = lods[lod].m_error * max_scale;
+            }
+            object_data.material_index = render_object->GetMaterialIndex();
+            object_data.vertex_offset = static_cast<int32_t>(geometry.m_vertex_offset);
+            object_data.draw_batch = draw_batch;
+            object_data.batch_first_slot = m_draw_batches.at(draw_batch).m_first_slot;
+            object_data.draw_slot = m_object_draw_slots[object_index];
+            objects[object_index] = object_data;
+            dirty_frames &= ~frame_bit;
+        }
+        // 其他帧槽位仍需写入的物体留在列表中
+        if (dirty_frames != 0) { m_dirty_objects[remaining_count++] = object_index; }
+    }
+    m_dirty_objects.resize(remaining_count);
+}
+
+void RenderSystem::CullObjectsOnGpu() {
+    auto object_count = static_cast<uint32_t>(m_render_objects.size());
+
+    auto cmd_cull = [&](const std::shared_ptr<CommandsBuilder> &cmd_builder) {
+        m_gpu_culler->CmdResetDrawCounts(cmd_builder, m_cur_swapchain_frame_index);
+        // 上一帧的深度只对主相机有意义，各cascade只做视锥剔除
+        m_gpu_culler->CmdCull(cmd_builder, m_cur_swapchain_frame_index, object_count, LodView::Main,
+                              m_camera_view_proj, m_main_lod_selection, *m_hiz_pyramid, m_enable_occlusion_culling);
+        for (uint32_t cascade = 0; cascade < kShadowCascadeCount; ++cascade) {
+            const auto &shadow_cascade = m_shadow_cascades->GetCascade(cascade);
+            GpuCuller::LodSelection lod_selection{};
+            lod_selection.m_pixels_per_unit = shadow_cascade.m_pixels_per_unit;
+            m_gpu_culler->CmdCull(cmd_builder, m_cur_swapchain_frame_index, object_count,
+                                  GetShadowCascadeView(cascade), shadow_cascade.m_view_proj, lod_selection,
+                                  *m_hiz_pyramid, false);
+        }
+        m_gpu_culler->CmdCopyDrawCounts(cmd_builder, m_cur_swapchain_frame_index);
+    };
+
+    if (IsAsyncComputeEnabled()) {
+        // 遮挡剔除读取上一帧graphics构建的Hi-Z金字塔，需等待其完成，否则与之前的帧完全重叠；
+        // 本帧的Hi-Z构建会覆盖金字塔，graphics在compute shader阶段同样需要等待剔除完成
+        BeginAsyncCompute(0);
+        cmd_cull(m_compute_command_builder);
+        SubmitAsyncCompute(VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           m_enable_occlusion_culling && m_hiz_pyramid->IsValid());
+        return;
+    }
+
+    m_gpu_profiler->BeginScope(m_command_builder->GetCurrentCommandBuffer(), "GPU Culling");
+    cmd_cull(m_command_builder);
+    m_gpu_culler->CmdBarrier(m_command_builder, m_cur_swapchain_frame_index);
+    m_gpu_profiler->EndScope(m_command_builder->GetCurrentCommandBuffer());
+}
+
+void RenderSystem::BeginAsyncCompute(uint32_t command_index) {
+    // 该帧槽位上一次提交的帧完成时，它等待过的compute提交也已完成，其command buffer可以重新录制
+    auto index = static_cast<int>(m_cur_swapchain_frame_index * 2 + command_index);
+    m_compute_command_builder->SetCurrentCommandBuffer(index).BeginRecord();
+}
+
+void RenderSystem::SubmitAsyncCompute(VkPipelineStageFlags graphics_wait_stages, bool wait_for_graphics) {
+    m_compute_command_builder->EndRecord();
+    if (wait_for_graphics) {
+        const auto &frame_timeline = m_render_device->GetFrameTimeline();
+        m_compute_command_builder->WaitForTimelineSemaphore(frame_timeline.GetVkSemaphore(),
+                                                            frame_timeline.GetSubmittedFrame(),
+                                                            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+    m_compute_command_builder
+            ->SignalTimelineSemaphore(m_compute_timeline->GetVkSemaphore(), ++m_compute_timeline_value)
+            .SubmitTo(m_render_device->GetQueue(QueueType::Compute));
+    m_compute_waits.emplace_back(m_compute_timeline_value, graphics_wait_stages);
+}
+
+void RenderSystem::BuildHiZPyramid() {
+    m_gpu_profiler->BeginScope(m_command_builder->GetCurrentCommandBuffer(), "Hi-Z Build");
+    m_hiz_pyramid->CmdBuild(m_command_builder, m_camera_view_proj, m_render_extent);
+    m_gpu_profiler->EndScope(m_command_builder->GetCurrentCommandBuffer());
+}
+
+void RenderSystem::CullClusters() {
+    if (!m_enable_cluster_culling) { return; }
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    m_cluster_culler->BeginFrame(m_cur_swapchain_frame_index);
+
+    ClusterCuller::CullView main_view{};
+    main_view.m_view_proj = m_camera_view_proj;
+    main_view.m_camera_position = m_camera_position;
+    main_view.m_cone_culling = m_enable_cone_culling;
+    m_cluster_culler->Cull(m_render_objects, LodView::Main, main_view);
+
+    // 背面同样会投射阴影，各cascade只做视锥剔除
+    for (uint32_t cascade = 0; cascade < kShadowCascadeCount; ++cascade) {
+        ClusterCuller::CullView shadow_view{};
+        shadow_view.m_view_proj = m_shadow_cascades->GetCascade(cascade).m_view_proj;
+        m_cluster_culler->Cull(m_render_objects, GetShadowCascadeView(cascade), shadow_view);
+    }
+
+    m_cluster_culling_milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>(
+                                             std::chrono::high_resolution_clock::now() - start_time)
+                                             .count();
+}
+
+auto RenderSystem::BeginFrame() -> bool {
+    m_render_device->GetFrameTimeline().WaitForFrame(m_frame_slot_frames.at(m_cur_swapchain_frame_index));
+    m_frame_pacer->OnFrameSlotAcquired(m_cur_swapchain_frame_index);
+    // 该帧的GPU工作已经完成，其临时descriptor set可以整体回收；延迟释放的资源按已完成的帧回收
+    m_frame_descriptor_allocators.at(m_cur_swapchain_frame_index)->ResetPools();
+    m_render_device->GetDeletionQueue().Collect();
+
     auto [result, image_index] = m_render_swapchain->AcquireNextImage(m_cur_swapchain_frame_index);
     m_image_index = image_index;
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+        // 该槽位没有提交新的帧，下一次仍可直接使用
         RecreateSwapchain();
-        return;
+        return false;
     }
     if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
         throw std::runtime_error("failed to acquire swap chain image!");
     }
 
     m_command_builder->SetCurrentCommandBuffer(m_cur_swapchain_frame_index).BeginRecord();
+    m_gpu_profiler->BeginFrame(m_command_builder->GetCurrentCommandBuffer(), m_cur_swapchain_frame_index);
+    // 上一帧之后录制的上传在transfer队列上执行，本帧的command buffer只需取得image的所有权
+    m_upload_semaphore = m_render_device->GetUploadQueue().Submit(m_command_builder->GetCurrentCommandBuffer());
+    return true;
 }
 
 void RenderSystem::EndFrame() {
+    m_gpu_profiler->EndFrame(m_command_builder->GetCurrentCommandBuffer());
     m_command_builder->EndRecord();
 
-    vkResetFences(m_render_device->GetVkDevice(), 1,
-                  &m_render_swapchain->GetInFlightFences()[m_cur_swapchain_frame_index]);
     // semaphores
     std::vector<VkSemaphore> image_available_semaphores = {
             m_render_swapchain
@@ -417,9 +1302,20 @@ void RenderSystem::EndFrame() {
     std::vector<VkSemaphore> render_finished_semaphores = {
             m_render_swapchain->GetRenderFinishedSemaphores()[m_cur_swapchain_frame_index]};
 
+    if (m_upload_semaphore != VK_NULL_HANDLE) {
+        m_command_builder->WaitForSemaphoresAndStages({m_upload_semaphore}, {UploadQueue::kWaitStages});
+        m_upload_semaphore = VK_NULL_HANDLE;
+    }
+    for (auto [value, stages]: m_compute_waits) {
+        m_command_builder->WaitForTimelineSemaphore(m_compute_timeline->GetVkSemaphore(), value, stages);
+    }
+    m_compute_waits.clear();
+    auto frame_signal = m_render_device->GetFrameTimeline().SubmitFrame();
+    m_frame_slot_frames.at(m_cur_swapchain_frame_index) = frame_signal.m_frame;
+
     m_command_builder->WaitForSemaphoresAndStages(image_available_semaphores, wait_stages)
             .SignalSemaphores(render_finished_semaphores)
-            .SignalFence(m_render_swapchain->GetInFlightFences()[m_cur_swapchain_frame_index])
+            .SignalFrame(frame_signal)
             .SubmitTo(m_render_device->GetGraphicsQueue());
 
     VkPresentInfoKHR present_info{};
@@ -435,7 +1331,9 @@ void RenderSystem::EndFrame() {
     present_info.pImageIndices = &m_image_index;
 
     auto result = vkQueuePresentKHR(m_render_device->GetPresentQueue(), &present_info);
+    m_frame_pacer->OnPresentQueued(m_cur_swapchain_frame_index);
 
+    // 重建在下一帧获取图像之前完成，本帧仍在使用的资源由DeletionQueue延迟释放
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || m_window->m_has_resized) {
         m_window->m_has_resized = false;
         RecreateSwapchain();
@@ -443,24 +1341,85 @@ void RenderSystem::EndFrame() {
         throw std::runtime_error("failed to present swap chain image!");
     }
 
-    m_cur_swapchain_frame_index = (m_cur_swapchain_frame_index + 1) % m_render_swapchain->GetMaxFramesInFlight();
+    m_cur_swapchain_frame_index = (m_cur_swapchain_frame_index + 1) % m_frames_in_flight;
 }
 
-void RenderSystem::BeginOffscreenRenderPass() {
-    auto *cmd_buffer = m_command_builder->GetCurrentCommandBuffer();
+void RenderSystem::DrawShadowCascades() {
+    m_gpu_profiler->BeginScope(m_command_builder->GetCurrentCommandBuffer(), "Shadow");
+    if (!m_enable_shadow_cache) { m_shadow_cascades->InvalidateCache(); }
+
+    m_shadow_triangle_count = 0;
+    m_static_shadow_render_count = 0;
+    m_dynamic_shadow_render_count = 0;
+    for (uint32_t cascade = 0; cascade < kShadowCascadeCount; ++cascade) {
+        auto lod_view = GetShadowCascadeView(cascade);
+        const auto &view_proj = m_shadow_cascades->GetCascade(cascade).m_view_proj;
+        // GPU剔除时cascade的LOD只取决于cascade与物体的变换，物体的版本即可代表投射阴影的状态
+        auto static_state = m_caster_versions.at(static_cast<size_t>(RenderObject::Mobility::Static));
+        auto dynamic_state = m_caster_versions.at(static_cast<size_t>(RenderObject::Mobility::Dynamic));
+        if (!m_enable_gpu_culling) {
+            static_state = ComputeCasterState(lod_view, view_proj, RenderObject::Mobility::Static);
+            dynamic_state = ComputeCasterState(lod_view, view_proj, RenderObject::Mobility::Dynamic);
+        }
+        auto update = m_shadow_cascades->UpdateCache(cascade, static_state, dynamic_state);
+        if (!update.m_render_static && !update.m_render_dynamic) { continue; }
+
+        // 各顶点格式的阴影pipeline声明了相同的push constant range，切换pipeline后push constant仍然有效
+        ShadowPushConstants push_constants{};
+        push_constants.cascade_index = cascade;
+        m_shadowmap_pipelines.front()->CmdPushConstants(m_command_builder, VK_SHADER_STAGE_VERTEX_BIT,
+                                                        push_constants);
+
+        if (update.m_render_static) {
+            m_shadow_cascades->CmdBeginStaticRenderPass(m_command_builder, cascade);
+            m_shadow_triangle_count += DrawRenderObjects(m_shadowmap_pipelines,
+                                                         m_shadowmap_descriptor_sets[m_cur_swapchain_frame_index],
+                                                         lod_view, true, RenderObject::Mobility::Static);
+            m_shadow_cascades->CmdEndRenderPass(m_command_builder);
+            ++m_static_shadow_render_count;
+        }
+
+        m_shadow_cascades->CmdBeginDynamicRenderPass(m_command_builder, cascade);
+        m_shadow_triangle_count += DrawRenderObjects(m_shadowmap_pipelines,
+                                                     m_shadowmap_descriptor_sets[m_cur_swapchain_frame_index],
+                                                     lod_view, true, RenderObject::Mobility::Dynamic);
+        m_shadow_cascades->CmdEndRenderPass(m_command_builder);
+        ++m_dynamic_shadow_render_count;
+    }
+    m_gpu_profiler->EndScope(m_command_builder->GetCurrentCommandBuffer());
+}
+
+auto RenderSystem::ComputeCasterState(LodView lod_view, const glm::mat4 &view_proj,
+                                      RenderObject::Mobility mobility) const -> size_t {
+    // cascade的近平面已经退到所有投射阴影的物体之前，视锥外的物体不会影响该cascade
+    auto frustum_planes = ExtractFrustumPlanes(view_proj);
 
-    // 获取shadowmap的尺寸
-    auto [shadow_map_width, shadow_map_height] = m_render_swapchain->GetShadowmapImage()->GetExtent();
+    size_t state = 0;
+    for (size_t object_index = 0; object_index < m_render_objects.size(); ++object_index) {
+        const auto &render_object = m_render_objects[object_index];
+        if (render_object->GetMobility() != mobility) { continue; }
+
+        auto bounding_sphere = render_object->GetWorldBoundingSphere();
+        if (IsSphereOutsideFrustum(frustum_planes, glm::vec3(bounding_sphere), bounding_sphere.w)) { continue; }
+
+        HashCombine(state, object_index, render_object->GetTransformVersion(), render_object->GetLodIndex(lod_view));
+    }
+    return state;
+}
+
+void RenderSystem::BeginShadingRenderPass() {
+    auto *cmd_buffer = m_command_builder->GetCurrentCommandBuffer();
 
     VkRenderPassBeginInfo render_pass_info{};
     render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    render_pass_info.renderPass = m_render_swapchain->GetOffscreenRenderPass();
-    render_pass_info.framebuffer = m_render_swapchain->GetOffscreenFramebuffer()[m_image_index];
+    render_pass_info.renderPass = m_render_swapchain->GetShadingRenderPass();
+    render_pass_info.framebuffer = m_render_swapchain->GetShadingFramebuffer();
     render_pass_info.renderArea.offset = {0, 0};
-    render_pass_info.renderArea.extent = {shadow_map_width, shadow_map_height};
+    render_pass_info.renderArea.extent = m_render_extent;
 
-    std::array<VkClearValue, 1> clear_values{};
-    clear_values[0].depthStencil = {1.0f, 0};
+    std::array<VkClearValue, 2> clear_values{};
+    clear_values[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+    clear_values[1].depthStencil = {1.0f, 0};
 
     render_pass_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
     render_pass_info.pClearValues = clear_values.data();
@@ -470,46 +1429,40 @@ void RenderSystem::BeginOffscreenRenderPass() {
     VkViewport viewport{};
     viewport.x = 0.0f;
     // 基于VK_KHR_Maintenance1扩展，通过设置负的视口来抵消vulkan的NDC坐标y轴向下的问题
-    viewport.y = static_cast<float>(shadow_map_height); // 这里一定要强转成float
-    viewport.width = static_cast<float>(shadow_map_width);
-    viewport.height = -static_cast<float>(shadow_map_height);
+    viewport.y = static_cast<float>(m_render_extent.height);
+    viewport.width = static_cast<float>(m_render_extent.width);
+    viewport.height = -static_cast<float>(m_render_extent.height);
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
     vkCmdSetViewport(cmd_buffer, 0, 1, &viewport);
 
     VkRect2D scissor{};
     scissor.offset = {0, 0};
-    scissor.extent = {shadow_map_width, shadow_map_height};
+    scissor.extent = m_render_extent;
     vkCmdSetScissor(cmd_buffer, 0, 1, &scissor);
 }
 
-void RenderSystem::EndOffscreenRenderPass() { vkCmdEndRenderPass(m_command_builder->GetCurrentCommandBuffer()); }
+void RenderSystem::EndShadingRenderPass() { vkCmdEndRenderPass(m_command_builder->GetCurrentCommandBuffer()); }
 
-void RenderSystem::BeginShadingRenderPass() {
+void RenderSystem::BeginPresentRenderPass() {
     auto *cmd_buffer = m_command_builder->GetCurrentCommandBuffer();
 
     VkRenderPassBeginInfo render_pass_info{};
     render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    render_pass_info.renderPass = m_render_swapchain->GetShadingRenderPass();
-    render_pass_info.framebuffer = m_render_swapchain->GetFramebuffer()[m_image_index];
+    render_pass_info.renderPass = m_render_swapchain->GetPresentRenderPass();
+    render_pass_info.framebuffer = m_render_swapchain->GetPresentFramebuffers()[m_image_index];
     render_pass_info.renderArea.offset = {0, 0};
     render_pass_info.renderArea.extent = m_render_swapchain->Extent();
-
-    std::array<VkClearValue, 2> clear_values{};
-    clear_values[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
-    clear_values[1].depthStencil = {1.0f, 0};
-
-    render_pass_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
-    render_pass_info.pClearValues = clear_values.data();
+    render_pass_info.clearValueCount = 0;
 
     vkCmdBeginRenderPass(cmd_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
 
+    // 全屏三角形直接输出NDC，使用正常的视口即可
     VkViewport viewport{};
     viewport.x = 0.0f;
-    // 基于VK_KHR_Maintenance1扩展，通过设置负的视口来抵消vulkan的NDC坐标y轴向下的问题
-    viewport.y = m_render_swapchain->Extent().height;
+    viewport.y = 0.0f;
     viewport.width = static_cast<float>(m_render_swapchain->Extent().width);
-    viewport.height = -static_cast<float>(m_render_swapchain->Extent().height);
+    viewport.height = static_cast<float>(m_render_swapchain->Extent().height);
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
     vkCmdSetViewport(cmd_buffer, 0, 1, &viewport);
@@ -520,7 +1473,185 @@ void RenderSystem::BeginShadingRenderPass() {
     vkCmdSetScissor(cmd_buffer, 0, 1, &scissor);
 }
 
-void RenderSystem::EndShadingRenderPass() { vkCmdEndRenderPass(m_command_builder->GetCurrentCommandBuffer()); }
+void RenderSystem::DrawUpscale() {
+    auto *cmd_buffer = m_command_builder->GetCurrentCommandBuffer();
+    const auto &upscale_pipeline = m_upscale_pipeline_cache->Get(m_enable_fxaa);
+    auto full_extent = m_render_swapchain->Extent();
+    bool scaled = m_render_extent.width != full_extent.width || m_render_extent.height != full_extent.height;
+
+    UpscalePushConstants push_constants{};
+    push_constants.uv_scale =
+            glm::vec2(static_cast<float>(m_render_extent.width) / static_cast<float>(full_extent.width),
+                      static_cast<float>(m_render_extent.height) / static_cast<float>(full_extent.height));
+    // 原生分辨率下不需要锐化
+    push_constants.sharpness = scaled ? m_upscale_sharpness : 0.0f;
+
+    // scene color随swapchain重建，每帧从临时allocator分配并写入当前的图像，旧的set随该帧槽位的allocator重置
+    VkDescriptorImageInfo image_info{};
+    image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    image_info.imageView = m_render_swapchain->GetSceneColorImage()->GetVkImageView();
+    image_info.sampler = m_upscale_sampler;
+    auto *descriptor_set = AllocateFrameDescriptorSet(m_upscale_descriptor_set_layout);
+    rendering::DescriptorWriter(m_upscale_descriptor_set_layout, nullptr, m_descriptor_write_cache)
+            .WriteImage(0, &image_info)
+            .Overwrite(descriptor_set);
+
+    m_gpu_profiler->BeginScope(cmd_buffer, m_enable_fxaa ? "Upscale + FXAA" : "Upscale");
+    upscale_pipeline->CmdBindCommandBuffer(m_command_builder);
+    upscale_pipeline->CmdBindDescriptorSets(m_command_builder, descriptor_set);
+    upscale_pipeline->CmdPushConstants(m_command_builder, VK_SHADER_STAGE_FRAGMENT_BIT, push_constants);
+    vkCmdDraw(cmd_buffer, 3, 1, 0, 0);
+    m_gpu_profiler->EndScope(cmd_buffer);
+}
+
+void RenderSystem::EndPresentRenderPass() { vkCmdEndRenderPass(m_command_builder->GetCurrentCommandBuffer()); }
+
+void RenderSystem::ApplySwapchainSettings() {
+    m_swapchain_settings = m_requested_swapchain_settings;
+    // 最小化时推迟到窗口恢复后重建
+    RecreateSwapchain();
+}
+
+void RenderSystem::ApplyFramesInFlight() {
+    // 设备空闲后所有帧都已完成，可以直接从第0个槽位开始
+    vkDeviceWaitIdle(m_render_device->GetVkDevice());
+    m_frames_in_flight = static_cast<uint32_t>(std::clamp(m_requested_frames_in_flight, 1,
+                                                          Swapchain::kMaxFramesInFlight));
+    m_requested_frames_in_flight = static_cast<int>(m_frames_in_flight);
+    m_cur_swapchain_frame_index = 0;
+    m_frame_pacer->ResetFrameSlots();
+    // 新启用的帧槽位的object buffer不含最新的数据
+    MarkObjectLayoutDirty();
+}
+
+void RenderSystem::UpdateRenderExtent() {
+    m_dynamic_resolution->Update(m_gpu_profiler->GetFrameMilliseconds());
+    m_render_extent = m_dynamic_resolution->ComputeRenderExtent(m_render_swapchain->Extent());
+}
+
+auto RenderSystem::DrawRenderObjects(const VertexFormatPipelines &pipelines, VkDescriptorSet descriptor_set,
+                                     LodView lod_view, bool position_only,
+                                     std::optional<RenderObject::Mobility> mobility) -> uint64_t {
+    if (m_enable_gpu_culling) {
+        return DrawGpuCulledObjects(pipelines, descriptor_set, lod_view, position_only, mobility);
+    }
+
+    auto *cmd_buffer = m_command_builder->GetCurrentCommandBuffer();
+    const Pipeline *bound_pipeline = nullptr;
+    VkBuffer bound_vertex_buffer = VK_NULL_HANDLE;
+    VkBuffer bound_index_buffer = VK_NULL_HANDLE;
+    uint64_t triangle_count = 0;
+
+    for (size_t object_index = 0; object_index < m_render_objects.size(); ++object_index) {
+        const auto &render_object = m_render_objects[object_index];
+        if (mobility.has_value() && render_object->GetMobility() != *mobility) { continue; }
+
+        // 剔除后的物体可能没有任何可见的meshlet
+        const auto &lod = render_object->GetLod(lod_view);
+        const auto &geometry = render_object->GetGeometry();
+        uint32_t first_index = geometry.m_first_index + lod.m_first_index;
+        uint32_t index_count = lod.m_index_count;
+        auto index_buffer = render_object->GetIndexBuffer();
+        if (m_enable_cluster_culling) {
+            const auto &draw_range = m_cluster_culler->GetDrawRanges(lod_view).at(object_index);
+            first_index = draw_range.m_first_index;
+            index_count = draw_range.m_index_count;
+            index_buffer = m_cluster_culler->GetIndexBuffer();
+        }
+        if (index_count == 0) { continue; }
+
+        // 不同顶点格式的物体使用各自的pipeline，仅在格式变化时切换
+        const auto &pipeline = pipelines.at(static_cast<size_t>(render_object->GetVertexFormat()));
+        if (pipeline.get() != bound_pipeline) {
+            pipeline->CmdBindCommandBuffer(m_command_builder);
+            pipeline->CmdBindDescriptorSets(m_command_builder, descriptor_set);
+            bound_pipeline = pipeline.get();
+        }
+
+        // 同一顶点格式的网格共用GeometryArena中的缓冲区，只有格式变化时才需要重新绑定
+        auto *vertex_buffer = position_only ? render_object->GetPositionBuffer()->GetVkBuffer()
+                                            : render_object->GetVertexBuffer()->GetVkBuffer();
+        if (vertex_buffer != bound_vertex_buffer) {
+            VkDeviceSize offset = 0;
+            vkCmdBindVertexBuffers(cmd_buffer, 0, 1, &vertex_buffer, &offset);
+            bound_vertex_buffer = vertex_buffer;
+        }
+        if (index_buffer->GetVkBuffer() != bound_index_buffer) {
+            bound_index_buffer = index_buffer->GetVkBuffer();
+            vkCmdBindIndexBuffer(cmd_buffer, bound_index_buffer, 0, VK_INDEX_TYPE_UINT32);
+        }
+
+        // firstInstance为物体下标，shader据此读取object buffer
+        auto first_instance = static_cast<uint32_t>(object_index);
+        vkCmdDrawIndexed(cmd_buffer, index_count, 1, first_index, static_cast<int32_t>(geometry.m_vertex_offset),
+                         first_instance);
+        triangle_count += index_count / 3;
+    }
+    return triangle_count;
+}
+
+auto RenderSystem::DrawGpuCulledObjects(const VertexFormatPipelines &pipelines, VkDescriptorSet descriptor_set,
+                                        LodView lod_view, bool position_only,
+                                        std::optional<RenderObject::Mobility> mobility) -> uint64_t {
+    auto *cmd_buffer = m_command_builder->GetCurrentCommandBuffer();
+    auto *indirect_buffer = m_gpu_culler->GetIndirectBuffer(m_cur_swapchain_frame_index)->GetVkBuffer();
+    auto *count_buffer = m_gpu_culler->GetCountBuffer(m_cur_swapchain_frame_index)->GetVkBuffer();
+    auto draw_indexed_indirect_count = m_render_device->GetExtensionFunctions().m_cmd_draw_indexed_indirect_count;
+    bool multi_draw_indirect = m_render_device->GetEnabledFeatures().multiDrawIndirect == VK_TRUE;
+    constexpr auto kCommandStride = static_cast<uint32_t>(sizeof(VkDrawIndexedIndirectCommand));
+    bool index_buffer_bound = false;
+    uint64_t triangle_count = 0;
+
+    for (size_t format = 0; format < resource::kVertexFormatCount; ++format) {
+        auto vertex_format = static_cast<resource::VertexFormat>(format);
+        bool pipeline_bound = false;
+        for (auto batch_mobility: {RenderObject::Mobility::Static, RenderObject::Mobility::Dynamic}) {
+            if (mobility.has_value() && batch_mobility != *mobility) { continue; }
+            auto batch = GpuCuller::GetDrawBatch(vertex_format, batch_mobility);
+            const auto &draw_batch = m_draw_batches.at(batch);
+            if (draw_batch.m_object_count == 0) { continue; }
+
+            // 同一顶点格式的网格共用GeometryArena中的缓冲区，整个批次只需绑定一次
+            if (!pipeline_bound) {
+                const auto &pipeline = pipelines.at(format);
+                pipeline->CmdBindCommandBuffer(m_command_builder);
+                pipeline->CmdBindDescriptorSets(m_command_builder, descriptor_set);
+                auto *vertex_buffer = position_only ? m_geometry_arena->GetPositionBuffer(vertex_format)->GetVkBuffer()
+                                                    : m_geometry_arena->GetVertexBuffer(vertex_format)->GetVkBuffer();
+                VkDeviceSize offset = 0;
+                vkCmdBindVertexBuffers(cmd_buffer, 0, 1, &vertex_buffer, &offset);
+                pipeline_bound = true;
+            }
+            if (!index_buffer_bound) {
+                vkCmdBindIndexBuffer(cmd_buffer, m_geometry_arena->GetIndexBuffer()->GetVkBuffer(), 0,
+                                     VK_INDEX_TYPE_UINT32);
+                index_buffer_bound = true;
+            }
+
+            auto command_offset =
+                    m_gpu_culler->GetCommandOffset(m_cur_swapchain_frame_index, lod_view, draw_batch.m_first_slot);
+            if (m_gpu_culler->IsCompacting()) {
+                // 可见的命令紧凑排列在批次的开头，绘制数由剔除时在GPU上累加
+                draw_indexed_indirect_count(cmd_buffer, indirect_buffer, command_offset, count_buffer,
+                                            GpuCuller::GetCountOffset(lod_view, batch), draw_batch.m_object_count,
+                                            kCommandStride);
+            } else if (multi_draw_indirect) {
+                // 不可见物体的命令instanceCount为0，整个批次一次提交
+                vkCmdDrawIndexedIndirect(cmd_buffer, indirect_buffer, command_offset, draw_batch.m_object_count,
+                                         kCommandStride);
+            } else {
+                for (uint32_t i = 0; i < draw_batch.m_object_count; ++i) {
+                    vkCmdDrawIndexedIndirect(cmd_buffer, indirect_buffer, command_offset + i * kCommandStride, 1,
+                                             kCommandStride);
+                }
+            }
+            // 剔除结果只在GPU上，CPU只能读到该帧槽位上一次提交的帧的统计
+            triangle_count +=
+                    m_gpu_culler->GetDrawCounts(m_cur_swapchain_frame_index, lod_view, batch).triangle_count;
+        }
+    }
+    return triangle_count;
+}
 
 }// namespace rendering
 
@@ -6,13 +6,26 @@
 
 #include <engine_pch.hpp>
 #include <runtime/function/rendering/buffer.hpp>
+#include <runtime/function/rendering/cluster_culler.hpp>
+#include <runtime/function/rendering/clustered_lighting.hpp>
 #include <runtime/function/rendering/commands.hpp>
 #include <runtime/function/rendering/descriptor.hpp>
+#include <runtime/function/rendering/descriptor_benchmark.hpp>
 #include <runtime/function/rendering/device.hpp>
+#include <runtime/function/rendering/dynamic_resolution.hpp>
+#include <runtime/function/rendering/frame_benchmark.hpp>
+#include <runtime/function/rendering/frame_pacer.hpp>
+#include <runtime/function/rendering/geometry_arena.hpp>
+#include <runtime/function/rendering/gpu_culler.hpp>
+#include <runtime/function/rendering/gpu_profiler.hpp>
+#include <runtime/function/rendering/hiz_pyramid.hpp>
 #include <runtime/function/rendering/image.hpp>
 #include <runtime/function/rendering/pipeline.hpp>
+#include <runtime/function/rendering/pipeline_variant_cache.hpp>
 #include <runtime/function/rendering/render_object.hpp>
+#include <runtime/function/rendering/shadow_cascades.hpp>
 #include <runtime/function/rendering/swapchain.hpp>
+#include <runtime/function/rendering/timeline_semaphore.hpp>
 #include <runtime/function/rendering/window.hpp>
 #include <runtime/resource/model.hpp>
 
@@ -21,17 +34,96 @@ namespace saturn {
 namespace rendering {
 
 struct UniformBufferObject {
-    alignas(16) glm::mat4 model;
     alignas(16) glm::mat4 view;
     alignas(16) glm::mat4 proj;
-    alignas(16) glm::mat4 light_view_proj;
+    alignas(16) std::array<glm::mat4, kShadowCascadeCount> cascade_view_proj;
+    alignas(16) glm::vec4 cascade_splits;// 各cascade远端在相机空间中的深度，shading据此选择cascade
+    alignas(16) glm::vec4 light_position;
+    alignas(16) glm::vec4 camera_position;
+    alignas(16) glm::vec4 shadow_params;// x为阴影比较时的深度偏移
+};
+
+/**
+ * @brief 布局需与shadow_map.vert中的push_constant块保持一致
+ */
+struct ShadowPushConstants {
+    uint32_t cascade_index;
+};
+
+/**
+ * @brief 布局需与upscale.frag中的push_constant块保持一致
+ */
+struct UpscalePushConstants {
+    glm::vec2 uv_scale;
+    float sharpness;
+};
+
+/**
+ * @brief 每个物体在object buffer中的数据，布局需与shader中的ObjectData（std430）保持一致
+ *
+ * 绘制时firstInstance为物体下标，顶点着色器通过gl_InstanceIndex读取。只有变换、网格或绘制批次改变时才重新写入，
+ * 不包含每帧变化的数据，LOD由GPU剔除按各级的误差选择
+ */
+struct GpuObjectData {
+    alignas(16) glm::mat4 model;
+    alignas(16) glm::vec4 position_scale;// 顶点位置解码：position = in_position * scale + offset
+    alignas(16) glm::vec4 position_offset;
+    alignas(16) glm::vec4 bounding_sphere;// 世界空间，供GPU剔除使用
+    std::array<glm::uvec2, resource::Model::kMaxLodCount> lod_ranges;// 各级LOD的first_index/index_count
+    std::array<float, resource::Model::kMaxLodCount> lod_errors;     // 乘以模型矩阵的最大缩放，即世界空间的误差
+    uint32_t lod_count;
+    uint32_t material_index;
+    int32_t vertex_offset;// 网格在GeometryArena中的起始顶点，lod_ranges的first_index同样是共享index buffer中的位置
+    uint32_t draw_batch;  // GpuCuller::GetDrawBatch
+    uint32_t draw_slot;   // 物体在GPU剔除各视角命令段中的位置，同一批次的物体连续排列
+    uint32_t batch_first_slot;
+};
+static_assert(sizeof(GpuObjectData) == 208, "GpuObjectData must match the std430 layout of ObjectData");
+
+/**
+ * @brief 按resource::VertexFormat索引的同一pass的pipeline
+ */
+using VertexFormatPipelines = std::array<std::shared_ptr<Pipeline>, resource::kVertexFormatCount>;
+
+/**
+ * @brief shading pipeline的变体key，决定顶点着色器、固定管线状态以及shading.frag的specialization constant
+ */
+struct ShadingVariant {
+    resource::VertexFormat m_vertex_format = resource::VertexFormat::Full;
+    ShadowFilter m_shadow_filter = ShadowFilter::OptimizedPcf3x3;
+    bool m_enable_shadows = true;
+    bool m_alpha_blending = true;
+    bool m_depth_equal = false;// depth pre-pass之后使用，EQUAL测试且不写深度
+    bool m_clustered_lighting = true;
+    uint32_t m_poisson_tap_count = 8;// 决定采样循环的次数，仅ShadowFilter::PoissonDisk使用
+    VkSampleCountFlagBits m_msaa_samples = VK_SAMPLE_COUNT_1_BIT;// 需与当前shading pass的采样数一致
+
+    auto operator==(const ShadingVariant &) const -> bool = default;
+
+    struct Hash {
+        auto operator()(const ShadingVariant &variant) const -> size_t {
+            size_t seed = 0;
+            HashCombine(seed, variant.m_vertex_format, variant.m_shadow_filter, variant.m_enable_shadows,
+                        variant.m_alpha_blending, variant.m_depth_equal, variant.m_clustered_lighting,
+                        variant.m_poisson_tap_count, variant.m_msaa_samples);
+            return seed;
+        }
+    };
 };
 
 class RenderSystem {
 public:
+    static constexpr const char *kTempleModelPath = R"(\models\japanese_temple.obj)";
+    static constexpr uint32_t kMaxStressInstanceCount = 65536;
+
     RenderSystem(uint32_t width, uint32_t height);
     ~RenderSystem();
 
+    /**
+     * @brief 帧率限制，需在采样输入之前调用
+     */
+    void WaitForNextFrame();
+
     void Tick(float delta_time);
 
     auto ShouldCloseWindow() -> bool;
@@ -47,63 +139,331 @@ private:
     void CreateDevice();
     void CreateSwapchain();
     void CreateDescriptorSetLayout();
+    void CreateShadowCascades();
     void CreateShadowmapPipeline();
+    void CreateDepthPrepassPipeline();
     void CreateGraphicsPipeline();
+    auto CreateShadingPipeline(const ShadingVariant &variant) -> std::shared_ptr<Pipeline>;
+
+    /**
+     * @brief 从缓存中取得variant对应的所有顶点格式的pipeline，variant中的顶点格式被忽略
+     */
+    auto GetShadingPipelines(ShadingVariant variant) -> VertexFormatPipelines;
     void CreateImage();
     void CreateImageSampler();
     void LoadModel();
     void CreateUniformBuffers();
+    void CreateObjectBuffers();
+    auto CreateObjectBuffer(uint32_t object_capacity) const -> std::shared_ptr<Buffer>;
     void CreateDescriptorPool();
     void CreateDescriptorSets();
     void CreateCommandBuffers();
 
-    void RecreateSwapchain();
+    /**
+     * @brief 有独立的compute队列族且支持timeline semaphore时，创建async compute的command buffer与timeline
+     */
+    void CreateAsyncCompute();
+    void CreateClusterCuller();
+    void CreateGpuCuller();
+
+    /**
+     * @brief 由当前swapchain的深度图创建Hi-Z金字塔，重建swapchain时一并重建
+     */
+    void CreateHiZPyramid();
+    void CreateClusteredLighting();
+    void CreateUpscalePipeline();
+    auto CreateUpscaleVariant(bool enable_fxaa) -> std::shared_ptr<Pipeline>;
+
+    /**
+     * @brief 按时间更新压力测试场景中前m_point_light_count个点光源的位置
+     */
+    void UpdatePointLights(float time);
+
+    /**
+     * @brief 在压力测试场景中依次运行cases，运行期间关闭动态分辨率，结束后恢复并调用on_finished
+     */
+    void StartBenchmark(std::string name, std::vector<FrameBenchmark::Case> cases, std::function<void()> on_finished);
+
+    /**
+     * @brief 对比寺庙模型以Full与Packed顶点格式导入时的GPU耗时
+     */
+    void StartVertexFormatBenchmark();
+
+    /**
+     * @brief 在1024个点光源的压力测试场景中对比各MSAA采样数与FXAA的GPU耗时
+     */
+    void StartAntiAliasingBenchmark();
+
+    /**
+     * @brief 开启GPU剔除，对比不同实例数下CPU更新场景的耗时与GPU剔除、绘制的耗时
+     */
+    void StartObjectCountBenchmark();
+
+    /**
+     * @brief 在场景周围按网格排列count个与寺庙共用网格的静态实例，替换之前的实例，count为0时全部移除
+     */
+    void SetStressInstanceCount(uint32_t count);
+
+    /**
+     * @brief 物体的变换或材质改变后调用，之后各帧槽位的object buffer在使用前重新写入该物体
+     */
+    void MarkObjectDirty(size_t object_index);
+
+    /**
+     * @brief 增删、替换物体或改变其mobility后调用，下一次UpdateObjectLayout重新分配绘制批次并重新写入所有物体
+     */
+    void MarkObjectLayoutDirty() { m_object_layout_dirty = true; }
+
+    /**
+     * @brief 重新导入第object_index个物体的模型，保留其变换、mobility与材质，旧物体交给DeletionQueue延迟释放
+     */
+    void ReloadRenderObject(size_t object_index, const std::string &model_path, bool allow_packed);
+
+    /**
+     * @brief 不等待设备空闲，旧swapchain以及依赖其尺寸的资源交给DeletionQueue延迟释放
+     * @return 窗口最小化（尺寸为0）时不重建并返回false，之后的帧跳过渲染直到重建成功
+     */
+    auto RecreateSwapchain() -> bool;
+
+    /**
+     * @brief 从当前帧的临时allocator分配descriptor set，该帧完成后整体重置
+     */
+    auto AllocateFrameDescriptorSet(const std::shared_ptr<DescriptorSetLayout> &layout) -> VkDescriptorSet;
     void UpdateUniformBuffer(uint32_t current_frame_index);
 
+    /**
+     * @brief 物体增删或网格的位置改变后重新分配绘制批次，并将所有物体标记为需要写入，需在每帧更新场景之前调用
+     */
+    void UpdateObjectLayout();
+
+    /**
+     * @brief 将该帧槽位上次写入之后改变过的物体写入当前帧的object buffer，容量不足时先扩容；
+     * 需在该帧槽位上一次提交的帧完成之后执行
+     */
+    void UpdateObjectBuffer();
+
+    /**
+     * @brief 按物体数为当前帧槽位扩容object buffer，容量按2的幂增长，同时更新引用它的descriptor set与GpuCuller
+     * @return 是否重新创建了缓冲区，新的缓冲区需要重新写入所有物体
+     */
+    auto ReserveObjectBuffer() -> bool;
+
+    /**
+     * @brief 包围所有投射阴影的物体的球，静态物体的部分只在其改变时重新计算
+     */
+    auto ComputeCasterBounds() -> glm::vec4;
+
+    /**
+     * @brief 对主相机与每个阴影cascade分别做meshlet级剔除，需在该帧槽位上一次提交的帧完成之后执行
+     */
+    void CullClusters();
+
+    /**
+     * @brief 录制主相机与每个阴影cascade的GPU剔除，结果供DrawRenderObjects间接绘制
+     */
+    void CullObjectsOnGpu();
+
+    [[nodiscard]] auto IsAsyncComputeEnabled() const -> bool {
+        return m_async_compute_supported && m_enable_async_compute;
+    }
+
+    /**
+     * @brief 开始录制当前帧槽位的第command_index个async compute command buffer
+     */
+    void BeginAsyncCompute(uint32_t command_index);
+
+    /**
+     * @brief 提交到compute队列并signal compute timeline，本帧graphics的提交在graphics_wait_stages等待它完成
+     * @param wait_for_graphics 为true时先等待之前所有graphics的提交完成，例如读取上一帧构建的Hi-Z金字塔
+     */
+    void SubmitAsyncCompute(VkPipelineStageFlags graphics_wait_stages, bool wait_for_graphics);
+
+    /**
+     * @brief shading pass结束后由本帧深度构建Hi-Z金字塔，供下一帧的遮挡剔除使用
+     */
+    void BuildHiZPyramid();
+
     /**
      * @brief 开始录制command
+     * @return 无法获取swapchain图像时返回false，本帧不录制也不提交
      */
-    void BeginFrame();
+    auto BeginFrame() -> bool;
 
     /**
      * @brief 结束录制command并提交
      */
     void EndFrame();
 
-    void BeginOffscreenRenderPass();
+    /**
+     * @brief 依次渲染每个cascade，各cascade使用自己的剔除结果与LOD；开启阴影缓存时只重新渲染发生变化的部分
+     */
+    void DrawShadowCascades();
 
-    void EndOffscreenRenderPass();
+    /**
+     * @brief 落在lod_view对应cascade内、指定mobility的物体的变换与LOD的哈希，阴影缓存据此判断是否需要重新渲染
+     *
+     * 只在CPU选择LOD时使用。GPU剔除时cascade的LOD只取决于cascade与物体的变换，改用m_caster_versions，
+     * 不再每帧遍历所有物体
+     */
+    auto ComputeCasterState(LodView lod_view, const glm::mat4 &view_proj, RenderObject::Mobility mobility) const
+            -> size_t;
 
     /**
-     * @brief 最终将物体渲染到屏幕上的pass
+     * @brief 将物体渲染到离屏scene color的pass，只渲染左上角m_render_extent大小的区域
      */
     void BeginShadingRenderPass();
 
     void EndShadingRenderPass();
 
+    /**
+     * @brief 将scene color的渲染区域放大并锐化到swapchain图像，之后在原生分辨率下绘制UI
+     */
+    void BeginPresentRenderPass();
+    void DrawUpscale();
+    void EndPresentRenderPass();
+
+    /**
+     * @brief 以上一次读回的GPU帧耗时更新动态分辨率，并计算本帧的渲染尺寸
+     */
+    void UpdateRenderExtent();
+
+    /**
+     * @brief 在录制之前应用UI中选择的swapchain设置
+     */
+    void ApplySwapchainSettings();
+
+    /**
+     * @brief 等待设备空闲后改变同时在飞的帧数，之后从第0个帧槽位重新开始
+     */
+    void ApplyFramesInFlight();
+
+    /**
+     * @brief 对每个RenderObject按其顶点格式选择pipeline，推送push constant并绘制lod_view对应的LOD
+     *
+     * 开启GPU剔除时使用GpuCuller写出的间接绘制命令；否则开启cluster剔除时绘制ClusterCuller写入的紧凑索引，
+     * 都未开启时绘制整个LOD
+     * @param position_only 为true时绑定只含位置的顶点流，pipeline需使用对应的顶点输入布局
+     * @param mobility 只绘制该mobility的物体，为空时绘制所有物体
+     * @return 绘制的三角形数
+     */
+    auto DrawRenderObjects(const VertexFormatPipelines &pipelines, VkDescriptorSet descriptor_set, LodView lod_view,
+                           bool position_only = false,
+                           std::optional<RenderObject::Mobility> mobility = std::nullopt) -> uint64_t;
+
+    /**
+     * @brief DrawRenderObjects在开启GPU剔除时的实现，每个绘制批次一次间接绘制
+     * @return GPU统计的三角形数，来自该帧槽位上一次提交的帧
+     */
+    auto DrawGpuCulledObjects(const VertexFormatPipelines &pipelines, VkDescriptorSet descriptor_set,
+                              LodView lod_view, bool position_only,
+                              std::optional<RenderObject::Mobility> mobility) -> uint64_t;
+
     std::shared_ptr<Window> m_window;
     std::shared_ptr<Device> m_render_device;
     std::unique_ptr<Swapchain> m_render_swapchain;
 
-    std::shared_ptr<DescriptorPool> m_descriptor_pool;
+    std::unique_ptr<DescriptorLayoutCache> m_descriptor_layout_cache;
+    std::unique_ptr<DescriptorAllocator> m_descriptor_allocator;
+    std::vector<std::unique_ptr<DescriptorAllocator>> m_frame_descriptor_allocators;
     std::shared_ptr<DescriptorPool> m_imgui_descriptor_pool;
     std::shared_ptr<DescriptorSetLayout> m_shadowmap_descriptor_set_layout;
     std::shared_ptr<DescriptorSetLayout> m_descriptor_set_layout;
     std::vector<VkDescriptorSet> m_shadowmap_descriptor_sets;
     std::vector<VkDescriptorSet> m_descriptor_sets;
+    std::shared_ptr<DescriptorWriteCache> m_descriptor_write_cache;
+    std::optional<DescriptorWriteBenchmarkResult> m_descriptor_benchmark_result;// 在UI中手动运行
 
     std::shared_ptr<Image> m_render_image;
 
-    std::shared_ptr<Pipeline> m_shading_pipeline;
-    std::shared_ptr<Pipeline> m_shadowmap_pipeline;
+    VertexFormatPipelines m_shadowmap_pipelines;
+    VertexFormatPipelines m_depth_prepass_pipelines;
+    std::unique_ptr<PipelineVariantCache<ShadingVariant, ShadingVariant::Hash>> m_shading_pipeline_cache;
 
+    std::shared_ptr<GeometryArena> m_geometry_arena;
     std::vector<std::shared_ptr<RenderObject>> m_render_objects;
     std::vector<std::shared_ptr<Buffer>> m_uniform_buffers;
+    std::vector<std::shared_ptr<Buffer>> m_object_buffers;
     std::shared_ptr<CommandsBuilder> m_command_builder;
+    std::shared_ptr<CommandsBuilder> m_compute_command_builder;// 每个帧槽位两个：GPU剔除与光源剔除
+    std::unique_ptr<TimelineSemaphore> m_compute_timeline;     // 每次async compute提交signal一个新的值
+    uint64_t m_compute_timeline_value = 0;
+    std::vector<std::pair<uint64_t, VkPipelineStageFlags>> m_compute_waits;// 本帧graphics提交需等待的compute值
+    VkSemaphore m_upload_semaphore = VK_NULL_HANDLE;// 本帧提交的上传，graphics提交需等待
+    bool m_async_compute_supported = false;
+    bool m_enable_async_compute = true;
+    std::unique_ptr<GpuProfiler> m_gpu_profiler;
+    std::unique_ptr<FrameBenchmark> m_frame_benchmark;
+    std::unique_ptr<ClusterCuller> m_cluster_culler;
+    std::unique_ptr<GpuCuller> m_gpu_culler;
+    std::array<GpuCuller::DrawBatch, GpuCuller::kDrawBatchCount> m_draw_batches{};// 物体增删或替换时重新计算
+    std::vector<uint32_t> m_object_draw_slots;   // 每个物体在各视角命令段中的位置
+    std::vector<uint32_t> m_object_dirty_frames; // 每个物体尚未写入最新数据的帧槽位，按位表示
+    std::vector<uint32_t> m_dirty_objects;       // m_object_dirty_frames非0的物体
+    std::vector<uint32_t> m_dynamic_objects;     // 每帧重新计算投射阴影包围球的物体
+    bool m_object_layout_dirty = true;
+    uint32_t m_geometry_layout_version = 0;      // 上次写入时GeometryArena的布局版本，变化后网格的位置需重新写入
+    std::array<uint64_t, 2> m_caster_versions{}; // 按mobility索引，物体改变时递增，供GPU剔除时的阴影缓存判断
+    std::optional<std::pair<glm::vec3, glm::vec3>> m_static_caster_bounds;// 静态物体的包围盒，为空时重新计算
+    std::unique_ptr<HiZPyramid> m_hiz_pyramid;
+    std::unique_ptr<ShadowCascades> m_shadow_cascades;
+    std::unique_ptr<ClusteredLighting> m_clustered_lighting;
+
+    /**
+     * @brief 压力测试场景中点光源绕y轴的运动
+     */
+    struct PointLightOrbit {
+        ClusteredLighting::PointLight m_light{};// 位置由运动参数计算，其余属性固定
+        float m_radius = 0.0f;
+        float m_height = 0.0f;
+        float m_phase = 0.0f;
+        float m_speed = 0.0f;
+    };
+    std::vector<PointLightOrbit> m_point_light_orbits;
+    std::vector<ClusteredLighting::PointLight> m_point_lights;
+    int m_point_light_count = 1024;
+
+    size_t m_scene_object_count = 0;// LoadModel加载的物体数，之后的物体都是压力测试的实例
+    uint32_t m_stress_instance_count = 0;
+    int m_requested_stress_instance_count = 0;// UI中选择的实例数，松开滑块后生效
+    float m_scene_update_milliseconds = 0.0f;// CPU更新UBO、object buffer并录制剔除的耗时
 
     VkSampler m_texture_sampler;
+
+    std::unique_ptr<DynamicResolution> m_dynamic_resolution;
+    std::unique_ptr<PipelineVariantCache<bool>> m_upscale_pipeline_cache;// key为是否开启FXAA
+    std::shared_ptr<DescriptorSetLayout> m_upscale_descriptor_set_layout;
+    VkSampler m_upscale_sampler = VK_NULL_HANDLE;
+    VkExtent2D m_render_extent{};// shading pass本帧的渲染尺寸，不超过swapchain的尺寸
+    float m_upscale_sharpness = 0.5f;
+    bool m_enable_fxaa = false;
+
+    Swapchain::Settings m_swapchain_settings;
+    Swapchain::Settings m_requested_swapchain_settings;// UI中选择的设置，下一帧开始前生效
+
+    std::unique_ptr<FramePacer> m_frame_pacer;
+    uint32_t m_frames_in_flight = 2;// 不超过Swapchain::kMaxFramesInFlight，越少延迟越低，越多越能掩盖CPU与GPU的波动
+    int m_requested_frames_in_flight = 2;
     uint32_t m_cur_swapchain_frame_index = 0;
+    std::array<uint64_t, Swapchain::kMaxFramesInFlight> m_frame_slot_frames{};// 每个帧槽位最近一次提交的帧
+    bool m_swapchain_dirty = false;// 最小化时重建被推迟
     uint32_t m_image_index = 0;
+    bool m_enable_depth_prepass = true;
+    bool m_enable_cluster_culling = true;
+    bool m_enable_gpu_culling = false;
+    bool m_enable_cone_culling = false;// 仅对闭合的网格生效，场景中的模型多为开放网格
+    bool m_enable_occlusion_culling = true;
+    bool m_enable_shadow_cache = true;
+    ShadingVariant m_shading_variant{};// 当前启用的shading功能，顶点格式与深度测试在绘制时确定
+    float m_shadow_bias = 0.005f;
+    float m_cluster_culling_milliseconds = 0.0f;
+    glm::vec3 m_camera_position{2.0f, 1.5f, 2.0f};
+    glm::vec3 m_light_position{-2.0f, 2.0f, 2.0f};
+    glm::mat4 m_camera_view_proj{1.0f};
+    GpuCuller::LodSelection m_main_lod_selection{};// 由UpdateUniformBuffer每帧计算，CPU与GPU选择LOD时共用
+    uint64_t m_main_triangle_count = 0;
+    uint64_t m_shadow_triangle_count = 0;
+    uint32_t m_static_shadow_render_count = 0; // 本帧重新渲染静态缓存的cascade数
+    uint32_t m_dynamic_shadow_render_count = 0;// 本帧重新合成的cascade数
 
     uint32_t m_width;
     uint32_t m_height;
@@ -0,0 +1,400 @@
+#include "shadow_cascades.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace saturn {
+
+namespace rendering {
+
+ShadowCascades::ShadowCascades(std::shared_ptr<Device> render_device, uint32_t resolution)
+    : m_render_device{std::move(render_device)}, m_resolution{resolution} {
+    auto depth_format = FindDepthFormat();
+
+    m_shadow_image = std::make_shared<Image>(
+            m_render_device, m_resolution, m_resolution, 1, VK_SAMPLE_COUNT_1_BIT, depth_format,
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, kShadowCascadeCount);
+    m_shadow_image->CreateImageView(VK_IMAGE_ASPECT_DEPTH_BIT);
+
+    m_static_image = std::make_shared<Image>(
+            m_render_device, m_resolution, m_resolution, 1, VK_SAMPLE_COUNT_1_BIT, depth_format,
+            VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, kShadowCascadeCount);
+
+    CreateRenderPasses(depth_format);
+    CreateFramebuffers(depth_format, m_static_image, m_static_render_pass, m_static_layer_views,
+                       m_static_framebuffers);
+    CreateFramebuffers(depth_format, m_shadow_image, m_dynamic_render_pass, m_layer_views, m_framebuffers);
+    CreateSampler();
+}
+
+ShadowCascades::~ShadowCascades() {
+    for (size_t i = 0; i < kShadowCascadeCount; ++i) {
+        vkDestroyFramebuffer(m_render_device->GetVkDevice(), m_framebuffers[i], nullptr);
+        vkDestroyFramebuffer(m_render_device->GetVkDevice(), m_static_framebuffers[i], nullptr);
+        vkDestroyImageView(m_render_device->GetVkDevice(), m_layer_views[i], nullptr);
+        vkDestroyImageView(m_render_device->GetVkDevice(), m_static_layer_views[i], nullptr);
+    }
+    vkDestroyRenderPass(m_render_device->GetVkDevice(), m_static_render_pass, nullptr);
+    vkDestroyRenderPass(m_render_device->GetVkDevice(), m_dynamic_render_pass, nullptr);
+    vkDestroySampler(m_render_device->GetVkDevice(), m_sampler, nullptr);
+}
+
+auto ShadowCascades::FindDepthFormat() const -> VkFormat {
+    // 阴影只需要深度，不带stencil的格式更省带宽；优先选择支持线性过滤的格式，硬件比较后可直接做2x2双线性PCF
+    VkFormatFeatureFlags required =
+            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+    for (VkFormatFeatureFlags features: {required | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT, required}) {
+        for (VkFormat format: {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM}) {
+            VkFormatProperties props;
+            vkGetPhysicalDeviceFormatProperties(m_render_device->GetPhyDevice(), format, &props);
+
+            if ((props.optimalTilingFeatures & features) == features) {
+                m_linear_filtering = (features & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) != 0;
+                return format;
+            }
+        }
+    }
+
+    throw std::runtime_error("failed to find supported shadow map format!");
+}
+
+void ShadowCascades::CreateRenderPasses(VkFormat depth_format) {
+    VkAttachmentReference depth_attachment_ref{};
+    depth_attachment_ref.attachment = 0;
+    depth_attachment_ref.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.pDepthStencilAttachment = &depth_attachment_ref;
+
+    auto create_render_pass = [&](const VkAttachmentDescription &depth_attachment,
+                                  const std::array<VkSubpassDependency, 2> &dependencies, VkRenderPass &render_pass) {
+        VkRenderPassCreateInfo render_pass_info{};
+        render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        render_pass_info.attachmentCount = 1;
+        render_pass_info.pAttachments = &depth_attachment;
+        render_pass_info.subpassCount = 1;
+        render_pass_info.pSubpasses = &subpass;
+        render_pass_info.dependencyCount = static_cast<uint32_t>(dependencies.size());
+        render_pass_info.pDependencies = dependencies.data();
+
+        if (vkCreateRenderPass(m_render_device->GetVkDevice(), &render_pass_info, nullptr, &render_pass) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("failed to create shadow render pass!");
+        }
+    };
+
+    // 静态缓存：每次重新渲染都清空，结束后作为拷贝源
+    {
+        VkAttachmentDescription depth_attachment{};
+        depth_attachment.format = depth_format;
+        depth_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depth_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        depth_attachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+        std::array<VkSubpassDependency, 2> dependencies{};
+        // 覆盖写入之前，等待之前的帧从该层的拷贝完成
+        dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[0].dstSubpass = 0;
+        dependencies[0].srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        dependencies[0].srcAccessMask = 0;
+        dependencies[0].dstStageMask =
+                VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[0].dstAccessMask =
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+        dependencies[1].srcSubpass = 0;
+        dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+        create_render_pass(depth_attachment, dependencies, m_static_render_pass);
+    }
+
+    // 最终的shadowmap：保留由静态缓存拷贝来的深度，叠加动态物体后供shading采样
+    {
+        VkAttachmentDescription depth_attachment{};
+        depth_attachment.format = depth_format;
+        depth_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+        depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depth_attachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        depth_attachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        std::array<VkSubpassDependency, 2> dependencies{};
+        // 拷贝写入的深度对深度测试可见
+        dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[0].dstSubpass = 0;
+        dependencies[0].srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        dependencies[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        dependencies[0].dstStageMask =
+                VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[0].dstAccessMask =
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+        // 写入的深度对之后shading的采样可见
+        dependencies[1].srcSubpass = 0;
+        dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        create_render_pass(depth_attachment, dependencies, m_dynamic_render_pass);
+    }
+}
+
+void ShadowCascades::CreateFramebuffers(VkFormat depth_format, const std::shared_ptr<Image> &image,
+                                        VkRenderPass render_pass,
+                                        std::array<VkImageView, kShadowCascadeCount> &layer_views,
+                                        std::array<VkFramebuffer, kShadowCascadeCount> &framebuffers) {
+    // 每个cascade渲染到各自的layer
+    for (uint32_t cascade = 0; cascade < kShadowCascadeCount; ++cascade) {
+        VkImageViewCreateInfo view_info{};
+        view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        view_info.image = image->GetVkImage();
+        view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        view_info.format = depth_format;
+        view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+        view_info.subresourceRange.baseMipLevel = 0;
+        view_info.subresourceRange.levelCount = 1;
+        view_info.subresourceRange.baseArrayLayer = cascade;
+        view_info.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(m_render_device->GetVkDevice(), &view_info, nullptr, &layer_views[cascade]) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("failed to create shadow cascade view!");
+        }
+
+        VkFramebufferCreateInfo framebuffer_info{};
+        framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebuffer_info.renderPass = render_pass;
+        framebuffer_info.attachmentCount = 1;
+        framebuffer_info.pAttachments = &layer_views[cascade];
+        framebuffer_info.width = m_resolution;
+        framebuffer_info.height = m_resolution;
+        framebuffer_info.layers = 1;
+
+        if (vkCreateFramebuffer(m_render_device->GetVkDevice(), &framebuffer_info, nullptr, &framebuffers[cascade]) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("failed to create shadow cascade framebuffer!");
+        }
+    }
+}
+
+void ShadowCascades::CreateSampler() {
+    // 比较采样器：硬件先逐texel与参考深度比较，再对比较结果做双线性过滤，一次采样即得到2x2的PCF
+    // 格式不支持线性过滤时退化为单点比较，shader中的多tap kernel仍然有效
+    auto filter = m_linear_filtering ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+    VkSamplerCreateInfo sampler_info{};
+    sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    sampler_info.magFilter = filter;
+    sampler_info.minFilter = filter;
+    sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.anisotropyEnable = VK_FALSE;
+    sampler_info.maxAnisotropy = 1.0f;
+    sampler_info.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+    sampler_info.unnormalizedCoordinates = VK_FALSE;
+    sampler_info.compareEnable = VK_TRUE;
+    sampler_info.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;// 参考深度不大于shadowmap中的深度时为受光
+    sampler_info.minLod = 0.0f;
+    sampler_info.maxLod = 0.0f;
+
+    if (vkCreateSampler(m_render_device->GetVkDevice(), &sampler_info, nullptr, &m_sampler) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shadow map sampler!");
+    }
+}
+
+void ShadowCascades::Update(const CameraInfo &camera, const glm::vec3 &light_direction,
+                            const glm::vec4 &caster_bounds) {
+    auto inv_view = glm::inverse(camera.m_view);
+    auto light_dir = glm::normalize(light_direction);
+    // 光线接近竖直时换一个up轴，避免lookAt退化
+    auto up = std::abs(light_dir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+    float near_depth = camera.m_near;
+    for (uint32_t cascade = 0; cascade < kShadowCascadeCount; ++cascade) {
+        // practical split：对数划分让近处的cascade足够小，与均匀划分插值避免近处切得过细
+        float t = static_cast<float>(cascade + 1) / static_cast<float>(kShadowCascadeCount);
+        float log_split = camera.m_near * std::pow(camera.m_far / camera.m_near, t);
+        float uniform_split = camera.m_near + (camera.m_far - camera.m_near) * t;
+        float far_depth = glm::mix(uniform_split, log_split, m_split_lambda);
+
+        auto corners = ComputeSliceCorners(camera, inv_view, near_depth, far_depth);
+        glm::vec3 center{0.0f};
+        for (const auto &corner: corners) { center += corner; }
+        center /= static_cast<float>(corners.size());
+
+        // 切片绕中心旋转时半径不变，量化后可消除浮点误差引起的投影尺寸抖动
+        float radius = 0.0f;
+        for (const auto &corner: corners) { radius = std::max(radius, glm::length(corner - center)); }
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+
+        // 光源退到包围球与所有投射阴影的物体之前，切片之外的遮挡物同样会写入深度
+        float caster_distance = glm::dot(glm::vec3(caster_bounds) - center, -light_dir) + caster_bounds.w;
+        float back_distance = std::max(radius, caster_distance);
+
+        auto light_view = glm::lookAt(center - light_dir * back_distance, center, up);
+        auto light_proj = glm::ortho(-radius, radius, -radius, radius, 0.0f, back_distance + radius);
+
+        // 将世界原点在shadowmap中的位置对齐到texel，相机平移时光栅化的采样点保持不变
+        float half_resolution = static_cast<float>(m_resolution) * 0.5f;
+        glm::vec2 origin = glm::vec2(light_proj * light_view * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)) * half_resolution;
+        glm::vec2 offset = (glm::round(origin) - origin) / half_resolution;
+        light_proj[3][0] += offset.x;
+        light_proj[3][1] += offset.y;
+
+        auto &result = m_cascades[cascade];
+        result.m_view_proj = light_proj * light_view;
+        result.m_split_depth = far_depth;
+        result.m_pixels_per_unit = static_cast<float>(m_resolution) / (radius * 2.0f);
+
+        near_depth = far_depth;
+    }
+}
+
+auto ShadowCascades::ComputeSliceCorners(const CameraInfo &camera, const glm::mat4 &inv_view, float near_depth,
+                                         float far_depth) -> std::array<glm::vec3, 8> {
+    std::array<glm::vec3, 8> corners{};
+    float tan_half_fov = std::tan(camera.m_fov_y * 0.5f);
+
+    size_t corner_index = 0;
+    for (float depth: {near_depth, far_depth}) {
+        float half_height = depth * tan_half_fov;
+        float half_width = half_height * camera.m_aspect;
+        for (float y: {-1.0f, 1.0f}) {
+            for (float x: {-1.0f, 1.0f}) {
+                // 相机空间中视线沿-z方向
+                corners[corner_index++] =
+                        glm::vec3(inv_view * glm::vec4(x * half_width, y * half_height, -depth, 1.0f));
+            }
+        }
+    }
+    return corners;
+}
+
+auto ShadowCascades::UpdateCache(uint32_t cascade, size_t static_caster_state, size_t dynamic_caster_state)
+        -> CacheUpdate {
+    auto &cache_state = m_cache_states.at(cascade);
+    const auto &view_proj = m_cascades.at(cascade).m_view_proj;
+
+    CacheUpdate update{};
+    update.m_render_static = !cache_state.m_valid || cache_state.m_view_proj != view_proj ||
+                             cache_state.m_static_caster_state != static_caster_state;
+    update.m_render_dynamic =
+            update.m_render_static || cache_state.m_dynamic_caster_state != dynamic_caster_state;
+
+    cache_state.m_view_proj = view_proj;
+    cache_state.m_static_caster_state = static_caster_state;
+    cache_state.m_dynamic_caster_state = dynamic_caster_state;
+    cache_state.m_valid = true;
+    return update;
+}
+
+void ShadowCascades::InvalidateCache() {
+    for (auto &cache_state: m_cache_states) { cache_state.m_valid = false; }
+}
+
+void ShadowCascades::CmdBeginStaticRenderPass(const std::shared_ptr<CommandsBuilder> &cmd_builder, uint32_t cascade) {
+    CmdBeginRenderPass(cmd_builder->GetCurrentCommandBuffer(), m_static_render_pass,
+                       m_static_framebuffers.at(cascade));
+}
+
+void ShadowCascades::CmdBeginDynamicRenderPass(const std::shared_ptr<CommandsBuilder> &cmd_builder,
+                                               uint32_t cascade) {
+    auto *cmd_buffer = cmd_builder->GetCurrentCommandBuffer();
+
+    // 整层都会被拷贝覆盖，旧内容无需保留；等待之前的帧对该层的采样完成
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = m_shadow_image->GetVkImage();
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, cascade, 1};
+    vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0,
+                         nullptr, 0, nullptr, 1, &barrier);
+
+    VkImageCopy region{};
+    region.srcSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, cascade, 1};
+    region.dstSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, cascade, 1};
+    region.extent = {m_resolution, m_resolution, 1};
+    vkCmdCopyImage(cmd_buffer, m_static_image->GetVkImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                   m_shadow_image->GetVkImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    // 转换到render pass的initialLayout，写入的可见性由render pass的subpass dependency保证
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, 0, 0,
+                         nullptr, 0, nullptr, 1, &barrier);
+
+    CmdBeginRenderPass(cmd_buffer, m_dynamic_render_pass, m_framebuffers.at(cascade));
+}
+
+void ShadowCascades::CmdBeginRenderPass(VkCommandBuffer cmd_buffer, VkRenderPass render_pass,
+                                        VkFramebuffer framebuffer) {
+    VkRenderPassBeginInfo render_pass_info{};
+    render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    render_pass_info.renderPass = render_pass;
+    render_pass_info.framebuffer = framebuffer;
+    render_pass_info.renderArea.offset = {0, 0};
+    render_pass_info.renderArea.extent = {m_resolution, m_resolution};
+
+    // 动态pass的loadOp为LOAD，不使用清除值
+    VkClearValue clear_value{};
+    clear_value.depthStencil = {1.0f, 0};
+    render_pass_info.clearValueCount = 1;
+    render_pass_info.pClearValues = &clear_value;
+
+    vkCmdBeginRenderPass(cmd_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    // 基于VK_KHR_Maintenance1扩展，通过设置负的视口来抵消vulkan的NDC坐标y轴向下的问题
+    viewport.y = static_cast<float>(m_resolution);
+    viewport.width = static_cast<float>(m_resolution);
+    viewport.height = -static_cast<float>(m_resolution);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(cmd_buffer, 0, 1, &viewport);
+
+    VkRect2D scissor{};
+    scissor.offset = {0, 0};
+    scissor.extent = {m_resolution, m_resolution};
+    vkCmdSetScissor(cmd_buffer, 0, 1, &scissor);
+}
+
+void ShadowCascades::CmdEndRenderPass(const std::shared_ptr<CommandsBuilder> &cmd_builder) {
+    vkCmdEndRenderPass(cmd_builder->GetCurrentCommandBuffer());
+}
+
+auto ShadowCascades::CreateDescriptorImageInfo() const -> VkDescriptorImageInfo {
+    VkDescriptorImageInfo image_info{};
+    image_info.sampler = m_sampler;
+    image_info.imageView = m_shadow_image->GetVkImageView();
+    image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    return image_info;
+}
+
+}// namespace rendering
+
+}// namespace saturn
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <engine_pch.hpp>
+#include <runtime/function/rendering/commands.hpp>
+#include <runtime/function/rendering/device.hpp>
+#include <runtime/function/rendering/image.hpp>
+#include <runtime/function/rendering/render_object.hpp>
+
+namespace saturn {
+
+namespace rendering {
+
+/**
+ * @brief shading.frag中阴影的过滤kernel，通过specialization constant传入，数值需与shader中的定义一致
+ */
+enum class ShadowFilter : uint32_t {
+    Hardware2x2,    // 一次比较采样，依赖硬件的双线性PCF
+    OptimizedPcf3x3,// 4次比较采样拟合3x3 texel的tent kernel
+    OptimizedPcf5x5,// 9次比较采样拟合5x5 texel的tent kernel
+    PoissonDisk,    // 按poisson disk分布的若干次比较采样
+};
+
+/**
+ * @brief 方向光的级联阴影（CSM），所有cascade保存在同一个layered深度图中，第i层对应第i个cascade
+ *
+ * 相机视锥按practical split（对数与均匀划分的插值）切分为kShadowCascadeCount段，每段以其包围球拟合一个正交投影，
+ * 投影尺寸只取决于包围球半径，相机旋转时保持不变；光源空间的原点按texel对齐，相机平移时阴影边缘不会闪烁
+ *
+ * 静态与动态物体分别渲染：静态物体渲染到单独的缓存中，只在cascade的投影或静态物体改变时重新渲染；
+ * 最终采样的shadowmap由缓存拷贝而来，再叠加动态物体，两者都未改变时整个cascade跳过
+ */
+class ShadowCascades {
+public:
+    /**
+     * @brief 切分所需的主相机参数，view为右手坐标系下的lookAt矩阵
+     */
+    struct CameraInfo {
+        glm::mat4 m_view{1.0f};
+        float m_fov_y = 0.0f;
+        float m_aspect = 1.0f;
+        float m_near = 0.1f;
+        float m_far = 1.0f;
+    };
+
+    /**
+     * @brief 本帧cascade需要重新渲染的部分
+     */
+    struct CacheUpdate {
+        bool m_render_static = false; // 重新渲染静态物体的缓存
+        bool m_render_dynamic = false;// 由缓存重新合成最终的shadowmap并叠加动态物体
+    };
+
+    struct Cascade {
+        glm::mat4 m_view_proj{1.0f};
+        float m_split_depth = 0.0f;    // cascade远端在相机空间中的深度（取正值）
+        float m_pixels_per_unit = 0.0f;// 每世界单位对应的shadowmap texel数，供LOD选择
+    };
+
+    ShadowCascades(std::shared_ptr<Device> render_device, uint32_t resolution);
+    ~ShadowCascades();
+
+    ShadowCascades(const ShadowCascades &) = delete;
+    auto operator=(const ShadowCascades &) -> ShadowCascades & = delete;
+
+    /**
+     * @brief 重新切分相机视锥并拟合各cascade的光源投影
+     * @param light_direction 光线的传播方向（由光源指向场景）
+     * @param caster_bounds 所有投射阴影物体的世界空间包围球，光源的近平面需要退到它们之前
+     */
+    void Update(const CameraInfo &camera, const glm::vec3 &light_direction, const glm::vec4 &caster_bounds);
+
+    /**
+     * @brief 与上次渲染时的投影以及投射阴影物体的状态比较，决定本帧cascade需要重新渲染的部分，并记录新的状态
+     * @param static_caster_state 落在cascade内的静态物体的变换与LOD的哈希，动态物体同理
+     */
+    auto UpdateCache(uint32_t cascade, size_t static_caster_state, size_t dynamic_caster_state) -> CacheUpdate;
+
+    /**
+     * @brief 下一次UpdateCache时所有cascade都完整地重新渲染
+     */
+    void InvalidateCache();
+
+    /**
+     * @brief 清空并开始渲染第cascade层的静态物体缓存，视口为负高度，与shading pass的约定一致
+     */
+    void CmdBeginStaticRenderPass(const std::shared_ptr<CommandsBuilder> &cmd_builder, uint32_t cascade);
+
+    /**
+     * @brief 将第cascade层的静态缓存拷贝到最终的shadowmap，然后在其上开始渲染动态物体，需在render pass之外调用
+     */
+    void CmdBeginDynamicRenderPass(const std::shared_ptr<CommandsBuilder> &cmd_builder, uint32_t cascade);
+    void CmdEndRenderPass(const std::shared_ptr<CommandsBuilder> &cmd_builder);
+
+    /**
+     * @brief practical split的插值系数，0为均匀划分，1为对数划分
+     */
+    void SetSplitLambda(float split_lambda) { m_split_lambda = std::clamp(split_lambda, 0.0f, 1.0f); }
+    [[nodiscard]] auto GetSplitLambda() const -> float { return m_split_lambda; }
+
+    /**
+     * @brief 静态与动态两个render pass只有load/store与layout不同，彼此兼容，pipeline可以使用任意一个创建
+     */
+    [[nodiscard]] auto GetRenderPass() const -> VkRenderPass { return m_dynamic_render_pass; }
+    [[nodiscard]] auto GetCascade(uint32_t cascade) const -> const Cascade & { return m_cascades.at(cascade); }
+    [[nodiscard]] auto GetResolution() const -> uint32_t { return m_resolution; }
+
+    /**
+     * @brief 采样器是否对比较结果做线性过滤，为false时每次比较采样只覆盖一个texel
+     */
+    [[nodiscard]] auto IsLinearFiltering() const -> bool { return m_linear_filtering; }
+
+    /**
+     * @brief 覆盖所有cascade的2D array view与比较采样器，渲染之外始终处于SHADER_READ_ONLY_OPTIMAL，
+     * shader中需以sampler2DArrayShadow访问
+     */
+    [[nodiscard]] auto CreateDescriptorImageInfo() const -> VkDescriptorImageInfo;
+
+private:
+    auto FindDepthFormat() const -> VkFormat;
+
+    /**
+     * @brief 静态pass清空后渲染，结束时转换为TRANSFER_SRC供拷贝；动态pass保留拷贝来的深度，结束时供shading采样
+     */
+    void CreateRenderPasses(VkFormat depth_format);
+    void CreateFramebuffers(VkFormat depth_format, const std::shared_ptr<Image> &image, VkRenderPass render_pass,
+                            std::array<VkImageView, kShadowCascadeCount> &layer_views,
+                            std::array<VkFramebuffer, kShadowCascadeCount> &framebuffers);
+    void CreateSampler();
+
+    void CmdBeginRenderPass(VkCommandBuffer cmd_buffer, VkRenderPass render_pass, VkFramebuffer framebuffer);
+
+    /**
+     * @brief 相机空间中深度near_depth到far_depth之间的视锥切片的8个世界空间角点
+     */
+    static auto ComputeSliceCorners(const CameraInfo &camera, const glm::mat4 &inv_view, float near_depth,
+                                    float far_depth) -> std::array<glm::vec3, 8>;
+
+    std::shared_ptr<Device> m_render_device;
+    std::shared_ptr<Image> m_shadow_image;// 最终供shading采样的shadowmap
+    std::shared_ptr<Image> m_static_image;// 只含静态物体的缓存
+    std::array<VkImageView, kShadowCascadeCount> m_layer_views{};
+    std::array<VkImageView, kShadowCascadeCount> m_static_layer_views{};
+    std::array<VkFramebuffer, kShadowCascadeCount> m_framebuffers{};
+    std::array<VkFramebuffer, kShadowCascadeCount> m_static_framebuffers{};
+    VkRenderPass m_static_render_pass = VK_NULL_HANDLE;
+    VkRenderPass m_dynamic_render_pass = VK_NULL_HANDLE;
+    VkSampler m_sampler = VK_NULL_HANDLE;
+
+    /**
+     * @brief 上次渲染各cascade时的投影与投射阴影物体的状态
+     */
+    struct CacheState {
+        glm::mat4 m_view_proj{1.0f};
+        size_t m_static_caster_state = 0;
+        size_t m_dynamic_caster_state = 0;
+        bool m_valid = false;
+    };
+
+    std::array<Cascade, kShadowCascadeCount> m_cascades{};
+    std::array<CacheState, kShadowCascadeCount> m_cache_states{};
+    uint32_t m_resolution;
+    float m_split_lambda = 0.75f;
+    bool m_linear_filtering = false;
+};
+
+}// namespace rendering
+
+}// namespace saturn
@@ -6,10 +6,14 @@ namespace saturn {
 
 namespace rendering {
 
-Swapchain::Swapchain(std::shared_ptr<Device> render_device) : m_device(std::move(render_device)) { Init(); }
+Swapchain::Swapchain(std::shared_ptr<Device> render_device, const Settings &settings)
+    : m_device(std::move(render_device)), m_settings(settings) {
+    Init();
+}
 
-Swapchain::Swapchain(std::shared_ptr<Device> render_device, std::shared_ptr<Swapchain> old_swapchain)
-    : m_device(std::move(render_device)), m_old_swapchain(std::move(old_swapchain)) {
+Swapchain::Swapchain(std::shared_ptr<Device> render_device, const Settings &settings,
+                     std::shared_ptr<Swapchain> old_swapchain)
+    : m_device(std::move(render_device)), m_old_swapchain(std::move(old_swapchain)), m_settings(settings) {
     Init();
     m_old_swapchain.reset();
 }
@@ -17,35 +21,47 @@ Swapchain::Swapchain(std::shared_ptr<Device> render_device, std::shared_ptr<Swap
 void Swapchain::Init() {
     CreateSwapchain();
     CreateImageViews();
-    CreateShadingRenderPass();
-    CreateOffscreenRenderPass();
+    if (m_old_swapchain != nullptr && m_old_swapchain->m_swapchain_image_format == m_swapchain_image_format &&
+        m_old_swapchain->m_settings.m_msaa_samples == m_settings.m_msaa_samples) {
+        // render pass与尺寸无关，已有的pipeline与之兼容
+        m_shading_renderpass = std::exchange(m_old_swapchain->m_shading_renderpass, VK_NULL_HANDLE);
+        m_present_renderpass = std::exchange(m_old_swapchain->m_present_renderpass, VK_NULL_HANDLE);
+    } else {
+        CreateShadingRenderPass();
+        CreatePresentRenderPass();
+    }
     CreateColorResources();
     CreateDepthResources();
     CreateFramebuffers();
-    CreateSyncObjects();
+    if (m_old_swapchain != nullptr) {
+        // 在飞的帧会signal这些semaphore，不能重新创建
+        m_image_available_semaphores = std::move(m_old_swapchain->m_image_available_semaphores);
+        m_render_finished_semaphores = std::move(m_old_swapchain->m_render_finished_semaphores);
+    } else {
+        CreateSyncObjects();
+    }
 }
 
 Swapchain::~Swapchain() {
-    for (auto *framebuffer: m_framebuffer) {
+    vkDestroyFramebuffer(m_device->GetVkDevice(), m_shading_framebuffer, nullptr);
+    for (auto *framebuffer: m_present_framebuffers) {
         vkDestroyFramebuffer(m_device->GetVkDevice(), framebuffer, nullptr);
     }
 
-    for (auto *offscreen_framebuffer: m_offscreen_framebuffer) {
-        vkDestroyFramebuffer(m_device->GetVkDevice(), offscreen_framebuffer, nullptr);
-    }
-
     for (auto *image_view: m_swapchain_imageviews) {
         vkDestroyImageView(m_device->GetVkDevice(), image_view, nullptr);
     }
 
-    for (size_t i = 0; i < m_max_frames_inflight; i++) {
-        vkDestroySemaphore(m_device->GetVkDevice(), m_render_finished_semaphores[i], nullptr);
-        vkDestroySemaphore(m_device->GetVkDevice(), m_image_available_semaphores[i], nullptr);
-        vkDestroyFence(m_device->GetVkDevice(), m_in_flight_fences[i], nullptr);
+    // 被新swapchain接管后为空
+    for (auto *semaphore: m_render_finished_semaphores) {
+        vkDestroySemaphore(m_device->GetVkDevice(), semaphore, nullptr);
+    }
+    for (auto *semaphore: m_image_available_semaphores) {
+        vkDestroySemaphore(m_device->GetVkDevice(), semaphore, nullptr);
     }
 
     vkDestroyRenderPass(m_device->GetVkDevice(), m_shading_renderpass, nullptr);
-    vkDestroyRenderPass(m_device->GetVkDevice(), m_offscreen_renderpass, nullptr);
+    vkDestroyRenderPass(m_device->GetVkDevice(), m_present_renderpass, nullptr);
 
     vkDestroySwapchainKHR(m_device->GetVkDevice(), m_vk_swapchain, nullptr);
 }
@@ -62,6 +78,7 @@ void Swapchain::CreateSwapchain() {
     SwapChainSupportDetails swap_chain_support = QuerySwapChainSupport(m_device->GetPhyDevice());
 
     VkSurfaceFormatKHR surface_format = ChooseSwapSurfaceFormat(swap_chain_support.formats);
+    m_supported_present_modes = swap_chain_support.presentModes;
     VkPresentModeKHR present_mode = ChooseSwapPresentMode(swap_chain_support.presentModes);
     VkExtent2D extent = ChooseSwapExtent(swap_chain_support.capabilities);
 
@@ -109,6 +126,7 @@ void Swapchain::CreateSwapchain() {
 
     m_swapchain_image_format = surface_format.format;
     m_swapchain_extent = extent;
+    m_present_mode = present_mode;
 }
 
 void Swapchain::CreateImageViews() {
@@ -123,7 +141,7 @@ void Swapchain::CreateImageViews() {
 void Swapchain::CreateShadingRenderPass() {
     VkAttachmentDescription color_attachment{};
     color_attachment.format = m_swapchain_image_format;
-    color_attachment.samples = m_device->GetMaxMsaaSamples();
+    color_attachment.samples = m_settings.m_msaa_samples;
     color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
     color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
@@ -133,13 +151,14 @@ void Swapchain::CreateShadingRenderPass() {
 
     VkAttachmentDescription depth_attachment{};
     depth_attachment.format = FindDepthFormat();
-    depth_attachment.samples = m_device->GetMaxMsaaSamples();
+    depth_attachment.samples = m_settings.m_msaa_samples;
     depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    // 保留深度供下一帧的Hi-Z遮挡剔除使用
+    depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     depth_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    depth_attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depth_attachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
     VkAttachmentDescription color_attachment_resolve{};
     color_attachment_resolve.format = m_swapchain_image_format;
@@ -149,7 +168,7 @@ void Swapchain::CreateShadingRenderPass() {
     color_attachment_resolve.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     color_attachment_resolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     color_attachment_resolve.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    color_attachment_resolve.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    color_attachment_resolve.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
     VkAttachmentReference color_attachment_ref{};
     color_attachment_ref.attachment = 0;
@@ -163,78 +182,100 @@ void Swapchain::CreateShadingRenderPass() {
     color_attachment_resolve_ref.attachment = 2;
     color_attachment_resolve_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+    bool multisampled = m_settings.m_msaa_samples != VK_SAMPLE_COUNT_1_BIT;
+    if (multisampled) {
+        // 多重采样的颜色只在subpass结束时resolve，不需要写回内存，配合transient附件可留在片上
+        color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    } else {
+        // 单采样时直接写入scene color，省去resolve附件
+        color_attachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    }
+
     VkSubpassDescription subpass{};
     subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
     subpass.colorAttachmentCount = 1;
     subpass.pColorAttachments = &color_attachment_ref;
     subpass.pDepthStencilAttachment = &depth_attachment_ref;
-    subpass.pResolveAttachments = &color_attachment_resolve_ref;
-
-    VkSubpassDependency dependency{};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-    dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-    dependency.dstStageMask =
+    subpass.pResolveAttachments = multisampled ? &color_attachment_resolve_ref : nullptr;
+
+    std::array<VkSubpassDependency, 2> dependencies{};
+    // 上一帧构建Hi-Z时对深度的读取需在本帧清除深度之前完成，上一帧present pass对scene color的采样同理
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = 0;
+    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                                   VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                                   VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies[0].dstStageMask =
             VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    // 写入的深度在pass结束后由compute shader读取以构建Hi-Z，resolve后的scene color由present pass采样
+    dependencies[1].srcSubpass = 0;
+    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                                   VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT |
+                                   VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
     std::array<VkAttachmentDescription, 3> attachments = {color_attachment, depth_attachment, color_attachment_resolve};
     VkRenderPassCreateInfo render_pass_info{};
     render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    render_pass_info.attachmentCount = static_cast<uint32_t>(attachments.size());
+    render_pass_info.attachmentCount = multisampled ? 3 : 2;
     render_pass_info.pAttachments = attachments.data();
     render_pass_info.subpassCount = 1;
     render_pass_info.pSubpasses = &subpass;
-    render_pass_info.dependencyCount = 1;
-    render_pass_info.pDependencies = &dependency;
+    render_pass_info.dependencyCount = static_cast<uint32_t>(dependencies.size());
+    render_pass_info.pDependencies = dependencies.data();
 
     if (vkCreateRenderPass(m_device->GetVkDevice(), &render_pass_info, nullptr, &m_shading_renderpass) != VK_SUCCESS) {
         throw std::runtime_error("failed to create render pass!");
     }
 }
 
-void Swapchain::CreateOffscreenRenderPass() {
-    VkAttachmentDescription depth_attachment{};
-    depth_attachment.format = FindDepthFormat();
-    depth_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depth_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    depth_attachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+void Swapchain::CreatePresentRenderPass() {
+    // 全屏绘制会覆盖所有像素，不需要保留或清除之前的内容
+    VkAttachmentDescription color_attachment{};
+    color_attachment.format = m_swapchain_image_format;
+    color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
-    VkAttachmentReference depth_attachment_ref{};
-    depth_attachment_ref.attachment = 0;
-    depth_attachment_ref.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    VkAttachmentReference color_attachment_ref{};
+    color_attachment_ref.attachment = 0;
+    color_attachment_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
     VkSubpassDescription subpass{};
     subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.pDepthStencilAttachment = &depth_attachment_ref;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &color_attachment_ref;
 
+    // 等待acquire的semaphore（COLOR_ATTACHMENT_OUTPUT阶段）之后再写swapchain图像
     VkSubpassDependency dependency{};
     dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
     dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-    dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-    dependency.dstStageMask =
-            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependency.srcAccessMask = 0;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 
-    std::array<VkAttachmentDescription, 1> attachments = {depth_attachment};
     VkRenderPassCreateInfo render_pass_info{};
     render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    render_pass_info.attachmentCount = static_cast<uint32_t>(attachments.size());
-    render_pass_info.pAttachments = attachments.data();
+    render_pass_info.attachmentCount = 1;
+    render_pass_info.pAttachments = &color_attachment;
     render_pass_info.subpassCount = 1;
     render_pass_info.pSubpasses = &subpass;
     render_pass_info.dependencyCount = 1;
     render_pass_info.pDependencies = &dependency;
 
-    if (vkCreateRenderPass(m_device->GetVkDevice(), &render_pass_info, nullptr, &m_offscreen_renderpass) !=
-        VK_SUCCESS) {
-        throw std::runtime_error("failed to create render pass!");
+    if (vkCreateRenderPass(m_device->GetVkDevice(), &render_pass_info, nullptr, &m_present_renderpass) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create present render pass!");
     }
 }
 
@@ -243,101 +284,83 @@ void Swapchain::CreateDepthResources() {
 
     {
         m_depth_image = std::make_shared<Image>(m_device, m_swapchain_extent.width, m_swapchain_extent.height, 1,
-                                                m_device->GetMaxMsaaSamples(), depth_format,
-                                                VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+                                                m_settings.m_msaa_samples, depth_format,
+                                                VK_IMAGE_TILING_OPTIMAL,
+                                                VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
                                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
         m_depth_image->CreateImageView(VK_IMAGE_ASPECT_DEPTH_BIT);
     }
-
-    {
-        m_shadowmap_image =
-                std::make_shared<Image>(m_device, 4096, 4096, 1,
-                                        VK_SAMPLE_COUNT_1_BIT, depth_format, VK_IMAGE_TILING_OPTIMAL,
-                                        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-                                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        m_shadowmap_image->CreateImageView(VK_IMAGE_ASPECT_DEPTH_BIT);
-    }
 }
 
 void Swapchain::CreateColorResources() {
     VkFormat color_format = m_swapchain_image_format;
 
-    m_color_image =
+    if (m_settings.m_msaa_samples != VK_SAMPLE_COUNT_1_BIT) {
+        m_color_image =
+                std::make_shared<Image>(m_device, m_swapchain_extent.width, m_swapchain_extent.height, 1,
+                                        m_settings.m_msaa_samples, color_format, VK_IMAGE_TILING_OPTIMAL,
+                                        VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+                                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        m_color_image->CreateImageView(VK_IMAGE_ASPECT_COLOR_BIT);
+    }
+
+    m_scene_color_image =
             std::make_shared<Image>(m_device, m_swapchain_extent.width, m_swapchain_extent.height, 1,
-                                    m_device->GetMaxMsaaSamples(), color_format, VK_IMAGE_TILING_OPTIMAL,
-                                    VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+                                    VK_SAMPLE_COUNT_1_BIT, color_format, VK_IMAGE_TILING_OPTIMAL,
+                                    VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
                                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-    m_color_image->CreateImageView(VK_IMAGE_ASPECT_COLOR_BIT);
+    m_scene_color_image->CreateImageView(VK_IMAGE_ASPECT_COLOR_BIT);
 }
 
 void Swapchain::CreateFramebuffers() {
-    // shadowmap
-    {
-        m_offscreen_framebuffer.resize(m_swapchain_imageviews.size());
-
-        for (size_t i = 0; i < m_swapchain_imageviews.size(); i++) {
-            std::vector<VkImageView> attachments = {m_shadowmap_image->GetVkImageView()};
-
-            VkFramebufferCreateInfo framebuffer_info{};
-            framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-            framebuffer_info.renderPass = m_offscreen_renderpass;
-            framebuffer_info.attachmentCount = static_cast<uint32_t>(attachments.size());
-            framebuffer_info.pAttachments = attachments.data();
-            framebuffer_info.width = m_shadowmap_image->GetImageInfo().m_width;
-            framebuffer_info.height = m_shadowmap_image->GetImageInfo().m_height;
-            framebuffer_info.layers = 1;
-
-            if (vkCreateFramebuffer(m_device->GetVkDevice(), &framebuffer_info, nullptr,
-                                    &m_offscreen_framebuffer[i]) != VK_SUCCESS) {
-                throw std::runtime_error("failed to create framebuffer!");
-            }
+    auto create_framebuffer = [&](VkRenderPass render_pass, const std::vector<VkImageView> &attachments,
+                                  VkFramebuffer &framebuffer) {
+        VkFramebufferCreateInfo framebuffer_info{};
+        framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebuffer_info.renderPass = render_pass;
+        framebuffer_info.attachmentCount = static_cast<uint32_t>(attachments.size());
+        framebuffer_info.pAttachments = attachments.data();
+        framebuffer_info.width = m_swapchain_extent.width;
+        framebuffer_info.height = m_swapchain_extent.height;
+        framebuffer_info.layers = 1;
+
+        if (vkCreateFramebuffer(m_device->GetVkDevice(), &framebuffer_info, nullptr, &framebuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create framebuffer!");
         }
+    };
+
+    // shading：只引用离屏图像，所有swapchain图像共用一个
+    if (m_color_image != nullptr) {
+        create_framebuffer(m_shading_renderpass,
+                           {m_color_image->GetVkImageView(), m_depth_image->GetVkImageView(),
+                            m_scene_color_image->GetVkImageView()},
+                           m_shading_framebuffer);
+    } else {
+        create_framebuffer(m_shading_renderpass,
+                           {m_scene_color_image->GetVkImageView(), m_depth_image->GetVkImageView()},
+                           m_shading_framebuffer);
     }
 
-    // shading
-    {
-        m_framebuffer.resize(m_swapchain_imageviews.size());
-
-        for (size_t i = 0; i < m_swapchain_imageviews.size(); i++) {
-            std::vector<VkImageView> attachments = {m_color_image->GetVkImageView(), m_depth_image->GetVkImageView(),
-                                                    m_swapchain_imageviews[i]};
-
-            VkFramebufferCreateInfo framebuffer_info{};
-            framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-            framebuffer_info.renderPass = m_shading_renderpass;
-            framebuffer_info.attachmentCount = static_cast<uint32_t>(attachments.size());
-            framebuffer_info.pAttachments = attachments.data();
-            framebuffer_info.width = m_swapchain_extent.width;
-            framebuffer_info.height = m_swapchain_extent.height;
-            framebuffer_info.layers = 1;
-
-            if (vkCreateFramebuffer(m_device->GetVkDevice(), &framebuffer_info, nullptr, &m_framebuffer[i]) !=
-                VK_SUCCESS) {
-                throw std::runtime_error("failed to create framebuffer!");
-            }
-        }
+    // present
+    m_present_framebuffers.resize(m_swapchain_imageviews.size());
+    for (size_t i = 0; i < m_swapchain_imageviews.size(); i++) {
+        create_framebuffer(m_present_renderpass, {m_swapchain_imageviews[i]}, m_present_framebuffers[i]);
     }
 }
 
 void Swapchain::CreateSyncObjects() {
-    m_image_available_semaphores.resize(m_max_frames_inflight);
-    m_render_finished_semaphores.resize(m_max_frames_inflight);
-    m_in_flight_fences.resize(m_max_frames_inflight);
+    m_image_available_semaphores.resize(kMaxFramesInFlight);
+    m_render_finished_semaphores.resize(kMaxFramesInFlight);
 
+    // 帧的完成由Device的FrameTimeline跟踪，这里只有与swapchain图像配对的binary semaphore
     VkSemaphoreCreateInfo semaphore_info{};
     semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    VkFenceCreateInfo fence_info{};
-    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-    for (size_t i = 0; i < m_max_frames_inflight; i++) {
+    for (size_t i = 0; i < kMaxFramesInFlight; i++) {
         if (vkCreateSemaphore(m_device->GetVkDevice(), &semaphore_info, nullptr,
                               &m_image_available_semaphores[i]) != VK_SUCCESS ||
             vkCreateSemaphore(m_device->GetVkDevice(), &semaphore_info, nullptr,
-                              &m_render_finished_semaphores[i]) != VK_SUCCESS ||
-            vkCreateFence(m_device->GetVkDevice(), &fence_info, nullptr, &m_in_flight_fences[i]) != VK_SUCCESS) {
+                              &m_render_finished_semaphores[i]) != VK_SUCCESS) {
             throw std::runtime_error("failed to create synchronization objects for a frame!");
         }
     }
@@ -383,12 +406,12 @@ auto Swapchain::ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &a
 
 auto Swapchain::ChooseSwapPresentMode(const std::vector<VkPresentModeKHR> &available_present_modes)
         -> VkPresentModeKHR {
+    // MAILBOX为三重缓冲，IMMEDIATE不等待垂直同步，FIFO_RELAXED在错过垂直同步时立即显示
     for (const auto &available_present_mode: available_present_modes) {
-        if (available_present_mode == VK_PRESENT_MODE_MAILBOX_KHR) {// 三重缓冲
-            return available_present_mode;
-        }
+        if (available_present_mode == m_settings.m_present_mode) { return available_present_mode; }
     }
 
+    // FIFO是唯一保证支持的模式
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
@@ -9,21 +9,68 @@ namespace rendering {
 
 class Swapchain {
 public:
-    explicit Swapchain(std::shared_ptr<Device> render_device);
-    explicit Swapchain(std::shared_ptr<Device> render_device, std::shared_ptr<Swapchain> old_swapchain);
+    /**
+     * @brief 每帧资源按该数量分配，实际同时在飞的帧数由RenderSystem在此范围内选择
+     */
+    static constexpr int kMaxFramesInFlight = 3;
+
+    /**
+     * @brief 只能通过重建swapchain改变的设置
+     */
+    struct Settings {
+        VkSampleCountFlagBits m_msaa_samples = VK_SAMPLE_COUNT_1_BIT;// 为1时直接渲染到scene color，不需要resolve
+        VkPresentModeKHR m_present_mode = VK_PRESENT_MODE_MAILBOX_KHR;// 不支持时退回FIFO
+
+        auto operator==(const Settings &) const -> bool = default;
+    };
+
+    Swapchain(std::shared_ptr<Device> render_device, const Settings &settings);
+
+    /**
+     * @brief 通过oldSwapchain交接，不需要等待设备空闲。在飞的帧仍在使用的semaphore，以及格式与采样数
+     * 不变时与尺寸无关的render pass由新swapchain接管；old_swapchain其余的资源仍可能被在飞的帧使用，
+     * 调用者需在这些帧完成后再释放它
+     */
+    Swapchain(std::shared_ptr<Device> render_device, const Settings &settings,
+              std::shared_ptr<Swapchain> old_swapchain);
     ~Swapchain();
 
     auto GetImageAvailableSemaphores() -> std::vector<VkSemaphore> & { return m_image_available_semaphores; }
     auto GetRenderFinishedSemaphores() -> std::vector<VkSemaphore> & { return m_render_finished_semaphores; }
-    auto GetInFlightFences() -> std::vector<VkFence> & { return m_in_flight_fences; }
 
-    auto GetOffscreenRenderPass() -> VkRenderPass { return m_offscreen_renderpass; }
+    /**
+     * @brief 场景的shading pass，resolve到离屏的scene color，可以只渲染左上角的一部分区域（动态分辨率）
+     */
     auto GetShadingRenderPass() -> VkRenderPass { return m_shading_renderpass; }
-    [[nodiscard]] auto GetFramebuffer() -> std::vector<VkFramebuffer>& { return m_framebuffer; }
-    [[nodiscard]] auto GetOffscreenFramebuffer() -> std::vector<VkFramebuffer>& { return m_offscreen_framebuffer; }
-    [[nodiscard]] auto GetMaxFramesInFlight() const -> int { return m_max_frames_inflight; }
-
-    auto GetShadowmapImage() -> std::shared_ptr<Image> { return m_shadowmap_image; }
+    [[nodiscard]] auto GetShadingFramebuffer() -> VkFramebuffer { return m_shading_framebuffer; }
+
+    /**
+     * @brief 将scene color放大到swapchain图像并绘制UI的pass，按AcquireNextImage返回的下标选择framebuffer
+     */
+    auto GetPresentRenderPass() -> VkRenderPass { return m_present_renderpass; }
+    [[nodiscard]] auto GetPresentFramebuffers() -> std::vector<VkFramebuffer> & { return m_present_framebuffers; }
+    [[nodiscard]] auto GetMaxFramesInFlight() const -> int { return kMaxFramesInFlight; }
+    [[nodiscard]] auto GetMsaaSamples() const -> VkSampleCountFlagBits { return m_settings.m_msaa_samples; }
+
+    /**
+     * @brief 实际使用的present mode，请求的模式不被支持时为FIFO
+     */
+    [[nodiscard]] auto GetPresentMode() const -> VkPresentModeKHR { return m_present_mode; }
+    [[nodiscard]] auto IsPresentModeSupported(VkPresentModeKHR present_mode) const -> bool {
+        return std::find(m_supported_present_modes.begin(), m_supported_present_modes.end(), present_mode) !=
+               m_supported_present_modes.end();
+    }
+
+    /**
+     * @brief shading pass的深度，pass结束后处于SHADER_READ_ONLY_OPTIMAL，开启MSAA时为多重采样图像
+     */
+    auto GetDepthImage() -> std::shared_ptr<Image> { return m_depth_image; }
+
+    /**
+     * @brief shading pass的resolve目标（不开启MSAA时直接作为颜色附件），与swapchain同尺寸，
+     * pass结束后处于SHADER_READ_ONLY_OPTIMAL
+     */
+    auto GetSceneColorImage() -> std::shared_ptr<Image> { return m_scene_color_image; }
 
     auto VkSwapchain() -> VkSwapchainKHR { return m_vk_swapchain; }
     auto Extent() -> VkExtent2D { return m_swapchain_extent; }
@@ -36,7 +83,7 @@ private:
     void CreateSwapchain();
     void CreateImageViews();
     void CreateShadingRenderPass();
-    void CreateOffscreenRenderPass();
+    void CreatePresentRenderPass();
     void CreateColorResources();
     void CreateDepthResources();
     void CreateFramebuffers();
@@ -52,26 +99,26 @@ private:
     std::shared_ptr<Device> m_device;
     VkSwapchainKHR m_vk_swapchain;
     std::shared_ptr<Swapchain> m_old_swapchain;
+    Settings m_settings;
+    VkPresentModeKHR m_present_mode;
+    std::vector<VkPresentModeKHR> m_supported_present_modes;
 
-    std::vector<VkImage> m_swapchain_images; // 最终渲染在屏幕上的图像，开启MSAA时，用于resolve（解析采样后的图像）
+    std::vector<VkImage> m_swapchain_images; // 最终渲染在屏幕上的图像，由present pass写入
     std::vector<VkImageView> m_swapchain_imageviews;
 
-    std::shared_ptr<Image> m_color_image;
-    std::shared_ptr<Image> m_shadowmap_image;
+    std::shared_ptr<Image> m_color_image;// 多重采样的颜色附件，不开启MSAA时为空
     std::shared_ptr<Image> m_depth_image;
+    std::shared_ptr<Image> m_scene_color_image;// 开启MSAA时用于resolve（解析采样后的图像）
 
     VkFormat m_swapchain_image_format;
     VkExtent2D m_swapchain_extent;
-    std::vector<VkFramebuffer> m_offscreen_framebuffer;
-    std::vector<VkFramebuffer> m_framebuffer;
+    VkFramebuffer m_shading_framebuffer;
+    std::vector<VkFramebuffer> m_present_framebuffers;
     VkRenderPass m_shading_renderpass;
-    VkRenderPass m_offscreen_renderpass;
+    VkRenderPass m_present_renderpass;
 
     std::vector<VkSemaphore> m_image_available_semaphores;
     std::vector<VkSemaphore> m_render_finished_semaphores;
-    std::vector<VkFence> m_in_flight_fences;
-
-    const int m_max_frames_inflight = 2;
 };
 
 }  // namespace rendering
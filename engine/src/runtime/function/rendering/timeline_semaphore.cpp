@@ -0,0 +1,52 @@
+#include "timeline_semaphore.hpp"
+
+namespace saturn {
+
+namespace rendering {
+
+TimelineSemaphore::TimelineSemaphore(std::shared_ptr<Device> render_device, uint64_t initial_value)
+    : m_render_device{std::move(render_device)} {
+    SATURN_ASSERT(m_render_device->IsTimelineSemaphoreSupported(), "Timeline semaphores are not supported");
+
+    VkSemaphoreTypeCreateInfoKHR type_info{};
+    type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+    type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+    type_info.initialValue = initial_value;
+
+    VkSemaphoreCreateInfo semaphore_info{};
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphore_info.pNext = &type_info;
+
+    if (vkCreateSemaphore(m_render_device->GetVkDevice(), &semaphore_info, nullptr, &m_semaphore) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create timeline semaphore!");
+    }
+}
+
+TimelineSemaphore::~TimelineSemaphore() {
+    // 在飞的提交可能仍在等待或signal它
+    m_render_device->GetDeletionQueue().Push(
+            [device = m_render_device->GetVkDevice(), semaphore = m_semaphore]() {
+                vkDestroySemaphore(device, semaphore, nullptr);
+            });
+}
+
+auto TimelineSemaphore::GetCompletedValue() const -> uint64_t {
+    uint64_t value = 0;
+    m_render_device->GetExtensionFunctions().m_get_semaphore_counter_value(m_render_device->GetVkDevice(),
+                                                                           m_semaphore, &value);
+    return value;
+}
+
+void TimelineSemaphore::Wait(uint64_t value) const {
+    VkSemaphoreWaitInfoKHR wait_info{};
+    wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+    wait_info.semaphoreCount = 1;
+    wait_info.pSemaphores = &m_semaphore;
+    wait_info.pValues = &value;
+    m_render_device->GetExtensionFunctions().m_wait_semaphores(m_render_device->GetVkDevice(), &wait_info,
+                                                               UINT64_MAX);
+}
+
+}// namespace rendering
+
+}// namespace saturn
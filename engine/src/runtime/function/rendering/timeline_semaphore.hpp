@@ -0,0 +1,43 @@
+#pragma once
+
+#include <engine_pch.hpp>
+#include <runtime/function/rendering/device.hpp>
+
+namespace saturn {
+
+namespace rendering {
+
+/**
+ * @brief timeline semaphore（Vulkan 1.2或VK_KHR_timeline_semaphore），值单调递增
+ *
+ * 与binary semaphore不同，一次signal可以被任意多次等待，也可以由CPU查询或等待，跨队列、跨帧的依赖不需要成对的
+ * signal与wait。设备不支持该扩展时不能创建，调用者需先检查Device::IsTimelineSemaphoreSupported()
+ */
+class TimelineSemaphore {
+public:
+    explicit TimelineSemaphore(std::shared_ptr<Device> render_device, uint64_t initial_value = 0);
+    ~TimelineSemaphore();
+
+    TimelineSemaphore(const TimelineSemaphore &) = delete;
+    auto operator=(const TimelineSemaphore &) -> TimelineSemaphore & = delete;
+
+    [[nodiscard]] auto GetVkSemaphore() const -> VkSemaphore { return m_semaphore; }
+
+    /**
+     * @brief GPU已经signal的最大值
+     */
+    [[nodiscard]] auto GetCompletedValue() const -> uint64_t;
+
+    /**
+     * @brief 阻塞直到值不小于value
+     */
+    void Wait(uint64_t value) const;
+
+private:
+    std::shared_ptr<Device> m_render_device;
+    VkSemaphore m_semaphore = VK_NULL_HANDLE;
+};
+
+}// namespace rendering
+
+}// namespace saturn
@@ -0,0 +1,191 @@
+#include "upload_queue.hpp"
+
+#include "device.hpp"
+
+namespace saturn {
+
+namespace rendering {
+
+UploadQueue::UploadQueue(Device &render_device) : m_render_device(render_device) {}
+
+UploadQueue::~UploadQueue() {
+    // 未提交的command buffer没有被GPU使用，直接释放
+    if (m_command_buffer != VK_NULL_HANDLE) {
+        vkFreeCommandBuffers(m_render_device.GetVkDevice(), m_render_device.GetCommandPool(QueueType::Transfer), 1,
+                             &m_command_buffer);
+    }
+}
+
+void UploadQueue::CopyBuffer(std::shared_ptr<void> staging, VkBuffer src, VkBuffer dst, const VkBufferCopy &region) {
+    vkCmdCopyBuffer(GetCommandBuffer(), src, dst, 1, &region);
+    m_staging_buffers.push_back(std::move(staging));
+}
+
+void UploadQueue::CopyBufferToImage(std::shared_ptr<void> staging, VkBuffer src, VkImage dst,
+                                    const VkBufferImageCopy &region, uint32_t mip_levels,
+                                    std::function<void(VkCommandBuffer)> on_acquired) {
+    auto *cmd_buffer = GetCommandBuffer();
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = dst;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, mip_levels, region.imageSubresource.baseArrayLayer,
+                                region.imageSubresource.layerCount};
+    vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr,
+                         0, nullptr, 1, &barrier);
+
+    vkCmdCopyBufferToImage(cmd_buffer, src, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    // 只有mip 0写入了数据，但整个image的所有权一起转移，layout保持不变
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    if (m_render_device.HasDedicatedQueue(QueueType::Transfer)) {
+        barrier.srcQueueFamilyIndex = m_render_device.GetQueueFamilyIndex(QueueType::Transfer);
+        barrier.dstQueueFamilyIndex = m_render_device.GetQueueFamilyIndex(QueueType::Graphics);
+        vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0,
+                             nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    // acquire与release的layout、队列族需完全一致，同族时只是等待semaphore之后的普通barrier
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    m_acquire_barriers.push_back(barrier);
+    if (on_acquired) { m_acquire_callbacks.push_back(std::move(on_acquired)); }
+    m_staging_buffers.push_back(std::move(staging));
+}
+
+auto UploadQueue::Submit(VkCommandBuffer graphics_cmd_buffer) -> VkSemaphore {
+    if (!HasPendingUploads()) { return VK_NULL_HANDLE; }
+
+    auto *semaphore = SubmitTransfer();
+    CmdAcquire(graphics_cmd_buffer);
+
+    // graphics的提交等待semaphore，该帧完成时拷贝一定已经完成
+    auto &deletion_queue = m_render_device.GetDeletionQueue();
+    for (auto &staging: m_staging_buffers) { deletion_queue.Retire(std::move(staging)); }
+    m_staging_buffers.clear();
+    deletion_queue.Push([device = m_render_device.GetVkDevice(),
+                         command_pool = m_render_device.GetCommandPool(QueueType::Transfer),
+                         command_buffer = m_command_buffer, semaphore]() {
+        vkFreeCommandBuffers(device, command_pool, 1, &command_buffer);
+        vkDestroySemaphore(device, semaphore, nullptr);
+    });
+    m_command_buffer = VK_NULL_HANDLE;
+    return semaphore;
+}
+
+void UploadQueue::SubmitAndWait() {
+    if (!HasPendingUploads()) { return; }
+
+    auto *device = m_render_device.GetVkDevice();
+    auto *semaphore = SubmitTransfer();
+
+    VkCommandBufferAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    alloc_info.commandPool = m_render_device.GetCommandPool(QueueType::Graphics);
+    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    alloc_info.commandBufferCount = 1;
+
+    VkCommandBuffer graphics_cmd_buffer;
+    if (vkAllocateCommandBuffers(device, &alloc_info, &graphics_cmd_buffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate upload command buffer!");
+    }
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(graphics_cmd_buffer, &begin_info);
+    CmdAcquire(graphics_cmd_buffer);
+    vkEndCommandBuffer(graphics_cmd_buffer);
+
+    VkPipelineStageFlags wait_stages = kWaitStages;
+    VkSubmitInfo submit_info{};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.waitSemaphoreCount = 1;
+    submit_info.pWaitSemaphores = &semaphore;
+    submit_info.pWaitDstStageMask = &wait_stages;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &graphics_cmd_buffer;
+    VkFenceCreateInfo fence_info{};
+    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VkFence fence;
+    if (vkCreateFence(device, &fence_info, nullptr, &fence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload fence!");
+    }
+    if (vkQueueSubmit(m_render_device.GetGraphicsQueue(), 1, &submit_info, fence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit upload command buffer!");
+    }
+    // 该提交等待了semaphore，完成时transfer队列上的拷贝也已完成；不需要等待graphics队列上在飞的帧
+    vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+    vkDestroyFence(device, fence, nullptr);
+
+    vkFreeCommandBuffers(device, m_render_device.GetCommandPool(QueueType::Graphics), 1, &graphics_cmd_buffer);
+    vkFreeCommandBuffers(device, m_render_device.GetCommandPool(QueueType::Transfer), 1, &m_command_buffer);
+    vkDestroySemaphore(device, semaphore, nullptr);
+    m_command_buffer = VK_NULL_HANDLE;
+    m_staging_buffers.clear();
+}
+
+auto UploadQueue::GetCommandBuffer() -> VkCommandBuffer {
+    if (m_command_buffer != VK_NULL_HANDLE) { return m_command_buffer; }
+
+    VkCommandBufferAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    alloc_info.commandPool = m_render_device.GetCommandPool(QueueType::Transfer);
+    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    alloc_info.commandBufferCount = 1;
+
+    if (vkAllocateCommandBuffers(m_render_device.GetVkDevice(), &alloc_info, &m_command_buffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate upload command buffer!");
+    }
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(m_command_buffer, &begin_info);
+    return m_command_buffer;
+}
+
+auto UploadQueue::SubmitTransfer() -> VkSemaphore {
+    vkEndCommandBuffer(m_command_buffer);
+
+    VkSemaphoreCreateInfo semaphore_info{};
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    VkSemaphore semaphore;
+    if (vkCreateSemaphore(m_render_device.GetVkDevice(), &semaphore_info, nullptr, &semaphore) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload semaphore!");
+    }
+
+    VkSubmitInfo submit_info{};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &m_command_buffer;
+    submit_info.signalSemaphoreCount = 1;
+    submit_info.pSignalSemaphores = &semaphore;
+    if (vkQueueSubmit(m_render_device.GetQueue(QueueType::Transfer), 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit upload command buffer!");
+    }
+    return semaphore;
+}
+
+void UploadQueue::CmdAcquire(VkCommandBuffer graphics_cmd_buffer) {
+    if (!m_acquire_barriers.empty()) {
+        vkCmdPipelineBarrier(graphics_cmd_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                             0, nullptr, 0, nullptr, static_cast<uint32_t>(m_acquire_barriers.size()),
+                             m_acquire_barriers.data());
+    }
+    for (const auto &on_acquired: m_acquire_callbacks) { on_acquired(graphics_cmd_buffer); }
+    m_acquire_barriers.clear();
+    m_acquire_callbacks.clear();
+}
+
+}// namespace rendering
+
+}// namespace saturn
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <engine_pch.hpp>
+
+#include <vulkan/vulkan.h>
+
+namespace saturn {
+
+namespace rendering {
+
+class Device;
+
+/**
+ * @brief 在transfer队列上把staging buffer中的数据拷贝到device local的资源
+ *
+ * 拷贝先录制到transfer队列的command buffer中，由Submit统一提交并signal一个binary semaphore，当前帧graphics的提交
+ * 等待它。上传与仍在GPU上执行的帧重叠，CPU也不再等待队列空闲。buffer以VK_SHARING_MODE_CONCURRENT创建，不需要转移
+ * 所有权；image在transfer队列上release，在graphics队列上acquire
+ */
+class UploadQueue {
+public:
+    /**
+     * @brief graphics提交等待Submit返回的semaphore时使用的stage
+     */
+    static constexpr VkPipelineStageFlags kWaitStages =
+            VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+    explicit UploadQueue(Device &render_device);
+    ~UploadQueue();
+
+    UploadQueue(const UploadQueue &) = delete;
+    auto operator=(const UploadQueue &) -> UploadQueue & = delete;
+
+    /**
+     * @param staging 拷贝完成之前保持存活
+     * @param dst 需以VK_SHARING_MODE_CONCURRENT创建
+     */
+    void CopyBuffer(std::shared_ptr<void> staging, VkBuffer src, VkBuffer dst, const VkBufferCopy &region);
+
+    /**
+     * @brief 拷贝到dst的mip 0，dst的所有mip先转换到TRANSFER_DST_OPTIMAL，graphics队列取得所有权后仍处于该layout
+     * @param on_acquired 在graphics队列取得所有权之后录制，例如生成mipmap并转换到最终的layout
+     * @note dst在提交之前不能被销毁
+     */
+    void CopyBufferToImage(std::shared_ptr<void> staging, VkBuffer src, VkImage dst, const VkBufferImageCopy &region,
+                           uint32_t mip_levels, std::function<void(VkCommandBuffer)> on_acquired);
+
+    [[nodiscard]] auto HasPendingUploads() const -> bool { return m_command_buffer != VK_NULL_HANDLE; }
+
+    /**
+     * @brief 提交已录制的拷贝，并在graphics_cmd_buffer中录制所有权的获取，需在该command buffer使用上传的资源之前调用
+     * @return graphics_cmd_buffer提交时需以kWaitStages等待的semaphore，没有上传时为VK_NULL_HANDLE
+     */
+    auto Submit(VkCommandBuffer graphics_cmd_buffer) -> VkSemaphore;
+
+    /**
+     * @brief 提交并等待拷贝与所有权的获取完成，用于帧循环之外，例如在graphics队列上读取刚上传的buffer之前
+     */
+    void SubmitAndWait();
+
+private:
+    /**
+     * @brief 第一次录制时分配并开始录制
+     */
+    auto GetCommandBuffer() -> VkCommandBuffer;
+
+    /**
+     * @brief 结束录制并提交到transfer队列
+     * @return 拷贝完成时signal的semaphore
+     */
+    auto SubmitTransfer() -> VkSemaphore;
+
+    void CmdAcquire(VkCommandBuffer graphics_cmd_buffer);
+
+    Device &m_render_device;
+    VkCommandBuffer m_command_buffer = VK_NULL_HANDLE;
+    std::vector<std::shared_ptr<void>> m_staging_buffers;
+    std::vector<VkImageMemoryBarrier> m_acquire_barriers;
+    std::vector<std::function<void(VkCommandBuffer)>> m_acquire_callbacks;
+};
+
+}// namespace rendering
+
+}// namespace saturn
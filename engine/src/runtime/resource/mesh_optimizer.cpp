@@ -0,0 +1,354 @@
+#include "mesh_optimizer.hpp"
+
+#include <numeric>
+
+namespace saturn {
+
+namespace resource {
+
+namespace {
+
+constexpr uint32_t kInvalidIndex = ~0u;
+
+// Forsyth算法的参数，参考 "Linear-Speed Vertex Cache Optimisation"
+constexpr uint32_t kForsythCacheSize = 32;
+constexpr uint32_t kForsythMaxValence = 32;
+constexpr float kCacheDecayPower = 1.5f;
+constexpr float kLastTriangleScore = 0.75f;
+constexpr float kValenceBoostScale = 2.0f;
+constexpr float kValenceBoostPower = 0.5f;
+
+struct ForsythScoreTable {
+    std::array<float, kForsythCacheSize> m_cache_scores{};
+    std::array<float, kForsythMaxValence + 1> m_valence_scores{};
+
+    ForsythScoreTable() {
+        for (uint32_t i = 0; i < kForsythCacheSize; ++i) {
+            if (i < 3) {
+                // 刚刚使用过的三个顶点得分固定，避免总是沿着同一条带状方向前进
+                m_cache_scores[i] = kLastTriangleScore;
+            } else {
+                float scaler = 1.0f / static_cast<float>(kForsythCacheSize - 3);
+                m_cache_scores[i] = std::pow(1.0f - static_cast<float>(i - 3) * scaler, kCacheDecayPower);
+            }
+        }
+        m_valence_scores[0] = 0.0f;
+        for (uint32_t i = 1; i <= kForsythMaxValence; ++i) {
+            m_valence_scores[i] = kValenceBoostScale * std::pow(static_cast<float>(i), -kValenceBoostPower);
+        }
+    }
+
+    [[nodiscard]] auto GetScore(uint32_t cache_position, uint32_t valence) const -> float {
+        // 所有三角形均已输出的顶点不再参与计算
+        if (valence == 0) { return -1.0f; }
+        float score = cache_position == kInvalidIndex ? 0.0f : m_cache_scores[cache_position];
+        return score + m_valence_scores[std::min(valence, kForsythMaxValence)];
+    }
+};
+
+/**
+ * @brief FIFO cache模拟，用时间戳代替真正的队列
+ */
+class FifoCacheSimulator {
+public:
+    FifoCacheSimulator(size_t vertex_count, uint32_t cache_size)
+        : m_timestamps(vertex_count, 0), m_cache_size{cache_size}, m_timestamp{cache_size + 1} {}
+
+    /**
+     * @brief 返回该三角形产生的miss数
+     */
+    auto AddTriangle(uint32_t a, uint32_t b, uint32_t c) -> uint32_t {
+        return AddVertex(a) + AddVertex(b) + AddVertex(c);
+    }
+
+    /**
+     * @brief 使之前的所有顶点都失效
+     */
+    void Reset() { m_timestamp += m_cache_size + 1; }
+
+private:
+    auto AddVertex(uint32_t vertex) -> uint32_t {
+        if (m_timestamp - m_timestamps[vertex] > m_cache_size) {
+            m_timestamps[vertex] = m_timestamp++;
+            return 1;
+        }
+        return 0;
+    }
+
+    std::vector<uint32_t> m_timestamps;
+    uint32_t m_cache_size;
+    uint32_t m_timestamp;
+};
+
+}// namespace
+
+auto MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t> &indices, size_t vertex_count,
+                                       uint32_t cache_size) -> CacheStatistics {
+    CacheStatistics statistics{};
+    if (indices.empty() || vertex_count == 0) { return statistics; }
+
+    FifoCacheSimulator cache{vertex_count, cache_size};
+    uint64_t misses = 0;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        misses += cache.AddTriangle(indices[i], indices[i + 1], indices[i + 2]);
+    }
+
+    statistics.m_acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+    statistics.m_atvr = static_cast<float>(misses) / static_cast<float>(vertex_count);
+    return statistics;
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t> &indices, size_t vertex_count) {
+    const size_t triangle_count = indices.size() / 3;
+    if (triangle_count == 0) { return; }
+
+    static const ForsythScoreTable kScoreTable{};
+
+    // 每个顶点相邻的、尚未输出的三角形
+    std::vector<uint32_t> valences(vertex_count, 0);
+    for (auto index: indices) { ++valences[index]; }
+
+    std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+    for (size_t i = 0; i < vertex_count; ++i) { adjacency_offsets[i + 1] = adjacency_offsets[i] + valences[i]; }
+
+    std::vector<uint32_t> adjacency_triangles(indices.size());
+    {
+        std::vector<uint32_t> fill_counts(vertex_count, 0);
+        for (size_t i = 0; i < indices.size(); ++i) {
+            auto vertex = indices[i];
+            adjacency_triangles[adjacency_offsets[vertex] + fill_counts[vertex]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<uint32_t> cache_positions(vertex_count, kInvalidIndex);
+    std::vector<float> vertex_scores(vertex_count);
+    for (size_t i = 0; i < vertex_count; ++i) {
+        vertex_scores[i] = kScoreTable.GetScore(kInvalidIndex, valences[i]);
+    }
+
+    std::vector<float> triangle_scores(triangle_count);
+    std::vector<bool> emitted(triangle_count, false);
+    for (size_t i = 0; i < triangle_count; ++i) {
+        triangle_scores[i] = vertex_scores[indices[i * 3]] + vertex_scores[indices[i * 3 + 1]] +
+                             vertex_scores[indices[i * 3 + 2]];
+    }
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+
+    // 多出的3个槽位用于暂存被挤出cache的顶点，以便更新它们的得分
+    std::array<uint32_t, kForsythCacheSize + 3> cache{};
+    std::array<uint32_t, kForsythCacheSize + 3> new_cache{};
+    uint32_t cache_count = 0;
+
+    auto best_triangle = static_cast<uint32_t>(
+            std::max_element(triangle_scores.begin(), triangle_scores.end()) - triangle_scores.begin());
+    size_t input_cursor = 0;
+
+    for (size_t emitted_count = 0; emitted_count < triangle_count; ++emitted_count) {
+        if (best_triangle == kInvalidIndex) {
+            // cache中没有可用的三角形，按输入顺序取下一个未输出的三角形
+            while (emitted[input_cursor]) { ++input_cursor; }
+            best_triangle = static_cast<uint32_t>(input_cursor);
+        }
+
+        const uint32_t triangle_vertices[3] = {indices[best_triangle * 3], indices[best_triangle * 3 + 1],
+                                               indices[best_triangle * 3 + 2]};
+        output.insert(output.end(), std::begin(triangle_vertices), std::end(triangle_vertices));
+        emitted[best_triangle] = true;
+
+        // 从相邻列表中移除已输出的三角形
+        for (auto vertex: triangle_vertices) {
+            auto *begin = adjacency_triangles.data() + adjacency_offsets[vertex];
+            auto *end = begin + valences[vertex];
+            auto *iter = std::find(begin, end, best_triangle);
+            if (iter != end) {
+                std::swap(*iter, *(end - 1));
+                --valences[vertex];
+            }
+        }
+
+        // 新三角形的顶点放在cache最前面，其余顶点依次后移
+        uint32_t new_cache_count = 0;
+        for (auto vertex: triangle_vertices) {
+            if (std::find(new_cache.begin(), new_cache.begin() + new_cache_count, vertex) ==
+                new_cache.begin() + new_cache_count) {
+                new_cache[new_cache_count++] = vertex;
+            }
+        }
+        for (uint32_t i = 0; i < cache_count; ++i) {
+            auto vertex = cache[i];
+            if (std::find(std::begin(triangle_vertices), std::end(triangle_vertices), vertex) ==
+                std::end(triangle_vertices)) {
+                new_cache[new_cache_count++] = vertex;
+            }
+        }
+
+        for (uint32_t i = 0; i < new_cache_count; ++i) {
+            auto vertex = new_cache[i];
+            cache_positions[vertex] = i < kForsythCacheSize ? i : kInvalidIndex;
+        }
+
+        best_triangle = kInvalidIndex;
+        float best_score = -1.0f;
+        for (uint32_t i = 0; i < new_cache_count; ++i) {
+            auto vertex = new_cache[i];
+            float new_score = kScoreTable.GetScore(cache_positions[vertex], valences[vertex]);
+            float score_delta = new_score - vertex_scores[vertex];
+            vertex_scores[vertex] = new_score;
+
+            const auto *begin = adjacency_triangles.data() + adjacency_offsets[vertex];
+            for (const auto *iter = begin; iter != begin + valences[vertex]; ++iter) {
+                auto triangle = *iter;
+                triangle_scores[triangle] += score_delta;
+                if (triangle_scores[triangle] > best_score) {
+                    best_score = triangle_scores[triangle];
+                    best_triangle = triangle;
+                }
+            }
+        }
+
+        cache_count = std::min(new_cache_count, kForsythCacheSize);
+        std::copy(new_cache.begin(), new_cache.begin() + cache_count, cache.begin());
+    }
+
+    indices = std::move(output);
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<Model::Vertex> &vertices,
+                                     float threshold) {
+    const size_t triangle_count = indices.size() / 3;
+    if (triangle_count == 0) { return; }
+
+    constexpr uint32_t kCacheSize = 16;
+
+    // 硬边界：三个顶点全部miss的三角形，说明cache优化在此处重新开始，在这里切开不会损失命中率
+    std::vector<size_t> hard_boundaries{};
+    {
+        FifoCacheSimulator cache{vertices.size(), kCacheSize};
+        for (size_t i = 0; i < triangle_count; ++i) {
+            if (cache.AddTriangle(indices[i * 3], indices[i * 3 + 1], indices[i * 3 + 2]) == 3 || i == 0) {
+                hard_boundaries.push_back(i);
+            }
+        }
+        hard_boundaries.push_back(triangle_count);
+    }
+
+    // 软边界：在硬边界之间，只要簇内的ACMR不超过整体ACMR * threshold就切开
+    std::vector<size_t> cluster_boundaries{};
+    {
+        FifoCacheSimulator cache{vertices.size(), kCacheSize};
+        for (size_t h = 0; h + 1 < hard_boundaries.size(); ++h) {
+            size_t hard_begin = hard_boundaries[h];
+            size_t hard_end = hard_boundaries[h + 1];
+
+            cache.Reset();
+            uint32_t hard_misses = 0;
+            for (size_t i = hard_begin; i < hard_end; ++i) {
+                hard_misses += cache.AddTriangle(indices[i * 3], indices[i * 3 + 1], indices[i * 3 + 2]);
+            }
+            float cluster_threshold =
+                    threshold * static_cast<float>(hard_misses) / static_cast<float>(hard_end - hard_begin);
+
+            cache.Reset();
+            size_t cluster_begin = hard_begin;
+            uint32_t cluster_misses = 0;
+            cluster_boundaries.push_back(hard_begin);
+            for (size_t i = hard_begin; i < hard_end; ++i) {
+                cluster_misses += cache.AddTriangle(indices[i * 3], indices[i * 3 + 1], indices[i * 3 + 2]);
+                auto cluster_size = static_cast<float>(i + 1 - cluster_begin);
+                if (i + 1 < hard_end && static_cast<float>(cluster_misses) <= cluster_threshold * cluster_size) {
+                    cluster_boundaries.push_back(i + 1);
+                    cluster_begin = i + 1;
+                    cluster_misses = 0;
+                    cache.Reset();
+                }
+            }
+        }
+        cluster_boundaries.push_back(triangle_count);
+    }
+
+    const size_t cluster_count = cluster_boundaries.size() - 1;
+    if (cluster_count <= 1) { return; }
+
+    // 以面积加权的质心作为网格中心
+    glm::vec3 mesh_centroid{0.0f};
+    float mesh_area = 0.0f;
+    std::vector<glm::vec3> cluster_centroids(cluster_count, glm::vec3(0.0f));
+    std::vector<glm::vec3> cluster_normals(cluster_count, glm::vec3(0.0f));
+
+    for (size_t c = 0; c < cluster_count; ++c) {
+        float cluster_area = 0.0f;
+        for (size_t i = cluster_boundaries[c]; i < cluster_boundaries[c + 1]; ++i) {
+            const auto &p0 = vertices[indices[i * 3]].m_position;
+            const auto &p1 = vertices[indices[i * 3 + 1]].m_position;
+            const auto &p2 = vertices[indices[i * 3 + 2]].m_position;
+
+            auto normal = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(normal);
+            auto centroid = (p0 + p1 + p2) / 3.0f;
+
+            cluster_centroids[c] += centroid * area;
+            cluster_normals[c] += normal;
+            cluster_area += area;
+        }
+
+        mesh_centroid += cluster_centroids[c];
+        mesh_area += cluster_area;
+        cluster_centroids[c] = cluster_area > 0.0f ? cluster_centroids[c] / cluster_area : cluster_centroids[c];
+    }
+    mesh_centroid = mesh_area > 0.0f ? mesh_centroid / mesh_area : mesh_centroid;
+
+    // 簇的平均法线越是背离网格中心，越可能遮挡其他簇，应当先绘制
+    std::vector<float> cluster_sort_keys(cluster_count);
+    for (size_t c = 0; c < cluster_count; ++c) {
+        float normal_length = glm::length(cluster_normals[c]);
+        auto normal = normal_length > 0.0f ? cluster_normals[c] / normal_length : glm::vec3(0.0f);
+        cluster_sort_keys[c] = glm::dot(cluster_centroids[c] - mesh_centroid, normal);
+    }
+
+    std::vector<size_t> cluster_order(cluster_count);
+    std::iota(cluster_order.begin(), cluster_order.end(), 0);
+    std::stable_sort(cluster_order.begin(), cluster_order.end(),
+                     [&](size_t lhs, size_t rhs) { return cluster_sort_keys[lhs] > cluster_sort_keys[rhs]; });
+
+    std::vector<uint32_t> output{};
+    output.reserve(indices.size());
+    for (auto cluster: cluster_order) {
+        output.insert(output.end(), indices.begin() + static_cast<std::ptrdiff_t>(cluster_boundaries[cluster] * 3),
+                      indices.begin() + static_cast<std::ptrdiff_t>(cluster_boundaries[cluster + 1] * 3));
+    }
+    indices = std::move(output);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Model::Vertex> &vertices, std::vector<uint32_t> &indices) {
+    std::vector<uint32_t> remap(vertices.size(), kInvalidIndex);
+    std::vector<Model::Vertex> output{};
+    output.reserve(vertices.size());
+
+    for (auto &index: indices) {
+        if (remap[index] == kInvalidIndex) {
+            remap[index] = static_cast<uint32_t>(output.size());
+            output.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices = std::move(output);
+}
+
+void MeshOptimizer::Optimize(std::vector<Model::Vertex> &vertices, std::vector<uint32_t> &indices) {
+    auto before = AnalyzeVertexCache(indices, vertices.size());
+
+    OptimizeVertexCache(indices, vertices.size());
+    OptimizeOverdraw(indices, vertices);
+    OptimizeVertexFetch(vertices, indices);
+
+    auto after = AnalyzeVertexCache(indices, vertices.size());
+    ENGINE_LOG_INFO("Mesh optimize: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}", before.m_acmr, after.m_acmr,
+                    before.m_atvr, after.m_atvr);
+}
+
+}// namespace resource
+
+}// namespace saturn
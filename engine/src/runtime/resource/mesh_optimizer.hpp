@@ -0,0 +1,52 @@
+#pragma once
+
+#include <engine_pch.hpp>
+
+#include "model.hpp"
+
+namespace saturn {
+
+namespace resource {
+
+/**
+ * @brief 导入模型时对索引与顶点重新排序，提升post-transform cache命中率、减少overdraw并让顶点读取更连续
+ */
+class MeshOptimizer {
+public:
+    struct CacheStatistics {
+        float m_acmr = 0.0f;// 平均每个三角形的cache miss数，理想值接近0.5
+        float m_atvr = 0.0f;// cache miss数与顶点数之比，理想值为1.0
+    };
+
+    /**
+     * @brief 模拟大小为cache_size的FIFO顶点cache，统计ACMR与ATVR
+     */
+    [[nodiscard]] static auto AnalyzeVertexCache(const std::vector<uint32_t> &indices, size_t vertex_count,
+                                                 uint32_t cache_size = 16) -> CacheStatistics;
+
+    /**
+     * @brief Tom Forsyth的线性时间顶点cache优化，按三角形得分贪心输出
+     */
+    static void OptimizeVertexCache(std::vector<uint32_t> &indices, size_t vertex_count);
+
+    /**
+     * @brief 在cache优化的结果上切分三角形簇，按簇朝外的程度排序，使外侧的面先绘制以减少overdraw
+     * @param threshold 允许ACMR变差的比例，越大切出的簇越多
+     */
+    static void OptimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<Model::Vertex> &vertices,
+                                 float threshold = 1.05f);
+
+    /**
+     * @brief 按索引首次出现的顺序重排顶点，未被引用的顶点会被移除
+     */
+    static void OptimizeVertexFetch(std::vector<Model::Vertex> &vertices, std::vector<uint32_t> &indices);
+
+    /**
+     * @brief 依次执行上述三个阶段并输出优化前后的统计
+     */
+    static void Optimize(std::vector<Model::Vertex> &vertices, std::vector<uint32_t> &indices);
+};
+
+}// namespace resource
+
+}// namespace saturn
@@ -0,0 +1,476 @@
+#include "mesh_simplifier.hpp"
+
+#include <queue>
+
+namespace saturn {
+
+namespace resource {
+
+namespace {
+
+/**
+ * @brief 对称4x4矩阵形式的二次误差，只存储上三角的10个元素
+ */
+struct Quadric {
+    double m_a00 = 0.0, m_a11 = 0.0, m_a22 = 0.0;
+    double m_a01 = 0.0, m_a02 = 0.0, m_a12 = 0.0;
+    double m_b0 = 0.0, m_b1 = 0.0, m_b2 = 0.0;
+    double m_c = 0.0;
+
+    static auto FromTriangle(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2) -> Quadric {
+        auto normal = glm::cross(p1 - p0, p2 - p0);
+        double area = glm::length(normal);
+        Quadric quadric{};
+        if (area == 0.0) { return quadric; }
+
+        double a = normal.x / area;
+        double b = normal.y / area;
+        double c = normal.z / area;
+        double d = -(a * p0.x + b * p0.y + c * p0.z);
+
+        // 按面积加权，大三角形对误差的贡献更大
+        quadric.m_a00 = a * a * area;
+        quadric.m_a11 = b * b * area;
+        quadric.m_a22 = c * c * area;
+        quadric.m_a01 = a * b * area;
+        quadric.m_a02 = a * c * area;
+        quadric.m_a12 = b * c * area;
+        quadric.m_b0 = a * d * area;
+        quadric.m_b1 = b * d * area;
+        quadric.m_b2 = c * d * area;
+        quadric.m_c = d * d * area;
+        return quadric;
+    }
+
+    auto operator+=(const Quadric &other) -> Quadric & {
+        m_a00 += other.m_a00;
+        m_a11 += other.m_a11;
+        m_a22 += other.m_a22;
+        m_a01 += other.m_a01;
+        m_a02 += other.m_a02;
+        m_a12 += other.m_a12;
+        m_b0 += other.m_b0;
+        m_b1 += other.m_b1;
+        m_b2 += other.m_b2;
+        m_c += other.m_c;
+        return *this;
+    }
+
+    [[nodiscard]] auto Evaluate(const glm::vec3 &position) const -> double {
+        double x = position.x;
+        double y = position.y;
+        double z = position.z;
+        double result = m_a00 * x * x + m_a11 * y * y + m_a22 * z * z +
+                        2.0 * (m_a01 * x * y + m_a02 * x * z + m_a12 * y * z) +
+                        2.0 * (m_b0 * x + m_b1 * y + m_b2 * z) + m_c;
+        return std::max(result, 0.0);
+    }
+
+    [[nodiscard]] auto GetWeight() const -> double { return m_a00 + m_a11 + m_a22; }
+
+    /**
+     * @brief 过边p0p1且垂直于三角形p0p1p2的平面，用于在边界与接缝上保持边的形状
+     */
+    static auto FromTriangleEdge(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2, double weight)
+            -> Quadric {
+        auto edge = p1 - p0;
+        double length = glm::length(edge);
+        Quadric quadric{};
+        if (length == 0.0) { return quadric; }
+        edge = edge / static_cast<float>(length);
+
+        auto normal = (p2 - p0) - edge * glm::dot(p2 - p0, edge);
+        double normal_length = glm::length(normal);
+        if (normal_length == 0.0) { return quadric; }
+
+        double a = normal.x / normal_length;
+        double b = normal.y / normal_length;
+        double c = normal.z / normal_length;
+        double d = -(a * p0.x + b * p0.y + c * p0.z);
+
+        // 与三角形的面积权重同样按长度的平方缩放
+        weight *= length * length;
+        quadric.m_a00 = a * a * weight;
+        quadric.m_a11 = b * b * weight;
+        quadric.m_a22 = c * c * weight;
+        quadric.m_a01 = a * b * weight;
+        quadric.m_a02 = a * c * weight;
+        quadric.m_a12 = b * c * weight;
+        quadric.m_b0 = a * d * weight;
+        quadric.m_b1 = b * d * weight;
+        quadric.m_b2 = c * d * weight;
+        quadric.m_c = d * d * weight;
+        return quadric;
+    }
+};
+
+/**
+ * @brief 位置的拓扑类型，决定它可以合并到哪些位置上
+ */
+enum class PositionKind : uint8_t {
+    Manifold,// 内部位置，可以合并到任意相邻位置
+    Border,  // 网格开放边界上的位置，只能沿边界合并
+    Locked,  // 非流形或多条边界交汇，不移动
+};
+
+constexpr uint32_t kNoVertex = std::numeric_limits<uint32_t>::max();
+
+/**
+ * @brief 将位置m_from合并到位置m_to的候选，记录入堆时两个位置的版本，任一端改变后该候选失效
+ */
+struct Collapse {
+    uint32_t m_from;
+    uint32_t m_to;
+    double m_cost;
+    uint32_t m_from_version;
+    uint32_t m_to_version;
+
+    // 代价相同时按目标排序，使同一位置的候选有确定的先后
+    auto operator>(const Collapse &other) const -> bool {
+        return m_cost != other.m_cost ? m_cost > other.m_cost : m_to > other.m_to;
+    }
+};
+
+/**
+ * @brief 将位置相同的顶点映射到同一个顶点上，接缝两侧的顶点会得到相同的下标
+ */
+auto BuildPositionRemap(const std::vector<Model::Vertex> &vertices) -> std::vector<uint32_t> {
+    struct PositionHash {
+        auto operator()(const glm::vec3 &position) const -> size_t {
+            size_t seed = 0;
+            uint32_t bits[3];
+            std::memcpy(bits, &position, sizeof(bits));
+            HashCombine(seed, bits[0], bits[1], bits[2]);
+            return seed;
+        }
+    };
+
+    std::unordered_map<glm::vec3, uint32_t, PositionHash> unique_positions{};
+    std::vector<uint32_t> remap(vertices.size());
+    for (uint32_t i = 0; i < vertices.size(); ++i) {
+        auto [iter, inserted] = unique_positions.try_emplace(vertices[i].m_position, i);
+        remap[i] = iter->second;
+    }
+    return remap;
+}
+
+/**
+ * @brief 将from移动到to之后，检查from周围仍然存在的三角形是否会翻转
+ */
+auto HasFlippedTriangle(const std::vector<Model::Vertex> &vertices, const std::vector<uint32_t> &indices,
+                        const std::vector<uint32_t> &position_remap, const std::vector<uint32_t> &from_triangles,
+                        const std::vector<bool> &removed_triangles, uint32_t from, uint32_t to) -> bool {
+    const auto &target_position = vertices[to].m_position;
+
+    for (auto triangle: from_triangles) {
+        if (removed_triangles[triangle]) { continue; }
+        uint32_t corners[3] = {indices[triangle * 3], indices[triangle * 3 + 1], indices[triangle * 3 + 2]};
+        // 同时包含from和to所在位置的三角形会在合并后退化并被移除
+        if (position_remap[corners[0]] == position_remap[to] || position_remap[corners[1]] == position_remap[to] ||
+            position_remap[corners[2]] == position_remap[to]) {
+            continue;
+        }
+
+        glm::vec3 positions[3] = {vertices[corners[0]].m_position, vertices[corners[1]].m_position,
+                                  vertices[corners[2]].m_position};
+        auto normal_before = glm::cross(positions[1] - positions[0], positions[2] - positions[0]);
+        for (int k = 0; k < 3; ++k) {
+            if (corners[k] == from) { positions[k] = target_position; }
+        }
+        auto normal_after = glm::cross(positions[1] - positions[0], positions[2] - positions[0]);
+
+        if (glm::dot(normal_before, normal_after) <= 0.0f) { return true; }
+    }
+    return false;
+}
+
+/**
+ * @brief 在位置空间中按开放边（没有反向半边的边）对位置分类
+ *
+ * loop[p]为从p出发的开放边的终点，loop_back[p]为指向p的开放边的起点，没有时为kNoVertex，不唯一时为p自身
+ */
+auto ClassifyPositions(const std::vector<uint32_t> &indices, const std::vector<uint32_t> &position_remap,
+                       std::vector<uint32_t> &loop, std::vector<uint32_t> &loop_back) -> std::vector<PositionKind> {
+    const auto vertex_count = static_cast<uint32_t>(position_remap.size());
+    std::vector<uint64_t> half_edges{};
+    half_edges.reserve(indices.size());
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        for (int k = 0; k < 3; ++k) {
+            auto a = position_remap[indices[i + k]];
+            auto b = position_remap[indices[i + (k + 1) % 3]];
+            half_edges.push_back((static_cast<uint64_t>(a) << 32) | b);
+        }
+    }
+    std::sort(half_edges.begin(), half_edges.end());
+
+    std::vector<PositionKind> kinds(vertex_count, PositionKind::Manifold);
+    loop.assign(vertex_count, kNoVertex);
+    loop_back.assign(vertex_count, kNoVertex);
+    for (size_t i = 0; i < half_edges.size(); ++i) {
+        auto a = static_cast<uint32_t>(half_edges[i] >> 32);
+        auto b = static_cast<uint32_t>(half_edges[i] & 0xffffffffu);
+        // 同向的半边出现多次说明该边被两个以上的三角形共用或朝向不一致
+        if ((i > 0 && half_edges[i - 1] == half_edges[i]) ||
+            (i + 1 < half_edges.size() && half_edges[i + 1] == half_edges[i])) {
+            kinds[a] = PositionKind::Locked;
+            kinds[b] = PositionKind::Locked;
+            continue;
+        }
+        auto opposite = (static_cast<uint64_t>(b) << 32) | a;
+        if (std::binary_search(half_edges.begin(), half_edges.end(), opposite)) { continue; }
+        loop[a] = loop[a] == kNoVertex ? b : a;
+        loop_back[b] = loop_back[b] == kNoVertex ? a : b;
+    }
+
+    for (uint32_t p = 0; p < vertex_count; ++p) {
+        if (kinds[p] == PositionKind::Locked || (loop[p] == kNoVertex && loop_back[p] == kNoVertex)) { continue; }
+        bool single_loop = loop[p] != kNoVertex && loop[p] != p && loop_back[p] != kNoVertex && loop_back[p] != p;
+        kinds[p] = single_loop ? PositionKind::Border : PositionKind::Locked;
+    }
+    return kinds;
+}
+
+}// namespace
+
+auto MeshSimplifier::Simplify(const std::vector<Model::Vertex> &vertices, const std::vector<uint32_t> &indices,
+                              size_t target_index_count, float target_error, float *result_error)
+        -> std::vector<uint32_t> {
+    std::vector<uint32_t> result = indices;
+    const auto vertex_count = static_cast<uint32_t>(vertices.size());
+    if (result.size() <= target_index_count || vertex_count == 0) {
+        if (result_error != nullptr) { *result_error = 0.0f; }
+        return result;
+    }
+
+    // 拓扑与误差都在按位置焊接后的网格上计算，以下标为position_remap[i]的顶点代表一个位置
+    auto position_remap = BuildPositionRemap(vertices);
+    std::vector<uint32_t> loop{};
+    std::vector<uint32_t> loop_back{};
+    auto kinds = ClassifyPositions(result, position_remap, loop, loop_back);
+
+    // 同一位置上仍被引用的顶点，之前各级简化中被合并掉的顶点不再参与
+    std::vector<bool> referenced(vertex_count, false);
+    for (auto index: result) { referenced[index] = true; }
+    std::vector<std::vector<uint32_t>> position_members(vertex_count);
+    for (uint32_t i = 0; i < vertex_count; ++i) {
+        if (referenced[i]) { position_members[position_remap[i]].push_back(i); }
+    }
+
+    std::vector<Quadric> quadrics(vertex_count);
+    for (size_t i = 0; i < result.size(); i += 3) {
+        auto quadric = Quadric::FromTriangle(vertices[result[i]].m_position, vertices[result[i + 1]].m_position,
+                                             vertices[result[i + 2]].m_position);
+        for (int k = 0; k < 3; ++k) { quadrics[position_remap[result[i + k]]] += quadric; }
+    }
+
+    // 边界上再加入垂直于三角形的平面，避免轮廓沿边界收缩
+    constexpr double kBorderWeight = 10.0;
+    for (size_t i = 0; i < result.size(); i += 3) {
+        for (int k = 0; k < 3; ++k) {
+            auto a = result[i + k];
+            auto b = result[i + (k + 1) % 3];
+            if (loop[position_remap[a]] != position_remap[b]) { continue; }
+
+            auto quadric = Quadric::FromTriangleEdge(vertices[a].m_position, vertices[b].m_position,
+                                                     vertices[result[i + (k + 2) % 3]].m_position, kBorderWeight);
+            quadrics[position_remap[a]] += quadric;
+            quadrics[position_remap[b]] += quadric;
+        }
+    }
+
+    // 顶点到三角形的邻接表，合并时只追加，被移除的三角形在遍历时跳过
+    const auto triangle_count = static_cast<uint32_t>(result.size() / 3);
+    std::vector<std::vector<uint32_t>> vertex_triangles(vertex_count);
+    for (uint32_t i = 0; i < result.size(); ++i) { vertex_triangles[result[i]].push_back(i / 3); }
+    std::vector<bool> removed_triangles(triangle_count, false);
+    std::vector<bool> collapsed(vertex_count, false);
+    std::vector<uint32_t> position_versions(vertex_count, 0);
+
+    // 为from位置上的顶点vertex选择to位置上的目标：优先选择与它共用三角形的顶点，接缝两侧的顶点因此各自留在同侧；
+    // 否则在from位置上与它纹理坐标相同的顶点所在的三角形中，选择法线最接近的to位置顶点；都没有时合并会撕开纹理
+    auto find_target = [&](uint32_t vertex, uint32_t to) -> uint32_t {
+        for (auto triangle: vertex_triangles[vertex]) {
+            if (removed_triangles[triangle]) { continue; }
+            for (int k = 0; k < 3; ++k) {
+                if (position_remap[result[triangle * 3 + k]] == to) { return result[triangle * 3 + k]; }
+            }
+        }
+
+        uint32_t target = kNoVertex;
+        float best_alignment = std::numeric_limits<float>::lowest();
+        for (auto member: position_members[position_remap[vertex]]) {
+            if (collapsed[member] || !(vertices[member].m_uv == vertices[vertex].m_uv)) { continue; }
+            for (auto triangle: vertex_triangles[member]) {
+                if (removed_triangles[triangle]) { continue; }
+                for (int k = 0; k < 3; ++k) {
+                    auto corner = result[triangle * 3 + k];
+                    if (position_remap[corner] != to) { continue; }
+                    float alignment = glm::dot(vertices[corner].m_normal, vertices[vertex].m_normal);
+                    if (alignment > best_alignment) {
+                        best_alignment = alignment;
+                        target = corner;
+                    }
+                }
+            }
+        }
+        return target;
+    };
+
+    // 内部位置可以合并到任意相邻位置，边界上的位置只能沿边界合并到边界或锁定的位置上
+    auto can_collapse = [&](uint32_t from, uint32_t to) -> bool {
+        if (from == to) { return false; }
+        switch (kinds[from]) {
+            case PositionKind::Manifold:
+                return true;
+            case PositionKind::Border:
+                return kinds[to] != PositionKind::Manifold && (loop[from] == to || loop_back[from] == to);
+            default:
+                return false;
+        }
+    };
+
+    std::vector<uint32_t> neighbors{};
+    auto gather_neighbors = [&](uint32_t position) {
+        neighbors.clear();
+        for (auto member: position_members[position]) {
+            auto &member_triangles = vertex_triangles[member];
+            std::erase_if(member_triangles, [&](uint32_t triangle) { return removed_triangles[triangle]; });
+            for (auto triangle: member_triangles) {
+                for (int k = 0; k < 3; ++k) {
+                    auto neighbor = position_remap[result[triangle * 3 + k]];
+                    if (neighbor != position) { neighbors.push_back(neighbor); }
+                }
+            }
+        }
+        std::sort(neighbors.begin(), neighbors.end());
+        neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+    };
+
+    // 每个位置只在堆中保留一个候选：排在after之后代价最小的相邻位置，代价为合并后在to位置上按权重归一化的二次误差
+    auto find_collapse = [&](uint32_t from, const std::optional<Collapse> &after) -> std::optional<Collapse> {
+        if (kinds[from] == PositionKind::Locked) { return std::nullopt; }
+        gather_neighbors(from);
+        std::optional<Collapse> best{};
+        for (auto to: neighbors) {
+            if (!can_collapse(from, to)) { continue; }
+            Quadric quadric = quadrics[from];
+            quadric += quadrics[to];
+            double weight = quadric.GetWeight();
+            double cost = weight > 0.0 ? quadric.Evaluate(vertices[to].m_position) / weight : 0.0;
+            Collapse collapse{from, to, cost, position_versions[from], position_versions[to]};
+            if (after.has_value() && !(collapse > *after)) { continue; }
+            if (!best.has_value() || *best > collapse) { best = collapse; }
+        }
+        return best;
+    };
+
+    // 返回退化并被移除的三角形数
+    auto move_vertex = [&](uint32_t from, uint32_t to) -> size_t {
+        size_t removed_count = 0;
+        for (auto triangle: vertex_triangles[from]) {
+            if (removed_triangles[triangle]) { continue; }
+            auto *corners = &result[triangle * 3];
+            for (int k = 0; k < 3; ++k) {
+                if (corners[k] == from) { corners[k] = to; }
+            }
+            if (position_remap[corners[0]] == position_remap[corners[1]] ||
+                position_remap[corners[1]] == position_remap[corners[2]] ||
+                position_remap[corners[0]] == position_remap[corners[2]]) {
+                removed_triangles[triangle] = true;
+                ++removed_count;
+            } else {
+                vertex_triangles[to].push_back(triangle);
+            }
+        }
+        vertex_triangles[from].clear();
+        collapsed[from] = true;
+        return removed_count;
+    };
+
+    // 候选按代价放入最小堆，合并后只重新计算受影响的位置，旧的候选在出堆时按版本丢弃
+    std::vector<Collapse> initial_collapses{};
+    for (uint32_t position = 0; position < vertex_count; ++position) {
+        if (position_members[position].empty()) { continue; }
+        if (auto collapse = find_collapse(position, std::nullopt)) { initial_collapses.push_back(*collapse); }
+    }
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<>> collapses(std::greater<>{},
+                                                                                   std::move(initial_collapses));
+
+    const double error_limit = static_cast<double>(target_error) * target_error;
+    double max_error = 0.0;
+    size_t index_count = result.size();
+    std::vector<std::pair<uint32_t, uint32_t>> moves{};
+    std::vector<uint32_t> affected{};
+
+    while (index_count > target_index_count && !collapses.empty()) {
+        auto collapse = collapses.top();
+        if (collapse.m_cost > error_limit) { break; }
+        collapses.pop();
+
+        auto from = collapse.m_from;
+        auto to = collapse.m_to;
+        if (position_versions[from] != collapse.m_from_version || position_versions[to] != collapse.m_to_version ||
+            !can_collapse(from, to)) {
+            continue;
+        }
+
+        // from位置上的每个顶点都要找到目标且不使三角形翻转，否则放弃这次合并
+        moves.clear();
+        bool valid = true;
+        for (auto member: position_members[from]) {
+            if (collapsed[member]) { continue; }
+            auto target = find_target(member, to);
+            if (target == kNoVertex ||
+                HasFlippedTriangle(vertices, result, position_remap, vertex_triangles[member], removed_triangles,
+                                   member, target)) {
+                valid = false;
+                break;
+            }
+            moves.emplace_back(member, target);
+        }
+        if (!valid) {
+            // 换成该位置的下一个候选
+            if (auto next = find_collapse(from, collapse)) { collapses.push(*next); }
+            continue;
+        }
+
+        for (auto [member, target]: moves) { index_count -= move_vertex(member, target) * 3; }
+
+        // 边界上原本指向from的位置改为指向to，沿反方向合并时to接上from的另一侧
+        auto next = loop[from];
+        auto previous = loop_back[from];
+        if (previous != kNoVertex && previous != from && loop[previous] == from) {
+            loop[previous] = previous == to ? next : to;
+        }
+        if (next != kNoVertex && next != from && loop_back[next] == from) {
+            loop_back[next] = next == to ? previous : to;
+        }
+
+        quadrics[to] += quadrics[from];
+        max_error = std::max(max_error, collapse.m_cost);
+
+        // from已不存在，to的二次误差改变，to及其相邻位置的候选都需要重新选择
+        ++position_versions[from];
+        ++position_versions[to];
+        gather_neighbors(to);
+        affected.assign(neighbors.begin(), neighbors.end());
+        affected.push_back(to);
+        for (auto position: affected) {
+            if (auto next = find_collapse(position, std::nullopt)) { collapses.push(*next); }
+        }
+    }
+
+    size_t write = 0;
+    for (uint32_t triangle = 0; triangle < triangle_count; ++triangle) {
+        if (removed_triangles[triangle]) { continue; }
+        for (int k = 0; k < 3; ++k) { result[write++] = result[triangle * 3 + k]; }
+    }
+    result.resize(write);
+
+    if (result_error != nullptr) { *result_error = static_cast<float>(std::sqrt(max_error)); }
+    return result;
+}
+
+}// namespace resource
+
+}// namespace saturn
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <engine_pch.hpp>
+
+#include "model.hpp"
+
+namespace saturn {
+
+namespace resource {
+
+/**
+ * @brief 基于二次误差度量（QEM）的网格简化，只把顶点合并到已有顶点上，因此所有LOD可以共用同一个vertex buffer
+ *
+ * 拓扑与误差在按位置焊接后的网格上计算，合并一个位置时其上的所有顶点一起移动，接缝两侧的顶点各自合并到同侧的顶点上，
+ * 因此接缝不会裂开；会把纹理撕开的合并被拒绝，网格边界上的位置只能沿边界合并
+ */
+class MeshSimplifier {
+public:
+    /**
+     * @param target_index_count 期望的索引数，无法继续简化时会提前停止
+     * @param target_error 允许的最大几何误差，单位与顶点位置相同
+     * @param result_error 输出实际达到的误差
+     * @return 简化后的索引
+     */
+    [[nodiscard]] static auto Simplify(const std::vector<Model::Vertex> &vertices,
+                                       const std::vector<uint32_t> &indices, size_t target_index_count,
+                                       float target_error, float *result_error = nullptr) -> std::vector<uint32_t>;
+};
+
+}// namespace resource
+
+}// namespace saturn
@@ -0,0 +1,102 @@
+#include "meshlet_builder.hpp"
+
+namespace saturn {
+
+namespace resource {
+
+auto MeshletBuilder::Build(const std::vector<Model::Vertex> &vertices, const std::vector<uint32_t> &indices,
+                           uint32_t first_index, uint32_t index_count, uint32_t max_vertices,
+                           uint32_t max_triangles) -> std::vector<Model::Meshlet> {
+    std::vector<Model::Meshlet> meshlets{};
+    if (index_count == 0) { return meshlets; }
+
+    // 记录每个顶点最后被哪个meshlet使用，用于O(1)判断顶点是否已在当前meshlet中
+    std::vector<uint32_t> vertex_owners(vertices.size(), std::numeric_limits<uint32_t>::max());
+    Model::Meshlet meshlet{first_index, 0};
+    uint32_t meshlet_vertex_count = 0;
+
+    auto flush = [&]() {
+        ComputeBounds(vertices, indices, meshlet);
+        meshlets.push_back(meshlet);
+        meshlet = Model::Meshlet{meshlet.m_first_index + meshlet.m_index_count, 0};
+        meshlet_vertex_count = 0;
+    };
+
+    for (uint32_t i = first_index; i < first_index + index_count; i += 3) {
+        auto meshlet_id = static_cast<uint32_t>(meshlets.size());
+        uint32_t new_vertex_count = 0;
+        for (uint32_t k = 0; k < 3; ++k) {
+            if (vertex_owners[indices[i + k]] != meshlet_id) { ++new_vertex_count; }
+        }
+
+        if (meshlet_vertex_count + new_vertex_count > max_vertices || meshlet.m_index_count / 3 >= max_triangles) {
+            flush();
+            meshlet_id = static_cast<uint32_t>(meshlets.size());
+        }
+
+        for (uint32_t k = 0; k < 3; ++k) {
+            auto &owner = vertex_owners[indices[i + k]];
+            if (owner != meshlet_id) {
+                owner = meshlet_id;
+                ++meshlet_vertex_count;
+            }
+        }
+        meshlet.m_index_count += 3;
+    }
+    if (meshlet.m_index_count > 0) { flush(); }
+
+    return meshlets;
+}
+
+void MeshletBuilder::ComputeBounds(const std::vector<Model::Vertex> &vertices, const std::vector<uint32_t> &indices,
+                                   Model::Meshlet &meshlet) {
+    auto begin = indices.begin() + meshlet.m_first_index;
+    auto end = begin + meshlet.m_index_count;
+
+    // 包围球：以包围盒中心为球心
+    glm::vec3 bounds_min{std::numeric_limits<float>::max()};
+    glm::vec3 bounds_max{std::numeric_limits<float>::lowest()};
+    for (auto iter = begin; iter != end; ++iter) {
+        bounds_min = glm::min(bounds_min, vertices[*iter].m_position);
+        bounds_max = glm::max(bounds_max, vertices[*iter].m_position);
+    }
+    meshlet.m_center = (bounds_min + bounds_max) * 0.5f;
+    meshlet.m_radius = 0.0f;
+    for (auto iter = begin; iter != end; ++iter) {
+        meshlet.m_radius = std::max(meshlet.m_radius, glm::length(vertices[*iter].m_position - meshlet.m_center));
+    }
+
+    // 法线锥：轴为三角形法线之和的方向，半角由与轴夹角最大的法线决定
+    std::vector<glm::vec3> normals{};
+    normals.reserve(meshlet.m_index_count / 3);
+    glm::vec3 normal_sum{0.0f};
+    for (auto iter = begin; iter != end; iter += 3) {
+        const auto &p0 = vertices[iter[0]].m_position;
+        const auto &p1 = vertices[iter[1]].m_position;
+        const auto &p2 = vertices[iter[2]].m_position;
+        auto normal = glm::cross(p1 - p0, p2 - p0);
+        float area = glm::length(normal);
+        if (area == 0.0f) { continue; }
+
+        normals.push_back(normal / area);
+        normal_sum += normals.back();
+    }
+
+    meshlet.m_cone_axis = glm::vec3(0.0f, 0.0f, 1.0f);
+    meshlet.m_cone_cutoff = 2.0f;
+    float axis_length = glm::length(normal_sum);
+    if (normals.empty() || axis_length < 1e-6f) { return; }
+
+    meshlet.m_cone_axis = normal_sum / axis_length;
+    float min_dot = 1.0f;
+    for (const auto &normal: normals) { min_dot = std::min(min_dot, glm::dot(normal, meshlet.m_cone_axis)); }
+
+    // 锥半角接近或超过90度时，不存在能看到所有面背面的视点
+    constexpr float kMinConeDot = 0.1f;
+    if (min_dot <= kMinConeDot) { return; }
+    meshlet.m_cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+}
+
+}// namespace resource
+
+}// namespace saturn
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <engine_pch.hpp>
+
+#include "model.hpp"
+
+namespace saturn {
+
+namespace resource {
+
+/**
+ * @brief 将索引切分为meshlet，并计算每个meshlet的包围球与法线锥
+ *
+ * 按索引顺序贪心地收集三角形，顶点数或三角形数达到上限时开始新的meshlet。
+ * 索引已经过顶点cache优化，相邻的三角形在空间上也相邻，因此不需要重排索引，每个meshlet对应一段连续的索引
+ */
+class MeshletBuilder {
+public:
+    /**
+     * @param first_index 参与切分的索引范围在indices中的起始位置，结果中的m_first_index同样相对于indices
+     */
+    [[nodiscard]] static auto Build(const std::vector<Model::Vertex> &vertices, const std::vector<uint32_t> &indices,
+                                    uint32_t first_index, uint32_t index_count,
+                                    uint32_t max_vertices = Model::kMaxMeshletVertices,
+                                    uint32_t max_triangles = Model::kMaxMeshletTriangles)
+            -> std::vector<Model::Meshlet>;
+
+private:
+    static void ComputeBounds(const std::vector<Model::Vertex> &vertices, const std::vector<uint32_t> &indices,
+                              Model::Meshlet &meshlet);
+};
+
+}// namespace resource
+
+}// namespace saturn
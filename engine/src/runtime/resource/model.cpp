@@ -1,9 +1,13 @@
 #include "model.hpp"
+#include "mesh_optimizer.hpp"
+#include "mesh_simplifier.hpp"
+#include "meshlet_builder.hpp"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
 
 #define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtc/packing.hpp>
 #include <glm/gtx/hash.hpp>
 
 namespace std {
@@ -42,7 +46,104 @@ auto Model::Vertex::GetAttributeDescriptions() -> std::vector<VkVertexInputAttri
 }
 //----------------------------------------------------------------------------
 
-Model::Model(const std::string &file_path) {
+namespace {
+
+/**
+ * @brief 八面体编码，将单位法线映射到[-1, 1]^2
+ */
+auto OctEncode(glm::vec3 normal) -> glm::vec2 {
+    float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (length == 0.0f) { return glm::vec2(0.0f); }
+    normal /= length;
+
+    glm::vec2 encoded{normal.x, normal.y};
+    if (normal.z < 0.0f) {
+        encoded = (1.0f - glm::abs(glm::vec2(normal.y, normal.x))) *
+                  glm::vec2(normal.x >= 0.0f ? 1.0f : -1.0f, normal.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return encoded;
+}
+
+/**
+ * @brief tinyobjloader会为没有颜色的顶点填充默认的白色，只有出现非白色时才认为网格带有顶点颜色
+ */
+auto HasVertexColors(const tinyobj::attrib_t &attrib) -> bool {
+    return std::any_of(attrib.colors.begin(), attrib.colors.end(), [](float value) { return value != 1.0f; });
+}
+
+/**
+ * @brief 按位置合并接缝两侧的顶点后，每条边恰好被两个三角形共用时网格是闭合的
+ */
+auto IsClosedMesh(const std::vector<Model::Vertex> &vertices, const std::vector<uint32_t> &indices) -> bool {
+    if (indices.empty()) { return false; }
+
+    std::unordered_map<glm::vec3, uint32_t> unique_positions{};
+    std::vector<uint32_t> position_ids(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        position_ids[i] = unique_positions.try_emplace(vertices[i].m_position, unique_positions.size()).first->second;
+    }
+
+    std::unordered_map<uint64_t, uint32_t> edge_use_counts{};
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        for (int k = 0; k < 3; ++k) {
+            auto a = position_ids[indices[i + k]];
+            auto b = position_ids[indices[i + (k + 1) % 3]];
+            if (a > b) { std::swap(a, b); }
+            ++edge_use_counts[(static_cast<uint64_t>(a) << 32) | b];
+        }
+    }
+    return std::all_of(edge_use_counts.begin(), edge_use_counts.end(),
+                       [](const auto &edge_use_count) { return edge_use_count.second == 2; });
+}
+
+}// namespace
+
+auto Model::GetBindingDescriptions(VertexFormat format) -> std::vector<VkVertexInputBindingDescription> {
+    std::vector<VkVertexInputBindingDescription> binding_descriptions(1);
+    binding_descriptions[0].binding = 0;
+    binding_descriptions[0].stride = GetVertexStride(format);
+    binding_descriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    return binding_descriptions;
+}
+
+auto Model::GetAttributeDescriptions(VertexFormat format) -> std::vector<VkVertexInputAttributeDescription> {
+    if (format == VertexFormat::Full) { return Vertex::GetAttributeDescriptions(); }
+
+    // Packed格式没有颜色，location 1空缺
+    std::vector<VkVertexInputAttributeDescription> attribute_descriptions{};
+    attribute_descriptions.push_back({0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(PackedVertex, m_position)});
+    attribute_descriptions.push_back({2, 0, VK_FORMAT_R16G16_SNORM, offsetof(PackedVertex, m_normal)});
+    attribute_descriptions.push_back({3, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(PackedVertex, m_uv)});
+    return attribute_descriptions;
+}
+
+auto Model::GetVertexStride(VertexFormat format) -> uint32_t {
+    return format == VertexFormat::Full ? sizeof(Vertex) : sizeof(PackedVertex);
+}
+
+auto Model::GetPositionBindingDescriptions(VertexFormat format) -> std::vector<VkVertexInputBindingDescription> {
+    std::vector<VkVertexInputBindingDescription> binding_descriptions(1);
+    binding_descriptions[0].binding = 0;
+    binding_descriptions[0].stride = GetPositionStride(format);
+    binding_descriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    return binding_descriptions;
+}
+
+auto Model::GetPositionAttributeDescriptions(VertexFormat format) -> std::vector<VkVertexInputAttributeDescription> {
+    std::vector<VkVertexInputAttributeDescription> attribute_descriptions{};
+    if (format == VertexFormat::Full) {
+        attribute_descriptions.push_back({0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0});
+    } else {
+        attribute_descriptions.push_back({0, 0, VK_FORMAT_R16G16B16A16_UNORM, 0});
+    }
+    return attribute_descriptions;
+}
+
+auto Model::GetPositionStride(VertexFormat format) -> uint32_t {
+    return format == VertexFormat::Full ? sizeof(glm::vec3) : sizeof(PackedVertex::m_position);
+}
+
+Model::Model(const std::string &file_path, bool allow_packed) {
     tinyobj::attrib_t attrib;
     std::vector<tinyobj::shape_t> shapes;
     std::vector<tinyobj::material_t> materials;
@@ -56,6 +157,8 @@ Model::Model(const std::string &file_path) {
     m_vertices.clear();
     m_indices.clear();
 
+    bool has_vertex_colors = HasVertexColors(attrib);
+
     std::unordered_map<Vertex, uint32_t> unique_vertices{};
     for (const auto &shape: shapes) {
         for (const auto &index: shape.mesh.indices) {
@@ -68,11 +171,15 @@ Model::Model(const std::string &file_path) {
                         attrib.vertices[3 * index.vertex_index + 2],
                 };
 
-                vertex.m_color = {
-                        attrib.colors[3 * index.vertex_index + 0],
-                        attrib.colors[3 * index.vertex_index + 1],
-                        attrib.colors[3 * index.vertex_index + 2],
-                };
+                if (has_vertex_colors) {
+                    vertex.m_color = {
+                            attrib.colors[3 * index.vertex_index + 0],
+                            attrib.colors[3 * index.vertex_index + 1],
+                            attrib.colors[3 * index.vertex_index + 2],
+                    };
+                } else {
+                    vertex.m_color = glm::vec3(1.0f);
+                }
             }
 
             if (index.normal_index >= 0) {
@@ -114,7 +221,133 @@ Model::Model(const std::string &file_path) {
         vertex.m_position.y -= 1.0f;
     }
 
-    ENGINE_LOG_INFO("Load model: {}\n vertices count:{}", file_path, m_vertices.size());
+    // 重排索引与顶点，需在打包顶点之前完成
+    MeshOptimizer::Optimize(m_vertices, m_indices);
+
+    m_bounds_min = glm::vec3(std::numeric_limits<float>::max());
+    m_bounds_max = glm::vec3(std::numeric_limits<float>::lowest());
+    for (const auto &vertex: m_vertices) {
+        m_bounds_min = glm::min(m_bounds_min, vertex.m_position);
+        m_bounds_max = glm::max(m_bounds_max, vertex.m_position);
+    }
+
+    m_closed = IsClosedMesh(m_vertices, m_indices);
+    ENGINE_LOG_INFO("Load model: {}\n vertices count:{} closed:{}", file_path, m_vertices.size(), m_closed);
+
+    GenerateLods();
+    BuildMeshlets();
+
+    if (allow_packed && !has_vertex_colors && !m_vertices.empty()) {
+        m_vertex_format = VertexFormat::Packed;
+        PackVertices();
+
+        auto full_size = m_vertices.size() * sizeof(Vertex);
+        auto packed_size = m_packed_vertices.size() * sizeof(PackedVertex);
+        ENGINE_LOG_INFO("Packed vertex format: {} -> {} bytes per vertex, vertex buffer {:.1f} KB -> {:.1f} KB",
+                        sizeof(Vertex), sizeof(PackedVertex), full_size / 1024.0, packed_size / 1024.0);
+    }
+}
+
+auto Model::GetPositionScale() const -> glm::vec3 {
+    if (m_vertex_format == VertexFormat::Full) { return glm::vec3(1.0f); }
+    return m_bounds_max - m_bounds_min;
+}
+
+auto Model::GetPositionOffset() const -> glm::vec3 {
+    if (m_vertex_format == VertexFormat::Full) { return glm::vec3(0.0f); }
+    return m_bounds_min;
+}
+
+auto Model::GetVertexData() const -> const void * {
+    if (m_vertex_format == VertexFormat::Full) { return m_vertices.data(); }
+    return m_packed_vertices.data();
+}
+
+auto Model::GetVertexDataSize() const -> VkDeviceSize {
+    return static_cast<VkDeviceSize>(m_vertices.size()) * GetVertexStride(m_vertex_format);
+}
+
+void Model::GenerateLods() {
+    // 每一级的目标三角形数减半，允许的误差上限为包围盒对角线的5%
+    constexpr float kTargetRatio = 0.5f;
+    constexpr float kMaxRelativeError = 0.05f;
+    // 简化后剩余的三角形超过上一级的85%时，说明已无法继续有效简化
+    constexpr float kMinReduction = 0.85f;
+
+    m_lods.clear();
+    m_lods.push_back({0, static_cast<uint32_t>(m_indices.size()), 0.0f});
+
+    float max_error = glm::length(m_bounds_max - m_bounds_min) * kMaxRelativeError;
+    std::vector<uint32_t> lod_indices = m_indices;
+    float lod_error = 0.0f;
+
+    while (m_lods.size() < kMaxLodCount) {
+        auto target_index_count = static_cast<size_t>(static_cast<float>(lod_indices.size()) * kTargetRatio) / 3 * 3;
+        float simplify_error = 0.0f;
+        auto simplified = MeshSimplifier::Simplify(m_vertices, lod_indices, target_index_count, max_error,
+                                                   &simplify_error);
+        if (simplified.empty() ||
+            static_cast<float>(simplified.size()) > static_cast<float>(lod_indices.size()) * kMinReduction) {
+            break;
+        }
+
+        MeshOptimizer::OptimizeVertexCache(simplified, m_vertices.size());
+        // 逐级简化，误差累加作为相对LOD 0的上界
+        lod_error += simplify_error;
+
+        m_lods.push_back(
+                {static_cast<uint32_t>(m_indices.size()), static_cast<uint32_t>(simplified.size()), lod_error});
+        m_indices.insert(m_indices.end(), simplified.begin(), simplified.end());
+        lod_indices = std::move(simplified);
+    }
+
+    for (size_t i = 0; i < m_lods.size(); ++i) {
+        ENGINE_LOG_INFO("LOD {}: {} triangles, error {:.5f}", i, m_lods[i].m_index_count / 3, m_lods[i].m_error);
+    }
+}
+
+void Model::BuildMeshlets() {
+    m_meshlets.clear();
+    for (auto &lod: m_lods) {
+        auto meshlets = MeshletBuilder::Build(m_vertices, m_indices, lod.m_first_index, lod.m_index_count);
+        lod.m_first_meshlet = static_cast<uint32_t>(m_meshlets.size());
+        lod.m_meshlet_count = static_cast<uint32_t>(meshlets.size());
+        m_meshlets.insert(m_meshlets.end(), meshlets.begin(), meshlets.end());
+    }
+
+    ENGINE_LOG_INFO("Meshlets: {} in LOD 0, {} in total", m_lods.empty() ? 0 : m_lods.front().m_meshlet_count,
+                    m_meshlets.size());
+}
+
+auto Model::BuildPositionStream() const -> std::vector<uint8_t> {
+    auto stride = GetPositionStride(m_vertex_format);
+    std::vector<uint8_t> position_stream(m_vertices.size() * stride);
+
+    for (size_t i = 0; i < m_vertices.size(); ++i) {
+        const void *position = m_vertex_format == VertexFormat::Full
+                                       ? static_cast<const void *>(&m_vertices[i].m_position)
+                                       : static_cast<const void *>(&m_packed_vertices[i].m_position);
+        std::memcpy(position_stream.data() + i * stride, position, stride);
+    }
+    return position_stream;
+}
+
+void Model::PackVertices() {
+    auto extent = m_bounds_max - m_bounds_min;
+    // 退化的轴上所有顶点量化为0，避免除0
+    auto inv_extent = glm::vec3(extent.x > 0.0f ? 1.0f / extent.x : 0.0f, extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+                                extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+
+    m_packed_vertices.resize(m_vertices.size());
+    for (size_t i = 0; i < m_vertices.size(); ++i) {
+        const auto &vertex = m_vertices[i];
+        auto &packed_vertex = m_packed_vertices[i];
+
+        auto normalized_position = (vertex.m_position - m_bounds_min) * inv_extent;
+        packed_vertex.m_position = glm::packUnorm4x16(glm::vec4(normalized_position, 0.0f));
+        packed_vertex.m_normal = glm::packSnorm2x16(OctEncode(vertex.m_normal));
+        packed_vertex.m_uv = glm::packHalf2x16(vertex.m_uv);
+    }
 }
 
 }  // namespace resource
@@ -9,6 +9,16 @@ namespace saturn {
 
 namespace resource {
 
+/**
+ * @brief 顶点在GPU上的存储格式，导入模型时按网格选择
+ */
+enum class VertexFormat : uint8_t {
+    Full,  // 44字节，全部属性为fp32
+    Packed,// 16字节，位置为相对包围盒的unorm16，法线为八面体编码的snorm16x2，uv为half，不含颜色
+};
+
+constexpr size_t kVertexFormatCount = 2;
+
 class Model {
 public:
     struct Vertex {
@@ -27,10 +37,99 @@ public:
     };
 
 
-    explicit Model(const std::string &file_path);
+    /**
+     * @brief 量化后的顶点，position的w分量仅用于补齐对齐
+     */
+    struct PackedVertex {
+        uint64_t m_position;// R16G16B16A16_UNORM
+        uint32_t m_normal;  // R16G16_SNORM
+        uint32_t m_uv;      // R16G16_SFLOAT
+    };
+
+    /**
+     * @brief 一级LOD在m_indices中的索引范围，所有LOD共用同一组顶点
+     */
+    struct LodLevel {
+        uint32_t m_first_index = 0;
+        uint32_t m_index_count = 0;
+        float m_error = 0.0f;// 相对LOD 0的几何误差，单位与顶点位置相同
+        uint32_t m_first_meshlet = 0;
+        uint32_t m_meshlet_count = 0;
+    };
+
+    /**
+     * @brief 由相邻三角形组成的簇，索引范围连续，剔除时作为最小单位
+     */
+    struct Meshlet {
+        uint32_t m_first_index = 0;
+        uint32_t m_index_count = 0;
+        glm::vec3 m_center{0.0f};// 包围球
+        float m_radius = 0.0f;
+        glm::vec3 m_cone_axis{0.0f, 0.0f, 1.0f};// 法线锥，m_cone_cutoff为锥半角的正弦，大于1时表示不做背面剔除
+        float m_cone_cutoff = 2.0f;
+    };
+
+    static constexpr uint32_t kMaxLodCount = 5;
+    static constexpr uint32_t kMaxMeshletVertices = 64;
+    static constexpr uint32_t kMaxMeshletTriangles = 124;
+
+    static auto GetBindingDescriptions(VertexFormat format) -> std::vector<VkVertexInputBindingDescription>;
+    static auto GetAttributeDescriptions(VertexFormat format) -> std::vector<VkVertexInputAttributeDescription>;
+    static auto GetVertexStride(VertexFormat format) -> uint32_t;
+
+    /**
+     * @brief 只含位置的顶点流的布局，供shadowmap等只需要位置的pass使用
+     */
+    static auto GetPositionBindingDescriptions(VertexFormat format) -> std::vector<VkVertexInputBindingDescription>;
+    static auto GetPositionAttributeDescriptions(VertexFormat format)
+            -> std::vector<VkVertexInputAttributeDescription>;
+    static auto GetPositionStride(VertexFormat format) -> uint32_t;
+
+    /**
+     * @param allow_packed 为true时，不含顶点颜色的网格会使用VertexFormat::Packed
+     */
+    explicit Model(const std::string &file_path, bool allow_packed = true);
+
+    [[nodiscard]] auto GetVertexFormat() const -> VertexFormat { return m_vertex_format; }
+
+    /**
+     * @brief 网格闭合时背面总被正面遮挡，即使光栅化不剔除背面，也可以按法线锥剔除背对相机的meshlet
+     */
+    [[nodiscard]] auto IsClosed() const -> bool { return m_closed; }
+
+    /**
+     * @brief 解码位置时使用的缩放与偏移：position = quantized * scale + offset，Full格式下为单位变换
+     */
+    [[nodiscard]] auto GetPositionScale() const -> glm::vec3;
+    [[nodiscard]] auto GetPositionOffset() const -> glm::vec3;
+
+    /**
+     * @brief 按当前格式排布的顶点数据，用于上传到vertex buffer
+     */
+    [[nodiscard]] auto GetVertexData() const -> const void *;
+    [[nodiscard]] auto GetVertexDataSize() const -> VkDeviceSize;
+
+    /**
+     * @brief 从交错的顶点数据中拆出位置流，格式与GetPositionAttributeDescriptions一致
+     */
+    [[nodiscard]] auto BuildPositionStream() const -> std::vector<uint8_t>;
 
     std::vector<Vertex> m_vertices{};
-    std::vector<uint32_t> m_indices{};
+    std::vector<PackedVertex> m_packed_vertices{};
+    std::vector<uint32_t> m_indices{};// 依次存放各级LOD的索引
+    std::vector<LodLevel> m_lods{};
+    std::vector<Meshlet> m_meshlets{};// 依次存放各级LOD的meshlet
+
+    glm::vec3 m_bounds_min{0.0f};
+    glm::vec3 m_bounds_max{0.0f};
+
+private:
+    void GenerateLods();
+    void BuildMeshlets();
+    void PackVertices();
+
+    VertexFormat m_vertex_format = VertexFormat::Full;
+    bool m_closed = false;
 };
 
 }  // namespace resource